@@ -21,6 +21,7 @@
 #include <gralloctypes/Gralloc4.h>
 #include <log/log.h>
 #include <ui/GraphicBufferMapper.h>
+#include <utils/Timers.h>
 
 namespace android {
 namespace hardware {
@@ -33,20 +34,15 @@ using aidl::android::hardware::graphics::common::PlaneLayoutComponent;
 using aidl::android::hardware::graphics::common::PlaneLayoutComponentType;
 using aidl::android::hardware::graphics::common::Smpte2086;
 
-HandleImporter::HandleImporter() : mInitialized(false) {}
+HandleImporter::HandleImporter() {}
 
-void HandleImporter::initializeLocked() {
-    if (mInitialized) {
-        return;
-    }
-
-    GraphicBufferMapper::preloadHal();
-    mInitialized = true;
-    return;
+void HandleImporter::initialize() {
+    std::call_once(mInitFlag, []() { GraphicBufferMapper::preloadHal(); });
 }
 
-void HandleImporter::cleanup() {
-    mInitialized = false;
+HandleImporter::Shard& HandleImporter::getShard(buffer_handle_t buf) {
+    // Handles are heap allocated, drop the low bits which are the same for all of them
+    return mShards[(reinterpret_cast<uintptr_t>(buf) >> 4) % kNumShards];
 }
 
 bool HandleImporter::importBufferInternal(buffer_handle_t& handle) {
@@ -61,16 +57,115 @@ bool HandleImporter::importBufferInternal(buffer_handle_t& handle) {
     return true;
 }
 
+std::vector<PlaneLayout> getPlaneLayouts(buffer_handle_t& buf) {
+    std::vector<PlaneLayout> planeLayouts;
+    status_t status = GraphicBufferMapper::get().getPlaneLayouts(buf, &planeLayouts);
+    if (status != OK) {
+        ALOGE("%s: failed to get PlaneLayouts! Status %d", __FUNCTION__, status);
+    }
+
+    return planeLayouts;
+}
+
+// Follows the plane layout to android_ycbcr translation done by the mapper for lockYCbCr.
+// Returns false for layouts that cannot be described by android_ycbcr.
+bool HandleImporter::computeYCbCrOffsets(buffer_handle_t& buf, BufferInfo* info) {
+    std::vector<PlaneLayout> planeLayouts = getPlaneLayouts(buf);
+    if (planeLayouts.empty()) {
+        return false;
+    }
+
+    bool hasY = false, hasCb = false, hasCr = false;
+    for (const auto& planeLayout : planeLayouts) {
+        for (const auto& component : planeLayout.components) {
+            if (!gralloc4::isStandardPlaneLayoutComponentType(component.type)) {
+                continue;
+            }
+            if (component.offsetInBits % 8 != 0 || component.sizeInBits != 8) {
+                return false;
+            }
+            size_t offset = planeLayout.offsetInBytes + component.offsetInBits / 8;
+            switch (static_cast<PlaneLayoutComponentType>(component.type.value)) {
+                case PlaneLayoutComponentType::Y:
+                    if (hasY || planeLayout.sampleIncrementInBits != 8) {
+                        return false;
+                    }
+                    info->yOffset = offset;
+                    info->yStride = planeLayout.strideInBytes;
+                    hasY = true;
+                    break;
+                case PlaneLayoutComponentType::CB:
+                case PlaneLayoutComponentType::CR: {
+                    if (planeLayout.sampleIncrementInBits % 8 != 0) {
+                        return false;
+                    }
+                    size_t chromaStep = planeLayout.sampleIncrementInBits / 8;
+                    if ((hasCb || hasCr) && (info->cStride != planeLayout.strideInBytes ||
+                                             info->chromaStep != chromaStep)) {
+                        return false;
+                    }
+                    info->cStride = planeLayout.strideInBytes;
+                    info->chromaStep = chromaStep;
+                    if (static_cast<PlaneLayoutComponentType>(component.type.value) ==
+                        PlaneLayoutComponentType::CB) {
+                        if (hasCb) {
+                            return false;
+                        }
+                        info->cbOffset = offset;
+                        hasCb = true;
+                    } else {
+                        if (hasCr) {
+                            return false;
+                        }
+                        info->crOffset = offset;
+                        hasCr = true;
+                    }
+                } break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    return hasY && hasCb && hasCr;
+}
+
 android_ycbcr HandleImporter::lockYCbCr(buffer_handle_t& buf, uint64_t cpuUsage,
                                         const android::Rect& accessRegion) {
-    Mutex::Autolock lock(mLock);
+    initialize();
+    Shard& shard = getShard(buf);
+    std::lock_guard<std::mutex> lock(shard.lock);
+
+    android_ycbcr layout = {};
+    auto it = shard.buffers.find(buf);
+    if (it != shard.buffers.end()) {
+        BufferInfo& info = it->second;
+        if (info.ycbcrState == BufferInfo::State::UNKNOWN) {
+            mLayoutCacheMisses++;
+            info.ycbcrState = computeYCbCrOffsets(buf, &info) ? BufferInfo::State::CACHED
+                                                              : BufferInfo::State::UNCACHEABLE;
+        } else if (info.ycbcrState == BufferInfo::State::CACHED) {
+            mLayoutCacheHits++;
+        }
 
-    if (!mInitialized) {
-        initializeLocked();
+        if (info.ycbcrState == BufferInfo::State::CACHED) {
+            uint8_t* base = static_cast<uint8_t*>(lockLocked(buf, cpuUsage, accessRegion));
+            if (base != nullptr) {
+                layout.y = base + info.yOffset;
+                layout.cb = base + info.cbOffset;
+                layout.cr = base + info.crOffset;
+                layout.ystride = info.yStride;
+                layout.cstride = info.cStride;
+                layout.chroma_step = info.chromaStep;
+            }
+            return layout;
+        }
     }
-    android_ycbcr layout;
 
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
     status_t status = GraphicBufferMapper::get().lockYCbCr(buf, cpuUsage, accessRegion, &layout);
+    mTotalLockTimeNs += systemTime(SYSTEM_TIME_MONOTONIC) - start;
+    mLockCount++;
 
     if (status != OK) {
         ALOGE("%s: failed to lockYCbCr error %d!", __FUNCTION__, status);
@@ -79,16 +174,6 @@ android_ycbcr HandleImporter::lockYCbCr(buffer_handle_t& buf, uint64_t cpuUsage,
     return layout;
 }
 
-std::vector<PlaneLayout> getPlaneLayouts(buffer_handle_t& buf) {
-    std::vector<PlaneLayout> planeLayouts;
-    status_t status = GraphicBufferMapper::get().getPlaneLayouts(buf, &planeLayouts);
-    if (status != OK) {
-        ALOGE("%s: failed to get PlaneLayouts! Status %d", __FUNCTION__, status);
-    }
-
-    return planeLayouts;
-}
-
 // In IComposer, any buffer_handle_t is owned by the caller and we need to
 // make a clone for hwcomposer2.  We also need to translate empty handle
 // to nullptr.  This function does that, in-place.
@@ -98,12 +183,15 @@ bool HandleImporter::importBuffer(buffer_handle_t& handle) {
         return true;
     }
 
-    Mutex::Autolock lock(mLock);
-    if (!mInitialized) {
-        initializeLocked();
+    initialize();
+    if (!importBufferInternal(handle)) {
+        return false;
     }
 
-    return importBufferInternal(handle);
+    Shard& shard = getShard(handle);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    shard.buffers[handle] = BufferInfo();
+    return true;
 }
 
 void HandleImporter::freeBuffer(buffer_handle_t handle) {
@@ -111,10 +199,11 @@ void HandleImporter::freeBuffer(buffer_handle_t handle) {
         return;
     }
 
-    Mutex::Autolock lock(mLock);
-    if (!mInitialized) {
-        initializeLocked();
-    }
+    initialize();
+    Shard& shard = getShard(handle);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    // The handle address may be reused by a later import, drop the cached layout first
+    shard.buffers.erase(handle);
 
     status_t status = GraphicBufferMapper::get().freeBuffer(handle);
     if (status != OK) {
@@ -152,14 +241,19 @@ void* HandleImporter::lock(buffer_handle_t& buf, uint64_t cpuUsage, size_t size)
 
 void* HandleImporter::lock(buffer_handle_t& buf, uint64_t cpuUsage,
                            const android::Rect& accessRegion) {
-    Mutex::Autolock lock(mLock);
-
-    if (!mInitialized) {
-        initializeLocked();
-    }
+    initialize();
+    Shard& shard = getShard(buf);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    return lockLocked(buf, cpuUsage, accessRegion);
+}
 
+void* HandleImporter::lockLocked(buffer_handle_t& buf, uint64_t cpuUsage,
+                                 const android::Rect& accessRegion) {
     void* ret = nullptr;
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
     status_t status = GraphicBufferMapper::get().lock(buf, cpuUsage, accessRegion, &ret);
+    mTotalLockTimeNs += systemTime(SYSTEM_TIME_MONOTONIC) - start;
+    mLockCount++;
     if (status != OK) {
         ALOGE("%s: failed to lock error %d!", __FUNCTION__, status);
     }
@@ -176,10 +270,15 @@ status_t HandleImporter::getMonoPlanarStrideBytes(buffer_handle_t& buf, uint32_t
         return BAD_VALUE;
     }
 
-    Mutex::Autolock lock(mLock);
+    initialize();
+    Shard& shard = getShard(buf);
+    std::lock_guard<std::mutex> lock(shard.lock);
 
-    if (!mInitialized) {
-        initializeLocked();
+    auto it = shard.buffers.find(buf);
+    if (it != shard.buffers.end() && it->second.strideCached) {
+        mLayoutCacheHits++;
+        *stride = it->second.monoPlanarStrideBytes;
+        return OK;
     }
 
     std::vector<PlaneLayout> planeLayouts = getPlaneLayouts(buf);
@@ -189,6 +288,11 @@ status_t HandleImporter::getMonoPlanarStrideBytes(buffer_handle_t& buf, uint32_t
     }
 
     *stride = planeLayouts[0].strideInBytes;
+    if (it != shard.buffers.end()) {
+        mLayoutCacheMisses++;
+        it->second.strideCached = true;
+        it->second.monoPlanarStrideBytes = *stride;
+    }
 
     return OK;
 }
@@ -196,6 +300,8 @@ status_t HandleImporter::getMonoPlanarStrideBytes(buffer_handle_t& buf, uint32_t
 int HandleImporter::unlock(buffer_handle_t& buf) {
     int releaseFence = -1;
 
+    Shard& shard = getShard(buf);
+    std::lock_guard<std::mutex> lock(shard.lock);
     status_t status = GraphicBufferMapper::get().unlockAsync(buf, &releaseFence);
     if (status != OK) {
         ALOGE("%s: failed to unlock error %d!", __FUNCTION__, status);
@@ -204,12 +310,15 @@ int HandleImporter::unlock(buffer_handle_t& buf) {
     return releaseFence;
 }
 
-bool HandleImporter::isSmpte2086Present(const buffer_handle_t& buf) {
-    Mutex::Autolock lock(mLock);
+HandleImporter::Stats HandleImporter::getStats() const {
+    return Stats{.layoutCacheHits = mLayoutCacheHits.load(),
+                 .layoutCacheMisses = mLayoutCacheMisses.load(),
+                 .lockCount = mLockCount.load(),
+                 .totalLockTimeNs = mTotalLockTimeNs.load()};
+}
 
-    if (!mInitialized) {
-        initializeLocked();
-    }
+bool HandleImporter::isSmpte2086Present(const buffer_handle_t& buf) {
+    initialize();
     std::optional<ui::Smpte2086> metadata;
     status_t status = GraphicBufferMapper::get().getSmpte2086(buf, &metadata);
     if (status != OK) {
@@ -221,11 +330,7 @@ bool HandleImporter::isSmpte2086Present(const buffer_handle_t& buf) {
 }
 
 bool HandleImporter::isSmpte2094_10Present(const buffer_handle_t& buf) {
-    Mutex::Autolock lock(mLock);
-
-    if (!mInitialized) {
-        initializeLocked();
-    }
+    initialize();
 
     std::optional<std::vector<uint8_t>> metadata;
     status_t status = GraphicBufferMapper::get().getSmpte2094_10(buf, &metadata);
@@ -238,11 +343,7 @@ bool HandleImporter::isSmpte2094_10Present(const buffer_handle_t& buf) {
 }
 
 bool HandleImporter::isSmpte2094_40Present(const buffer_handle_t& buf) {
-    Mutex::Autolock lock(mLock);
-
-    if (!mInitialized) {
-        initializeLocked();
-    }
+    initialize();
 
     std::optional<std::vector<uint8_t>> metadata;
     status_t status = GraphicBufferMapper::get().getSmpte2094_40(buf, &metadata);
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <CameraMetadata.h>
+#include <log/log.h>
+#include <system/camera_metadata.h>
+
+#include <string.h>
+
+namespace android::hardware::camera::common::helper {
+namespace {
+
+// Measures the per-frame cost of turning the settings of a repeating request into a capture
+// result, as the external camera HAL does in fillCaptureResult:
+//  - ByTag updates each result tag with update(), which is what the HAL does.
+//  - FromTemplate compares the settings with those of the previous frame, clones the result built
+//    for them, and only updates the per-frame tags. update() overwrites an entry of the same size
+//    in place, so this is the cost of reusing a result template across frames.
+
+void check(status_t res) {
+    LOG_ALWAYS_FATAL_IF(res != OK, "metadata update failed: %d", res);
+}
+
+CameraMetadata createSettings() {
+    CameraMetadata settings;
+    const uint8_t controlMode = ANDROID_CONTROL_MODE_AUTO;
+    const uint8_t aeMode = ANDROID_CONTROL_AE_MODE_ON;
+    const uint8_t afMode = ANDROID_CONTROL_AF_MODE_CONTINUOUS_PICTURE;
+    const uint8_t awbMode = ANDROID_CONTROL_AWB_MODE_AUTO;
+    const uint8_t captureIntent = ANDROID_CONTROL_CAPTURE_INTENT_PREVIEW;
+    const uint8_t afTrigger = ANDROID_CONTROL_AF_TRIGGER_IDLE;
+    const int32_t fpsRange[] = {15, 30};
+    const int32_t aeCompensation = 0;
+    const uint8_t antibanding = ANDROID_CONTROL_AE_ANTIBANDING_MODE_AUTO;
+    const uint8_t videoStabilization = ANDROID_CONTROL_VIDEO_STABILIZATION_MODE_OFF;
+    const uint8_t noiseReduction = ANDROID_NOISE_REDUCTION_MODE_FAST;
+    const uint8_t edgeMode = ANDROID_EDGE_MODE_FAST;
+    const uint8_t flashMode = ANDROID_FLASH_MODE_OFF;
+    const int32_t jpegOrientation = 0;
+    const uint8_t jpegQuality = 90;
+    check(settings.update(ANDROID_CONTROL_MODE, &controlMode, 1));
+    check(settings.update(ANDROID_CONTROL_AE_MODE, &aeMode, 1));
+    check(settings.update(ANDROID_CONTROL_AF_MODE, &afMode, 1));
+    check(settings.update(ANDROID_CONTROL_AWB_MODE, &awbMode, 1));
+    check(settings.update(ANDROID_CONTROL_CAPTURE_INTENT, &captureIntent, 1));
+    check(settings.update(ANDROID_CONTROL_AF_TRIGGER, &afTrigger, 1));
+    check(settings.update(ANDROID_CONTROL_AE_TARGET_FPS_RANGE, fpsRange, 2));
+    check(settings.update(ANDROID_CONTROL_AE_EXPOSURE_COMPENSATION, &aeCompensation, 1));
+    check(settings.update(ANDROID_CONTROL_AE_ANTIBANDING_MODE, &antibanding, 1));
+    check(settings.update(ANDROID_CONTROL_VIDEO_STABILIZATION_MODE, &videoStabilization, 1));
+    check(settings.update(ANDROID_NOISE_REDUCTION_MODE, &noiseReduction, 1));
+    check(settings.update(ANDROID_EDGE_MODE, &edgeMode, 1));
+    check(settings.update(ANDROID_FLASH_MODE, &flashMode, 1));
+    check(settings.update(ANDROID_JPEG_ORIENTATION, &jpegOrientation, 1));
+    check(settings.update(ANDROID_JPEG_QUALITY, &jpegQuality, 1));
+    return settings;
+}
+
+// The tags fillCaptureResult and fillCaptureResultCommon add to the settings.
+void fillResult(CameraMetadata& md, int64_t timestamp) {
+    const uint8_t afState = ANDROID_CONTROL_AF_STATE_INACTIVE;
+    const uint8_t aeState = ANDROID_CONTROL_AE_STATE_CONVERGED;
+    const uint8_t aeLock = ANDROID_CONTROL_AE_LOCK_OFF;
+    const uint8_t awbState = ANDROID_CONTROL_AWB_STATE_CONVERGED;
+    const uint8_t awbLock = ANDROID_CONTROL_AWB_LOCK_OFF;
+    const uint8_t flashState = ANDROID_FLASH_STATE_UNAVAILABLE;
+    const uint8_t pipelineDepth = 4;
+    const int32_t cropRegion[] = {0, 0, 1920, 1080};
+    const uint8_t lensShadingMapMode = ANDROID_STATISTICS_LENS_SHADING_MAP_MODE_OFF;
+    const uint8_t sceneFlicker = ANDROID_STATISTICS_SCENE_FLICKER_NONE;
+    check(md.update(ANDROID_CONTROL_AF_STATE, &afState, 1));
+    check(md.update(ANDROID_CONTROL_AE_STATE, &aeState, 1));
+    check(md.update(ANDROID_CONTROL_AE_LOCK, &aeLock, 1));
+    check(md.update(ANDROID_CONTROL_AWB_STATE, &awbState, 1));
+    check(md.update(ANDROID_CONTROL_AWB_LOCK, &awbLock, 1));
+    check(md.update(ANDROID_FLASH_STATE, &flashState, 1));
+    check(md.update(ANDROID_REQUEST_PIPELINE_DEPTH, &pipelineDepth, 1));
+    check(md.update(ANDROID_SCALER_CROP_REGION, cropRegion, 4));
+    check(md.update(ANDROID_SENSOR_TIMESTAMP, &timestamp, 1));
+    check(md.update(ANDROID_STATISTICS_LENS_SHADING_MAP_MODE, &lensShadingMapMode, 1));
+    check(md.update(ANDROID_STATISTICS_SCENE_FLICKER, &sceneFlicker, 1));
+}
+
+bool contentsEqual(const CameraMetadata& a, const CameraMetadata& b) {
+    const camera_metadata_t* bufferA = a.getAndLock();
+    const camera_metadata_t* bufferB = b.getAndLock();
+    const size_t size = get_camera_metadata_compact_size(bufferA);
+    const bool equal = a.entryCount() == b.entryCount() &&
+                       size == get_camera_metadata_compact_size(bufferB) &&
+                       memcmp(bufferA, bufferB, size) == 0;
+    a.unlock(bufferA);
+    b.unlock(bufferB);
+    return equal;
+}
+
+void BM_FillResultByTag(benchmark::State& state) {
+    const CameraMetadata settings = createSettings();
+    int64_t timestamp = 0;
+    for (auto _ : state) {
+        CameraMetadata md = settings;
+        fillResult(md, ++timestamp);
+        benchmark::DoNotOptimize(md.entryCount());
+    }
+}
+
+void BM_FillResultFromTemplate(benchmark::State& state) {
+    const CameraMetadata settings = createSettings();
+    const CameraMetadata templateSettings = settings;
+    CameraMetadata resultTemplate = settings;
+    fillResult(resultTemplate, 0);
+
+    const uint8_t afState = ANDROID_CONTROL_AF_STATE_INACTIVE;
+    int64_t timestamp = 0;
+    for (auto _ : state) {
+        CameraMetadata md = settings;
+        LOG_ALWAYS_FATAL_IF(!contentsEqual(md, templateSettings), "settings changed");
+        md = resultTemplate;
+        ++timestamp;
+        check(md.update(ANDROID_CONTROL_AF_STATE, &afState, 1));
+        check(md.update(ANDROID_SENSOR_TIMESTAMP, &timestamp, 1));
+        benchmark::DoNotOptimize(md.entryCount());
+    }
+}
+
+BENCHMARK(BM_FillResultByTag);
+BENCHMARK(BM_FillResultFromTemplate);
+
+}  // namespace
+}  // namespace android::hardware::camera::common::helper
+
+BENCHMARK_MAIN();
@@ -20,7 +20,12 @@
 #include <cutils/native_handle.h>
 #include <system/graphics.h>
 #include <ui/Rect.h>
+#include <utils/Errors.h>
 #include <utils/Mutex.h>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
 
 namespace android {
 namespace hardware {
@@ -29,10 +34,22 @@ namespace common {
 namespace helper {
 
 // Borrowed from graphics HAL. Use this until gralloc mapper HAL is working
+//
+// Thread safe. Buffers are tracked in a fixed number of shards, each with its own lock, so
+// sessions locking different buffers do not contend. Buffers imported through importBuffer have
+// their YCbCr plane layout and stride cached until freeBuffer, so repeated lockYCbCr calls on
+// the same buffer skip the mapper's plane layout query.
 class HandleImporter {
   public:
     HandleImporter();
 
+    struct Stats {
+        uint64_t layoutCacheHits;
+        uint64_t layoutCacheMisses;
+        uint64_t lockCount;
+        uint64_t totalLockTimeNs;  // Time spent in mapper lock calls
+    };
+
     // In IComposer, any buffer_handle_t is owned by the caller and we need to
     // make a clone for hwcomposer2.  We also need to translate empty handle
     // to nullptr.  This function does that, in-place.
@@ -61,15 +78,46 @@ class HandleImporter {
     bool isSmpte2094_10Present(const buffer_handle_t& buf);
     bool isSmpte2094_40Present(const buffer_handle_t& buf);
 
+    Stats getStats() const;
+
   private:
-    void initializeLocked();
-    void cleanup();
+    // Layout information of an imported buffer, filled on first use
+    struct BufferInfo {
+        enum class State { UNKNOWN, CACHED, UNCACHEABLE };
+        State ycbcrState = State::UNKNOWN;
+        // Plane offsets from the address returned by lock()
+        size_t yOffset = 0;
+        size_t cbOffset = 0;
+        size_t crOffset = 0;
+        size_t yStride = 0;
+        size_t cStride = 0;
+        size_t chromaStep = 0;
+
+        bool strideCached = false;
+        uint32_t monoPlanarStrideBytes = 0;
+    };
+
+    struct Shard {
+        std::mutex lock;  // Serializes mapper calls on the buffers of this shard
+        std::unordered_map<buffer_handle_t, BufferInfo> buffers;
+    };
+
+    static constexpr size_t kNumShards = 16;
+
+    void initialize();
+    Shard& getShard(buffer_handle_t buf);
+    void* lockLocked(buffer_handle_t& buf, uint64_t cpuUsage, const android::Rect& accessRegion);
+    static bool computeYCbCrOffsets(buffer_handle_t& buf, BufferInfo* info);
 
     bool importBufferInternal(buffer_handle_t& handle);
-    int unlockInternal(buffer_handle_t& buf);
 
-    Mutex mLock;
-    bool mInitialized;
+    std::once_flag mInitFlag;
+    std::array<Shard, kNumShards> mShards;
+
+    std::atomic<uint64_t> mLayoutCacheHits = 0;
+    std::atomic<uint64_t> mLayoutCacheMisses = 0;
+    std::atomic<uint64_t> mLockCount = 0;
+    std::atomic<uint64_t> mTotalLockTimeNs = 0;
 };
 
 }  // namespace helper
@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "ExtCamCapStore"
+// #define LOG_NDEBUG 0
+#include <log/log.h>
+
+#include "ExternalCameraCapabilityStore.h"
+
+#include <ExternalCameraDevice.h>
+#include <android-base/file.h>
+#include <android-base/strings.h>
+#include <cctype>
+#include <cstring>
+#include <regex>
+
+namespace android {
+namespace hardware {
+namespace camera {
+namespace device {
+namespace implementation {
+
+namespace {
+constexpr uint32_t kMagic = 0x53434345;  // 'ECCS'
+constexpr uint32_t kVersion = 1;
+
+const std::regex kDevicePathRE("/dev/(video[0-9]+)");
+
+std::string readSysfsAttr(const std::string& path) {
+    std::string value;
+    if (!base::ReadFileToString(path, &value)) {
+        return "";
+    }
+    return base::Trim(value);
+}
+
+// Keep only characters that are safe in a file name
+std::string sanitize(const std::string& str) {
+    std::string out;
+    for (char c : str) {
+        out += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    }
+    return out;
+}
+
+std::string getConfigSignature(const ExternalCameraConfig& cfg) {
+    std::string sig = ExternalCameraDevice::kDeviceVersion;
+    sig += "/jpeg:" + std::to_string(cfg.maxJpegBufSize);
+    sig += "/orientation:" + std::to_string(cfg.orientation);
+    sig += "/min:" + std::to_string(cfg.minStreamSize.width) + "x" +
+           std::to_string(cfg.minStreamSize.height);
+    sig += "/depth:" + std::to_string(cfg.depthEnabled);
+    for (const auto& limit : cfg.fpsLimits) {
+        sig += "/fps:" + std::to_string(limit.size.width) + "x" +
+               std::to_string(limit.size.height) + "@" + std::to_string(limit.fpsUpperBound);
+    }
+    for (const auto& limit : cfg.depthFpsLimits) {
+        sig += "/depthfps:" + std::to_string(limit.size.width) + "x" +
+               std::to_string(limit.size.height) + "@" + std::to_string(limit.fpsUpperBound);
+    }
+    return sig;
+}
+
+template <typename T>
+void append(std::string* out, const T& value) {
+    out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+class Reader {
+  public:
+    explicit Reader(const std::string& data) : mData(data) {}
+
+    template <typename T>
+    bool read(T* value) {
+        return readBytes(value, sizeof(T));
+    }
+
+    bool readBytes(void* out, size_t size) {
+        if (mData.size() - mOffset < size) {
+            return false;
+        }
+        memcpy(out, mData.data() + mOffset, size);
+        mOffset += size;
+        return true;
+    }
+
+  private:
+    const std::string& mData;
+    size_t mOffset = 0;
+};
+}  // anonymous namespace
+
+ExternalCameraCapabilityStore::ExternalCameraCapabilityStore(const std::string& dir,
+                                                             const ExternalCameraConfig& cfg)
+    : mDir(dir), mConfigSignature(getConfigSignature(cfg)) {}
+
+std::string ExternalCameraCapabilityStore::getDeviceKey(const std::string& devicePath) {
+    std::smatch sm;
+    if (!std::regex_match(devicePath, sm, kDevicePathRE)) {
+        return "";
+    }
+
+    // The video4linux device links to the USB interface, whose parent is the USB device
+    std::string usbDevice;
+    std::string interfacePath = "/sys/class/video4linux/" + sm[1].str() + "/device";
+    if (!base::Realpath(interfacePath, &usbDevice)) {
+        return "";
+    }
+    usbDevice = base::Dirname(usbDevice);
+
+    std::string vid = readSysfsAttr(usbDevice + "/idVendor");
+    std::string pid = readSysfsAttr(usbDevice + "/idProduct");
+    if (vid.empty() || pid.empty()) {
+        return "";
+    }
+    // A device may expose several video nodes, include the interface to tell them apart
+    std::string key = vid + "_" + pid + "_" + readSysfsAttr(usbDevice + "/serial") + "_" +
+                      readSysfsAttr(interfacePath + "/bInterfaceNumber");
+    return sanitize(key);
+}
+
+std::string ExternalCameraCapabilityStore::getEntryPath(const std::string& key) const {
+    return mDir + "/" + key + ".caps";
+}
+
+std::shared_ptr<const ExternalCameraCapabilities> ExternalCameraCapabilityStore::load(
+        const std::string& key) {
+    if (key.empty()) {
+        return nullptr;
+    }
+
+    std::string data;
+    {
+        std::lock_guard<std::mutex> lk(mLock);
+        if (!base::ReadFileToString(getEntryPath(key), &data)) {
+            ALOGV("%s: no stored capabilities for %s", __FUNCTION__, key.c_str());
+            return nullptr;
+        }
+    }
+
+    Reader reader(data);
+    uint32_t magic, version, sigSize;
+    if (!reader.read(&magic) || !reader.read(&version) || magic != kMagic ||
+        version != kVersion || !reader.read(&sigSize) || sigSize != mConfigSignature.size()) {
+        ALOGW("%s: stored capabilities for %s are stale, ignoring", __FUNCTION__, key.c_str());
+        return nullptr;
+    }
+    std::string sig(sigSize, '\0');
+    if (!reader.readBytes(sig.data(), sigSize) || sig != mConfigSignature) {
+        ALOGW("%s: stored capabilities for %s are stale, ignoring", __FUNCTION__, key.c_str());
+        return nullptr;
+    }
+
+    auto caps = std::make_shared<ExternalCameraCapabilities>();
+    int32_t croppingType;
+    uint32_t numFormats;
+    if (!reader.read(&croppingType) || !reader.read(&numFormats)) {
+        ALOGE("%s: truncated entry for %s", __FUNCTION__, key.c_str());
+        return nullptr;
+    }
+    caps->croppingType = croppingType == VERTICAL ? VERTICAL : HORIZONTAL;
+    for (uint32_t i = 0; i < numFormats; i++) {
+        SupportedV4L2Format fmt;
+        uint32_t numRates;
+        if (!reader.read(&fmt.width) || !reader.read(&fmt.height) || !reader.read(&fmt.fourcc) ||
+            !reader.read(&numRates)) {
+            ALOGE("%s: truncated entry for %s", __FUNCTION__, key.c_str());
+            return nullptr;
+        }
+        for (uint32_t j = 0; j < numRates; j++) {
+            SupportedV4L2Format::FrameRate rate;
+            if (!reader.read(&rate.durationNumerator) || !reader.read(&rate.durationDenominator)) {
+                ALOGE("%s: truncated entry for %s", __FUNCTION__, key.c_str());
+                return nullptr;
+            }
+            fmt.frameRates.push_back(rate);
+        }
+        caps->supportedFormats.push_back(std::move(fmt));
+    }
+
+    uint32_t metadataSize;
+    if (!reader.read(&metadataSize) || metadataSize == 0) {
+        ALOGE("%s: truncated entry for %s", __FUNCTION__, key.c_str());
+        return nullptr;
+    }
+    std::vector<uint8_t> metadata(metadataSize);
+    if (!reader.readBytes(metadata.data(), metadataSize)) {
+        ALOGE("%s: truncated entry for %s", __FUNCTION__, key.c_str());
+        return nullptr;
+    }
+    camera_metadata_t* buffer = allocate_copy_camera_metadata_checked(
+            reinterpret_cast<const camera_metadata_t*>(metadata.data()), metadataSize);
+    if (buffer == nullptr) {
+        ALOGE("%s: invalid characteristics stored for %s", __FUNCTION__, key.c_str());
+        return nullptr;
+    }
+    caps->characteristics.acquire(buffer);
+
+    if (caps->supportedFormats.empty()) {
+        return nullptr;
+    }
+    return caps;
+}
+
+bool ExternalCameraCapabilityStore::save(const std::string& key,
+                                         const ExternalCameraCapabilities& capabilities) {
+    if (key.empty()) {
+        return false;
+    }
+
+    std::string data;
+    append(&data, kMagic);
+    append(&data, kVersion);
+    append(&data, static_cast<uint32_t>(mConfigSignature.size()));
+    data += mConfigSignature;
+    append(&data, static_cast<int32_t>(capabilities.croppingType));
+    append(&data, static_cast<uint32_t>(capabilities.supportedFormats.size()));
+    for (const auto& fmt : capabilities.supportedFormats) {
+        append(&data, fmt.width);
+        append(&data, fmt.height);
+        append(&data, fmt.fourcc);
+        append(&data, static_cast<uint32_t>(fmt.frameRates.size()));
+        for (const auto& rate : fmt.frameRates) {
+            append(&data, rate.durationNumerator);
+            append(&data, rate.durationDenominator);
+        }
+    }
+    const camera_metadata_t* metadata = capabilities.characteristics.getAndLock();
+    uint32_t metadataSize = static_cast<uint32_t>(get_camera_metadata_compact_size(metadata));
+    std::vector<uint8_t> compact(metadataSize);
+    bool copied = copy_camera_metadata(compact.data(), metadataSize, metadata) != nullptr;
+    capabilities.characteristics.unlock(metadata);
+    if (!copied) {
+        ALOGE("%s: failed to copy characteristics of %s", __FUNCTION__, key.c_str());
+        return false;
+    }
+    append(&data, metadataSize);
+    data.append(reinterpret_cast<const char*>(compact.data()), metadataSize);
+
+    std::lock_guard<std::mutex> lk(mLock);
+    // Write to a temporary file and rename so a crash never leaves a partial entry behind
+    std::string path = getEntryPath(key);
+    std::string tmpPath = path + ".tmp";
+    if (!base::WriteStringToFile(data, tmpPath)) {
+        ALOGE("%s: failed to write %s: %s", __FUNCTION__, tmpPath.c_str(), strerror(errno));
+        return false;
+    }
+    if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+        ALOGE("%s: failed to rename %s: %s", __FUNCTION__, tmpPath.c_str(), strerror(errno));
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace implementation
+}  // namespace device
+}  // namespace camera
+}  // namespace hardware
+}  // namespace android
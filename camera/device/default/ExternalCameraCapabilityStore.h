@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HARDWARE_INTERFACES_CAMERA_DEVICE_DEFAULT_EXTERNALCAMERACAPABILITYSTORE_H_
+#define HARDWARE_INTERFACES_CAMERA_DEVICE_DEFAULT_EXTERNALCAMERACAPABILITYSTORE_H_
+
+#include <ExternalCameraUtils.h>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace android {
+namespace hardware {
+namespace camera {
+namespace device {
+namespace implementation {
+
+using ::android::hardware::camera::external::common::ExternalCameraConfig;
+
+// Persists probed capabilities of external cameras so that reconnecting a known camera, or
+// restarting the provider, does not require enumerating the V4L2 device again.
+//
+// Entries are keyed by the USB identity (vendor id, product id and serial number) of the
+// device. Each entry also records the parts of ExternalCameraConfig that affect probing, and
+// is ignored if they no longer match.
+class ExternalCameraCapabilityStore {
+  public:
+    ExternalCameraCapabilityStore(const std::string& dir, const ExternalCameraConfig& cfg);
+
+    // Returns the store key of a V4L2 device node such as "/dev/video0", or an empty string
+    // if the device has no USB identity.
+    static std::string getDeviceKey(const std::string& devicePath);
+
+    // Returns nullptr if there is no valid entry for the key
+    std::shared_ptr<const ExternalCameraCapabilities> load(const std::string& key);
+
+    // Atomically replaces the entry for the key
+    bool save(const std::string& key, const ExternalCameraCapabilities& capabilities);
+
+  private:
+    std::string getEntryPath(const std::string& key) const;
+
+    const std::string mDir;
+    const std::string mConfigSignature;
+    std::mutex mLock;  // Serializes file access
+};
+
+}  // namespace implementation
+}  // namespace device
+}  // namespace camera
+}  // namespace hardware
+}  // namespace android
+
+#endif  // HARDWARE_INTERFACES_CAMERA_DEVICE_DEFAULT_EXTERNALCAMERACAPABILITYSTORE_H_
@@ -61,8 +61,29 @@ ExternalCameraDevice::ExternalCameraDevice(const std::string& devicePath,
     }
 }
 
+ExternalCameraDevice::ExternalCameraDevice(const std::string& devicePath,
+                                           const ExternalCameraConfig& config,
+                                           const ExternalCameraCapabilities& capabilities)
+    : ExternalCameraDevice(devicePath, config) {
+    mCameraCharacteristics = capabilities.characteristics;
+    mSupportedFormats = capabilities.supportedFormats;
+    mCroppingType = capabilities.croppingType;
+}
+
 ExternalCameraDevice::~ExternalCameraDevice() {}
 
+std::shared_ptr<const ExternalCameraCapabilities> ExternalCameraDevice::getCapabilities() {
+    Mutex::Autolock _l(mLock);
+    if (isInitFailedLocked()) {
+        return nullptr;
+    }
+    auto caps = std::make_shared<ExternalCameraCapabilities>();
+    caps->characteristics = mCameraCharacteristics;
+    caps->supportedFormats = mSupportedFormats;
+    caps->croppingType = mCroppingType;
+    return caps;
+}
+
 ndk::ScopedAStatus ExternalCameraDevice::getCameraCharacteristics(CameraMetadata* _aidl_return) {
     Mutex::Autolock _l(mLock);
     if (_aidl_return == nullptr) {
@@ -44,6 +44,9 @@ class ExternalCameraDevice : public BnCameraDevice {
     // to keep track of all CameraDevice objects in order to notify CameraDevice when the underlying
     // camera is detached.
     ExternalCameraDevice(const std::string& devicePath, const ExternalCameraConfig& config);
+    // Skips probing the V4L2 device and uses previously probed capabilities instead
+    ExternalCameraDevice(const std::string& devicePath, const ExternalCameraConfig& config,
+                         const ExternalCameraCapabilities& capabilities);
     ~ExternalCameraDevice() override;
 
     ndk::ScopedAStatus getCameraCharacteristics(CameraMetadata* _aidl_return) override;
@@ -66,6 +69,9 @@ class ExternalCameraDevice : public BnCameraDevice {
     // Caller must use this method to check if CameraDevice ctor failed
     bool isInitFailed();
 
+    // Returns the probed capabilities of the device, or nullptr if initialization failed
+    std::shared_ptr<const ExternalCameraCapabilities> getCapabilities();
+
     // Device version to be used by the external camera provider.
     // Should be of the form <major>.<minor>
     static std::string kDeviceVersion;
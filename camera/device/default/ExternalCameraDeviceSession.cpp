@@ -89,6 +89,18 @@ bool tryLock(std::mutex& mutex) {
     return locked;
 }
 
+libyuv::FilterMode toLibyuvFilterMode(ScalingFilter filter) {
+    switch (filter) {
+        case ScalingFilter::BILINEAR:
+            return libyuv::FilterMode::kFilterBilinear;
+        case ScalingFilter::BOX:
+            return libyuv::FilterMode::kFilterBox;
+        case ScalingFilter::NONE:
+        default:
+            return libyuv::FilterMode::kFilterNone;
+    }
+}
+
 }  // anonymous namespace
 
 using ::aidl::android::hardware::camera::device::BufferRequestStatus;
@@ -179,6 +191,7 @@ bool ExternalCameraDeviceSession::initialize() {
         return true;
     }
     mOutputThread->setExifMakeModel(mExifMake, mExifModel);
+    mOutputThread->setScalingFilter(mCfg.scalingFilter);
 
     status_t status = initDefaultRequests();
     if (status != OK) {
@@ -848,7 +861,8 @@ Status ExternalCameraDeviceSession::switchToOffline(
     std::shared_ptr<ExternalCameraOfflineSession> sessionImpl =
             ndk::SharedRefBase::make<ExternalCameraOfflineSession>(
                     mCroppingType, mCameraCharacteristics, mCameraId, mExifMake, mExifModel,
-                    mBlobBufferSize, afTrigger, streamInfos, offlineReqs, circulatingBuffers);
+                    mBlobBufferSize, mCfg.scalingFilter, afTrigger, streamInfos, offlineReqs,
+                    circulatingBuffers);
 
     bool initFailed = sessionImpl->initialize();
     if (initFailed) {
@@ -1948,6 +1962,13 @@ binder_status_t ExternalCameraDeviceSession::dump(int fd, const char** /*args*/,
     }
     dprintf(fd, "\n");
     mOutputThread->dump(fd);
+
+    HandleImporter::Stats importerStats = sHandleImporter.getStats();
+    dprintf(fd,
+            "HandleImporter layout cache hits %" PRIu64 ", misses %" PRIu64 ", %" PRIu64
+            " locks in %" PRIu64 " ns\n",
+            importerStats.layoutCacheHits, importerStats.layoutCacheMisses,
+            importerStats.lockCount, importerStats.totalLockTimeNs);
     dprintf(fd, "\n");
 
     if (intfLocked) {
@@ -2243,6 +2264,8 @@ Status ExternalCameraDeviceSession::OutputThread::allocateIntermediateBuffers(
         }
     }
 
+    updateScalingPlansLocked();
+
     // Allocate mute test pattern frame
     mMuteTestPatternFrame.resize(mYu12Frame->mWidth * mYu12Frame->mHeight * 3);
 
@@ -2250,6 +2273,23 @@ Status ExternalCameraDeviceSession::OutputThread::allocateIntermediateBuffers(
     return Status::OK;
 }
 
+void ExternalCameraDeviceSession::OutputThread::updateScalingPlansLocked() {
+    mScalingPlans.clear();
+    mScalingPlanInputSize = {mYu12Frame->mWidth, mYu12Frame->mHeight};
+    const Size& inSz = mScalingPlanInputSize;
+    for (const auto& [outSz, buf] : mIntermediateBuffers) {
+        ScalingPlan plan;
+        if (getCropRect(mCroppingType, inSz, outSz, &plan.inputCrop) != 0) {
+            // cropAndScaleLocked will report the error if this size is ever requested
+            continue;
+        }
+        plan.needScale = !((mCroppingType == VERTICAL && inSz.width == outSz.width) ||
+                           (mCroppingType == HORIZONTAL && inSz.height == outSz.height));
+        plan.scaledFrame = plan.needScale ? buf : nullptr;
+        mScalingPlans[outSz] = plan;
+    }
+}
+
 Status ExternalCameraDeviceSession::OutputThread::submitRequest(
         const std::shared_ptr<HalRequest>& req) {
     std::unique_lock<std::mutex> lk(mRequestListLock);
@@ -2297,6 +2337,13 @@ void ExternalCameraDeviceSession::OutputThread::dump(int fd) {
         dprintf(fd, "%d, ", req->frameNumber);
     }
     dprintf(fd, "\n");
+    dprintf(fd, "OutputThread scaling filter %d, scaled %" PRIu64 " images, reused %" PRIu64 "\n",
+            static_cast<int>(mScalingFilter), mNumScaleOps.load(), mNumScaleReuses.load());
+}
+
+void ExternalCameraDeviceSession::OutputThread::setScalingFilter(ScalingFilter filter) {
+    std::lock_guard<std::mutex> lk(mBufferLock);
+    mScalingFilter = filter;
 }
 
 void ExternalCameraDeviceSession::OutputThread::setExifMakeModel(const std::string& make,
@@ -2398,14 +2445,43 @@ int ExternalCameraDeviceSession::OutputThread::cropAndScaleLocked(
         return ret;
     }
 
-    // Cropping to output aspect ratio
-    IMapper::Rect inputCrop;
-    ret = getCropRect(mCroppingType, inSz, outSz, &inputCrop);
-    if (ret != 0) {
-        ALOGE("%s: failed to compute crop rect for output size %dx%d", __FUNCTION__, outSz.width,
-              outSz.height);
-        return ret;
+    // Another output of this frame already has this size, reuse its scaled image
+    auto scaledIt = mScaledYu12Frames.find(outSz);
+    if (scaledIt != mScaledYu12Frames.end()) {
+        ret = scaledIt->second->getLayout(out);
+        if (ret != 0) {
+            ALOGE("%s: failed to get scaled image layout", __FUNCTION__);
+            return ret;
+        }
+        mNumScaleReuses++;
+        return 0;
+    }
+
+    ScalingPlan plan;
+    auto planIt = mScalingPlans.find(outSz);
+    if (inSz == mScalingPlanInputSize && planIt != mScalingPlans.end()) {
+        plan = planIt->second;
+    } else {
+        // Cropping to output aspect ratio
+        ret = getCropRect(mCroppingType, inSz, outSz, &plan.inputCrop);
+        if (ret != 0) {
+            ALOGE("%s: failed to compute crop rect for output size %dx%d", __FUNCTION__,
+                  outSz.width, outSz.height);
+            return ret;
+        }
+        plan.needScale = !((mCroppingType == VERTICAL && inSz.width == outSz.width) ||
+                           (mCroppingType == HORIZONTAL && inSz.height == outSz.height));
+        if (plan.needScale) {
+            auto bufIt = mIntermediateBuffers.find(outSz);
+            if (bufIt == mIntermediateBuffers.end()) {
+                ALOGE("%s: failed to find intermediate buffer size %dx%d", __FUNCTION__,
+                      outSz.width, outSz.height);
+                return -1;
+            }
+            plan.scaledFrame = bufIt->second;
+        }
     }
+    const IMapper::Rect& inputCrop = plan.inputCrop;
 
     YCbCrLayout croppedLayout;
     ret = in->getCroppedLayout(inputCrop, &croppedLayout);
@@ -2415,29 +2491,15 @@ int ExternalCameraDeviceSession::OutputThread::cropAndScaleLocked(
         return ret;
     }
 
-    if ((mCroppingType == VERTICAL && inSz.width == outSz.width) ||
-        (mCroppingType == HORIZONTAL && inSz.height == outSz.height)) {
+    if (!plan.needScale) {
         // No scale is needed
         *out = croppedLayout;
         return 0;
     }
 
-    auto it = mScaledYu12Frames.find(outSz);
-    std::shared_ptr<AllocatedFrame> scaledYu12Buf;
-    if (it != mScaledYu12Frames.end()) {
-        scaledYu12Buf = it->second;
-    } else {
-        it = mIntermediateBuffers.find(outSz);
-        if (it == mIntermediateBuffers.end()) {
-            ALOGE("%s: failed to find intermediate buffer size %dx%d", __FUNCTION__, outSz.width,
-                  outSz.height);
-            return -1;
-        }
-        scaledYu12Buf = it->second;
-    }
     // Scale
     YCbCrLayout outLayout;
-    ret = scaledYu12Buf->getLayout(&outLayout);
+    ret = plan.scaledFrame->getLayout(&outLayout);
     if (ret != 0) {
         ALOGE("%s: failed to get output buffer layout", __FUNCTION__);
         return ret;
@@ -2450,8 +2512,7 @@ int ExternalCameraDeviceSession::OutputThread::cropAndScaleLocked(
             inputCrop.height, static_cast<uint8_t*>(outLayout.y), outLayout.yStride,
             static_cast<uint8_t*>(outLayout.cb), outLayout.cStride,
             static_cast<uint8_t*>(outLayout.cr), outLayout.cStride, outSz.width, outSz.height,
-            // TODO: b/72261744 see if we can use better filter without losing too much perf
-            libyuv::FilterMode::kFilterNone);
+            toLibyuvFilterMode(mScalingFilter));
 
     if (ret != 0) {
         ALOGE("%s: failed to scale buffer from %dx%d to %dx%d. Ret %d", __FUNCTION__,
@@ -2460,7 +2521,8 @@ int ExternalCameraDeviceSession::OutputThread::cropAndScaleLocked(
     }
 
     *out = outLayout;
-    mScaledYu12Frames.insert({outSz, scaledYu12Buf});
+    mScaledYu12Frames.insert({outSz, plan.scaledFrame});
+    mNumScaleOps++;
     return 0;
 }
 
@@ -2476,6 +2538,17 @@ int ExternalCameraDeviceSession::OutputThread::cropAndScaleThumbLocked(
 
     int ret;
 
+    if (outSz == mScaledThumbSize) {
+        // Thumbnail of this size was already generated for the current frame
+        ret = mYu12ThumbFrame->getLayout(out);
+        if (ret != 0) {
+            ALOGE("%s: failed to get thumbnail layout", __FUNCTION__);
+            return ret;
+        }
+        mNumScaleReuses++;
+        return 0;
+    }
+
     /* This will crop-and-zoom the input YUV frame to the thumbnail size
      * Based on the following logic:
      *  1) Square pixels come in, square pixels come out, therefore single
@@ -2575,7 +2648,7 @@ int ExternalCameraDeviceSession::OutputThread::cropAndScaleThumbLocked(
                             static_cast<uint8_t*>(outFullLayout.y), outFullLayout.yStride,
                             static_cast<uint8_t*>(outFullLayout.cb), outFullLayout.cStride,
                             static_cast<uint8_t*>(outFullLayout.cr), outFullLayout.cStride,
-                            outSz.width, outSz.height, libyuv::FilterMode::kFilterNone);
+                            outSz.width, outSz.height, toLibyuvFilterMode(mScalingFilter));
 
     if (ret != 0) {
         ALOGE("%s: failed to scale buffer from %dx%d to %dx%d. Ret %d", __FUNCTION__,
@@ -2584,6 +2657,8 @@ int ExternalCameraDeviceSession::OutputThread::cropAndScaleThumbLocked(
     }
 
     *out = outFullLayout;
+    mScaledThumbSize = outSz;
+    mNumScaleOps++;
     return 0;
 }
 
@@ -2750,6 +2825,8 @@ void ExternalCameraDeviceSession::OutputThread::clearIntermediateBuffers() {
     mYu12Frame.reset();
     mYu12ThumbFrame.reset();
     mIntermediateBuffers.clear();
+    mScalingPlans.clear();
+    mScalingPlanInputSize = {0, 0};
     mMuteTestPatternFrame.clear();
     mBlobBufferSize = 0;
 }
@@ -2982,6 +3059,7 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
         }
     }  // for each buffer
     mScaledYu12Frames.clear();
+    mScaledThumbSize = {0, 0};
 
     // Don't hold the lock while calling back to parent
     lk.unlock();
@@ -29,6 +29,7 @@
 #include <android/hardware/graphics/mapper/4.0/IMapper.h>
 #include <fmq/AidlMessageQueue.h>
 #include <utils/Thread.h>
+#include <atomic>
 #include <deque>
 #include <list>
 
@@ -57,6 +58,7 @@ using ::android::AidlMessageQueue;
 using ::android::base::unique_fd;
 using ::android::hardware::camera::common::helper::SimpleThread;
 using ::android::hardware::camera::external::common::ExternalCameraConfig;
+using ::android::hardware::camera::external::common::ScalingFilter;
 using ::android::hardware::camera::external::common::SizeHasher;
 using ::android::hardware::graphics::mapper::V2_0::YCbCrLayout;
 using ::ndk::ScopedAStatus;
@@ -178,6 +180,8 @@ class ExternalCameraDeviceSession : public BnCameraDeviceSession, public OutputT
 
         void setExifMakeModel(const std::string& make, const std::string& model);
 
+        void setScalingFilter(ScalingFilter filter);
+
         // The remaining request list is returned for offline processing
         std::list<std::shared_ptr<HalRequest>> switchToOffline();
 
@@ -200,6 +204,10 @@ class ExternalCameraDeviceSession : public BnCameraDeviceSession, public OutputT
         int cropAndScaleThumbLocked(std::shared_ptr<AllocatedFrame>& in, const Size& outSize,
                                     YCbCrLayout* out);
 
+        // Precompute crop rect and destination buffer for each configured output size.
+        // Called with mBufferLock held after intermediate buffers are (re)allocated.
+        void updateScalingPlansLocked();
+
         int createJpegLocked(HalStreamBuffer& halBuf,
                              const common::V1_0::helper::CameraMetadata& settings);
 
@@ -217,6 +225,14 @@ class ExternalCameraDeviceSession : public BnCameraDeviceSession, public OutputT
         bool mProcessingRequest = false;
         uint32_t mProcessingFrameNumber = 0;
 
+        // Per-configuration crop/scale parameters for one output size
+        struct ScalingPlan {
+            IMapper::Rect inputCrop;
+            bool needScale;
+            // Destination of the scaled image, nullptr if needScale is false
+            std::shared_ptr<AllocatedFrame> scaledFrame;
+        };
+
         // V4L2 frameIn
         // (MJPG decode)-> mYu12Frame
         // (Scale)-> mScaledYu12Frames
@@ -225,7 +241,18 @@ class ExternalCameraDeviceSession : public BnCameraDeviceSession, public OutputT
         std::shared_ptr<AllocatedFrame> mYu12Frame;
         std::shared_ptr<AllocatedFrame> mYu12ThumbFrame;
         std::unordered_map<Size, std::shared_ptr<AllocatedFrame>, SizeHasher> mIntermediateBuffers;
+        // Output sizes already scaled for the frame being processed. Outputs sharing a size reuse
+        // the scaled image instead of scaling again. Cleared after each frame.
         std::unordered_map<Size, std::shared_ptr<AllocatedFrame>, SizeHasher> mScaledYu12Frames;
+        // Size held by mYu12ThumbFrame for the frame being processed, {0, 0} if none
+        Size mScaledThumbSize = {0, 0};
+        // Keyed by output size, valid for input frames of mScalingPlanInputSize
+        std::unordered_map<Size, ScalingPlan, SizeHasher> mScalingPlans;
+        Size mScalingPlanInputSize = {0, 0};
+        ScalingFilter mScalingFilter = ScalingFilter::NONE;
+        // Scaling statistics, read without mBufferLock by dump()
+        std::atomic<uint64_t> mNumScaleOps = 0;
+        std::atomic<uint64_t> mNumScaleReuses = 0;
         YCbCrLayout mYu12FrameLayout;
         YCbCrLayout mYu12ThumbFrameLayout;
         std::vector<uint8_t> mMuteTestPatternFrame;
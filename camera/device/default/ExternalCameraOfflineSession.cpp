@@ -56,7 +56,8 @@ HandleImporter ExternalCameraOfflineSession::sHandleImporter;
 ExternalCameraOfflineSession::ExternalCameraOfflineSession(
         const CroppingType& croppingType, const common::V1_0::helper::CameraMetadata& chars,
         const std::string& cameraId, const std::string& exifMake, const std::string& exifModel,
-        uint32_t blobBufferSize, bool afTrigger, const std::vector<Stream>& offlineStreams,
+        uint32_t blobBufferSize, ScalingFilter scalingFilter, bool afTrigger,
+        const std::vector<Stream>& offlineStreams,
         std::deque<std::shared_ptr<HalRequest>>& offlineReqs,
         const std::map<int, CirculatingBuffers>& circulatingBuffers)
     : mCroppingType(croppingType),
@@ -65,6 +66,7 @@ ExternalCameraOfflineSession::ExternalCameraOfflineSession(
       mExifMake(exifMake),
       mExifModel(exifModel),
       mBlobBufferSize(blobBufferSize),
+      mScalingFilter(scalingFilter),
       mAfTrigger(afTrigger),
       mOfflineStreams(offlineStreams),
       mOfflineReqs(offlineReqs),
@@ -312,6 +314,7 @@ void ExternalCameraOfflineSession::initOutputThread() {
                                                    mBufferRequestThread, mOfflineReqs);
 
     mOutputThread->setExifMakeModel(mExifMake, mExifModel);
+    mOutputThread->setScalingFilter(mScalingFilter);
 
     Size inputSize = {mOfflineReqs[0]->frameIn->mWidth, mOfflineReqs[0]->frameIn->mHeight};
     Size maxThumbSize = getMaxThumbnailResolution(mChars);
@@ -542,6 +545,7 @@ bool ExternalCameraOfflineSession::OutputThread::threadLoop() {
         }
     }  // for each buffer
     mScaledYu12Frames.clear();
+    mScaledThumbSize = {0, 0};
 
     // Don't hold the lock while calling back to parent
     lk.unlock();
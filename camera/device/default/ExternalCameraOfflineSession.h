@@ -47,7 +47,8 @@ class ExternalCameraOfflineSession final : public BnCameraOfflineSession,
                                  const common::V1_0::helper::CameraMetadata& chars,
                                  const std::string& cameraId, const std::string& exifMake,
                                  const std::string& exifModel, uint32_t blobBufferSize,
-                                 bool afTrigger, const std::vector<Stream>& offlineStreams,
+                                 ScalingFilter scalingFilter, bool afTrigger,
+                                 const std::vector<Stream>& offlineStreams,
                                  std::deque<std::shared_ptr<HalRequest>>& offlineReqs,
                                  const std::map<int, CirculatingBuffers>& circulatingBuffers);
 
@@ -109,6 +110,7 @@ class ExternalCameraOfflineSession final : public BnCameraOfflineSession,
     const std::string mExifMake;
     const std::string mExifModel;
     const uint32_t mBlobBufferSize;
+    const ScalingFilter mScalingFilter;
 
     std::mutex mAfTriggerLock;  // protect mAfTrigger
     bool mAfTrigger;
@@ -26,6 +26,7 @@
 #include <algorithm>
 #include <cinttypes>
 #include <cmath>
+#include <cstring>
 
 #define HAVE_JPEG  // required for libyuv.h to export MJPEG decode APIs
 #include <libyuv.h>
@@ -44,6 +45,7 @@ const int kDefaultNumVideoBuffer = 4;
 const int kDefaultNumStillBuffer = 2;
 const int kDefaultOrientation = 0;  // suitable for natural landscape displays like tablet/TV
                                     // For phone devices 270 is better
+const ScalingFilter kDefaultScalingFilter = ScalingFilter::NONE;
 }  // anonymous namespace
 
 const char* ExternalCameraConfig::kDefaultCfgPath = "/vendor/etc/external_camera_config.xml";
@@ -79,6 +81,14 @@ ExternalCameraConfig ExternalCameraConfig::loadFromCfg(const char* cfgPath) {
         ret.cameraIdOffset = std::atoi(cameraIdOffset->GetText());
     }
 
+    XMLElement* capabilityCache = providerCfg->FirstChildElement("CapabilityCache");
+    if (capabilityCache != nullptr) {
+        const char* path = capabilityCache->Attribute("path");
+        if (path != nullptr) {
+            ret.capabilityCacheDir = path;
+        }
+    }
+
     XMLElement* ignore = providerCfg->FirstChildElement("ignore");
     if (ignore == nullptr) {
         ALOGI("%s: no internal ignored device specified", __FUNCTION__);
@@ -168,10 +178,26 @@ ExternalCameraConfig ExternalCameraConfig::loadFromCfg(const char* cfgPath) {
         ret.orientation = orientation->IntAttribute("degree", /*Default*/ kDefaultOrientation);
     }
 
+    XMLElement* scalingFilter = deviceCfg->FirstChildElement("ScalingFilter");
+    if (scalingFilter == nullptr) {
+        ALOGI("%s: no scaling filter specified", __FUNCTION__);
+    } else {
+        const char* mode = scalingFilter->Attribute("mode");
+        if (mode == nullptr || strcmp(mode, "none") == 0) {
+            ret.scalingFilter = ScalingFilter::NONE;
+        } else if (strcmp(mode, "bilinear") == 0) {
+            ret.scalingFilter = ScalingFilter::BILINEAR;
+        } else if (strcmp(mode, "box") == 0) {
+            ret.scalingFilter = ScalingFilter::BOX;
+        } else {
+            ALOGW("%s: unknown scaling filter mode '%s', using default", __FUNCTION__, mode);
+        }
+    }
+
     ALOGI("%s: external camera cfg loaded: maxJpgBufSize %d,"
-          " num video buffers %d, num still buffers %d, orientation %d",
+          " num video buffers %d, num still buffers %d, orientation %d, scaling filter %d",
           __FUNCTION__, ret.maxJpegBufSize, ret.numVideoBuffers, ret.numStillBuffers,
-          ret.orientation);
+          ret.orientation, static_cast<int>(ret.scalingFilter));
     for (const auto& limit : ret.fpsLimits) {
         ALOGI("%s: fpsLimitList: %dx%d@%f", __FUNCTION__, limit.size.width, limit.size.height,
               limit.fpsUpperBound);
@@ -220,7 +246,8 @@ ExternalCameraConfig::ExternalCameraConfig()
       numVideoBuffers(kDefaultNumVideoBuffer),
       numStillBuffers(kDefaultNumStillBuffer),
       depthEnabled(false),
-      orientation(kDefaultOrientation) {
+      orientation(kDefaultOrientation),
+      scalingFilter(kDefaultScalingFilter) {
     fpsLimits.push_back({/* size */ {/* width */ 640, /* height */ 480}, /* fpsUpperBound */ 30.0});
     fpsLimits.push_back({/* size */ {/* width */ 1280, /* height */ 720}, /* fpsUpperBound */ 7.5});
     fpsLimits.push_back(
@@ -69,6 +69,9 @@ struct SizeHasher {
     }
 };
 
+// Filter quality used when cropping and scaling intermediate YU12 frames
+enum class ScalingFilter { NONE = 0, BILINEAR, BOX };
+
 struct ExternalCameraConfig {
     static const char* kDefaultCfgPath;
     static ExternalCameraConfig loadFromCfg(const char* cfgPath = kDefaultCfgPath);
@@ -107,6 +110,12 @@ struct ExternalCameraConfig {
     // The value of android.sensor.orientation
     int32_t orientation;
 
+    // Filter used to scale the decoded V4L2 frame to output stream sizes
+    ScalingFilter scalingFilter;
+
+    // Directory where probed device capabilities are persisted. Empty disables persistence.
+    std::string capabilityCacheDir;
+
   private:
     ExternalCameraConfig();
     static bool updateFpsList(tinyxml2::XMLElement* fpsList, std::vector<FpsLimitation>& fpsLimits);
@@ -191,6 +200,14 @@ class AllocatedFrame : public Frame {
 
 enum CroppingType { HORIZONTAL = 0, VERTICAL = 1 };
 
+// Everything ExternalCameraDevice derives from querying the V4L2 device. Probing a device
+// enumerates all formats, sizes and frame rates, so results are reused across device objects.
+struct ExternalCameraCapabilities {
+    common::V1_0::helper::CameraMetadata characteristics;
+    std::vector<SupportedV4L2Format> supportedFormats;
+    CroppingType croppingType;
+};
+
 // Aspect ratio is defined as width/height here and ExternalCameraDevice
 // will guarantee all supported sizes has width >= height (so aspect ratio >= 1.0)
 #define ASPECT_RATIO(sz) (static_cast<float>((sz).width) / (sz).height)
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <ExternalCameraUtils.h>
+#include <libyuv.h>
+#include <log/log.h>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace android::hardware::camera::device::implementation {
+namespace {
+
+using ::android::hardware::camera::external::common::SizeHasher;
+
+// Measures the per-frame cost of cropping and scaling the decoded YU12 frame to the configured
+// output sizes, as OutputThread does for every capture:
+//  - PerOutput computes the crop rect and scales once per output buffer.
+//  - WithPlans looks up the crop rect computed when the streams were configured, and scales once
+//    per output size, so outputs of the same size reuse the scaled image.
+// The argument is the libyuv filter mode, as set by the ScalingFilter config option.
+
+constexpr Size kInputSize = {1920, 1080};
+// Preview and video record streams share a size, as does the JPEG thumbnail with the analysis
+// stream.
+const std::vector<Size> kOutputSizes = {{1280, 720}, {1280, 720}, {640, 480}, {640, 480}};
+
+struct ScalingPlan {
+    IMapper::Rect inputCrop;
+    std::shared_ptr<AllocatedFrame> scaledFrame;
+};
+
+std::shared_ptr<AllocatedFrame> allocateFrame(const Size& size) {
+    auto frame = std::make_shared<AllocatedFrame>(size.width, size.height);
+    LOG_ALWAYS_FATAL_IF(frame->allocate() != 0, "failed to allocate %dx%d frame", size.width,
+                        size.height);
+    return frame;
+}
+
+void scale(AllocatedFrame& in, const IMapper::Rect& inputCrop, AllocatedFrame& out,
+           const Size& outSize, libyuv::FilterMode filter) {
+    YCbCrLayout cropped;
+    YCbCrLayout outLayout;
+    LOG_ALWAYS_FATAL_IF(in.getCroppedLayout(inputCrop, &cropped) != 0 ||
+                                out.getLayout(&outLayout) != 0,
+                        "failed to get frame layouts");
+    int ret = libyuv::I420Scale(
+            static_cast<uint8_t*>(cropped.y), cropped.yStride, static_cast<uint8_t*>(cropped.cb),
+            cropped.cStride, static_cast<uint8_t*>(cropped.cr), cropped.cStride, inputCrop.width,
+            inputCrop.height, static_cast<uint8_t*>(outLayout.y), outLayout.yStride,
+            static_cast<uint8_t*>(outLayout.cb), outLayout.cStride,
+            static_cast<uint8_t*>(outLayout.cr), outLayout.cStride, outSize.width, outSize.height,
+            filter);
+    LOG_ALWAYS_FATAL_IF(ret != 0, "I420Scale failed: %d", ret);
+}
+
+void BM_ScalePerOutput(benchmark::State& state) {
+    const auto filter = static_cast<libyuv::FilterMode>(state.range(0));
+    auto input = allocateFrame(kInputSize);
+    std::unordered_map<Size, std::shared_ptr<AllocatedFrame>, SizeHasher> buffers;
+    for (const Size& size : kOutputSizes) {
+        buffers[size] = allocateFrame(size);
+    }
+
+    for (auto _ : state) {
+        for (const Size& size : kOutputSizes) {
+            IMapper::Rect inputCrop;
+            LOG_ALWAYS_FATAL_IF(getCropRect(HORIZONTAL, kInputSize, size, &inputCrop) != 0,
+                                "failed to compute crop rect");
+            scale(*input, inputCrop, *buffers[size], size, filter);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_ScaleWithPlans(benchmark::State& state) {
+    const auto filter = static_cast<libyuv::FilterMode>(state.range(0));
+    auto input = allocateFrame(kInputSize);
+    std::unordered_map<Size, ScalingPlan, SizeHasher> plans;
+    for (const Size& size : kOutputSizes) {
+        ScalingPlan& plan = plans[size];
+        LOG_ALWAYS_FATAL_IF(getCropRect(HORIZONTAL, kInputSize, size, &plan.inputCrop) != 0,
+                            "failed to compute crop rect");
+        plan.scaledFrame = allocateFrame(size);
+    }
+
+    std::unordered_map<Size, std::shared_ptr<AllocatedFrame>, SizeHasher> scaledFrames;
+    for (auto _ : state) {
+        for (const Size& size : kOutputSizes) {
+            if (scaledFrames.find(size) != scaledFrames.end()) {
+                continue;
+            }
+            const ScalingPlan& plan = plans.find(size)->second;
+            scale(*input, plan.inputCrop, *plan.scaledFrame, size, filter);
+            scaledFrames.insert({size, plan.scaledFrame});
+        }
+        scaledFrames.clear();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ScalePerOutput)
+        ->ArgName("filter")
+        ->Arg(libyuv::kFilterNone)
+        ->Arg(libyuv::kFilterBilinear)
+        ->Arg(libyuv::kFilterBox);
+BENCHMARK(BM_ScaleWithPlans)
+        ->ArgName("filter")
+        ->Arg(libyuv::kFilterNone)
+        ->Arg(libyuv::kFilterBilinear)
+        ->Arg(libyuv::kFilterBox);
+
+}  // namespace
+}  // namespace android::hardware::camera::device::implementation
+
+BENCHMARK_MAIN();
@@ -26,6 +26,8 @@
 #include <linux/videodev2.h>
 #include <log/log.h>
 #include <sys/inotify.h>
+#include <utils/Timers.h>
+#include <cinttypes>
 #include <regex>
 
 namespace android {
@@ -65,12 +67,19 @@ bool matchDeviceName(int cameraIdOffset, const std::string& deviceName, std::str
 }  // namespace
 
 ExternalCameraProvider::ExternalCameraProvider() : mCfg(ExternalCameraConfig::loadFromCfg()) {
+    if (!mCfg.capabilityCacheDir.empty()) {
+        mCapabilityStore =
+                std::make_unique<ExternalCameraCapabilityStore>(mCfg.capabilityCacheDir, mCfg);
+    }
+    mProbeThread = std::make_shared<ProbeThread>(this);
+    mProbeThread->run();
     mHotPlugThread = std::make_shared<HotplugThread>(this);
     mHotPlugThread->run();
 }
 
 ExternalCameraProvider::~ExternalCameraProvider() {
     mHotPlugThread->requestExitAndWait();
+    mProbeThread->requestExitAndWait();
 }
 
 ndk::ScopedAStatus ExternalCameraProvider::setCallback(
@@ -130,9 +139,20 @@ ndk::ScopedAStatus ExternalCameraProvider::getCameraDeviceInterface(
         return fromStatus(Status::ILLEGAL_ARGUMENT);
     }
 
+    std::shared_ptr<const ExternalCameraCapabilities> caps;
+    {
+        Mutex::Autolock _l(mLock);
+        auto it = mCapabilities.find(cameraDevicePath);
+        if (it != mCapabilities.end()) {
+            caps = it->second;
+        }
+    }
+
     ALOGV("Constructing external camera device");
     std::shared_ptr<ExternalCameraDevice> deviceImpl =
-            ndk::SharedRefBase::make<ExternalCameraDevice>(cameraDevicePath, mCfg);
+            caps != nullptr ? ndk::SharedRefBase::make<ExternalCameraDevice>(cameraDevicePath,
+                                                                             mCfg, *caps)
+                            : ndk::SharedRefBase::make<ExternalCameraDevice>(cameraDevicePath, mCfg);
     if (deviceImpl == nullptr || deviceImpl->isInitFailed()) {
         ALOGE("%s: camera device %s init failed!", __FUNCTION__, cameraDevicePath.c_str());
         *_aidl_return = nullptr;
@@ -188,38 +208,75 @@ void ExternalCameraProvider::addExternalCamera(const char* devName) {
 
 void ExternalCameraProvider::deviceAdded(const char* devName) {
     {
-        base::unique_fd fd(::open(devName, O_RDWR));
+        Mutex::Autolock _l(mLock);
+        mPendingProbes.insert(devName);
+    }
+    mProbeThread->enqueue(devName);
+}
+
+void ExternalCameraProvider::probeDevice(const std::string& devName) {
+    nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    {
+        base::unique_fd fd(::open(devName.c_str(), O_RDWR));
         if (fd.get() < 0) {
-            ALOGE("%s open v4l2 device %s failed:%s", __FUNCTION__, devName, strerror(errno));
+            ALOGE("%s open v4l2 device %s failed:%s", __FUNCTION__, devName.c_str(),
+                  strerror(errno));
             return;
         }
 
         struct v4l2_capability capability;
         int ret = ioctl(fd.get(), VIDIOC_QUERYCAP, &capability);
         if (ret < 0) {
-            ALOGE("%s v4l2 QUERYCAP %s failed", __FUNCTION__, devName);
+            ALOGE("%s v4l2 QUERYCAP %s failed", __FUNCTION__, devName.c_str());
             return;
         }
 
         if (!(capability.device_caps & V4L2_CAP_VIDEO_CAPTURE)) {
-            ALOGW("%s device %s does not support VIDEO_CAPTURE", __FUNCTION__, devName);
+            ALOGW("%s device %s does not support VIDEO_CAPTURE", __FUNCTION__, devName.c_str());
             return;
         }
     }
 
-    // See if we can initialize ExternalCameraDevice correctly
-    std::shared_ptr<ExternalCameraDevice> deviceImpl =
-            ndk::SharedRefBase::make<ExternalCameraDevice>(devName, mCfg);
-    if (deviceImpl == nullptr || deviceImpl->isInitFailed()) {
-        ALOGW("%s: Attempt to init camera device %s failed!", __FUNCTION__, devName);
-        return;
+    std::string storeKey;
+    std::shared_ptr<const ExternalCameraCapabilities> caps;
+    if (mCapabilityStore != nullptr) {
+        storeKey = ExternalCameraCapabilityStore::getDeviceKey(devName);
+        caps = mCapabilityStore->load(storeKey);
+    }
+    bool fromStore = caps != nullptr;
+
+    if (caps == nullptr) {
+        // See if we can initialize ExternalCameraDevice correctly
+        std::shared_ptr<ExternalCameraDevice> deviceImpl =
+                ndk::SharedRefBase::make<ExternalCameraDevice>(devName, mCfg);
+        caps = deviceImpl != nullptr ? deviceImpl->getCapabilities() : nullptr;
+        if (caps == nullptr) {
+            ALOGW("%s: Attempt to init camera device %s failed!", __FUNCTION__, devName.c_str());
+            return;
+        }
+        if (mCapabilityStore != nullptr && !storeKey.empty()) {
+            mCapabilityStore->save(storeKey, *caps);
+        }
+    }
+    ALOGI("%s: %s probed in %" PRId64 " us (%s)", __FUNCTION__, devName.c_str(),
+          ns2us(systemTime(SYSTEM_TIME_MONOTONIC) - startTime),
+          fromStore ? "stored capabilities" : "V4L2 enumeration");
+
+    {
+        Mutex::Autolock _l(mLock);
+        if (mPendingProbes.erase(devName) == 0) {
+            // Removed while probing
+            return;
+        }
+        mCapabilities[devName] = caps;
     }
-    deviceImpl.reset();
-    addExternalCamera(devName);
+    addExternalCamera(devName.c_str());
 }
 
 void ExternalCameraProvider::deviceRemoved(const char* devName) {
     Mutex::Autolock _l(mLock);
+    mPendingProbes.erase(devName);
+    mCapabilities.erase(devName);
     std::string deviceName;
     std::string cameraId =
             std::to_string(mCfg.cameraIdOffset + std::atoi(devName + kDevicePrefixLen));
@@ -240,6 +297,7 @@ void ExternalCameraProvider::deviceRemoved(const char* devName) {
 
 void ExternalCameraProvider::updateAttachedCameras() {
     ALOGV("%s start scanning for existing V4L2 devices", __FUNCTION__);
+    nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
 
     // Find existing /dev/video* devices
     DIR* devdir = opendir(kDevicePath);
@@ -262,8 +320,43 @@ void ExternalCameraProvider::updateAttachedCameras() {
         }
     }
     closedir(devdir);
+    ALOGI("%s: scanned existing V4L2 devices in %" PRId64 " us", __FUNCTION__,
+          ns2us(systemTime(SYSTEM_TIME_MONOTONIC) - startTime));
 }
 
+// Start ExternalCameraProvider::ProbeThread functions
+
+ExternalCameraProvider::ProbeThread::ProbeThread(ExternalCameraProvider* parent)
+    : mParent(parent) {}
+
+ExternalCameraProvider::ProbeThread::~ProbeThread() {}
+
+void ExternalCameraProvider::ProbeThread::enqueue(const std::string& devName) {
+    {
+        std::lock_guard<std::mutex> lk(mQueueLock);
+        mQueue.push_back(devName);
+    }
+    mQueueCond.notify_one();
+}
+
+bool ExternalCameraProvider::ProbeThread::threadLoop() {
+    std::string devName;
+    {
+        std::unique_lock<std::mutex> lk(mQueueLock);
+        // Wake up periodically so a pending exit request is noticed
+        if (!mQueueCond.wait_for(lk, std::chrono::milliseconds(kWaitTimeoutMs),
+                                 [this] { return !mQueue.empty(); })) {
+            return true;
+        }
+        devName = std::move(mQueue.front());
+        mQueue.pop_front();
+    }
+    mParent->probeDevice(devName);
+    return true;
+}
+
+// End ExternalCameraProvider::ProbeThread functions
+
 // Start ExternalCameraProvider::HotplugThread functions
 
 ExternalCameraProvider::HotplugThread::HotplugThread(ExternalCameraProvider* parent)
@@ -17,6 +17,7 @@
 #ifndef HARDWARE_INTERFACES_CAMERA_PROVIDER_DEFAULT_EXTERNALCAMERAPROVIDER_H_
 #define HARDWARE_INTERFACES_CAMERA_PROVIDER_DEFAULT_EXTERNALCAMERAPROVIDER_H_
 
+#include <ExternalCameraCapabilityStore.h>
 #include <ExternalCameraUtils.h>
 #include <SimpleThread.h>
 #include <aidl/android/hardware/camera/common/CameraDeviceStatus.h>
@@ -29,6 +30,9 @@
 #include <poll.h>
 #include <utils/Mutex.h>
 #include <utils/Thread.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
@@ -47,6 +51,8 @@ using ::aidl::android::hardware::camera::provider::CameraIdAndStreamCombination;
 using ::aidl::android::hardware::camera::provider::ConcurrentCameraIdCombination;
 using ::aidl::android::hardware::camera::provider::ICameraProviderCallback;
 using ::android::hardware::camera::common::helper::SimpleThread;
+using ::android::hardware::camera::device::implementation::ExternalCameraCapabilities;
+using ::android::hardware::camera::device::implementation::ExternalCameraCapabilityStore;
 using ::android::hardware::camera::external::common::ExternalCameraConfig;
 
 class ExternalCameraProvider : public BnCameraProvider {
@@ -72,6 +78,29 @@ class ExternalCameraProvider : public BnCameraProvider {
     void deviceAdded(const char* devName);
     void deviceRemoved(const char* devName);
     void updateAttachedCameras();
+    // Called from ProbeThread. Checks the device can be used as a camera and reports it.
+    void probeDevice(const std::string& devName);
+
+    // A separate thread probing the capabilities of newly attached devices, so that V4L2
+    // enumeration of one device does not delay handling of other hotplug events.
+    class ProbeThread : public SimpleThread {
+      public:
+        explicit ProbeThread(ExternalCameraProvider* parent);
+        ~ProbeThread() override;
+
+        void enqueue(const std::string& devName);
+
+      protected:
+        bool threadLoop() override;
+
+      private:
+        static const int kWaitTimeoutMs = 250;
+
+        ExternalCameraProvider* mParent = nullptr;
+        std::mutex mQueueLock;
+        std::condition_variable mQueueCond;
+        std::deque<std::string> mQueue;
+    };
 
     // A separate thread to monitor '/dev' directory for '/dev/video*' entries
     // This thread calls back into ExternalCameraProvider when an actionable change is detected.
@@ -104,7 +133,15 @@ class ExternalCameraProvider : public BnCameraProvider {
     Mutex mLock;
     std::shared_ptr<ICameraProviderCallback> mCallback = nullptr;
     std::unordered_map<std::string, CameraDeviceStatus> mCameraStatusMap;  // camera id -> status
+    // Devices queued on ProbeThread. A device removed before its probe finishes is dropped.
+    std::unordered_set<std::string> mPendingProbes;
+    // device path -> capabilities of attached devices
+    std::unordered_map<std::string, std::shared_ptr<const ExternalCameraCapabilities>>
+            mCapabilities;
     const ExternalCameraConfig mCfg;
+    // nullptr if capability persistence is not configured
+    std::unique_ptr<ExternalCameraCapabilityStore> mCapabilityStore;
+    std::shared_ptr<ProbeThread> mProbeThread;
     std::shared_ptr<HotplugThread> mHotPlugThread;
 };
 
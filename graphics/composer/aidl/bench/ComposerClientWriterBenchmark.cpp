@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <android/binder_auto_utils.h>
+#include <android/binder_parcel.h>
+#include <android/hardware/graphics/composer3/ComposerClientWriter.h>
+#include <log/log.h>
+
+#include <vector>
+
+namespace aidl::android::hardware::graphics::composer3 {
+namespace {
+
+// Measures the cost of writing the commands of one frame, either taking the commands from the
+// writer each frame or reusing their storage across frames, and the size of the commands of a frame
+// in which no layer changed, with and without layer state tracking. The argument is the number of
+// layers.
+
+constexpr int64_t kDisplay = 1;
+constexpr float kIdentity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+void writeFrame(ComposerClientWriter& writer, int64_t numLayers) {
+    const std::vector<Rect> visibleRegion = {{0, 0, 540, 1200}, {540, 0, 1080, 1200}};
+    const std::vector<Rect> damage = {{0, 0, 1080, 100}};
+    writer.setColorTransform(kDisplay, kIdentity);
+    for (int64_t layer = 0; layer < numLayers; ++layer) {
+        writer.setLayerBuffer(kDisplay, layer, 0, nullptr, -1);
+        writer.setLayerCompositionType(kDisplay, layer, Composition::DEVICE);
+        writer.setLayerDisplayFrame(kDisplay, layer, {0, 0, 1080, 1200});
+        writer.setLayerSourceCrop(kDisplay, layer, {0.f, 0.f, 1080.f, 1200.f});
+        writer.setLayerPlaneAlpha(kDisplay, layer, 1.f);
+        writer.setLayerZOrder(kDisplay, layer, static_cast<uint32_t>(layer));
+        writer.setLayerVisibleRegion(kDisplay, layer, visibleRegion);
+        writer.setLayerSurfaceDamage(kDisplay, layer, damage);
+        writer.setLayerColorTransform(kDisplay, layer, kIdentity);
+    }
+    writer.validateDisplay(kDisplay, ComposerClientWriter::kNoTimestamp, 0);
+    writer.presentDisplay(kDisplay);
+}
+
+void BM_TakePendingCommands(benchmark::State& state) {
+    ComposerClientWriter writer(kDisplay);
+    for (auto _ : state) {
+        writeFrame(writer, state.range(0));
+        benchmark::DoNotOptimize(writer.takePendingCommands());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ReusePendingCommands(benchmark::State& state) {
+    ComposerClientWriter writer(kDisplay);
+    for (auto _ : state) {
+        writeFrame(writer, state.range(0));
+        benchmark::DoNotOptimize(writer.getPendingCommands().data());
+        writer.clearPendingCommands();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+size_t getSerializedSize(const std::vector<DisplayCommand>& commands) {
+    ndk::ScopedAParcel parcel(AParcel_create());
+    for (const auto& command : commands) {
+        LOG_ALWAYS_FATAL_IF(command.writeToParcel(parcel.get()) != STATUS_OK,
+                            "Failed to write command");
+    }
+    return AParcel_getDataSize(parcel.get());
+}
+
+// Writes the same frame repeatedly, as for a static UI.
+void BM_StaticFrame(benchmark::State& state, bool trackLayerState) {
+    ComposerClientWriter writer(kDisplay);
+    writer.setLayerStateTracking(trackLayerState);
+    writeFrame(writer, state.range(0));
+    writer.clearPendingCommands();
+
+    size_t serializedSize = 0;
+    for (auto _ : state) {
+        writeFrame(writer, state.range(0));
+        state.PauseTiming();
+        serializedSize = getSerializedSize(writer.getPendingCommands());
+        state.ResumeTiming();
+        writer.clearPendingCommands();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["bytes_per_frame"] = serializedSize;
+    state.counters["elided_per_frame"] =
+            state.iterations() == 0
+                    ? 0.0
+                    : static_cast<double>(writer.getElidedLayerCommandCount()) / state.iterations();
+}
+
+BENCHMARK(BM_TakePendingCommands)->ArgName("layers")->Arg(8)->Arg(32)->Arg(64);
+BENCHMARK(BM_ReusePendingCommands)->ArgName("layers")->Arg(8)->Arg(32)->Arg(64);
+BENCHMARK_CAPTURE(BM_StaticFrame, untracked, /*trackLayerState=*/false)
+        ->ArgName("layers")
+        ->Arg(8)
+        ->Arg(32)
+        ->Arg(64);
+BENCHMARK_CAPTURE(BM_StaticFrame, tracked, /*trackLayerState=*/true)
+        ->ArgName("layers")
+        ->Arg(8)
+        ->Arg(32)
+        ->Arg(64);
+
+}  // namespace
+}  // namespace aidl::android::hardware::graphics::composer3
+
+BENCHMARK_MAIN();
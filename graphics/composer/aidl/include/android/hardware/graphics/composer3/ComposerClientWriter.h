@@ -17,8 +17,12 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <limits>
 #include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <inttypes.h>
@@ -72,11 +76,27 @@ class ComposerClientWriter final {
     ComposerClientWriter(const ComposerClientWriter&) = delete;
     ComposerClientWriter& operator=(const ComposerClientWriter&) = delete;
 
+    // When enabled, the writer remembers the last value it wrote for each layer property and skips
+    // writing a property again with the same value. The remembered state is only valid as long as
+    // the composer applied every command written, so the caller must call forgetLayerState after
+    // a command fails, and for a layer destroyed other than with
+    // setLayerLifecycleBatchCommandType. Composition types are forgotten whenever the composer may
+    // change them, on acceptDisplayChanges and presentOrvalidateDisplay.
+    void setLayerStateTracking(bool enabled) {
+        mTrackLayerState = enabled;
+        mLayerStates.clear();
+    }
+
+    void forgetLayerState() { mLayerStates.clear(); }
+
+    void forgetLayerState(int64_t layer) { mLayerStates.erase(layer); }
+
+    // Number of layer properties which were not written because they had not changed.
+    uint64_t getElidedLayerCommandCount() const { return mElidedLayerCommandCount; }
+
     void setColorTransform(int64_t display, const float* matrix) {
-        std::vector<float> matVec;
-        matVec.reserve(16);
-        matVec.assign(matrix, matrix + 16);
-        getDisplayCommand(display).colorTransformMatrix.emplace(std::move(matVec));
+        assignFromPool(getDisplayCommand(display).colorTransformMatrix, mMatrixPool, matrix,
+                       matrix + 16);
     }
 
     void setDisplayBrightness(int64_t display, float brightness, float brightnessNits) {
@@ -107,6 +127,9 @@ class ComposerClientWriter final {
 
     void setLayerLifecycleBatchCommandType(int64_t display, int64_t layer,
                                            LayerLifecycleBatchCommandType cmd) {
+        if (cmd != LayerLifecycleBatchCommandType::MODIFY) {
+            forgetLayerState(layer);
+        }
         getLayerCommand(display, layer).layerLifecycleBatchCommandType = cmd;
     }
 
@@ -130,10 +153,12 @@ class ComposerClientWriter final {
         command.expectedPresentTime = expectedPresentTime;
         command.presentOrValidateDisplay = true;
         command.frameIntervalNs = frameIntervalNs;
+        forgetLayerCompositionTypes();
     }
 
     void acceptDisplayChanges(int64_t display) {
         getDisplayCommand(display).acceptDisplayChanges = true;
+        forgetLayerCompositionTypes();
     }
 
     void presentDisplay(int64_t display) { getDisplayCommand(display).presentDisplay = true; }
@@ -147,11 +172,20 @@ class ComposerClientWriter final {
 
     void setLayerBuffer(int64_t display, int64_t layer, uint32_t slot,
                         const native_handle_t* buffer, int acquireFence) {
+        // Without a new handle or fence, the buffer is the one the composer already has in the
+        // slot, so it only needs to be written if the layer was showing another slot.
+        const bool reusesSlot = buffer == nullptr && acquireFence < 0;
+        if (reusesSlot && isLayerStateUnchanged(display, layer, &LayerState::bufferSlot,
+                                                static_cast<int32_t>(slot))) {
+            return;
+        }
+        rememberLayerState(layer, &LayerState::bufferSlot, static_cast<int32_t>(slot));
         getLayerCommand(display, layer).buffer = getBufferCommand(slot, buffer, acquireFence);
     }
 
     void setLayerBufferWithNewCommand(int64_t display, int64_t layer, uint32_t slot,
                                       const native_handle_t* buffer, int acquireFence) {
+        rememberLayerState(layer, &LayerState::bufferSlot, static_cast<int32_t>(slot));
         flushLayerCommand();
         getLayerCommand(display, layer).buffer = getBufferCommand(slot, buffer, acquireFence);
         flushLayerCommand();
@@ -159,41 +193,58 @@ class ComposerClientWriter final {
 
     void setLayerBufferSlotsToClear(int64_t display, int64_t layer,
                                     const std::vector<uint32_t>& slotsToClear) {
-        getLayerCommand(display, layer)
-                .bufferSlotsToClear.emplace(slotsToClear.begin(), slotsToClear.end());
+        if (const auto it = mLayerStates.find(layer); it != mLayerStates.end()) {
+            auto& bufferSlot = it->second.bufferSlot;
+            if (bufferSlot.has_value() &&
+                std::find(slotsToClear.begin(), slotsToClear.end(),
+                          static_cast<uint32_t>(*bufferSlot)) != slotsToClear.end()) {
+                bufferSlot.reset();
+            }
+        }
+        assignFromPool(getLayerCommand(display, layer).bufferSlotsToClear, mSlotPool,
+                       slotsToClear.begin(), slotsToClear.end());
     }
 
     void setLayerSurfaceDamage(int64_t display, int64_t layer, const std::vector<Rect>& damage) {
-        getLayerCommand(display, layer).damage.emplace(damage.begin(), damage.end());
+        // The composer keeps the surface damage of a layer until it is set again.
+        if (isLayerStateUnchanged(display, layer, &LayerState::damage, damage)) return;
+        assignFromPool(getLayerCommand(display, layer).damage, mRegionPool, damage.begin(),
+                       damage.end());
     }
 
     void setLayerBlendMode(int64_t display, int64_t layer, BlendMode mode) {
+        if (isLayerStateUnchanged(display, layer, &LayerState::blendMode, mode)) return;
         ParcelableBlendMode parcelableBlendMode;
         parcelableBlendMode.blendMode = mode;
         getLayerCommand(display, layer).blendMode.emplace(std::move(parcelableBlendMode));
     }
 
     void setLayerColor(int64_t display, int64_t layer, Color color) {
+        if (isLayerStateUnchanged(display, layer, &LayerState::color, color)) return;
         getLayerCommand(display, layer).color.emplace(std::move(color));
     }
 
     void setLayerCompositionType(int64_t display, int64_t layer, Composition type) {
+        if (isLayerStateUnchanged(display, layer, &LayerState::composition, type)) return;
         ParcelableComposition compositionPayload;
         compositionPayload.composition = type;
         getLayerCommand(display, layer).composition.emplace(std::move(compositionPayload));
     }
 
     void setLayerDataspace(int64_t display, int64_t layer, Dataspace dataspace) {
+        if (isLayerStateUnchanged(display, layer, &LayerState::dataspace, dataspace)) return;
         ParcelableDataspace dataspacePayload;
         dataspacePayload.dataspace = dataspace;
         getLayerCommand(display, layer).dataspace.emplace(std::move(dataspacePayload));
     }
 
     void setLayerDisplayFrame(int64_t display, int64_t layer, const Rect& frame) {
+        if (isLayerStateUnchanged(display, layer, &LayerState::displayFrame, frame)) return;
         getLayerCommand(display, layer).displayFrame.emplace(frame);
     }
 
     void setLayerPlaneAlpha(int64_t display, int64_t layer, float alpha) {
+        if (isLayerStateUnchanged(display, layer, &LayerState::planeAlpha, alpha)) return;
         PlaneAlpha planeAlpha;
         planeAlpha.alpha = alpha;
         getLayerCommand(display, layer).planeAlpha.emplace(std::move(planeAlpha));
@@ -206,20 +257,25 @@ class ComposerClientWriter final {
     }
 
     void setLayerSourceCrop(int64_t display, int64_t layer, const FRect& crop) {
+        if (isLayerStateUnchanged(display, layer, &LayerState::sourceCrop, crop)) return;
         getLayerCommand(display, layer).sourceCrop.emplace(crop);
     }
 
     void setLayerTransform(int64_t display, int64_t layer, Transform transform) {
+        if (isLayerStateUnchanged(display, layer, &LayerState::transform, transform)) return;
         ParcelableTransform transformPayload;
         transformPayload.transform = transform;
         getLayerCommand(display, layer).transform.emplace(std::move(transformPayload));
     }
 
     void setLayerVisibleRegion(int64_t display, int64_t layer, const std::vector<Rect>& visible) {
-        getLayerCommand(display, layer).visibleRegion.emplace(visible.begin(), visible.end());
+        if (isLayerStateUnchanged(display, layer, &LayerState::visibleRegion, visible)) return;
+        assignFromPool(getLayerCommand(display, layer).visibleRegion, mRegionPool, visible.begin(),
+                       visible.end());
     }
 
     void setLayerZOrder(int64_t display, int64_t layer, uint32_t z) {
+        if (isLayerStateUnchanged(display, layer, &LayerState::z, z)) return;
         ZOrder zorder;
         zorder.z = static_cast<int32_t>(z);
         getLayerCommand(display, layer).z.emplace(std::move(zorder));
@@ -232,7 +288,11 @@ class ComposerClientWriter final {
     }
 
     void setLayerColorTransform(int64_t display, int64_t layer, const float* matrix) {
-        getLayerCommand(display, layer).colorTransform.emplace(matrix, matrix + 16);
+        std::array<float, 16> matrixArray;
+        std::copy_n(matrix, matrixArray.size(), matrixArray.begin());
+        if (isLayerStateUnchanged(display, layer, &LayerState::colorTransform, matrixArray)) return;
+        assignFromPool(getLayerCommand(display, layer).colorTransform, mMatrixPool, matrix,
+                       matrix + 16);
     }
 
     void setLayerPerFrameMetadataBlobs(int64_t display, int64_t layer,
@@ -242,12 +302,15 @@ class ComposerClientWriter final {
     }
 
     void setLayerBrightness(int64_t display, int64_t layer, float brightness) {
+        if (isLayerStateUnchanged(display, layer, &LayerState::brightness, brightness)) return;
         getLayerCommand(display, layer)
                 .brightness.emplace(LayerBrightness{.brightness = brightness});
     }
 
     void setLayerBlockingRegion(int64_t display, int64_t layer, const std::vector<Rect>& blocking) {
-        getLayerCommand(display, layer).blockingRegion.emplace(blocking.begin(), blocking.end());
+        if (isLayerStateUnchanged(display, layer, &LayerState::blockingRegion, blocking)) return;
+        assignFromPool(getLayerCommand(display, layer).blockingRegion, mRegionPool,
+                       blocking.begin(), blocking.end());
     }
 
     void setLayerLuts(int64_t display, int64_t layer, Luts& luts) {
@@ -267,12 +330,152 @@ class ComposerClientWriter final {
         return moved;
     }
 
+    // Returns the pending commands without giving up their storage. Unlike takePendingCommands,
+    // this lets clearPendingCommands reuse the layer lists and regions of this frame for the next
+    // one, so that a steady stream of frames does not allocate. The commands stay valid until the
+    // next call to clearPendingCommands, takePendingCommands or any of the set methods.
+    const std::vector<DisplayCommand>& getPendingCommands() {
+        flushLayerCommand();
+        flushDisplayCommand();
+        return mCommands;
+    }
+
+    // Discards the pending commands, keeping their storage for the commands written next.
+    void clearPendingCommands() {
+        flushLayerCommand();
+        flushDisplayCommand();
+        for (auto& command : mCommands) {
+            recycle(command);
+        }
+        mCommands.clear();
+    }
+
   private:
+    // Vectors whose elements have been cleared but whose capacity is kept for reuse.
+    template <typename Vector>
+    class VectorPool {
+      public:
+        Vector take() {
+            if (mVectors.empty()) {
+                return {};
+            }
+            Vector vector = std::move(mVectors.back());
+            mVectors.pop_back();
+            return vector;
+        }
+
+        void give(Vector&& vector) {
+            if (vector.capacity() == 0) {
+                return;
+            }
+            vector.clear();
+            mVectors.push_back(std::move(vector));
+        }
+
+        void give(std::optional<Vector>& vector) {
+            if (vector.has_value()) {
+                give(std::move(*vector));
+                vector.reset();
+            }
+        }
+
+      private:
+        std::vector<Vector> mVectors;
+    };
+
+    // The last value written for each layer property tracked by setLayerStateTracking.
+    struct LayerState {
+        std::optional<int32_t> bufferSlot;
+        std::optional<BlendMode> blendMode;
+        std::optional<Color> color;
+        std::optional<Composition> composition;
+        std::optional<Dataspace> dataspace;
+        std::optional<Rect> displayFrame;
+        std::optional<float> planeAlpha;
+        std::optional<FRect> sourceCrop;
+        std::optional<Transform> transform;
+        std::optional<std::vector<Rect>> visibleRegion;
+        std::optional<std::vector<Rect>> damage;
+        std::optional<std::vector<Rect>> blockingRegion;
+        std::optional<uint32_t> z;
+        std::optional<std::array<float, 16>> colorTransform;
+        std::optional<float> brightness;
+    };
+
+    using RegionVector = decltype(LayerCommand().damage)::value_type;
+    using MatrixVector = decltype(LayerCommand().colorTransform)::value_type;
+    using SlotVector = decltype(LayerCommand().bufferSlotsToClear)::value_type;
+
     std::optional<DisplayCommand> mDisplayCommand;
     std::optional<LayerCommand> mLayerCommand;
     std::vector<DisplayCommand> mCommands;
     const int64_t mDisplay;
 
+    VectorPool<std::vector<LayerCommand>> mLayerPool;
+    VectorPool<RegionVector> mRegionPool;
+    VectorPool<MatrixVector> mMatrixPool;
+    VectorPool<SlotVector> mSlotPool;
+
+    bool mTrackLayerState = false;
+    std::unordered_map<int64_t, LayerState> mLayerStates;
+    uint64_t mElidedLayerCommandCount = 0;
+
+    // Returns true, without writing anything, if the property was last written with the same
+    // value. Otherwise remembers the value, which the caller then writes.
+    template <typename T>
+    bool isLayerStateUnchanged(int64_t display, int64_t layer, std::optional<T> LayerState::*field,
+                               const T& value) {
+        if (!mTrackLayerState) {
+            return false;
+        }
+        LOG_ALWAYS_FATAL_IF(display != mDisplay, "Expected display %" PRId64 ", got %" PRId64,
+                            mDisplay, display);
+        auto& state = mLayerStates[layer].*field;
+        if (state.has_value() && *state == value) {
+            mElidedLayerCommandCount++;
+            return true;
+        }
+        state = value;
+        return false;
+    }
+
+    template <typename T>
+    void rememberLayerState(int64_t layer, std::optional<T> LayerState::*field, const T& value) {
+        if (mTrackLayerState) {
+            mLayerStates[layer].*field = value;
+        }
+    }
+
+    // Accepting the composition types the composer changed during validation sets them on the
+    // layers, so the types last written no longer describe the layers.
+    void forgetLayerCompositionTypes() {
+        for (auto& [layer, state] : mLayerStates) {
+            state.composition.reset();
+        }
+    }
+
+    template <typename Vector, typename Iterator>
+    static void assignFromPool(std::optional<Vector>& field, VectorPool<Vector>& pool,
+                               Iterator first, Iterator last) {
+        if (!field.has_value()) {
+            field.emplace(pool.take());
+        }
+        field->assign(first, last);
+    }
+
+    void recycle(DisplayCommand& command) {
+        mMatrixPool.give(command.colorTransformMatrix);
+        for (auto& layerCommand : command.layers) {
+            mRegionPool.give(layerCommand.damage);
+            mRegionPool.give(layerCommand.visibleRegion);
+            mRegionPool.give(layerCommand.blockingRegion);
+            mMatrixPool.give(layerCommand.colorTransform);
+            mSlotPool.give(layerCommand.bufferSlotsToClear);
+        }
+        command.layers.clear();
+        mLayerPool.give(std::move(command.layers));
+    }
+
     Buffer getBufferCommand(uint32_t slot, const native_handle_t* bufferHandle, int fence) {
         Buffer bufferCommand;
         bufferCommand.slot = static_cast<int32_t>(slot);
@@ -303,6 +506,7 @@ class ComposerClientWriter final {
             flushDisplayCommand();
             mDisplayCommand.emplace();
             mDisplayCommand->display = display;
+            mDisplayCommand->layers = mLayerPool.take();
         }
         return *mDisplayCommand;
     }
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android/hardware/graphics/composer3/ComposerClientWriter.h>
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <vector>
+
+namespace aidl::android::hardware::graphics::composer3 {
+namespace {
+
+constexpr int64_t kDisplay = 1;
+constexpr int64_t kLayer = 2;
+constexpr int64_t kOtherLayer = 3;
+
+// A frame which sets every pooled vector: regions, color transforms and buffer slots to clear.
+void writeFirstFrame(ComposerClientWriter& writer) {
+    const float matrix[16] = {1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f,
+                              0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f};
+    writer.setColorTransform(kDisplay, matrix);
+    writer.setLayerSurfaceDamage(kDisplay, kLayer, {{0, 0, 1, 1}, {1, 1, 2, 2}, {2, 2, 3, 3}});
+    writer.setLayerVisibleRegion(kDisplay, kLayer, {{0, 0, 10, 10}, {10, 10, 20, 20}});
+    writer.setLayerBlockingRegion(kDisplay, kLayer, {{0, 0, 5, 5}});
+    writer.setLayerColorTransform(kDisplay, kLayer, matrix);
+    writer.setLayerBufferSlotsToClear(kDisplay, kLayer, {1, 2, 3});
+    writer.setLayerSurfaceDamage(kDisplay, kOtherLayer, {{4, 4, 5, 5}, {5, 5, 6, 6}});
+}
+
+// A smaller frame, written in a different layer order, which sets none of the matrices or slots.
+void writeSecondFrame(ComposerClientWriter& writer) {
+    writer.setLayerVisibleRegion(kDisplay, kOtherLayer, {{0, 0, 8, 8}});
+    writer.setLayerSurfaceDamage(kDisplay, kLayer, {{7, 7, 8, 8}});
+    writer.setLayerPlaneAlpha(kDisplay, kLayer, 0.5f);
+}
+
+class ComposerClientWriterTest : public ::testing::Test {
+  protected:
+    ComposerClientWriterTest() : mWriter(kDisplay) { mWriter.setLayerStateTracking(true); }
+
+    // Returns the commands written for the layer since the last call, and discards all of the
+    // pending commands so that the next writes belong to a new frame.
+    std::optional<LayerCommand> takeLayerCommand(int64_t layer) {
+        std::optional<LayerCommand> result;
+        for (auto& command : mWriter.takePendingCommands()) {
+            for (auto& layerCommand : command.layers) {
+                if (layerCommand.layer == layer) {
+                    result.emplace(std::move(layerCommand));
+                }
+            }
+        }
+        return result;
+    }
+
+    ComposerClientWriter mWriter;
+};
+
+TEST_F(ComposerClientWriterTest, IdenticalPropertyIsElided) {
+    mWriter.setLayerPlaneAlpha(kDisplay, kLayer, 0.5f);
+    mWriter.setLayerBuffer(kDisplay, kLayer, 1, nullptr, -1);
+    ASSERT_TRUE(takeLayerCommand(kLayer).has_value());
+
+    mWriter.setLayerPlaneAlpha(kDisplay, kLayer, 0.5f);
+    mWriter.setLayerBuffer(kDisplay, kLayer, 1, nullptr, -1);
+
+    EXPECT_FALSE(takeLayerCommand(kLayer).has_value());
+    EXPECT_EQ(2u, mWriter.getElidedLayerCommandCount());
+}
+
+TEST_F(ComposerClientWriterTest, ChangedPropertyIsWritten) {
+    mWriter.setLayerPlaneAlpha(kDisplay, kLayer, 0.5f);
+    mWriter.setLayerZOrder(kDisplay, kLayer, 1);
+    ASSERT_TRUE(takeLayerCommand(kLayer).has_value());
+
+    mWriter.setLayerPlaneAlpha(kDisplay, kLayer, 1.f);
+    mWriter.setLayerZOrder(kDisplay, kLayer, 1);
+
+    const auto command = takeLayerCommand(kLayer);
+    ASSERT_TRUE(command.has_value());
+    ASSERT_TRUE(command->planeAlpha.has_value());
+    EXPECT_EQ(1.f, command->planeAlpha->alpha);
+    EXPECT_FALSE(command->z.has_value());
+    EXPECT_EQ(1u, mWriter.getElidedLayerCommandCount());
+}
+
+TEST_F(ComposerClientWriterTest, ClearedSlotForcesBufferRewrite) {
+    mWriter.setLayerBuffer(kDisplay, kLayer, 1, nullptr, -1);
+    ASSERT_TRUE(takeLayerCommand(kLayer).has_value());
+
+    mWriter.setLayerBufferSlotsToClear(kDisplay, kLayer, {1});
+    mWriter.setLayerBuffer(kDisplay, kLayer, 1, nullptr, -1);
+
+    const auto command = takeLayerCommand(kLayer);
+    ASSERT_TRUE(command.has_value());
+    ASSERT_TRUE(command->buffer.has_value());
+    EXPECT_EQ(1, command->buffer->slot);
+    EXPECT_EQ(0u, mWriter.getElidedLayerCommandCount());
+}
+
+TEST_F(ComposerClientWriterTest, LifecycleCommandForgetsState) {
+    for (const auto type : {LayerLifecycleBatchCommandType::CREATE,
+                            LayerLifecycleBatchCommandType::DESTROY}) {
+        mWriter.setLayerPlaneAlpha(kDisplay, kLayer, 0.5f);
+        takeLayerCommand(kLayer);
+
+        mWriter.setLayerLifecycleBatchCommandType(kDisplay, kLayer, type);
+        mWriter.setLayerPlaneAlpha(kDisplay, kLayer, 0.5f);
+
+        const auto command = takeLayerCommand(kLayer);
+        ASSERT_TRUE(command.has_value());
+        EXPECT_TRUE(command->planeAlpha.has_value()) << toString(type);
+    }
+}
+
+TEST_F(ComposerClientWriterTest, ModifyCommandKeepsState) {
+    mWriter.setLayerPlaneAlpha(kDisplay, kLayer, 0.5f);
+    takeLayerCommand(kLayer);
+
+    mWriter.setLayerLifecycleBatchCommandType(kDisplay, kLayer,
+                                              LayerLifecycleBatchCommandType::MODIFY);
+    mWriter.setLayerPlaneAlpha(kDisplay, kLayer, 0.5f);
+
+    const auto command = takeLayerCommand(kLayer);
+    ASSERT_TRUE(command.has_value());
+    EXPECT_FALSE(command->planeAlpha.has_value());
+}
+
+TEST_F(ComposerClientWriterTest, ForgetLayerStateForgetsOneLayer) {
+    mWriter.setLayerPlaneAlpha(kDisplay, kLayer, 0.5f);
+    mWriter.setLayerPlaneAlpha(kDisplay, kOtherLayer, 0.5f);
+    mWriter.takePendingCommands();
+
+    mWriter.forgetLayerState(kLayer);
+    mWriter.setLayerPlaneAlpha(kDisplay, kLayer, 0.5f);
+    mWriter.setLayerPlaneAlpha(kDisplay, kOtherLayer, 0.5f);
+
+    const auto& pending = mWriter.getPendingCommands();
+    ASSERT_EQ(1u, pending.size());
+    ASSERT_EQ(1u, pending[0].layers.size());
+    EXPECT_EQ(kLayer, pending[0].layers[0].layer);
+    EXPECT_TRUE(pending[0].layers[0].planeAlpha.has_value());
+}
+
+TEST_F(ComposerClientWriterTest, ForgetLayerStateForgetsAllLayers) {
+    mWriter.setLayerPlaneAlpha(kDisplay, kLayer, 0.5f);
+    mWriter.setLayerPlaneAlpha(kDisplay, kOtherLayer, 0.5f);
+    mWriter.takePendingCommands();
+
+    mWriter.forgetLayerState();
+    mWriter.setLayerPlaneAlpha(kDisplay, kLayer, 0.5f);
+    mWriter.setLayerPlaneAlpha(kDisplay, kOtherLayer, 0.5f);
+
+    const auto& pending = mWriter.getPendingCommands();
+    ASSERT_EQ(1u, pending.size());
+    EXPECT_EQ(2u, pending[0].layers.size());
+    EXPECT_EQ(0u, mWriter.getElidedLayerCommandCount());
+}
+
+TEST_F(ComposerClientWriterTest, AcceptDisplayChangesForgetsCompositionType) {
+    mWriter.setLayerCompositionType(kDisplay, kLayer, Composition::DEVICE);
+    mWriter.setLayerPlaneAlpha(kDisplay, kLayer, 0.5f);
+    mWriter.validateDisplay(kDisplay, ComposerClientWriter::kNoTimestamp, 0);
+    takeLayerCommand(kLayer);
+
+    // The composer changed the layer to CLIENT, which accepting the changes applies.
+    mWriter.acceptDisplayChanges(kDisplay);
+    mWriter.setLayerCompositionType(kDisplay, kLayer, Composition::DEVICE);
+    mWriter.setLayerPlaneAlpha(kDisplay, kLayer, 0.5f);
+
+    const auto command = takeLayerCommand(kLayer);
+    ASSERT_TRUE(command.has_value());
+    ASSERT_TRUE(command->composition.has_value());
+    EXPECT_EQ(Composition::DEVICE, command->composition->composition);
+    EXPECT_FALSE(command->planeAlpha.has_value());
+}
+
+TEST_F(ComposerClientWriterTest, PresentOrValidateForgetsCompositionType) {
+    mWriter.setLayerCompositionType(kDisplay, kLayer, Composition::DEVICE);
+    mWriter.presentOrvalidateDisplay(kDisplay, ComposerClientWriter::kNoTimestamp, 0);
+    takeLayerCommand(kLayer);
+
+    mWriter.setLayerCompositionType(kDisplay, kLayer, Composition::DEVICE);
+
+    const auto command = takeLayerCommand(kLayer);
+    ASSERT_TRUE(command.has_value());
+    EXPECT_TRUE(command->composition.has_value());
+}
+
+TEST_F(ComposerClientWriterTest, UntrackedWriterWritesEveryProperty) {
+    mWriter.setLayerStateTracking(false);
+    mWriter.setLayerPlaneAlpha(kDisplay, kLayer, 0.5f);
+    takeLayerCommand(kLayer);
+
+    mWriter.setLayerPlaneAlpha(kDisplay, kLayer, 0.5f);
+
+    const auto command = takeLayerCommand(kLayer);
+    ASSERT_TRUE(command.has_value());
+    EXPECT_TRUE(command->planeAlpha.has_value());
+    EXPECT_EQ(0u, mWriter.getElidedLayerCommandCount());
+}
+
+TEST_F(ComposerClientWriterTest, RecycledFrameMatchesTakenFrame) {
+    ComposerClientWriter recycling(kDisplay);
+    ComposerClientWriter taking(kDisplay);
+    writeFirstFrame(recycling);
+    writeFirstFrame(taking);
+    ASSERT_EQ(taking.takePendingCommands(), recycling.getPendingCommands());
+    recycling.clearPendingCommands();
+
+    writeSecondFrame(recycling);
+    writeSecondFrame(taking);
+
+    EXPECT_EQ(taking.takePendingCommands(), recycling.getPendingCommands());
+}
+
+TEST_F(ComposerClientWriterTest, RecycledFrameDoesNotLeakPreviousFrame) {
+    ComposerClientWriter writer(kDisplay);
+    writeFirstFrame(writer);
+    writer.getPendingCommands();
+    writer.clearPendingCommands();
+
+    writeSecondFrame(writer);
+
+    const auto& pending = writer.getPendingCommands();
+    ASSERT_EQ(1u, pending.size());
+    EXPECT_FALSE(pending[0].colorTransformMatrix.has_value());
+    ASSERT_EQ(2u, pending[0].layers.size());
+
+    const LayerCommand& otherLayerCommand = pending[0].layers[0];
+    EXPECT_EQ(kOtherLayer, otherLayerCommand.layer);
+    EXPECT_FALSE(otherLayerCommand.damage.has_value());
+    ASSERT_TRUE(otherLayerCommand.visibleRegion.has_value());
+    EXPECT_EQ(1u, otherLayerCommand.visibleRegion->size());
+
+    const LayerCommand& layerCommand = pending[0].layers[1];
+    EXPECT_EQ(kLayer, layerCommand.layer);
+    ASSERT_TRUE(layerCommand.damage.has_value());
+    ASSERT_EQ(1u, layerCommand.damage->size());
+    EXPECT_EQ((Rect{7, 7, 8, 8}), (*layerCommand.damage)[0]);
+    EXPECT_FALSE(layerCommand.visibleRegion.has_value());
+    EXPECT_FALSE(layerCommand.blockingRegion.has_value());
+    EXPECT_FALSE(layerCommand.colorTransform.has_value());
+    EXPECT_FALSE(layerCommand.bufferSlotsToClear.has_value());
+    EXPECT_TRUE(layerCommand.planeAlpha.has_value());
+}
+
+}  // namespace
+}  // namespace aidl::android::hardware::graphics::composer3
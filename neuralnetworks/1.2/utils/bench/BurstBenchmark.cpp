@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/logging.h>
+#include <android/hardware/neuralnetworks/1.0/types.h>
+#include <android/hardware/neuralnetworks/1.2/types.h>
+#include <nnapi/hal/1.2/BurstUtils.h>
+
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace android::hardware::neuralnetworks::V1_2::utils {
+namespace {
+
+// Measures the round trip of a burst execution over the request and result FMQs, with a server
+// thread which answers each request immediately. The "InPlace" benchmarks serialize and deserialize
+// packets directly in the FMQs, while the "Staged" ones go through a vector of FMQ elements on
+// both sides, as every execution used to.
+
+constexpr size_t kNumInputs = 4;
+constexpr size_t kNumOutputs = 2;
+constexpr size_t kNumSlots = 3;
+constexpr uint32_t kDimensions[] = {1, 224, 224, 3};
+constexpr Timing kTiming = {std::numeric_limits<uint64_t>::max(),
+                            std::numeric_limits<uint64_t>::max()};
+
+V1_0::Request makeRequest() {
+    const auto makeArgument = [](uint32_t poolIndex) {
+        return V1_0::RequestArgument{
+                .hasNoValue = false,
+                .location = {.poolIndex = poolIndex, .offset = 0, .length = 224 * 224 * 3},
+                .dimensions = std::vector<uint32_t>(std::begin(kDimensions),
+                                                    std::end(kDimensions))};
+    };
+    V1_0::Request request;
+    request.inputs.resize(kNumInputs);
+    for (size_t i = 0; i < kNumInputs; ++i) {
+        request.inputs[i] = makeArgument(i % kNumSlots);
+    }
+    request.outputs.resize(kNumOutputs);
+    for (size_t i = 0; i < kNumOutputs; ++i) {
+        request.outputs[i] = makeArgument(i % kNumSlots);
+    }
+    return request;
+}
+
+std::vector<OutputShape> makeOutputShapes() {
+    std::vector<OutputShape> outputShapes(kNumOutputs);
+    for (auto& outputShape : outputShapes) {
+        outputShape.dimensions =
+                std::vector<uint32_t>(std::begin(kDimensions), std::end(kDimensions));
+        outputShape.isSufficient = true;
+    }
+    return outputShapes;
+}
+
+// Both ends of the request and result channels, with a server thread answering the requests.
+class BurstChannels {
+  public:
+    explicit BurstChannels(bool inPlace) {
+        auto [requestSender, requestDescriptor] =
+                RequestChannelSender::create(kExecutionBurstChannelLength).value();
+        auto [resultReceiver, resultDescriptor] =
+                ResultChannelReceiver::create(kExecutionBurstChannelLength,
+                                              std::chrono::microseconds{0})
+                        .value();
+        mRequestSender = std::move(requestSender);
+        mResultReceiver = std::move(resultReceiver);
+        mRequestReceiver =
+                RequestChannelReceiver::create(*requestDescriptor, std::chrono::microseconds{0})
+                        .value();
+        mResultSender = ResultChannelSender::create(*resultDescriptor).value();
+        mServer = std::thread([this, inPlace] { serve(inPlace); });
+    }
+
+    ~BurstChannels() {
+        mRequestReceiver->invalidate();
+        mServer.join();
+    }
+
+    RequestChannelSender& requestSender() { return *mRequestSender; }
+    ResultChannelReceiver& resultReceiver() { return *mResultReceiver; }
+
+  private:
+    void serve(bool inPlace) {
+        const auto outputShapes = makeOutputShapes();
+        while (true) {
+            if (inPlace) {
+                if (!mRequestReceiver->getBlocking().ok()) {
+                    return;
+                }
+                mResultSender->send(V1_0::ErrorStatus::NONE, outputShapes, kTiming);
+            } else {
+                const auto packet = mRequestReceiver->getPacketBlocking();
+                if (!packet.ok() || !deserialize(packet.value()).ok()) {
+                    return;
+                }
+                mResultSender->sendPacket(
+                        serialize(V1_0::ErrorStatus::NONE, outputShapes, kTiming));
+            }
+        }
+    }
+
+    std::unique_ptr<RequestChannelSender> mRequestSender;
+    std::unique_ptr<ResultChannelReceiver> mResultReceiver;
+    std::unique_ptr<RequestChannelReceiver> mRequestReceiver;
+    std::unique_ptr<ResultChannelSender> mResultSender;
+    std::thread mServer;
+};
+
+void BM_BurstRoundTripInPlace(benchmark::State& state) {
+    BurstChannels channels(/*inPlace=*/true);
+    const auto request = makeRequest();
+    const std::vector<int32_t> slots = {0, 1, 2};
+    for (auto _ : state) {
+        CHECK(channels.requestSender().send(request, MeasureTiming::NO, slots).ok());
+        const auto result = channels.resultReceiver().getBlocking();
+        CHECK(result.ok());
+        benchmark::DoNotOptimize(result);
+    }
+}
+
+void BM_BurstRoundTripStaged(benchmark::State& state) {
+    BurstChannels channels(/*inPlace=*/false);
+    const auto request = makeRequest();
+    const std::vector<int32_t> slots = {0, 1, 2};
+    for (auto _ : state) {
+        const auto packet = serialize(request, MeasureTiming::NO, slots);
+        CHECK(channels.requestSender().sendPacket(packet).ok());
+        const auto resultPacket = channels.resultReceiver().getPacketBlocking();
+        CHECK(resultPacket.ok());
+        const auto result = deserialize(resultPacket.value());
+        CHECK(result.ok());
+        benchmark::DoNotOptimize(result);
+    }
+}
+
+BENCHMARK(BM_BurstRoundTripInPlace)->UseRealTime();
+BENCHMARK(BM_BurstRoundTripStaged)->UseRealTime();
+
+}  // namespace
+}  // namespace android::hardware::neuralnetworks::V1_2::utils
+
+BENCHMARK_MAIN();
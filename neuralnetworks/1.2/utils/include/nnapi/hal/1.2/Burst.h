@@ -185,7 +185,7 @@ class Burst final : public nn::IBurst, public std::enable_shared_from_this<Burst
     // execution path if the packet could not be sent. Otherwise, failing to send the packet will
     // result in an error.
     nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>> executeInternal(
-            const std::vector<FmqRequestDatum>& requestPacket,
+            const V1_0::Request& request, MeasureTiming measure, const std::vector<int32_t>& slots,
             const hal::utils::RequestRelocation& relocation, FallbackFunction fallback) const;
 
   private:
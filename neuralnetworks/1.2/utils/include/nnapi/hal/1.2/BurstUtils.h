@@ -19,6 +19,7 @@
 
 #include <android/hardware/neuralnetworks/1.0/types.h>
 #include <android/hardware/neuralnetworks/1.2/types.h>
+#include <fmq/EventFlag.h>
 #include <fmq/MessageQueue.h>
 #include <hidl/MQDescriptor.h>
 #include <nnapi/Result.h>
@@ -126,6 +127,8 @@ class RequestChannelSender final : public neuralnetworks::utils::IProtectedCallb
     /**
      * Send the request to the channel.
      *
+     * The request is serialized directly into the FMQ, without an intermediate buffer.
+     *
      * @param request Request object without the pool information.
      * @param measure Whether to collect timing information for the execution.
      * @param slots Slot identifiers corresponding to memory resources for the request.
@@ -144,9 +147,11 @@ class RequestChannelSender final : public neuralnetworks::utils::IProtectedCallb
     nn::Result<void> sendPacket(const std::vector<FmqRequestDatum>& packet);
 
     RequestChannelSender(PrivateConstructorTag tag, size_t channelLength);
+    ~RequestChannelSender() override;
 
   private:
     MessageQueue<FmqRequestDatum, kSynchronizedReadWrite> mFmqRequestChannel;
+    EventFlag* mEventFlag = nullptr;
     std::atomic<bool> mValid{true};
 };
 
@@ -181,6 +186,8 @@ class RequestChannelReceiver final {
      * 1) The packet has been retrieved, or
      * 2) The receiver has been invalidated
      *
+     * The packet is deserialized in place from the FMQ.
+     *
      * @return Request object if successfully received, an appropriate message if error or if the
      *     receiver object was invalidated.
      */
@@ -192,12 +199,16 @@ class RequestChannelReceiver final {
      */
     void invalidate();
 
+    // prefer calling RequestChannelReceiver::getBlocking
+    nn::Result<std::vector<FmqRequestDatum>> getPacketBlocking();
+
     RequestChannelReceiver(PrivateConstructorTag tag,
                            const MQDescriptorSync<FmqRequestDatum>& requestChannel,
                            std::chrono::microseconds pollingTimeWindow);
 
   private:
-    nn::Result<std::vector<FmqRequestDatum>> getPacketBlocking();
+    // Waits for a packet and reads its first element, returning the number of remaining elements.
+    nn::Result<size_t> readFirstDatumBlocking(FmqRequestDatum* datum);
 
     MessageQueue<FmqRequestDatum, kSynchronizedReadWrite> mFmqRequestChannel;
     std::atomic<bool> mTeardown{false};
@@ -224,6 +235,8 @@ class ResultChannelSender final {
     /**
      * Send the result to the channel.
      *
+     * The result is serialized directly into the FMQ, without an intermediate buffer.
+     *
      * @param errorStatus Status of the execution.
      * @param outputShapes Dynamic shapes of the output tensors.
      * @param timing Timing information of the execution.
@@ -236,9 +249,11 @@ class ResultChannelSender final {
 
     ResultChannelSender(PrivateConstructorTag tag,
                         const MQDescriptorSync<FmqResultDatum>& resultChannel);
+    ~ResultChannelSender();
 
   private:
     MessageQueue<FmqResultDatum, kSynchronizedReadWrite> mFmqResultChannel;
+    EventFlag* mEventFlag = nullptr;
 };
 
 /**
@@ -273,6 +288,8 @@ class ResultChannelReceiver final : public neuralnetworks::utils::IProtectedCall
      * 1) The packet has been retrieved, or
      * 2) The receiver has been invalidated
      *
+     * The packet is deserialized in place from the FMQ.
+     *
      * @return Result object if successfully received, otherwise an appropriate message if error or
      *     if the receiver object was invalidated.
      */
@@ -291,6 +308,9 @@ class ResultChannelReceiver final : public neuralnetworks::utils::IProtectedCall
                           std::chrono::microseconds pollingTimeWindow);
 
   private:
+    // Waits for a packet and reads its first element, returning the number of remaining elements.
+    nn::Result<size_t> readFirstDatumBlocking(FmqResultDatum* datum);
+
     MessageQueue<FmqResultDatum, kSynchronizedReadWrite> mFmqResultChannel;
     std::atomic<bool> mValid{true};
     const std::chrono::microseconds kPollingTimeWindow;
@@ -55,12 +55,13 @@ class BurstExecution final : public nn::IExecution,
 
   public:
     static nn::GeneralResult<std::shared_ptr<const BurstExecution>> create(
-            std::shared_ptr<const Burst> controller, std::vector<FmqRequestDatum> request,
-            hal::utils::RequestRelocation relocation,
+            std::shared_ptr<const Burst> controller, V1_0::Request request, MeasureTiming measure,
+            std::vector<int32_t> slots, hal::utils::RequestRelocation relocation,
             std::vector<Burst::OptionalCacheHold> cacheHolds);
 
     BurstExecution(PrivateConstructorTag tag, std::shared_ptr<const Burst> controller,
-                   std::vector<FmqRequestDatum> request, hal::utils::RequestRelocation relocation,
+                   V1_0::Request request, MeasureTiming measure, std::vector<int32_t> slots,
+                   hal::utils::RequestRelocation relocation,
                    std::vector<Burst::OptionalCacheHold> cacheHolds);
 
     nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>> compute(
@@ -72,7 +73,9 @@ class BurstExecution final : public nn::IExecution,
 
   private:
     const std::shared_ptr<const Burst> kController;
-    const std::vector<FmqRequestDatum> kRequest;
+    const V1_0::Request kRequest;
+    const MeasureTiming kMeasure;
+    const std::vector<int32_t> kSlots;
     const hal::utils::RequestRelocation kRelocation;
     const std::vector<Burst::OptionalCacheHold> kCacheHolds;
 };
@@ -345,11 +348,10 @@ nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>> Burst::
     }
 
     // send request packet
-    const auto requestPacket = serialize(hidlRequest, hidlMeasure, slots);
     const auto fallback = [this, &request, measure, &deadline, &loopTimeoutDuration] {
         return kPreparedModel->execute(request, measure, deadline, loopTimeoutDuration, {}, {});
     };
-    return executeInternal(requestPacket, relocation, fallback);
+    return executeInternal(hidlRequest, hidlMeasure, slots, relocation, fallback);
 }
 
 // See IBurst::createReusableExecution for information on this method.
@@ -391,14 +393,14 @@ nn::GeneralResult<nn::SharedExecution> Burst::createReusableExecution(
         holds.push_back(std::move(hold));
     }
 
-    const auto requestPacket = serialize(hidlRequest, hidlMeasure, slots);
-    return BurstExecution::create(shared_from_this(), std::move(requestPacket),
-                                  std::move(relocation), std::move(holds));
+    return BurstExecution::create(shared_from_this(), std::move(hidlRequest), hidlMeasure,
+                                  std::move(slots), std::move(relocation), std::move(holds));
 }
 
 nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>> Burst::executeInternal(
-        const std::vector<FmqRequestDatum>& requestPacket,
-        const hal::utils::RequestRelocation& relocation, FallbackFunction fallback) const {
+        const V1_0::Request& request, V1_2::MeasureTiming measure,
+        const std::vector<int32_t>& slots, const hal::utils::RequestRelocation& relocation,
+        FallbackFunction fallback) const {
     NNTRACE_FULL(NNTRACE_LAYER_IPC, NNTRACE_PHASE_EXECUTION, "Burst::executeInternal");
 
     // Ensure that at most one execution is in flight at any given time.
@@ -413,7 +415,7 @@ nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>> Burst::
     }
 
     // send request packet
-    const auto sendStatus = mRequestChannelSender->sendPacket(requestPacket);
+    const auto sendStatus = mRequestChannelSender->send(request, measure, slots);
     if (!sendStatus.ok()) {
         // fallback to another execution path if the packet could not be sent
         if (fallback) {
@@ -432,31 +434,34 @@ nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>> Burst::
 }
 
 nn::GeneralResult<std::shared_ptr<const BurstExecution>> BurstExecution::create(
-        std::shared_ptr<const Burst> controller, std::vector<FmqRequestDatum> request,
-        hal::utils::RequestRelocation relocation,
+        std::shared_ptr<const Burst> controller, V1_0::Request request, V1_2::MeasureTiming measure,
+        std::vector<int32_t> slots, hal::utils::RequestRelocation relocation,
         std::vector<Burst::OptionalCacheHold> cacheHolds) {
     if (controller == nullptr) {
         return NN_ERROR() << "V1_2::utils::BurstExecution::create must have non-null controller";
     }
 
-    return std::make_shared<const BurstExecution>(PrivateConstructorTag{}, std::move(controller),
-                                                  std::move(request), std::move(relocation),
-                                                  std::move(cacheHolds));
+    return std::make_shared<const BurstExecution>(
+            PrivateConstructorTag{}, std::move(controller), std::move(request), measure,
+            std::move(slots), std::move(relocation), std::move(cacheHolds));
 }
 
 BurstExecution::BurstExecution(PrivateConstructorTag /*tag*/,
-                               std::shared_ptr<const Burst> controller,
-                               std::vector<FmqRequestDatum> request,
+                               std::shared_ptr<const Burst> controller, V1_0::Request request,
+                               V1_2::MeasureTiming measure, std::vector<int32_t> slots,
                                hal::utils::RequestRelocation relocation,
                                std::vector<Burst::OptionalCacheHold> cacheHolds)
     : kController(std::move(controller)),
       kRequest(std::move(request)),
+      kMeasure(measure),
+      kSlots(std::move(slots)),
       kRelocation(std::move(relocation)),
       kCacheHolds(std::move(cacheHolds)) {}
 
 nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>> BurstExecution::compute(
         const nn::OptionalTimePoint& /*deadline*/) const {
-    return kController->executeInternal(kRequest, kRelocation, /*fallback=*/nullptr);
+    return kController->executeInternal(kRequest, kMeasure, kSlots, kRelocation,
+                                        /*fallback=*/nullptr);
 }
 
 nn::GeneralResult<std::pair<nn::SyncFence, nn::ExecuteFencedInfoCallback>>
@@ -21,6 +21,7 @@
 #include <android/hardware/neuralnetworks/1.0/types.h>
 #include <android/hardware/neuralnetworks/1.1/types.h>
 #include <android/hardware/neuralnetworks/1.2/types.h>
+#include <fmq/EventFlag.h>
 #include <fmq/MessageQueue.h>
 #include <hidl/MQDescriptor.h>
 #include <nnapi/Result.h>
@@ -29,7 +30,10 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstring>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <thread>
 #include <tuple>
 #include <utility>
@@ -54,20 +58,15 @@ std::chrono::microseconds getPollingTimeWindow(const std::string& property) {
 #endif  // NN_DEBUGGABLE
 }
 
-}  // namespace
-
-std::chrono::microseconds getBurstControllerPollingTimeWindow() {
-    return getPollingTimeWindow("debug.nn.burst-controller-polling-window");
-}
+// Notification bit which MessageQueue::writeBlocking signals and MessageQueue::readBlocking waits
+// on by default. Packets written in place must wake the reader with the same bit.
+constexpr uint32_t kFmqNotEmpty = 1 << 1;
 
-std::chrono::microseconds getBurstServerPollingTimeWindow() {
-    return getPollingTimeWindow("debug.nn.burst-server-polling-window");
-}
+using RequestQueue = MessageQueue<FmqRequestDatum, kSynchronizedReadWrite>;
+using ResultQueue = MessageQueue<FmqResultDatum, kSynchronizedReadWrite>;
 
-// serialize a request into a packet
-std::vector<FmqRequestDatum> serialize(const V1_0::Request& request, V1_2::MeasureTiming measure,
-                                       const std::vector<int32_t>& slots) {
-    // count how many elements need to be sent for a request
+// count how many elements need to be sent for a request
+size_t getPacketSize(const V1_0::Request& request, const std::vector<int32_t>& slots) {
     size_t count = 2 + request.inputs.size() + request.outputs.size() + slots.size();
     for (const auto& input : request.inputs) {
         count += input.dimensions.size();
@@ -76,246 +75,235 @@ std::vector<FmqRequestDatum> serialize(const V1_0::Request& request, V1_2::Measu
         count += output.dimensions.size();
     }
     CHECK_LE(count, std::numeric_limits<uint32_t>::max());
+    return count;
+}
+
+// count how many elements need to be sent for a result
+size_t getPacketSize(const std::vector<V1_2::OutputShape>& outputShapes) {
+    size_t count = 2 + outputShapes.size();
+    for (const auto& outputShape : outputShapes) {
+        count += outputShape.dimensions.size();
+    }
+    CHECK_LE(count, std::numeric_limits<uint32_t>::max());
+    return count;
+}
 
-    // create buffer to temporarily store elements
-    std::vector<FmqRequestDatum> data;
-    data.reserve(count);
+// Serializes a request, passing each element of the packet to write in order. This lets the packet
+// be written straight into an FMQ instead of being staged in a buffer.
+template <typename WriteFunction>
+void serializeRequest(const V1_0::Request& request, V1_2::MeasureTiming measure,
+                      const std::vector<int32_t>& slots, const WriteFunction& write) {
+    const size_t count = getPacketSize(request, slots);
+    FmqRequestDatum datum;
 
     // package packetInfo
-    data.emplace_back();
-    data.back().packetInformation(
+    datum.packetInformation(
             {.packetSize = static_cast<uint32_t>(count),
              .numberOfInputOperands = static_cast<uint32_t>(request.inputs.size()),
              .numberOfOutputOperands = static_cast<uint32_t>(request.outputs.size()),
              .numberOfPools = static_cast<uint32_t>(slots.size())});
+    write(datum);
 
     // package input data
     for (const auto& input : request.inputs) {
         // package operand information
-        data.emplace_back();
-        data.back().inputOperandInformation(
+        datum.inputOperandInformation(
                 {.hasNoValue = input.hasNoValue,
                  .location = input.location,
                  .numberOfDimensions = static_cast<uint32_t>(input.dimensions.size())});
+        write(datum);
 
         // package operand dimensions
         for (uint32_t dimension : input.dimensions) {
-            data.emplace_back();
-            data.back().inputOperandDimensionValue(dimension);
+            datum.inputOperandDimensionValue(dimension);
+            write(datum);
         }
     }
 
     // package output data
     for (const auto& output : request.outputs) {
         // package operand information
-        data.emplace_back();
-        data.back().outputOperandInformation(
+        datum.outputOperandInformation(
                 {.hasNoValue = output.hasNoValue,
                  .location = output.location,
                  .numberOfDimensions = static_cast<uint32_t>(output.dimensions.size())});
+        write(datum);
 
         // package operand dimensions
         for (uint32_t dimension : output.dimensions) {
-            data.emplace_back();
-            data.back().outputOperandDimensionValue(dimension);
+            datum.outputOperandDimensionValue(dimension);
+            write(datum);
         }
     }
 
     // package pool identifier
     for (int32_t slot : slots) {
-        data.emplace_back();
-        data.back().poolIdentifier(slot);
+        datum.poolIdentifier(slot);
+        write(datum);
     }
 
     // package measureTiming
-    data.emplace_back();
-    data.back().measureTiming(measure);
-
-    CHECK_EQ(data.size(), count);
-
-    // return packet
-    return data;
+    datum.measureTiming(measure);
+    write(datum);
 }
 
-// serialize result
-std::vector<FmqResultDatum> serialize(V1_0::ErrorStatus errorStatus,
-                                      const std::vector<V1_2::OutputShape>& outputShapes,
-                                      V1_2::Timing timing) {
-    // count how many elements need to be sent for a request
-    size_t count = 2 + outputShapes.size();
-    for (const auto& outputShape : outputShapes) {
-        count += outputShape.dimensions.size();
-    }
-
-    // create buffer to temporarily store elements
-    std::vector<FmqResultDatum> data;
-    data.reserve(count);
+// Serializes a result, passing each element of the packet to write in order.
+template <typename WriteFunction>
+void serializeResult(V1_0::ErrorStatus errorStatus,
+                     const std::vector<V1_2::OutputShape>& outputShapes, V1_2::Timing timing,
+                     const WriteFunction& write) {
+    const size_t count = getPacketSize(outputShapes);
+    FmqResultDatum datum;
 
     // package packetInfo
-    data.emplace_back();
-    data.back().packetInformation({.packetSize = static_cast<uint32_t>(count),
-                                   .errorStatus = errorStatus,
-                                   .numberOfOperands = static_cast<uint32_t>(outputShapes.size())});
+    datum.packetInformation({.packetSize = static_cast<uint32_t>(count),
+                             .errorStatus = errorStatus,
+                             .numberOfOperands = static_cast<uint32_t>(outputShapes.size())});
+    write(datum);
 
     // package output shape data
     for (const auto& operand : outputShapes) {
         // package operand information
-        data.emplace_back();
-        data.back().operandInformation(
+        datum.operandInformation(
                 {.isSufficient = operand.isSufficient,
                  .numberOfDimensions = static_cast<uint32_t>(operand.dimensions.size())});
+        write(datum);
 
         // package operand dimensions
         for (uint32_t dimension : operand.dimensions) {
-            data.emplace_back();
-            data.back().operandDimensionValue(dimension);
+            datum.operandDimensionValue(dimension);
+            write(datum);
         }
     }
 
     // package executionTiming
-    data.emplace_back();
-    data.back().executionTiming(timing);
-
-    CHECK_EQ(data.size(), count);
-
-    // return result
-    return data;
+    datum.executionTiming(timing);
+    write(datum);
 }
 
-// deserialize request
-nn::Result<std::tuple<V1_0::Request, std::vector<int32_t>, V1_2::MeasureTiming>> deserialize(
-        const std::vector<FmqRequestDatum>& data) {
+// Deserializes a request packet of size elements, where get(index) returns a copy of an element.
+// Each element is copied once before it is inspected, so the packet may be read in place from an
+// FMQ whose other end is not trusted.
+template <typename GetFunction>
+nn::Result<std::tuple<V1_0::Request, std::vector<int32_t>, V1_2::MeasureTiming>>
+deserializeRequest(size_t size, const GetFunction& get) {
     using discriminator = FmqRequestDatum::hidl_discriminator;
 
     size_t index = 0;
+    const auto next = [&get, &index, size](discriminator expected) {
+        std::optional<FmqRequestDatum> datum;
+        if (index < size) {
+            datum = get(index++);
+            if (datum->getDiscriminator() != expected) {
+                datum.reset();
+            }
+        }
+        return datum;
+    };
 
     // validate packet information
-    if (index >= data.size() ||
-        data.at(index).getDiscriminator() != discriminator::packetInformation) {
+    const auto packetInfoDatum = next(discriminator::packetInformation);
+    if (!packetInfoDatum.has_value()) {
         return NN_ERROR() << "FMQ Request packet ill-formed";
     }
 
     // unpackage packet information
-    const FmqRequestDatum::PacketInformation& packetInfo = data.at(index).packetInformation();
-    index++;
+    const FmqRequestDatum::PacketInformation& packetInfo = packetInfoDatum->packetInformation();
     const uint32_t packetSize = packetInfo.packetSize;
     const uint32_t numberOfInputOperands = packetInfo.numberOfInputOperands;
     const uint32_t numberOfOutputOperands = packetInfo.numberOfOutputOperands;
     const uint32_t numberOfPools = packetInfo.numberOfPools;
 
     // verify packet size
-    if (data.size() != packetSize) {
+    if (size != packetSize) {
         return NN_ERROR() << "FMQ Request packet ill-formed";
     }
 
-    // unpackage input operands
-    std::vector<V1_0::RequestArgument> inputs;
-    inputs.reserve(numberOfInputOperands);
-    for (size_t operand = 0; operand < numberOfInputOperands; ++operand) {
-        // validate input operand information
-        if (index >= data.size() ||
-            data.at(index).getDiscriminator() != discriminator::inputOperandInformation) {
-            return NN_ERROR() << "FMQ Request packet ill-formed";
-        }
-
-        // unpackage operand information
-        const FmqRequestDatum::OperandInformation& operandInfo =
-                data.at(index).inputOperandInformation();
-        index++;
-        const bool hasNoValue = operandInfo.hasNoValue;
-        const V1_0::DataLocation location = operandInfo.location;
-        const uint32_t numberOfDimensions = operandInfo.numberOfDimensions;
+    // verify that the packet can hold all of its operands and pools before allocating them
+    const size_t numberOfOperandsAndPools =
+            static_cast<size_t>(numberOfInputOperands) + numberOfOutputOperands + numberOfPools;
+    if (numberOfOperandsAndPools > size) {
+        return NN_ERROR() << "FMQ Request packet ill-formed";
+    }
 
-        // unpackage operand dimensions
-        std::vector<uint32_t> dimensions;
-        dimensions.reserve(numberOfDimensions);
-        for (size_t i = 0; i < numberOfDimensions; ++i) {
-            // validate dimension
-            if (index >= data.size() ||
-                data.at(index).getDiscriminator() != discriminator::inputOperandDimensionValue) {
-                return NN_ERROR() << "FMQ Request packet ill-formed";
+    // unpackage operands
+    const auto unpackageOperands =
+            [&next, &index, size](hidl_vec<V1_0::RequestArgument>* operands,
+                                  discriminator informationDiscriminator,
+                                  discriminator dimensionDiscriminator) -> bool {
+        for (auto& operand : *operands) {
+            // validate operand information
+            const auto operandInfoDatum = next(informationDiscriminator);
+            if (!operandInfoDatum.has_value()) {
+                return false;
             }
 
-            // unpackage dimension
-            const uint32_t dimension = data.at(index).inputOperandDimensionValue();
-            index++;
-
-            // store result
-            dimensions.push_back(dimension);
+            // unpackage operand information
+            const FmqRequestDatum::OperandInformation& operandInfo =
+                    informationDiscriminator == discriminator::inputOperandInformation
+                            ? operandInfoDatum->inputOperandInformation()
+                            : operandInfoDatum->outputOperandInformation();
+            const uint32_t numberOfDimensions = operandInfo.numberOfDimensions;
+            if (numberOfDimensions > size - index) {
+                return false;
+            }
+            operand.hasNoValue = operandInfo.hasNoValue;
+            operand.location = operandInfo.location;
+
+            // unpackage operand dimensions
+            operand.dimensions.resize(numberOfDimensions);
+            for (uint32_t& dimension : operand.dimensions) {
+                // validate dimension
+                const auto dimensionDatum = next(dimensionDiscriminator);
+                if (!dimensionDatum.has_value()) {
+                    return false;
+                }
+
+                // unpackage dimension
+                dimension = dimensionDiscriminator == discriminator::inputOperandDimensionValue
+                                    ? dimensionDatum->inputOperandDimensionValue()
+                                    : dimensionDatum->outputOperandDimensionValue();
+            }
         }
+        return true;
+    };
 
-        // store result
-        inputs.push_back(
-                {.hasNoValue = hasNoValue, .location = location, .dimensions = dimensions});
+    // unpackage input operands
+    hidl_vec<V1_0::RequestArgument> inputs(numberOfInputOperands);
+    if (!unpackageOperands(&inputs, discriminator::inputOperandInformation,
+                           discriminator::inputOperandDimensionValue)) {
+        return NN_ERROR() << "FMQ Request packet ill-formed";
     }
 
     // unpackage output operands
-    std::vector<V1_0::RequestArgument> outputs;
-    outputs.reserve(numberOfOutputOperands);
-    for (size_t operand = 0; operand < numberOfOutputOperands; ++operand) {
-        // validate output operand information
-        if (index >= data.size() ||
-            data.at(index).getDiscriminator() != discriminator::outputOperandInformation) {
-            return NN_ERROR() << "FMQ Request packet ill-formed";
-        }
-
-        // unpackage operand information
-        const FmqRequestDatum::OperandInformation& operandInfo =
-                data.at(index).outputOperandInformation();
-        index++;
-        const bool hasNoValue = operandInfo.hasNoValue;
-        const V1_0::DataLocation location = operandInfo.location;
-        const uint32_t numberOfDimensions = operandInfo.numberOfDimensions;
-
-        // unpackage operand dimensions
-        std::vector<uint32_t> dimensions;
-        dimensions.reserve(numberOfDimensions);
-        for (size_t i = 0; i < numberOfDimensions; ++i) {
-            // validate dimension
-            if (index >= data.size() ||
-                data.at(index).getDiscriminator() != discriminator::outputOperandDimensionValue) {
-                return NN_ERROR() << "FMQ Request packet ill-formed";
-            }
-
-            // unpackage dimension
-            const uint32_t dimension = data.at(index).outputOperandDimensionValue();
-            index++;
-
-            // store result
-            dimensions.push_back(dimension);
-        }
-
-        // store result
-        outputs.push_back(
-                {.hasNoValue = hasNoValue, .location = location, .dimensions = dimensions});
+    hidl_vec<V1_0::RequestArgument> outputs(numberOfOutputOperands);
+    if (!unpackageOperands(&outputs, discriminator::outputOperandInformation,
+                           discriminator::outputOperandDimensionValue)) {
+        return NN_ERROR() << "FMQ Request packet ill-formed";
     }
 
     // unpackage pools
     std::vector<int32_t> slots;
     slots.reserve(numberOfPools);
     for (size_t pool = 0; pool < numberOfPools; ++pool) {
-        // validate input operand information
-        if (index >= data.size() ||
-            data.at(index).getDiscriminator() != discriminator::poolIdentifier) {
+        // validate pool identifier
+        const auto poolIdDatum = next(discriminator::poolIdentifier);
+        if (!poolIdDatum.has_value()) {
             return NN_ERROR() << "FMQ Request packet ill-formed";
         }
 
-        // unpackage operand information
-        const int32_t poolId = data.at(index).poolIdentifier();
-        index++;
-
         // store result
-        slots.push_back(poolId);
+        slots.push_back(poolIdDatum->poolIdentifier());
     }
 
     // validate measureTiming
-    if (index >= data.size() || data.at(index).getDiscriminator() != discriminator::measureTiming) {
+    const auto measureDatum = next(discriminator::measureTiming);
+    if (!measureDatum.has_value()) {
         return NN_ERROR() << "FMQ Request packet ill-formed";
     }
 
     // unpackage measureTiming
-    const V1_2::MeasureTiming measure = data.at(index).measureTiming();
-    index++;
+    const V1_2::MeasureTiming measure = measureDatum->measureTiming();
 
     // validate packet information
     if (index != packetSize) {
@@ -323,81 +311,91 @@ nn::Result<std::tuple<V1_0::Request, std::vector<int32_t>, V1_2::MeasureTiming>>
     }
 
     // return request
-    V1_0::Request request = {.inputs = inputs, .outputs = outputs, .pools = {}};
+    V1_0::Request request = {
+            .inputs = std::move(inputs), .outputs = std::move(outputs), .pools = {}};
     return std::make_tuple(std::move(request), std::move(slots), measure);
 }
 
-// deserialize a packet into the result
-nn::Result<std::tuple<V1_0::ErrorStatus, std::vector<V1_2::OutputShape>, V1_2::Timing>> deserialize(
-        const std::vector<FmqResultDatum>& data) {
+// Deserializes a result packet of size elements, where get(index) returns a copy of an element.
+template <typename GetFunction>
+nn::Result<std::tuple<V1_0::ErrorStatus, std::vector<V1_2::OutputShape>, V1_2::Timing>>
+deserializeResult(size_t size, const GetFunction& get) {
     using discriminator = FmqResultDatum::hidl_discriminator;
+
     size_t index = 0;
+    const auto next = [&get, &index, size](discriminator expected) {
+        std::optional<FmqResultDatum> datum;
+        if (index < size) {
+            datum = get(index++);
+            if (datum->getDiscriminator() != expected) {
+                datum.reset();
+            }
+        }
+        return datum;
+    };
 
     // validate packet information
-    if (index >= data.size() ||
-        data.at(index).getDiscriminator() != discriminator::packetInformation) {
+    const auto packetInfoDatum = next(discriminator::packetInformation);
+    if (!packetInfoDatum.has_value()) {
         return NN_ERROR() << "FMQ Result packet ill-formed";
     }
 
     // unpackage packet information
-    const FmqResultDatum::PacketInformation& packetInfo = data.at(index).packetInformation();
-    index++;
+    const FmqResultDatum::PacketInformation& packetInfo = packetInfoDatum->packetInformation();
     const uint32_t packetSize = packetInfo.packetSize;
     const V1_0::ErrorStatus errorStatus = packetInfo.errorStatus;
     const uint32_t numberOfOperands = packetInfo.numberOfOperands;
 
     // verify packet size
-    if (data.size() != packetSize) {
+    if (size != packetSize) {
+        return NN_ERROR() << "FMQ Result packet ill-formed";
+    }
+
+    // verify that the packet can hold all of its operands before allocating them
+    if (numberOfOperands > size) {
         return NN_ERROR() << "FMQ Result packet ill-formed";
     }
 
     // unpackage operands
-    std::vector<V1_2::OutputShape> outputShapes;
-    outputShapes.reserve(numberOfOperands);
-    for (size_t operand = 0; operand < numberOfOperands; ++operand) {
+    std::vector<V1_2::OutputShape> outputShapes(numberOfOperands);
+    for (auto& outputShape : outputShapes) {
         // validate operand information
-        if (index >= data.size() ||
-            data.at(index).getDiscriminator() != discriminator::operandInformation) {
+        const auto operandInfoDatum = next(discriminator::operandInformation);
+        if (!operandInfoDatum.has_value()) {
             return NN_ERROR() << "FMQ Result packet ill-formed";
         }
 
         // unpackage operand information
-        const FmqResultDatum::OperandInformation& operandInfo = data.at(index).operandInformation();
-        index++;
-        const bool isSufficient = operandInfo.isSufficient;
+        const FmqResultDatum::OperandInformation& operandInfo =
+                operandInfoDatum->operandInformation();
         const uint32_t numberOfDimensions = operandInfo.numberOfDimensions;
+        if (numberOfDimensions > size - index) {
+            return NN_ERROR() << "FMQ Result packet ill-formed";
+        }
+        outputShape.isSufficient = operandInfo.isSufficient;
 
         // unpackage operand dimensions
-        std::vector<uint32_t> dimensions;
-        dimensions.reserve(numberOfDimensions);
-        for (size_t i = 0; i < numberOfDimensions; ++i) {
+        outputShape.dimensions.resize(numberOfDimensions);
+        for (uint32_t& dimension : outputShape.dimensions) {
             // validate dimension
-            if (index >= data.size() ||
-                data.at(index).getDiscriminator() != discriminator::operandDimensionValue) {
+            const auto dimensionDatum = next(discriminator::operandDimensionValue);
+            if (!dimensionDatum.has_value()) {
                 return NN_ERROR() << "FMQ Result packet ill-formed";
             }
 
             // unpackage dimension
-            const uint32_t dimension = data.at(index).operandDimensionValue();
-            index++;
-
-            // store result
-            dimensions.push_back(dimension);
+            dimension = dimensionDatum->operandDimensionValue();
         }
-
-        // store result
-        outputShapes.push_back({.dimensions = dimensions, .isSufficient = isSufficient});
     }
 
     // validate execution timing
-    if (index >= data.size() ||
-        data.at(index).getDiscriminator() != discriminator::executionTiming) {
+    const auto timingDatum = next(discriminator::executionTiming);
+    if (!timingDatum.has_value()) {
         return NN_ERROR() << "FMQ Result packet ill-formed";
     }
 
     // unpackage execution timing
-    const V1_2::Timing timing = data.at(index).executionTiming();
-    index++;
+    const V1_2::Timing timing = timingDatum->executionTiming();
 
     // validate packet information
     if (index != packetSize) {
@@ -408,6 +406,96 @@ nn::Result<std::tuple<V1_0::ErrorStatus, std::vector<V1_2::OutputShape>, V1_2::T
     return std::make_tuple(errorStatus, std::move(outputShapes), timing);
 }
 
+// Reads the remaining count elements of a packet out of the queue into a vector that starts with
+// the already read first element.
+template <typename Queue, typename Datum>
+nn::Result<std::vector<Datum>> readPacket(Queue* queue, const Datum& firstDatum, size_t count) {
+    std::vector<Datum> packet(count + 1);
+    std::memcpy(&packet.front(), &firstDatum, sizeof(firstDatum));
+    if (!queue->read(packet.data() + 1, count)) {
+        return NN_ERROR() << "Error receiving packet";
+    }
+    return packet;
+}
+
+// Returns a function which copies an element out of a packet that is read in place from an FMQ,
+// where the first element was already read out of the queue and tx holds the remaining ones.
+template <typename Datum, typename MemTransaction>
+auto makeInPlaceGetter(const Datum& firstDatum, MemTransaction& tx) {
+    return [&firstDatum, &tx](size_t index) {
+        if (index == 0) {
+            return firstDatum;
+        }
+        Datum datum;
+        tx.copyFrom(&datum, index - 1);
+        return datum;
+    };
+}
+
+// Serializes a packet of count elements in place into the queue, then wakes the reader the same
+// way MessageQueue::writeBlocking does.
+template <typename Queue, typename SerializeFunction>
+bool serializeInPlace(Queue* queue, EventFlag* eventFlag, size_t count,
+                      const SerializeFunction& serializePacket) {
+    typename Queue::MemTransaction tx;
+    if (!queue->beginWrite(count, &tx)) {
+        return false;
+    }
+    size_t index = 0;
+    serializePacket([&tx, &index](const auto& datum) { tx.copyTo(&datum, index++); });
+    CHECK_EQ(index, count);
+    if (!queue->commitWrite(count)) {
+        return false;
+    }
+    eventFlag->wake(kFmqNotEmpty);
+    return true;
+}
+
+}  // namespace
+
+std::chrono::microseconds getBurstControllerPollingTimeWindow() {
+    return getPollingTimeWindow("debug.nn.burst-controller-polling-window");
+}
+
+std::chrono::microseconds getBurstServerPollingTimeWindow() {
+    return getPollingTimeWindow("debug.nn.burst-server-polling-window");
+}
+
+// serialize a request into a packet
+std::vector<FmqRequestDatum> serialize(const V1_0::Request& request, V1_2::MeasureTiming measure,
+                                       const std::vector<int32_t>& slots) {
+    // create buffer to temporarily store elements
+    std::vector<FmqRequestDatum> data;
+    data.reserve(getPacketSize(request, slots));
+    serializeRequest(request, measure, slots,
+                     [&data](const FmqRequestDatum& datum) { data.push_back(datum); });
+    return data;
+}
+
+// serialize result
+std::vector<FmqResultDatum> serialize(V1_0::ErrorStatus errorStatus,
+                                      const std::vector<V1_2::OutputShape>& outputShapes,
+                                      V1_2::Timing timing) {
+    // create buffer to temporarily store elements
+    std::vector<FmqResultDatum> data;
+    data.reserve(getPacketSize(outputShapes));
+    serializeResult(errorStatus, outputShapes, timing,
+                    [&data](const FmqResultDatum& datum) { data.push_back(datum); });
+    return data;
+}
+
+// deserialize request
+nn::Result<std::tuple<V1_0::Request, std::vector<int32_t>, V1_2::MeasureTiming>> deserialize(
+        const std::vector<FmqRequestDatum>& data) {
+    return deserializeRequest(data.size(), [&data](size_t index) { return data[index]; });
+}
+
+// deserialize a packet into the result
+nn::Result<std::tuple<V1_0::ErrorStatus, std::vector<V1_2::OutputShape>, V1_2::Timing>> deserialize(
+        const std::vector<FmqResultDatum>& data) {
+    return deserializeResult(data.size(), [&data](size_t index) { return data[index]; });
+}
+
 // RequestChannelSender methods
 
 nn::GeneralResult<
@@ -418,6 +506,10 @@ RequestChannelSender::create(size_t channelLength) {
     if (!requestChannelSender->mFmqRequestChannel.isValid()) {
         return NN_ERROR() << "Unable to create RequestChannelSender";
     }
+    if (EventFlag::createEventFlag(requestChannelSender->mFmqRequestChannel.getEventFlagWord(),
+                                   &requestChannelSender->mEventFlag) != OK) {
+        return NN_ERROR() << "Unable to create EventFlag for RequestChannelSender";
+    }
 
     const MQDescriptorSync<FmqRequestDatum>* descriptor =
             requestChannelSender->mFmqRequestChannel.getDesc();
@@ -427,11 +519,35 @@ RequestChannelSender::create(size_t channelLength) {
 RequestChannelSender::RequestChannelSender(PrivateConstructorTag /*tag*/, size_t channelLength)
     : mFmqRequestChannel(channelLength, /*configureEventFlagWord=*/true) {}
 
+RequestChannelSender::~RequestChannelSender() {
+    if (mEventFlag != nullptr) {
+        EventFlag::deleteEventFlag(&mEventFlag);
+    }
+}
+
 nn::Result<void> RequestChannelSender::send(const V1_0::Request& request,
                                             V1_2::MeasureTiming measure,
                                             const std::vector<int32_t>& slots) {
-    const std::vector<FmqRequestDatum> serialized = serialize(request, measure, slots);
-    return sendPacket(serialized);
+    if (!mValid) {
+        return NN_ERROR() << "FMQ object is invalid";
+    }
+
+    const size_t count = getPacketSize(request, slots);
+    if (count > mFmqRequestChannel.availableToWrite()) {
+        return NN_ERROR()
+               << "RequestChannelSender::send -- packet size exceeds size available in FMQ";
+    }
+
+    // Serialize the packet straight into the FMQ instead of staging it in a buffer.
+    const bool success = serializeInPlace(
+            &mFmqRequestChannel, mEventFlag, count, [&request, measure, &slots](const auto& write) {
+                serializeRequest(request, measure, slots, write);
+            });
+    if (!success) {
+        return NN_ERROR() << "RequestChannelSender::send -- unable to write packet to FMQ";
+    }
+
+    return {};
 }
 
 nn::Result<void> RequestChannelSender::sendPacket(const std::vector<FmqRequestDatum>& packet) {
@@ -485,8 +601,17 @@ RequestChannelReceiver::RequestChannelReceiver(
 
 nn::Result<std::tuple<V1_0::Request, std::vector<int32_t>, V1_2::MeasureTiming>>
 RequestChannelReceiver::getBlocking() {
-    const auto packet = NN_TRY(getPacketBlocking());
-    return deserialize(packet);
+    FmqRequestDatum firstDatum;
+    const size_t count = NN_TRY(readFirstDatumBlocking(&firstDatum));
+
+    // Deserialize the rest of the packet in place instead of copying it out of the FMQ first.
+    RequestQueue::MemTransaction tx;
+    if (!mFmqRequestChannel.beginRead(count, &tx)) {
+        return NN_ERROR() << "Error receiving packet";
+    }
+    auto result = deserializeRequest(count + 1, makeInPlaceGetter(firstDatum, tx));
+    mFmqRequestChannel.commitRead(count);
+    return result;
 }
 
 void RequestChannelReceiver::invalidate() {
@@ -501,6 +626,12 @@ void RequestChannelReceiver::invalidate() {
 }
 
 nn::Result<std::vector<FmqRequestDatum>> RequestChannelReceiver::getPacketBlocking() {
+    FmqRequestDatum firstDatum;
+    const size_t count = NN_TRY(readFirstDatumBlocking(&firstDatum));
+    return readPacket(&mFmqRequestChannel, firstDatum, count);
+}
+
+nn::Result<size_t> RequestChannelReceiver::readFirstDatumBlocking(FmqRequestDatum* datum) {
     if (mTeardown) {
         return NN_ERROR() << "FMQ object is being torn down";
     }
@@ -518,37 +649,26 @@ nn::Result<std::vector<FmqRequestDatum>> RequestChannelReceiver::getPacketBlocki
             return NN_ERROR() << "FMQ object is being torn down";
         }
 
-        // Check if data is available. If it is, immediately retrieve it and return.
-        const size_t available = mFmqRequestChannel.availableToRead();
-        if (available > 0) {
-            std::vector<FmqRequestDatum> packet(available);
-            const bool success = mFmqRequestChannel.readBlocking(packet.data(), available);
-            if (!success) {
-                return NN_ERROR() << "Error receiving packet";
-            }
-            return packet;
+        // Check if data is available. If it is, stop polling and immediately retrieve it.
+        if (mFmqRequestChannel.availableToRead() > 0) {
+            break;
         }
 
         std::this_thread::yield();
     }
 
-    // If we get to this point, we either stopped polling because it was taking too long or polling
-    // was not allowed. Instead, perform a blocking call which uses a futex to save power.
+    // If data is not available at this point, we either stopped polling because it was taking too
+    // long or polling was not allowed. In that case, readBlocking waits on the futex to save power.
 
     // wait for request packet and read first element of request packet
-    FmqRequestDatum datum;
-    bool success = mFmqRequestChannel.readBlocking(&datum, 1);
+    const bool success = mFmqRequestChannel.readBlocking(datum, 1);
 
-    // retrieve remaining elements
     // NOTE: all of the data is already available at this point, so there's no need to do a blocking
     // wait to wait for more data. This is known because in FMQ, all writes are published (made
     // available) atomically. Currently, the producer always publishes the entire packet in one
     // function call, so if the first element of the packet is available, the remaining elements are
     // also available.
     const size_t count = mFmqRequestChannel.availableToRead();
-    std::vector<FmqRequestDatum> packet(count + 1);
-    std::memcpy(&packet.front(), &datum, sizeof(datum));
-    success &= mFmqRequestChannel.read(packet.data() + 1, count);
 
     // terminate loop
     if (mTeardown) {
@@ -560,7 +680,7 @@ nn::Result<std::vector<FmqRequestDatum>> RequestChannelReceiver::getPacketBlocki
         return NN_ERROR() << "Error receiving packet";
     }
 
-    return packet;
+    return count;
 }
 
 // ResultChannelSender methods
@@ -577,6 +697,10 @@ nn::GeneralResult<std::unique_ptr<ResultChannelSender>> ResultChannelSender::cre
         return NN_ERROR()
                << "ResultChannelSender::create was passed an MQDescriptor without an EventFlag";
     }
+    if (EventFlag::createEventFlag(resultChannelSender->mFmqResultChannel.getEventFlagWord(),
+                                   &resultChannelSender->mEventFlag) != OK) {
+        return NN_ERROR() << "Unable to create EventFlag for ResultChannelSender";
+    }
 
     return resultChannelSender;
 }
@@ -585,11 +709,31 @@ ResultChannelSender::ResultChannelSender(PrivateConstructorTag /*tag*/,
                                          const MQDescriptorSync<FmqResultDatum>& resultChannel)
     : mFmqResultChannel(resultChannel) {}
 
+ResultChannelSender::~ResultChannelSender() {
+    if (mEventFlag != nullptr) {
+        EventFlag::deleteEventFlag(&mEventFlag);
+    }
+}
+
 void ResultChannelSender::send(V1_0::ErrorStatus errorStatus,
                                const std::vector<V1_2::OutputShape>& outputShapes,
                                V1_2::Timing timing) {
-    const std::vector<FmqResultDatum> serialized = serialize(errorStatus, outputShapes, timing);
-    sendPacket(serialized);
+    // Serialize the packet straight into the FMQ instead of staging it in a buffer.
+    const auto trySend = [this](V1_0::ErrorStatus status,
+                                const std::vector<V1_2::OutputShape>& shapes, V1_2::Timing time) {
+        const size_t count = getPacketSize(shapes);
+        if (count > mFmqResultChannel.availableToWrite()) {
+            return false;
+        }
+        return serializeInPlace(&mFmqResultChannel, mEventFlag, count, [&](const auto& write) {
+            serializeResult(status, shapes, time, write);
+        });
+    };
+
+    if (!trySend(errorStatus, outputShapes, timing)) {
+        LOG(ERROR) << "ResultChannelSender::send -- unable to write packet to FMQ";
+        trySend(V1_0::ErrorStatus::GENERAL_FAILURE, {}, kNoTiming);
+    }
 }
 
 void ResultChannelSender::sendPacket(const std::vector<FmqResultDatum>& packet) {
@@ -632,8 +776,17 @@ ResultChannelReceiver::ResultChannelReceiver(PrivateConstructorTag /*tag*/, size
 
 nn::Result<std::tuple<V1_0::ErrorStatus, std::vector<V1_2::OutputShape>, V1_2::Timing>>
 ResultChannelReceiver::getBlocking() {
-    const auto packet = NN_TRY(getPacketBlocking());
-    return deserialize(packet);
+    FmqResultDatum firstDatum;
+    const size_t count = NN_TRY(readFirstDatumBlocking(&firstDatum));
+
+    // Deserialize the rest of the packet in place instead of copying it out of the FMQ first.
+    ResultQueue::MemTransaction tx;
+    if (!mFmqResultChannel.beginRead(count, &tx)) {
+        return NN_ERROR() << "Error receiving packet";
+    }
+    auto result = deserializeResult(count + 1, makeInPlaceGetter(firstDatum, tx));
+    mFmqResultChannel.commitRead(count);
+    return result;
 }
 
 void ResultChannelReceiver::notifyAsDeadObject() {
@@ -648,6 +801,12 @@ void ResultChannelReceiver::notifyAsDeadObject() {
 }
 
 nn::Result<std::vector<FmqResultDatum>> ResultChannelReceiver::getPacketBlocking() {
+    FmqResultDatum firstDatum;
+    const size_t count = NN_TRY(readFirstDatumBlocking(&firstDatum));
+    return readPacket(&mFmqResultChannel, firstDatum, count);
+}
+
+nn::Result<size_t> ResultChannelReceiver::readFirstDatumBlocking(FmqResultDatum* datum) {
     if (!mValid) {
         return NN_ERROR() << "FMQ object is invalid";
     }
@@ -665,37 +824,26 @@ nn::Result<std::vector<FmqResultDatum>> ResultChannelReceiver::getPacketBlocking
             return NN_ERROR() << "FMQ object is invalid";
         }
 
-        // Check if data is available. If it is, immediately retrieve it and return.
-        const size_t available = mFmqResultChannel.availableToRead();
-        if (available > 0) {
-            std::vector<FmqResultDatum> packet(available);
-            const bool success = mFmqResultChannel.readBlocking(packet.data(), available);
-            if (!success) {
-                return NN_ERROR() << "Error receiving packet";
-            }
-            return packet;
+        // Check if data is available. If it is, stop polling and immediately retrieve it.
+        if (mFmqResultChannel.availableToRead() > 0) {
+            break;
         }
 
         std::this_thread::yield();
     }
 
-    // If we get to this point, we either stopped polling because it was taking too long or polling
-    // was not allowed. Instead, perform a blocking call which uses a futex to save power.
+    // If data is not available at this point, we either stopped polling because it was taking too
+    // long or polling was not allowed. In that case, readBlocking waits on the futex to save power.
 
     // wait for result packet and read first element of result packet
-    FmqResultDatum datum;
-    bool success = mFmqResultChannel.readBlocking(&datum, 1);
+    const bool success = mFmqResultChannel.readBlocking(datum, 1);
 
-    // retrieve remaining elements
     // NOTE: all of the data is already available at this point, so there's no need to do a blocking
     // wait to wait for more data. This is known because in FMQ, all writes are published (made
     // available) atomically. Currently, the producer always publishes the entire packet in one
     // function call, so if the first element of the packet is available, the remaining elements are
     // also available.
     const size_t count = mFmqResultChannel.availableToRead();
-    std::vector<FmqResultDatum> packet(count + 1);
-    std::memcpy(&packet.front(), &datum, sizeof(datum));
-    success &= mFmqResultChannel.read(packet.data() + 1, count);
 
     if (!mValid) {
         return NN_ERROR() << "FMQ object is invalid";
@@ -706,7 +854,7 @@ nn::Result<std::vector<FmqResultDatum>> ResultChannelReceiver::getPacketBlocking
         return NN_ERROR() << "Error receiving packet";
     }
 
-    return packet;
+    return count;
 }
 
 }  // namespace android::hardware::neuralnetworks::V1_2::utils
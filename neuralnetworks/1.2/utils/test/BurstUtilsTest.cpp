@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android/hardware/neuralnetworks/1.0/types.h>
+#include <android/hardware/neuralnetworks/1.2/types.h>
+#include <gtest/gtest.h>
+#include <nnapi/hal/1.2/BurstUtils.h>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace android::hardware::neuralnetworks::V1_2::utils {
+namespace {
+
+constexpr uint32_t kOversizedCount = std::numeric_limits<uint32_t>::max();
+constexpr auto kTiming = V1_2::Timing{.timeOnDevice = 1, .timeInDriver = 2};
+
+V1_0::RequestArgument makeArgument(uint32_t offset) {
+    return {.hasNoValue = false,
+            .location = {.poolIndex = 0, .offset = offset, .length = 16},
+            .dimensions = {2, 2}};
+}
+
+// Packet layout: packetInformation, inputOperandInformation, 2 x inputOperandDimensionValue,
+// outputOperandInformation, 2 x outputOperandDimensionValue, poolIdentifier, measureTiming.
+std::vector<FmqRequestDatum> makeRequestPacket() {
+    const V1_0::Request request = {
+            .inputs = {makeArgument(0)}, .outputs = {makeArgument(16)}, .pools = {}};
+    return serialize(request, V1_2::MeasureTiming::YES, {7});
+}
+
+// Packet layout: packetInformation, operandInformation, 2 x operandDimensionValue,
+// executionTiming.
+std::vector<FmqResultDatum> makeResultPacket() {
+    const std::vector<V1_2::OutputShape> outputShapes = {
+            {.dimensions = {2, 2}, .isSufficient = true}};
+    return serialize(V1_0::ErrorStatus::NONE, outputShapes, kTiming);
+}
+
+// Makes the packet information agree with a packet of a different size
+template <typename Datum>
+void setPacketSize(std::vector<Datum>* packet) {
+    auto packetInfo = packet->front().packetInformation();
+    packetInfo.packetSize = static_cast<uint32_t>(packet->size());
+    packet->front().packetInformation(packetInfo);
+}
+
+}  // namespace
+
+TEST(BurstUtilsTest, deserializeRequest) {
+    // setup test
+    const auto packet = makeRequestPacket();
+
+    // run test
+    const auto result = deserialize(packet);
+
+    // verify result
+    ASSERT_TRUE(result.has_value()) << result.error().message;
+    const auto& [request, slots, measure] = result.value();
+    ASSERT_EQ(1u, request.inputs.size());
+    EXPECT_EQ(makeArgument(0), request.inputs[0]);
+    ASSERT_EQ(1u, request.outputs.size());
+    EXPECT_EQ(makeArgument(16), request.outputs[0]);
+    EXPECT_EQ(std::vector<int32_t>{7}, slots);
+    EXPECT_EQ(V1_2::MeasureTiming::YES, measure);
+}
+
+TEST(BurstUtilsTest, deserializeEmptyRequestPacketError) {
+    // run test
+    const auto result = deserialize(std::vector<FmqRequestDatum>{});
+
+    // verify result
+    EXPECT_FALSE(result.has_value());
+}
+
+TEST(BurstUtilsTest, deserializeTruncatedRequestPacketError) {
+    // setup test
+    auto packet = makeRequestPacket();
+    packet.pop_back();
+
+    // run test
+    const auto result = deserialize(packet);
+
+    // verify result
+    EXPECT_FALSE(result.has_value());
+}
+
+TEST(BurstUtilsTest, deserializeTruncatedRequestPacketWithMatchingSizeError) {
+    // setup test
+    auto packet = makeRequestPacket();
+    packet.resize(3);
+    setPacketSize(&packet);
+
+    // run test
+    const auto result = deserialize(packet);
+
+    // verify result
+    EXPECT_FALSE(result.has_value());
+}
+
+TEST(BurstUtilsTest, deserializeRequestOversizedDimensionCountError) {
+    // setup test
+    auto packet = makeRequestPacket();
+    auto operandInfo = packet[1].inputOperandInformation();
+    operandInfo.numberOfDimensions = kOversizedCount;
+    packet[1].inputOperandInformation(operandInfo);
+
+    // run test
+    const auto result = deserialize(packet);
+
+    // verify result
+    EXPECT_FALSE(result.has_value());
+}
+
+TEST(BurstUtilsTest, deserializeRequestOversizedOperandCountError) {
+    // setup test
+    auto packet = makeRequestPacket();
+    auto packetInfo = packet.front().packetInformation();
+    packetInfo.numberOfInputOperands = kOversizedCount;
+    packet.front().packetInformation(packetInfo);
+
+    // run test
+    const auto result = deserialize(packet);
+
+    // verify result
+    EXPECT_FALSE(result.has_value());
+}
+
+TEST(BurstUtilsTest, deserializeRequestOversizedPoolCountError) {
+    // setup test
+    auto packet = makeRequestPacket();
+    auto packetInfo = packet.front().packetInformation();
+    packetInfo.numberOfPools = kOversizedCount;
+    packet.front().packetInformation(packetInfo);
+
+    // run test
+    const auto result = deserialize(packet);
+
+    // verify result
+    EXPECT_FALSE(result.has_value());
+}
+
+TEST(BurstUtilsTest, deserializeResult) {
+    // setup test
+    const auto packet = makeResultPacket();
+
+    // run test
+    const auto result = deserialize(packet);
+
+    // verify result
+    ASSERT_TRUE(result.has_value()) << result.error().message;
+    const auto& [status, outputShapes, timing] = result.value();
+    EXPECT_EQ(V1_0::ErrorStatus::NONE, status);
+    ASSERT_EQ(1u, outputShapes.size());
+    EXPECT_EQ((hidl_vec<uint32_t>{2, 2}), outputShapes[0].dimensions);
+    EXPECT_TRUE(outputShapes[0].isSufficient);
+    EXPECT_EQ(kTiming, timing);
+}
+
+TEST(BurstUtilsTest, deserializeEmptyResultPacketError) {
+    // run test
+    const auto result = deserialize(std::vector<FmqResultDatum>{});
+
+    // verify result
+    EXPECT_FALSE(result.has_value());
+}
+
+TEST(BurstUtilsTest, deserializeTruncatedResultPacketError) {
+    // setup test
+    auto packet = makeResultPacket();
+    packet.pop_back();
+
+    // run test
+    const auto result = deserialize(packet);
+
+    // verify result
+    EXPECT_FALSE(result.has_value());
+}
+
+TEST(BurstUtilsTest, deserializeTruncatedResultPacketWithMatchingSizeError) {
+    // setup test
+    auto packet = makeResultPacket();
+    packet.resize(3);
+    setPacketSize(&packet);
+
+    // run test
+    const auto result = deserialize(packet);
+
+    // verify result
+    EXPECT_FALSE(result.has_value());
+}
+
+TEST(BurstUtilsTest, deserializeResultOversizedDimensionCountError) {
+    // setup test
+    auto packet = makeResultPacket();
+    auto operandInfo = packet[1].operandInformation();
+    operandInfo.numberOfDimensions = kOversizedCount;
+    packet[1].operandInformation(operandInfo);
+
+    // run test
+    const auto result = deserialize(packet);
+
+    // verify result
+    EXPECT_FALSE(result.has_value());
+}
+
+TEST(BurstUtilsTest, deserializeResultOversizedOperandCountError) {
+    // setup test
+    auto packet = makeResultPacket();
+    auto packetInfo = packet.front().packetInformation();
+    packetInfo.numberOfOperands = kOversizedCount;
+    packet.front().packetInformation(packetInfo);
+
+    // run test
+    const auto result = deserialize(packet);
+
+    // verify result
+    EXPECT_FALSE(result.has_value());
+}
+
+}  // namespace android::hardware::neuralnetworks::V1_2::utils
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/logging.h>
+#include <nnapi/Types.h>
+#include <nnapi/hal/aidl/BufferTracker.h>
+
+#include <memory>
+#include <mutex>
+#include <stack>
+#include <utility>
+#include <vector>
+
+namespace android::nn {
+namespace {
+
+// Measures token lookup and token allocation under contention from several threads, comparing
+// AidlBufferTracker with a tracker which guards its token table with a single mutex.
+
+constexpr size_t kNumTokens = 64;
+
+// The single mutex token table which AidlBufferTracker used to have.
+class MutexBufferTracker {
+  public:
+    uint32_t add(std::shared_ptr<AidlManagedBuffer> buffer) {
+        std::lock_guard guard(mMutex);
+        if (mFreeTokens.empty()) {
+            mTokenToBuffers.push_back(std::move(buffer));
+            return mTokenToBuffers.size() - 1;
+        }
+        const uint32_t token = mFreeTokens.top();
+        mFreeTokens.pop();
+        mTokenToBuffers[token] = std::move(buffer);
+        return token;
+    }
+
+    std::shared_ptr<AidlManagedBuffer> get(uint32_t token) const {
+        std::lock_guard guard(mMutex);
+        return token < mTokenToBuffers.size() ? mTokenToBuffers[token] : nullptr;
+    }
+
+    void free(uint32_t token) {
+        std::lock_guard guard(mMutex);
+        mTokenToBuffers[token] = nullptr;
+        mFreeTokens.push(token);
+    }
+
+  private:
+    mutable std::mutex mMutex;
+    std::stack<uint32_t, std::vector<uint32_t>> mFreeTokens;
+    std::vector<std::shared_ptr<AidlManagedBuffer>> mTokenToBuffers{1};
+};
+
+std::shared_ptr<AidlManagedBuffer> createBuffer() {
+    const Operand operand = {.type = OperandType::TENSOR_FLOAT32, .dimensions = {1}};
+    auto buffer = AidlManagedBuffer::create(sizeof(float), {}, operand);
+    CHECK(buffer != nullptr);
+    return buffer;
+}
+
+std::shared_ptr<AidlBufferTracker> gTracker;
+std::vector<std::unique_ptr<AidlBufferTracker::Token>> gTokens;
+std::unique_ptr<MutexBufferTracker> gMutexTracker;
+std::vector<uint32_t> gMutexTokens;
+
+void BM_Get(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        gTracker = AidlBufferTracker::create();
+        for (size_t i = 0; i < kNumTokens; ++i) {
+            gTokens.push_back(gTracker->add(createBuffer()));
+        }
+    }
+    size_t i = state.thread_index();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(gTracker->get(gTokens[i++ % kNumTokens]->get()));
+    }
+    if (state.thread_index() == 0) {
+        gTokens.clear();
+        gTracker.reset();
+    }
+}
+
+void BM_MutexGet(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        gMutexTracker = std::make_unique<MutexBufferTracker>();
+        for (size_t i = 0; i < kNumTokens; ++i) {
+            gMutexTokens.push_back(gMutexTracker->add(createBuffer()));
+        }
+    }
+    size_t i = state.thread_index();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(gMutexTracker->get(gMutexTokens[i++ % kNumTokens]));
+    }
+    if (state.thread_index() == 0) {
+        gMutexTokens.clear();
+        gMutexTracker.reset();
+    }
+}
+
+void BM_AddAndFree(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        gTracker = AidlBufferTracker::create();
+    }
+    const auto buffer = createBuffer();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(gTracker->add(buffer));
+    }
+    if (state.thread_index() == 0) {
+        gTracker.reset();
+    }
+}
+
+void BM_MutexAddAndFree(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        gMutexTracker = std::make_unique<MutexBufferTracker>();
+    }
+    const auto buffer = createBuffer();
+    for (auto _ : state) {
+        gMutexTracker->free(gMutexTracker->add(buffer));
+    }
+    if (state.thread_index() == 0) {
+        gMutexTracker.reset();
+    }
+}
+
+BENCHMARK(BM_Get)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_MutexGet)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_AddAndFree)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_MutexAddAndFree)->ThreadRange(1, 16)->UseRealTime();
+
+}  // namespace
+}  // namespace android::nn
+
+BENCHMARK_MAIN();
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/logging.h>
+#include <nnapi/Types.h>
+#include <nnapi/hal/aidl/Conversions.h>
+#include <nnapi/hal/aidl/ModelConversion.h>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace aidl::android::hardware::neuralnetworks::utils {
+namespace {
+
+namespace nn = ::android::nn;
+
+// Measures the time a driver takes to convert and validate a model with about 100MB of constants,
+// passed either copied into the model or in shared memory.
+
+constexpr uint32_t kNumOperations = 64;
+constexpr uint32_t kNumElements = 400 * 1024;
+constexpr size_t kMinSharedConstantSize = 64 * 1024;
+
+// Creates a chain of ADD operations, each of which adds a constant tensor to the previous result.
+nn::Model createModel() {
+    nn::Model model;
+    const std::vector<float> weights(kNumElements, 1.0f);
+    const int32_t activation = 0;
+    const auto activationLocation = model.operandValues.append(
+            reinterpret_cast<const uint8_t*>(&activation), sizeof(activation));
+
+    const nn::Operand tensor = {.type = nn::OperandType::TENSOR_FLOAT32,
+                                .dimensions = {kNumElements},
+                                .lifetime = nn::Operand::LifeTime::SUBGRAPH_INPUT};
+    auto& operands = model.main.operands;
+    operands.push_back({.type = nn::OperandType::INT32,
+                        .lifetime = nn::Operand::LifeTime::CONSTANT_COPY,
+                        .location = activationLocation});
+    operands.push_back(tensor);
+    model.main.inputIndexes = {1};
+
+    for (uint32_t i = 0; i < kNumOperations; ++i) {
+        const auto input = static_cast<uint32_t>(operands.size() - 1);
+        auto constant = tensor;
+        constant.lifetime = nn::Operand::LifeTime::CONSTANT_COPY;
+        constant.location = model.operandValues.append(
+                reinterpret_cast<const uint8_t*>(weights.data()), weights.size() * sizeof(float));
+        operands.push_back(constant);
+        auto output = tensor;
+        output.lifetime = i + 1 < kNumOperations ? nn::Operand::LifeTime::TEMPORARY_VARIABLE
+                                                 : nn::Operand::LifeTime::SUBGRAPH_OUTPUT;
+        operands.push_back(output);
+        model.main.operations.push_back({.type = nn::OperationType::ADD,
+                                         .inputs = {input, input + 1, 0},
+                                         .outputs = {input + 2}});
+    }
+    model.main.outputIndexes = {static_cast<uint32_t>(operands.size() - 1)};
+    return model;
+}
+
+Model createAidlModel(bool sharedConstants) {
+    const auto model = createModel();
+    std::optional<nn::Model> maybeModelInShared;
+    const nn::Model& modelToConvert =
+            sharedConstants
+                    ? moveLargeConstantsToShared(&model, kMinSharedConstantSize,
+                                                 &maybeModelInShared)
+                              .value()
+                              .get()
+                    : model;
+    auto aidlModel = convert(modelToConvert);
+    CHECK(aidlModel.has_value()) << aidlModel.error().message;
+    return std::move(aidlModel).value();
+}
+
+void BM_MoveLargeConstantsToShared(benchmark::State& state) {
+    const auto model = createModel();
+    for (auto _ : state) {
+        std::optional<nn::Model> maybeModelInShared;
+        const auto result =
+                moveLargeConstantsToShared(&model, kMinSharedConstantSize, &maybeModelInShared);
+        CHECK(result.has_value()) << result.error().message;
+        benchmark::DoNotOptimize(maybeModelInShared);
+    }
+    state.SetBytesProcessed(state.iterations() * model.operandValues.size());
+}
+
+void BM_ConvertCopiedConstants(benchmark::State& state) {
+    const auto aidlModel = createAidlModel(/*sharedConstants=*/false);
+    for (auto _ : state) {
+        auto model = convert(aidlModel);
+        CHECK(model.has_value()) << model.error().message;
+        benchmark::DoNotOptimize(model);
+    }
+}
+
+void BM_ConvertSharedConstants(benchmark::State& state) {
+    const auto aidlModel = createAidlModel(/*sharedConstants=*/true);
+    for (auto _ : state) {
+        auto model = convert(aidlModel);
+        CHECK(model.has_value()) << model.error().message;
+        benchmark::DoNotOptimize(model);
+    }
+}
+
+BENCHMARK(BM_MoveLargeConstantsToShared)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ConvertCopiedConstants)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ConvertSharedConstants)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace aidl::android::hardware::neuralnetworks::utils
+
+BENCHMARK_MAIN();
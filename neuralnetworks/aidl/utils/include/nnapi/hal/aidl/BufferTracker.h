@@ -20,11 +20,13 @@
 #include <android-base/macros.h>
 #include <android-base/thread_annotations.h>
 
+#include <array>
+#include <atomic>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <set>
-#include <stack>
 #include <utility>
 #include <vector>
 
@@ -66,7 +68,7 @@ class AidlManagedBuffer {
     const OperandType kOperandType;
     const std::vector<uint32_t> kInitialDimensions;
     std::vector<uint32_t> mUpdatedDimensions GUARDED_BY(mMutex);
-    bool mInitialized GUARDED_BY(mMutex) = false;
+    std::atomic<bool> mInitialized = false;
 };
 
 // Keep track of all AidlManagedBuffers and assign each with a unique token.
@@ -97,21 +99,55 @@ class AidlBufferTracker : public std::enable_shared_from_this<AidlBufferTracker>
     }
 
     // Prefer AidlBufferTracker::create.
-    AidlBufferTracker() : mTokenToBuffers(1) {}
+    AidlBufferTracker() = default;
+    ~AidlBufferTracker();
 
+    // Returns nullptr if the buffer is nullptr or if kMaxSlots buffers are already tracked.
     std::unique_ptr<Token> add(std::shared_ptr<AidlManagedBuffer> buffer);
+
+    // Never blocks, so that executions using device memory do not contend with each other or with
+    // buffers being added and freed.
     std::shared_ptr<AidlManagedBuffer> get(uint32_t token) const;
 
   private:
-    void free(uint32_t token);
+    // A token is the index of its slot in the lower kIndexBits and the generation of the slot in
+    // the bits above, so that a token which has been freed is not confused with a later token for
+    // the same slot. Tokens are passed across AIDL as non-negative int32_t values, leaving 31 bits.
+    static constexpr uint32_t kIndexBits = 20;
+    static constexpr uint32_t kIndexMask = (1u << kIndexBits) - 1;
+    static constexpr uint32_t kGenerationMask = (1u << (31 - kIndexBits)) - 1;
+    static constexpr uint32_t kSlotsPerChunk = 1024;
+    static constexpr uint32_t kMaxChunks = (kIndexMask + 1) / kSlotsPerChunk;
+    static constexpr uint32_t kMaxSlots = kIndexMask + 1;
+
+    struct Slot {
+        // The generation of the slot in the upper 32 bits, whether the slot holds a buffer in bit
+        // 31, and the number of get calls reading the buffer in the bits below.
+        std::atomic<uint64_t> state = 0;
+        // Index of the next slot in the free list, or 0 for the end of the list.
+        std::atomic<uint32_t> nextFree = 0;
+        // Only written while the slot is not occupied and no get call is reading it.
+        std::shared_ptr<AidlManagedBuffer> buffer;
+    };
+    using Chunk = std::array<Slot, kSlotsPerChunk>;
 
-    mutable std::mutex mMutex;
-    std::stack<uint32_t, std::vector<uint32_t>> mFreeTokens GUARDED_BY(mMutex);
+    void free(uint32_t token);
 
-    // Since the tokens are allocated in a non-sparse way, we use a vector to represent the mapping.
-    // The index of the vector is the token. When the token gets freed, the corresponding entry is
-    // set to nullptr. mTokenToBuffers[0] is always set to nullptr because 0 is an invalid token.
-    std::vector<std::shared_ptr<AidlManagedBuffer>> mTokenToBuffers GUARDED_BY(mMutex);
+    // Returns nullptr if the chunk of the slot has not been allocated.
+    Slot* getSlot(uint32_t index) const;
+    std::optional<uint32_t> allocateSlot();
+    void pushFreeSlot(uint32_t index);
+    std::optional<uint32_t> popFreeSlot();
+
+    // Slots are allocated in chunks which are never freed before the tracker, so a slot can be
+    // read at any time once its chunk has been published. Slot 0 is never used because 0 is an
+    // invalid token.
+    std::array<std::atomic<Chunk*>, kMaxChunks> mChunks = {};
+    std::atomic<uint32_t> mNextUnusedSlot = 1;
+
+    // Lock-free stack of freed slots. The index of the top slot is in the lower 32 bits, and the
+    // upper 32 bits count the updates so that a stale compare-exchange cannot succeed.
+    std::atomic<uint64_t> mFreeSlots = 0;
 };
 
 }  // namespace android::nn
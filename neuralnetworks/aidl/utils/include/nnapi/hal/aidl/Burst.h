@@ -24,13 +24,16 @@
 #include <nnapi/Result.h>
 #include <nnapi/Types.h>
 #include <nnapi/hal/CommonUtils.h>
+#include <nnapi/hal/RequestRelocationCache.h>
 
+#include <array>
 #include <atomic>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 // See hardware/interfaces/neuralnetworks/utils/README.md for more information on AIDL interface
 // lifetimes across processes and for protecting asynchronous calls across AIDL.
@@ -45,6 +48,10 @@ class Burst final : public nn::IBurst, public std::enable_shared_from_this<Burst
     /**
      * Thread-safe, self-cleaning cache that relates an nn::Memory object to a unique int64_t
      * identifier.
+     *
+     * Lookups of memory that is already cached do not lock. The entries are kept in an immutable
+     * snapshot which is replaced, under a mutex, whenever an entry is added or removed. Replaced
+     * snapshots are freed once every lookup that started before they were replaced has finished.
      */
     class MemoryCache : public std::enable_shared_from_this<MemoryCache> {
       public:
@@ -53,7 +60,23 @@ class Burst final : public nn::IBurst, public std::enable_shared_from_this<Burst
         using SharedCleanup = std::shared_ptr<const Cleanup>;
         using WeakCleanup = std::weak_ptr<const Cleanup>;
 
+        struct Metrics {
+            // Number of lookups which found a live entry.
+            uint64_t hits = 0;
+            // Number of lookups which found no entry or an expired one.
+            uint64_t misses = 0;
+            // Number of entries removed after their last hold was released.
+            uint64_t evictions = 0;
+        };
+
         explicit MemoryCache(std::shared_ptr<aidl_hal::IBurst> burst);
+        ~MemoryCache();
+
+        // Prevent copy and move.
+        MemoryCache(const MemoryCache&) = delete;
+        MemoryCache(MemoryCache&&) = delete;
+        MemoryCache& operator=(const MemoryCache&) = delete;
+        MemoryCache& operator=(MemoryCache&&) = delete;
 
         /**
          * Get or cache a memory object in the MemoryCache object.
@@ -76,14 +99,31 @@ class Burst final : public nn::IBurst, public std::enable_shared_from_this<Burst
         std::optional<std::pair<int64_t, SharedCleanup>> getMemoryIfAvailable(
                 const nn::SharedMemory& memory);
 
+        Metrics getMetrics() const;
+
       private:
+        using Snapshot = std::unordered_map<nn::SharedMemory, std::pair<int64_t, WeakCleanup>>;
+
+        // Returns the live entry for memory in the current snapshot, without locking.
+        std::optional<std::pair<int64_t, SharedCleanup>> lookup(const nn::SharedMemory& memory);
+        // Replaces the current snapshot and frees the snapshots no lookup can still be reading.
+        void publishLocked(std::unique_ptr<const Snapshot> snapshot) REQUIRES(mMutex);
         void tryFreeMemory(const nn::SharedMemory& memory, int64_t identifier);
 
         const std::shared_ptr<aidl_hal::IBurst> kBurst;
         std::mutex mMutex;
         int64_t mUnusedIdentifier GUARDED_BY(mMutex) = 0;
-        std::unordered_map<nn::SharedMemory, std::pair<int64_t, WeakCleanup>> mCache
+        std::atomic<const Snapshot*> mSnapshot;
+        // Lookups are counted by the parity of the epoch they started in. The epoch only advances
+        // under mMutex, once the lookups of the previous epoch have finished.
+        std::atomic<uint64_t> mEpoch = 0;
+        std::array<std::atomic<uint32_t>, 2> mActiveLookups = {0, 0};
+        // Snapshots replaced during an epoch, indexed by its parity.
+        std::array<std::vector<std::unique_ptr<const Snapshot>>, 2> mRetiredSnapshots
                 GUARDED_BY(mMutex);
+        std::atomic<uint64_t> mHits = 0;
+        std::atomic<uint64_t> mMisses = 0;
+        std::atomic<uint64_t> mEvictions = 0;
     };
 
     // featureLevel is for testing purposes.
@@ -110,6 +150,8 @@ class Burst final : public nn::IBurst, public std::enable_shared_from_this<Burst
             const std::vector<nn::TokenValuePair>& hints,
             const std::vector<nn::ExtensionNameAndPrefix>& extensionNameToPrefix) const override;
 
+    MemoryCache::Metrics getMemoryCacheMetrics() const;
+
     nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>> executeInternal(
             const aidl_hal::Request& request, const std::vector<int64_t>& memoryIdentifierTokens,
             bool measure, int64_t deadline, int64_t loopTimeoutDuration,
@@ -122,6 +164,7 @@ class Burst final : public nn::IBurst, public std::enable_shared_from_this<Burst
     const std::shared_ptr<aidl_hal::IBurst> kBurst;
     const std::shared_ptr<MemoryCache> kMemoryCache;
     const nn::Version kFeatureLevel;
+    const std::shared_ptr<hal::utils::RequestRelocationCache> kRelocationCache;
 };
 
 }  // namespace aidl::android::hardware::neuralnetworks::utils
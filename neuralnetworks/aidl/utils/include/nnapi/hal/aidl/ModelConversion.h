@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_AIDL_UTILS_MODEL_CONVERSION_H
+#define ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_AIDL_UTILS_MODEL_CONVERSION_H
+
+#include <nnapi/Result.h>
+#include <nnapi/Types.h>
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+
+namespace aidl::android::hardware::neuralnetworks::utils {
+
+namespace nn = ::android::nn;
+
+/**
+ * Moves the data of large CONSTANT_COPY operands into a shared memory pool.
+ *
+ * Each CONSTANT_COPY operand of at least minSize bytes becomes a CONSTANT_REFERENCE operand of a
+ * new pool appended to the model's pools, so that its data is passed across AIDL as a file
+ * descriptor instead of being copied into the model's operandValues.
+ *
+ * @param model Model which may have large CONSTANT_COPY operands.
+ * @param minSize Smallest CONSTANT_COPY operand, in bytes, which is moved to shared memory.
+ * @param maybeModelInSharedOut Holds the converted model if any operand was moved.
+ * @return model if no operand was moved, *maybeModelInSharedOut otherwise.
+ */
+nn::GeneralResult<std::reference_wrapper<const nn::Model>> moveLargeConstantsToShared(
+        const nn::Model* model, size_t minSize, std::optional<nn::Model>* maybeModelInSharedOut);
+
+}  // namespace aidl::android::hardware::neuralnetworks::utils
+
+#endif  // ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_AIDL_UTILS_MODEL_CONVERSION_H
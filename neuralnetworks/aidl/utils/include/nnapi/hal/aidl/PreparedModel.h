@@ -23,6 +23,7 @@
 #include <nnapi/Result.h>
 #include <nnapi/Types.h>
 #include <nnapi/hal/CommonUtils.h>
+#include <nnapi/hal/RequestRelocationCache.h>
 
 #include <memory>
 #include <tuple>
@@ -90,6 +91,7 @@ class PreparedModel final : public nn::IPreparedModel,
   private:
     const std::shared_ptr<aidl_hal::IPreparedModel> kPreparedModel;
     const nn::Version kFeatureLevel;
+    const std::shared_ptr<hal::utils::RequestRelocationCache> kRelocationCache;
 };
 
 }  // namespace aidl::android::hardware::neuralnetworks::utils
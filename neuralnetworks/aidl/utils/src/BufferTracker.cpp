@@ -21,14 +21,28 @@
 #include <android-base/macros.h>
 #include <nnapi/TypeUtils.h>
 
+#include <atomic>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <set>
-#include <stack>
+#include <thread>
 #include <utility>
 #include <vector>
 
 namespace android::nn {
+namespace {
+
+constexpr uint64_t kOccupied = uint64_t{1} << 31;
+constexpr uint64_t kReadersMask = kOccupied - 1;
+constexpr uint32_t kGenerationShift = 32;
+constexpr uint64_t kStackIndexMask = 0xffffffff;
+
+uint32_t getGeneration(uint64_t state) {
+    return static_cast<uint32_t>(state >> kGenerationShift);
+}
+
+}  // namespace
 
 std::shared_ptr<AidlManagedBuffer> AidlManagedBuffer::create(
         uint32_t size, std::set<AidlHalPreparedModelRole> roles, const Operand& operand) {
@@ -71,7 +85,7 @@ ErrorStatus AidlManagedBuffer::validateRequest(
             LOG(ERROR) << "AidlManagedBuffer::validateRequest -- invalid buffer role.";
             return ErrorStatus::INVALID_ARGUMENT;
         }
-        if (!mInitialized) {
+        if (!mInitialized.load(std::memory_order_acquire)) {
             LOG(ERROR)
                     << "AidlManagedBuffer::validateRequest -- using uninitialized buffer as input "
                        "request.";
@@ -162,8 +176,7 @@ ErrorStatus AidlManagedBuffer::validateCopyTo(uint32_t size) const {
                    << " vs " << size;
         return ErrorStatus::INVALID_ARGUMENT;
     }
-    std::lock_guard<std::mutex> guard(mMutex);
-    if (!mInitialized) {
+    if (!mInitialized.load(std::memory_order_acquire)) {
         LOG(ERROR) << "AidlManagedBuffer::validateCopyTo -- using uninitialized buffer as source.";
         return ErrorStatus::GENERAL_FAILURE;
     }
@@ -183,8 +196,13 @@ bool AidlManagedBuffer::updateDimensions(const std::vector<uint32_t>& dimensions
 }
 
 void AidlManagedBuffer::setInitialized(bool initialized) {
-    std::lock_guard<std::mutex> guard(mMutex);
-    mInitialized = initialized;
+    mInitialized.store(initialized, std::memory_order_release);
+}
+
+AidlBufferTracker::~AidlBufferTracker() {
+    for (auto& chunk : mChunks) {
+        delete chunk.load(std::memory_order_acquire);
+    }
 }
 
 std::unique_ptr<AidlBufferTracker::Token> AidlBufferTracker::add(
@@ -192,36 +210,118 @@ std::unique_ptr<AidlBufferTracker::Token> AidlBufferTracker::add(
     if (buffer == nullptr) {
         return nullptr;
     }
-    std::lock_guard<std::mutex> guard(mMutex);
-    uint32_t token = 0;
-    if (mFreeTokens.empty()) {
-        token = mTokenToBuffers.size();
-        mTokenToBuffers.push_back(std::move(buffer));
-    } else {
-        token = mFreeTokens.top();
-        mFreeTokens.pop();
-        mTokenToBuffers[token] = std::move(buffer);
+    const auto index = allocateSlot();
+    if (!index.has_value()) {
+        LOG(ERROR) << "AidlBufferTracker::add -- too many buffers, the limit is " << kMaxSlots - 1;
+        return nullptr;
     }
+    Slot* slot = getSlot(*index);
+    slot->buffer = std::move(buffer);
+    // Publishes the buffer to get. A get call with a stale token may have registered as a reader
+    // in the meantime, but it will not read the buffer because its generation does not match.
+    const uint64_t state = slot->state.fetch_or(kOccupied, std::memory_order_release);
+    const uint32_t token = ((getGeneration(state) & kGenerationMask) << kIndexBits) | *index;
     VLOG(MEMORY) << "AidlBufferTracker::add -- new token = " << token;
     return std::make_unique<Token>(token, shared_from_this());
 }
 
 std::shared_ptr<AidlManagedBuffer> AidlBufferTracker::get(uint32_t token) const {
-    std::lock_guard<std::mutex> guard(mMutex);
-    if (mTokenToBuffers.size() <= token || mTokenToBuffers[token] == nullptr) {
+    const uint32_t index = token & kIndexMask;
+    Slot* slot = index == 0 ? nullptr : getSlot(index);
+    std::shared_ptr<AidlManagedBuffer> buffer;
+    if (slot != nullptr) {
+        // Registering as a reader keeps the buffer from being released until it has been copied.
+        const uint64_t state = slot->state.fetch_add(1, std::memory_order_acquire);
+        if ((state & kOccupied) != 0 &&
+            (getGeneration(state) & kGenerationMask) == token >> kIndexBits) {
+            buffer = slot->buffer;
+        }
+        slot->state.fetch_sub(1, std::memory_order_release);
+    }
+    if (buffer == nullptr) {
         LOG(ERROR) << "AidlBufferTracker::get -- unknown token " << token;
-        return nullptr;
     }
-    return mTokenToBuffers[token];
+    return buffer;
 }
 
 void AidlBufferTracker::free(uint32_t token) {
-    std::lock_guard<std::mutex> guard(mMutex);
-    CHECK_LT(token, mTokenToBuffers.size());
-    CHECK(mTokenToBuffers[token] != nullptr);
+    const uint32_t index = token & kIndexMask;
+    Slot* slot = getSlot(index);
+    CHECK(slot != nullptr);
+    const uint64_t state = slot->state.fetch_and(~kOccupied, std::memory_order_acq_rel);
+    CHECK((state & kOccupied) != 0);
+    CHECK_EQ(getGeneration(state) & kGenerationMask, token >> kIndexBits);
     VLOG(MEMORY) << "AidlBufferTracker::free -- release token = " << token;
-    mTokenToBuffers[token] = nullptr;
-    mFreeTokens.push(token);
+
+    // Readers only copy a shared_ptr, so this wait is short. No new reader can copy the buffer
+    // once the slot is no longer occupied.
+    while ((slot->state.load(std::memory_order_acquire) & kReadersMask) != 0) {
+        std::this_thread::yield();
+    }
+    slot->buffer = nullptr;
+    slot->state.fetch_add(uint64_t{1} << kGenerationShift, std::memory_order_relaxed);
+    pushFreeSlot(index);
+}
+
+AidlBufferTracker::Slot* AidlBufferTracker::getSlot(uint32_t index) const {
+    if (index >= kMaxSlots) {
+        return nullptr;
+    }
+    Chunk* chunk = mChunks[index / kSlotsPerChunk].load(std::memory_order_acquire);
+    return chunk == nullptr ? nullptr : &(*chunk)[index % kSlotsPerChunk];
+}
+
+std::optional<uint32_t> AidlBufferTracker::allocateSlot() {
+    if (const auto index = popFreeSlot()) {
+        return index;
+    }
+
+    uint32_t index = mNextUnusedSlot.load(std::memory_order_relaxed);
+    do {
+        if (index >= kMaxSlots) {
+            return std::nullopt;
+        }
+    } while (!mNextUnusedSlot.compare_exchange_weak(index, index + 1, std::memory_order_relaxed));
+
+    auto& chunk = mChunks[index / kSlotsPerChunk];
+    if (chunk.load(std::memory_order_acquire) == nullptr) {
+        // Several threads may race to allocate the same chunk, in which case all but one of them
+        // delete theirs.
+        auto* newChunk = new Chunk();
+        Chunk* expected = nullptr;
+        if (!chunk.compare_exchange_strong(expected, newChunk, std::memory_order_acq_rel)) {
+            delete newChunk;
+        }
+    }
+    return index;
+}
+
+void AidlBufferTracker::pushFreeSlot(uint32_t index) {
+    Slot* slot = getSlot(index);
+    uint64_t head = mFreeSlots.load(std::memory_order_relaxed);
+    uint64_t newHead;
+    do {
+        slot->nextFree.store(static_cast<uint32_t>(head & kStackIndexMask),
+                             std::memory_order_relaxed);
+        newHead = ((head >> 32) + 1) << 32 | index;
+    } while (!mFreeSlots.compare_exchange_weak(head, newHead, std::memory_order_release,
+                                               std::memory_order_relaxed));
+}
+
+std::optional<uint32_t> AidlBufferTracker::popFreeSlot() {
+    uint64_t head = mFreeSlots.load(std::memory_order_acquire);
+    while ((head & kStackIndexMask) != 0) {
+        const auto index = static_cast<uint32_t>(head & kStackIndexMask);
+        // The slot may be popped and pushed again concurrently, in which case the update count
+        // has changed and the compare-exchange below fails.
+        const uint32_t next = getSlot(index)->nextFree.load(std::memory_order_relaxed);
+        const uint64_t newHead = ((head >> 32) + 1) << 32 | next;
+        if (mFreeSlots.compare_exchange_weak(head, newHead, std::memory_order_acquire,
+                                             std::memory_order_acquire)) {
+            return index;
+        }
+    }
+    return std::nullopt;
 }
 
 }  // namespace android::nn
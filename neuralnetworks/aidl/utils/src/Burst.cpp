@@ -27,6 +27,8 @@
 #include <nnapi/TypeUtils.h>
 #include <nnapi/Types.h>
 
+#include <atomic>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -82,17 +84,26 @@ nn::GeneralResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>> convertEx
 }  // namespace
 
 Burst::MemoryCache::MemoryCache(std::shared_ptr<aidl_hal::IBurst> burst)
-    : kBurst(std::move(burst)) {}
+    : kBurst(std::move(burst)), mSnapshot(new Snapshot()) {}
+
+Burst::MemoryCache::~MemoryCache() {
+    delete mSnapshot.load();
+}
 
 std::pair<int64_t, Burst::MemoryCache::SharedCleanup> Burst::MemoryCache::getOrCacheMemory(
         const nn::SharedMemory& memory) {
+    // If cache payload already exists, reuse it.
+    if (auto cached = lookup(memory)) {
+        return std::move(*cached);
+    }
+
     std::lock_guard lock(mMutex);
 
-    // Get the cache payload or create it (with default values) if it does not exist.
-    auto& cachedPayload = mCache[memory];
-    {
-        const auto& [identifier, maybeCleaner] = cachedPayload;
-        // If cache payload already exists, reuse it.
+    // Another thread may have cached the same memory object after the lookup. The snapshot cannot
+    // be replaced while mMutex is held.
+    const Snapshot& current = *mSnapshot.load();
+    if (const auto iter = current.find(memory); iter != current.end()) {
+        const auto& [identifier, maybeCleaner] = iter->second;
         if (auto cleaner = maybeCleaner.lock()) {
             return std::make_pair(identifier, std::move(cleaner));
         }
@@ -114,28 +125,66 @@ std::pair<int64_t, Burst::MemoryCache::SharedCleanup> Burst::MemoryCache::getOrC
     };
     auto cleaner = std::make_shared<const Cleanup>(std::move(cleanup));
 
-    // Store the result in the cache and return it.
+    // Store the result in a new snapshot and return it.
     auto result = std::make_pair(identifier, std::move(cleaner));
-    cachedPayload = result;
+    auto snapshot = std::make_unique<Snapshot>(current);
+    (*snapshot)[memory] = result;
+    publishLocked(std::move(snapshot));
     return result;
 }
 
 std::optional<std::pair<int64_t, Burst::MemoryCache::SharedCleanup>>
 Burst::MemoryCache::getMemoryIfAvailable(const nn::SharedMemory& memory) {
-    std::lock_guard lock(mMutex);
+    // If the entry is not found, the cached payload did not exist or was actively being deleted.
+    return lookup(memory);
+}
+
+Burst::MemoryCache::Metrics Burst::MemoryCache::getMetrics() const {
+    return {
+            .hits = mHits.load(std::memory_order_relaxed),
+            .misses = mMisses.load(std::memory_order_relaxed),
+            .evictions = mEvictions.load(std::memory_order_relaxed),
+    };
+}
 
-    // Get the existing cached entry if it exists.
-    const auto iter = mCache.find(memory);
-    if (iter != mCache.end()) {
+std::optional<std::pair<int64_t, Burst::MemoryCache::SharedCleanup>> Burst::MemoryCache::lookup(
+        const nn::SharedMemory& memory) {
+    std::optional<std::pair<int64_t, SharedCleanup>> result;
+
+    // The snapshot is not freed while this lookup is counted, see publishLocked.
+    auto& activeLookups = mActiveLookups[mEpoch.load() % 2];
+    activeLookups.fetch_add(1);
+    const Snapshot& snapshot = *mSnapshot.load();
+    if (const auto iter = snapshot.find(memory); iter != snapshot.end()) {
         const auto& [identifier, maybeCleaner] = iter->second;
         if (auto cleaner = maybeCleaner.lock()) {
-            return std::make_pair(identifier, std::move(cleaner));
+            result.emplace(identifier, std::move(cleaner));
         }
     }
+    activeLookups.fetch_sub(1);
 
-    // If the code reaches this point, the cached payload did not exist or was actively being
-    // deleted.
-    return std::nullopt;
+    (result.has_value() ? mHits : mMisses).fetch_add(1, std::memory_order_relaxed);
+    return result;
+}
+
+void Burst::MemoryCache::publishLocked(std::unique_ptr<const Snapshot> snapshot) {
+    const uint64_t epoch = mEpoch.load();
+    mRetiredSnapshots[epoch % 2].emplace_back(mSnapshot.exchange(snapshot.release()));
+
+    // A lookup which can still read a replaced snapshot loaded it before the snapshot was replaced,
+    // so it is counted in the epoch the snapshot was retired in or in an earlier one. Lookups of
+    // the epochs before the previous one finished before the epoch last advanced. Once the lookups
+    // of the previous epoch have finished too, the snapshots retired in it can be freed and the
+    // epoch advanced. Lookups which start from now on are counted in the new epoch, so the count of
+    // the current one drains even if lookups never stop.
+    //
+    // A lookup which read the epoch before it advanced but is counted after it reads the current
+    // snapshot, which has not been retired.
+    auto& previousLookups = mActiveLookups[(epoch + 1) % 2];
+    if (previousLookups.load() == 0) {
+        mRetiredSnapshots[(epoch + 1) % 2].clear();
+        mEpoch.store(epoch + 1);
+    }
 }
 
 void Burst::MemoryCache::tryFreeMemory(const nn::SharedMemory& memory, int64_t identifier) {
@@ -144,11 +193,13 @@ void Burst::MemoryCache::tryFreeMemory(const nn::SharedMemory& memory, int64_t i
         // Remove the cached memory and payload if it is present but expired. Note that it may not
         // be present or may not be expired because another thread may have removed or cached the
         // same memory object before the current thread locked mMutex in tryFreeMemory.
-        const auto iter = mCache.find(memory);
-        if (iter != mCache.end()) {
-            if (std::get<WeakCleanup>(iter->second).expired()) {
-                mCache.erase(iter);
-            }
+        const Snapshot& current = *mSnapshot.load();
+        const auto iter = current.find(memory);
+        if (iter != current.end() && std::get<WeakCleanup>(iter->second).expired()) {
+            auto snapshot = std::make_unique<Snapshot>(current);
+            snapshot->erase(memory);
+            publishLocked(std::move(snapshot));
+            mEvictions.fetch_add(1, std::memory_order_relaxed);
         }
     }
     kBurst->releaseMemoryResource(identifier);
@@ -168,10 +219,15 @@ Burst::Burst(PrivateConstructorTag /*tag*/, std::shared_ptr<aidl_hal::IBurst> bu
              nn::Version featureLevel)
     : kBurst(std::move(burst)),
       kMemoryCache(std::make_shared<MemoryCache>(kBurst)),
-      kFeatureLevel(featureLevel) {
+      kFeatureLevel(featureLevel),
+      kRelocationCache(std::make_shared<hal::utils::RequestRelocationCache>()) {
     CHECK(kBurst != nullptr);
 }
 
+Burst::MemoryCache::Metrics Burst::getMemoryCacheMetrics() const {
+    return kMemoryCache->getMetrics();
+}
+
 Burst::OptionalCacheHold Burst::cacheMemory(const nn::SharedMemory& memory) const {
     auto [identifier, hold] = kMemoryCache->getOrCacheMemory(memory);
     return hold;
@@ -185,7 +241,7 @@ nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>> Burst::
     // Ensure that request is ready for IPC.
     std::optional<nn::Request> maybeRequestInShared;
     hal::utils::RequestRelocation relocation;
-    const nn::Request& requestInShared = NN_TRY(hal::utils::convertRequestFromPointerToShared(
+    const nn::Request& requestInShared = NN_TRY(kRelocationCache->convertRequestFromPointerToShared(
             &request, nn::kDefaultRequestMemoryAlignment, nn::kDefaultRequestMemoryPadding,
             &maybeRequestInShared, &relocation));
 
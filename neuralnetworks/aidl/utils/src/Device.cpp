@@ -19,6 +19,7 @@
 #include "Buffer.h"
 #include "Callbacks.h"
 #include "Conversions.h"
+#include "ModelConversion.h"
 #include "PreparedModel.h"
 #include "ProtectCallback.h"
 #include "Utils.h"
@@ -48,6 +49,10 @@ namespace aidl::android::hardware::neuralnetworks::utils {
 
 namespace {
 
+// CONSTANT_COPY operands of at least this size are passed to prepareModel in shared memory rather
+// than being copied into the AIDL model.
+constexpr size_t kMinSharedConstantSize = 64 * 1024;
+
 nn::GeneralResult<std::vector<std::shared_ptr<IPreparedModel>>> convert(
         const std::vector<nn::SharedPreparedModel>& preparedModels) {
     std::vector<std::shared_ptr<IPreparedModel>> aidlPreparedModels(preparedModels.size());
@@ -222,8 +227,11 @@ nn::GeneralResult<nn::SharedPreparedModel> Device::prepareModel(
     std::optional<nn::Model> maybeModelInShared;
     const nn::Model& modelInShared =
             NN_TRY(hal::utils::flushDataFromPointerToShared(&model, &maybeModelInShared));
+    std::optional<nn::Model> maybeModelWithSharedConstants;
+    const nn::Model& modelWithSharedConstants = NN_TRY(moveLargeConstantsToShared(
+            &modelInShared, kMinSharedConstantSize, &maybeModelWithSharedConstants));
 
-    const auto aidlModel = NN_TRY(convert(modelInShared));
+    const auto aidlModel = NN_TRY(convert(modelWithSharedConstants));
     const auto aidlPreference = NN_TRY(convert(preference));
     const auto aidlPriority = NN_TRY(convert(priority));
     const auto aidlDeadline = NN_TRY(convert(deadline));
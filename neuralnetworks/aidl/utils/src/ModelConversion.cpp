@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ModelConversion.h"
+
+#include <android-base/logging.h>
+#include <nnapi/Result.h>
+#include <nnapi/SharedMemory.h>
+#include <nnapi/Types.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <variant>
+
+namespace aidl::android::hardware::neuralnetworks::utils {
+namespace {
+
+// Alignment of each constant moved to shared memory, which is enough for any operand type.
+constexpr size_t kConstantAlignment = 64;
+
+size_t roundUp(size_t size, size_t multiple) {
+    return (size + multiple - 1) / multiple * multiple;
+}
+
+}  // namespace
+
+nn::GeneralResult<std::reference_wrapper<const nn::Model>> moveLargeConstantsToShared(
+        const nn::Model* model, size_t minSize, std::optional<nn::Model>* maybeModelInSharedOut) {
+    CHECK(model != nullptr);
+    CHECK(maybeModelInSharedOut != nullptr);
+
+    const auto isLarge = [minSize](const nn::Operand& operand) {
+        return operand.lifetime == nn::Operand::LifeTime::CONSTANT_COPY &&
+               operand.location.length >= std::max<size_t>(minSize, 1);
+    };
+
+    size_t sharedSize = 0;
+    const auto addToSharedSize = [&isLarge, &sharedSize](const nn::Model::Subgraph& subgraph) {
+        for (const auto& operand : subgraph.operands) {
+            if (isLarge(operand)) {
+                sharedSize = roundUp(sharedSize, kConstantAlignment) + operand.location.length;
+            }
+        }
+    };
+    addToSharedSize(model->main);
+    std::for_each(model->referenced.begin(), model->referenced.end(), addToSharedSize);
+
+    if (sharedSize == 0) {
+        return std::cref(*model);
+    }
+    if (sharedSize > std::numeric_limits<uint32_t>::max()) {
+        return NN_ERROR(nn::ErrorStatus::INVALID_ARGUMENT)
+               << "Constants of " << sharedSize << " bytes do not fit in one memory pool";
+    }
+
+    auto memory = NN_TRY(nn::createSharedMemory(sharedSize));
+    const auto mapping = NN_TRY(nn::map(memory));
+    auto* sharedData = static_cast<uint8_t*>(std::get<void*>(mapping.pointer));
+
+    // The operand values are rebuilt rather than copied, as they only keep the small constants.
+    nn::Model& modelInShared = maybeModelInSharedOut->emplace(nn::Model{
+            .main = model->main,
+            .referenced = model->referenced,
+            .pools = model->pools,
+            .relaxComputationFloat32toFloat16 = model->relaxComputationFloat32toFloat16,
+            .extensionNameToPrefix = model->extensionNameToPrefix,
+    });
+    const auto poolIndex = static_cast<uint32_t>(modelInShared.pools.size());
+    modelInShared.pools.push_back(std::move(memory));
+
+    size_t sharedOffset = 0;
+    const auto relocate = [&](nn::Model::Subgraph* subgraph) -> nn::GeneralResult<void> {
+        for (auto& operand : subgraph->operands) {
+            if (operand.lifetime != nn::Operand::LifeTime::CONSTANT_COPY) {
+                continue;
+            }
+            const size_t offset = operand.location.offset;
+            const size_t length = operand.location.length;
+            if (offset + length > model->operandValues.size()) {
+                return NN_ERROR(nn::ErrorStatus::INVALID_ARGUMENT)
+                       << "CONSTANT_COPY operand at offset " << offset << " of length " << length
+                       << " exceeds the " << model->operandValues.size()
+                       << " bytes of operand values";
+            }
+            const uint8_t* data = model->operandValues.data() + offset;
+            if (isLarge(operand)) {
+                sharedOffset = roundUp(sharedOffset, kConstantAlignment);
+                std::memcpy(sharedData + sharedOffset, data, length);
+                operand.lifetime = nn::Operand::LifeTime::CONSTANT_REFERENCE;
+                operand.location = {.poolIndex = poolIndex,
+                                    .offset = static_cast<uint32_t>(sharedOffset),
+                                    .length = static_cast<uint32_t>(length)};
+                sharedOffset += length;
+            } else {
+                operand.location = modelInShared.operandValues.append(data, length);
+            }
+        }
+        return {};
+    };
+    NN_TRY(relocate(&modelInShared.main));
+    for (auto& subgraph : modelInShared.referenced) {
+        NN_TRY(relocate(&subgraph));
+    }
+
+    return std::cref(modelInShared);
+}
+
+}  // namespace aidl::android::hardware::neuralnetworks::utils
@@ -124,7 +124,9 @@ nn::GeneralResult<std::shared_ptr<const PreparedModel>> PreparedModel::create(
 PreparedModel::PreparedModel(PrivateConstructorTag /*tag*/,
                              std::shared_ptr<aidl_hal::IPreparedModel> preparedModel,
                              nn::Version featureLevel)
-    : kPreparedModel(std::move(preparedModel)), kFeatureLevel(featureLevel) {}
+    : kPreparedModel(std::move(preparedModel)),
+      kFeatureLevel(featureLevel),
+      kRelocationCache(std::make_shared<hal::utils::RequestRelocationCache>()) {}
 
 nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>> PreparedModel::execute(
         const nn::Request& request, nn::MeasureTiming measure,
@@ -134,7 +136,7 @@ nn::ExecutionResult<std::pair<std::vector<nn::OutputShape>, nn::Timing>> Prepare
     // Ensure that request is ready for IPC.
     std::optional<nn::Request> maybeRequestInShared;
     hal::utils::RequestRelocation relocation;
-    const nn::Request& requestInShared = NN_TRY(hal::utils::convertRequestFromPointerToShared(
+    const nn::Request& requestInShared = NN_TRY(kRelocationCache->convertRequestFromPointerToShared(
             &request, nn::kDefaultRequestMemoryAlignment, nn::kDefaultRequestMemoryPadding,
             &maybeRequestInShared, &relocation));
 
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <nnapi/Types.h>
+#include <nnapi/hal/aidl/BufferTracker.h>
+
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace android::nn {
+namespace {
+
+std::shared_ptr<AidlManagedBuffer> createBuffer() {
+    const Operand operand = {.type = OperandType::TENSOR_FLOAT32, .dimensions = {1}};
+    auto buffer = AidlManagedBuffer::create(sizeof(float), {}, operand);
+    EXPECT_NE(buffer, nullptr);
+    return buffer;
+}
+
+}  // namespace
+
+TEST(BufferTrackerTest, addAndGet) {
+    // setup test
+    const auto tracker = AidlBufferTracker::create();
+    const auto buffer = createBuffer();
+
+    // run test
+    const auto token = tracker->add(buffer);
+
+    // verify result
+    ASSERT_NE(token, nullptr);
+    EXPECT_NE(token->get(), 0u);
+    EXPECT_EQ(tracker->get(token->get()), buffer);
+}
+
+TEST(BufferTrackerTest, addNullBuffer) {
+    // setup test
+    const auto tracker = AidlBufferTracker::create();
+
+    // run test
+    const auto token = tracker->add(nullptr);
+
+    // verify result
+    EXPECT_EQ(token, nullptr);
+}
+
+TEST(BufferTrackerTest, getUnknownToken) {
+    // setup test
+    const auto tracker = AidlBufferTracker::create();
+    const auto token = tracker->add(createBuffer());
+    ASSERT_NE(token, nullptr);
+
+    // run test and verify result
+    EXPECT_EQ(tracker->get(0), nullptr);
+    EXPECT_EQ(tracker->get(token->get() + 1), nullptr);
+    EXPECT_EQ(tracker->get(0x7fffffff), nullptr);
+}
+
+TEST(BufferTrackerTest, getFreedToken) {
+    // setup test
+    const auto tracker = AidlBufferTracker::create();
+    auto token = tracker->add(createBuffer());
+    ASSERT_NE(token, nullptr);
+    const uint32_t freedToken = token->get();
+
+    // run test
+    token.reset();
+
+    // verify result
+    EXPECT_EQ(tracker->get(freedToken), nullptr);
+}
+
+TEST(BufferTrackerTest, reusedSlotHasNewToken) {
+    // setup test
+    const auto tracker = AidlBufferTracker::create();
+    auto token = tracker->add(createBuffer());
+    ASSERT_NE(token, nullptr);
+    const uint32_t freedToken = token->get();
+    token.reset();
+
+    // run test
+    const auto buffer = createBuffer();
+    const auto newToken = tracker->add(buffer);
+
+    // verify result
+    ASSERT_NE(newToken, nullptr);
+    EXPECT_NE(newToken->get(), freedToken);
+    EXPECT_EQ(tracker->get(freedToken), nullptr);
+    EXPECT_EQ(tracker->get(newToken->get()), buffer);
+}
+
+TEST(BufferTrackerTest, tokensAreUnique) {
+    // setup test
+    const auto tracker = AidlBufferTracker::create();
+    std::vector<std::unique_ptr<AidlBufferTracker::Token>> tokens;
+    std::set<uint32_t> values;
+
+    // run test
+    for (size_t i = 0; i < 3000; ++i) {
+        tokens.push_back(tracker->add(createBuffer()));
+        ASSERT_NE(tokens.back(), nullptr);
+        values.insert(tokens.back()->get());
+    }
+
+    // verify result
+    EXPECT_EQ(values.size(), tokens.size());
+    for (const auto value : values) {
+        EXPECT_LE(value, static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
+    }
+}
+
+TEST(BufferTrackerTest, concurrentAddGetAndFree) {
+    // setup test
+    constexpr size_t kNumThreads = 8;
+    constexpr size_t kNumIterations = 1000;
+    const auto tracker = AidlBufferTracker::create();
+    const auto sharedBuffer = createBuffer();
+    const auto sharedToken = tracker->add(sharedBuffer);
+    ASSERT_NE(sharedToken, nullptr);
+    std::atomic<size_t> failures = 0;
+
+    // run test
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < kNumThreads; ++i) {
+        threads.emplace_back([&] {
+            for (size_t j = 0; j < kNumIterations; ++j) {
+                const auto buffer = createBuffer();
+                auto token = tracker->add(buffer);
+                if (token == nullptr || tracker->get(token->get()) != buffer ||
+                    tracker->get(sharedToken->get()) != sharedBuffer) {
+                    ++failures;
+                }
+                const uint32_t freedToken = token == nullptr ? 0 : token->get();
+                token.reset();
+                if (tracker->get(freedToken) == buffer) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // verify result
+    EXPECT_EQ(failures, 0u);
+}
+
+}  // namespace android::nn
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MockBurst.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <nnapi/SharedMemory.h>
+#include <nnapi/Types.h>
+#include <nnapi/hal/aidl/Burst.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace aidl::android::hardware::neuralnetworks::utils {
+namespace {
+
+using ::testing::_;
+using ::testing::InvokeWithoutArgs;
+
+constexpr auto makeStatusOk = [] { return ndk::ScopedAStatus::ok(); };
+
+nn::SharedMemory createMemory() {
+    return nn::createSharedMemory(64).value();
+}
+
+}  // namespace
+
+TEST(BurstMemoryCacheTest, getOrCacheMemoryReusesLiveEntry) {
+    // setup test
+    const auto mockBurst = ndk::SharedRefBase::make<MockBurst>();
+    const auto memoryCache = std::make_shared<Burst::MemoryCache>(mockBurst);
+    const auto memory = createMemory();
+
+    // run test
+    const auto [identifier0, hold0] = memoryCache->getOrCacheMemory(memory);
+    const auto [identifier1, hold1] = memoryCache->getOrCacheMemory(memory);
+
+    // verify result
+    EXPECT_EQ(identifier0, identifier1);
+    EXPECT_EQ(hold0, hold1);
+    const auto metrics = memoryCache->getMetrics();
+    EXPECT_EQ(metrics.hits, 1u);
+    EXPECT_EQ(metrics.misses, 1u);
+    EXPECT_EQ(metrics.evictions, 0u);
+}
+
+TEST(BurstMemoryCacheTest, releasingLastHoldEvictsEntry) {
+    // setup test
+    const auto mockBurst = ndk::SharedRefBase::make<MockBurst>();
+    const auto memoryCache = std::make_shared<Burst::MemoryCache>(mockBurst);
+    const auto memory = createMemory();
+    auto [identifier, hold] = memoryCache->getOrCacheMemory(memory);
+    EXPECT_CALL(*mockBurst, releaseMemoryResource(identifier))
+            .Times(1)
+            .WillOnce(InvokeWithoutArgs(makeStatusOk));
+
+    // run test
+    hold.reset();
+    const auto result = memoryCache->getMemoryIfAvailable(memory);
+
+    // verify result
+    EXPECT_FALSE(result.has_value());
+    const auto metrics = memoryCache->getMetrics();
+    EXPECT_EQ(metrics.hits, 0u);
+    EXPECT_EQ(metrics.misses, 2u);
+    EXPECT_EQ(metrics.evictions, 1u);
+}
+
+TEST(BurstMemoryCacheTest, concurrentLookupsAndUpdates) {
+    // setup test
+    constexpr size_t kNumThreads = 4;
+    constexpr size_t kNumIterations = 1000;
+    const auto mockBurst = ndk::SharedRefBase::make<MockBurst>();
+    EXPECT_CALL(*mockBurst, releaseMemoryResource(_))
+            .WillRepeatedly(InvokeWithoutArgs(makeStatusOk));
+    const auto memoryCache = std::make_shared<Burst::MemoryCache>(mockBurst);
+    const auto sharedMemory = createMemory();
+    const auto sharedHold = memoryCache->getOrCacheMemory(sharedMemory).second;
+
+    // run test
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < kNumThreads; ++i) {
+        threads.emplace_back([&memoryCache, &sharedMemory] {
+            const auto memory = createMemory();
+            for (size_t j = 0; j < kNumIterations; ++j) {
+                // Adds and evicts an entry, replacing the snapshot read by the other threads.
+                memoryCache->getOrCacheMemory(memory);
+                EXPECT_TRUE(memoryCache->getMemoryIfAvailable(sharedMemory).has_value());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // verify result
+    const auto metrics = memoryCache->getMetrics();
+    EXPECT_EQ(metrics.evictions, kNumThreads * kNumIterations);
+    EXPECT_GE(metrics.hits, kNumThreads * kNumIterations);
+}
+
+}  // namespace aidl::android::hardware::neuralnetworks::utils
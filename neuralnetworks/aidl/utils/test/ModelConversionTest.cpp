@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <nnapi/SharedMemory.h>
+#include <nnapi/Types.h>
+#include <nnapi/hal/aidl/Conversions.h>
+#include <nnapi/hal/aidl/ModelConversion.h>
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <variant>
+#include <vector>
+
+namespace aidl::android::hardware::neuralnetworks::utils {
+namespace {
+
+namespace nn = ::android::nn;
+
+constexpr size_t kMinSize = 1024;
+
+// Creates a model which adds a constant tensor of the given number of elements to its input.
+nn::Model createAddModel(uint32_t numElements, float weight = 1.0f) {
+    nn::Model model;
+    const std::vector<float> weights(numElements, weight);
+    const int32_t activation = 0;
+    const auto weightsLocation = model.operandValues.append(
+            reinterpret_cast<const uint8_t*>(weights.data()), weights.size() * sizeof(float));
+    const auto activationLocation = model.operandValues.append(
+            reinterpret_cast<const uint8_t*>(&activation), sizeof(activation));
+    model.main = {
+            .operands = {{.type = nn::OperandType::TENSOR_FLOAT32,
+                          .dimensions = {numElements},
+                          .lifetime = nn::Operand::LifeTime::SUBGRAPH_INPUT},
+                         {.type = nn::OperandType::TENSOR_FLOAT32,
+                          .dimensions = {numElements},
+                          .lifetime = nn::Operand::LifeTime::CONSTANT_COPY,
+                          .location = weightsLocation},
+                         {.type = nn::OperandType::INT32,
+                          .lifetime = nn::Operand::LifeTime::CONSTANT_COPY,
+                          .location = activationLocation},
+                         {.type = nn::OperandType::TENSOR_FLOAT32,
+                          .dimensions = {numElements},
+                          .lifetime = nn::Operand::LifeTime::SUBGRAPH_OUTPUT}},
+            .operations = {{.type = nn::OperationType::ADD, .inputs = {0, 1, 2}, .outputs = {3}}},
+            .inputIndexes = {0},
+            .outputIndexes = {3}};
+    return model;
+}
+
+}  // namespace
+
+TEST(ModelConversionTest, moveLargeConstantsToSharedKeepsSmallConstants) {
+    // setup test
+    const auto model = createAddModel(kMinSize / sizeof(float) / 2);
+    std::optional<nn::Model> maybeModelInShared;
+
+    // run test
+    const auto result = moveLargeConstantsToShared(&model, kMinSize, &maybeModelInShared);
+
+    // verify result
+    ASSERT_TRUE(result.has_value()) << result.error().message;
+    EXPECT_EQ(&result.value().get(), &model);
+    EXPECT_FALSE(maybeModelInShared.has_value());
+}
+
+TEST(ModelConversionTest, moveLargeConstantsToSharedMovesLargeConstants) {
+    // setup test
+    const uint32_t numElements = kMinSize;
+    const auto model = createAddModel(numElements, 2.0f);
+    std::optional<nn::Model> maybeModelInShared;
+
+    // run test
+    const auto result = moveLargeConstantsToShared(&model, kMinSize, &maybeModelInShared);
+
+    // verify result
+    ASSERT_TRUE(result.has_value()) << result.error().message;
+    ASSERT_TRUE(maybeModelInShared.has_value());
+    const nn::Model& modelInShared = result.value();
+    EXPECT_EQ(&modelInShared, &maybeModelInShared.value());
+    ASSERT_EQ(modelInShared.pools.size(), 1u);
+    EXPECT_LT(modelInShared.operandValues.size(), kMinSize);
+
+    const auto& weights = modelInShared.main.operands[1];
+    EXPECT_EQ(weights.lifetime, nn::Operand::LifeTime::CONSTANT_REFERENCE);
+    EXPECT_EQ(weights.location.poolIndex, 0u);
+    EXPECT_EQ(weights.location.length, numElements * sizeof(float));
+    EXPECT_EQ(modelInShared.main.operands[2].lifetime, nn::Operand::LifeTime::CONSTANT_COPY);
+
+    const auto mapping = nn::map(modelInShared.pools[0]);
+    ASSERT_TRUE(mapping.has_value()) << mapping.error().message;
+    const auto* data = static_cast<const uint8_t*>(std::get<void*>(mapping.value().pointer)) +
+                       weights.location.offset;
+    EXPECT_EQ(std::memcmp(data, model.operandValues.data() + model.main.operands[1].location.offset,
+                          weights.location.length),
+              0);
+
+    // The moved model is still a valid model.
+    EXPECT_TRUE(convert(modelInShared).has_value());
+}
+
+TEST(ModelConversionTest, moveLargeConstantsToSharedInvalidLocation) {
+    // setup test
+    auto model = createAddModel(kMinSize);
+    model.main.operands[1].location.offset = model.operandValues.size();
+    std::optional<nn::Model> maybeModelInShared;
+
+    // run test
+    const auto result = moveLargeConstantsToShared(&model, kMinSize, &maybeModelInShared);
+
+    // verify result
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error().code, nn::ErrorStatus::INVALID_ARGUMENT);
+}
+
+}  // namespace aidl::android::hardware::neuralnetworks::utils
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/logging.h>
+#include <nnapi/Types.h>
+#include <nnapi/hal/aidl/Adapter.h>
+#include <nnapi/hal/aidl/RequestBatcher.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace aidl::android::hardware::neuralnetworks::adapter {
+namespace {
+
+namespace nn = ::android::nn;
+
+// Measures the throughput and latency of synchronous executions issued concurrently by several
+// clients against one prepared model, with and without batching. The simulated driver runs one
+// dispatch at a time, and each dispatch costs a fixed overhead plus a smaller cost per request.
+// The argument is the number of concurrent clients.
+
+constexpr auto kDispatchOverhead = std::chrono::microseconds(200);
+constexpr auto kRequestCost = std::chrono::microseconds(20);
+constexpr size_t kRequestsPerClient = 32;
+constexpr size_t kMaxBatchSize = 16;
+
+void busyWait(std::chrono::nanoseconds duration) {
+    const auto end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+class SimulatedDriver {
+  public:
+    std::vector<BatchedResult> execute(size_t numRequests) {
+        std::lock_guard guard(mMutex);
+        busyWait(kDispatchOverhead + numRequests * kRequestCost);
+        return std::vector<BatchedResult>(
+                numRequests, std::make_pair(std::vector<nn::OutputShape>{}, nn::Timing{}));
+    }
+
+  private:
+    std::mutex mMutex;
+};
+
+template <typename Execute>
+void runClients(benchmark::State& state, const Execute& execute) {
+    const size_t numClients = state.range(0);
+    std::atomic<int64_t> totalLatencyNs = 0;
+    for (auto _ : state) {
+        std::vector<std::thread> clients;
+        clients.reserve(numClients);
+        for (size_t i = 0; i < numClients; ++i) {
+            clients.emplace_back([&execute, &totalLatencyNs] {
+                for (size_t j = 0; j < kRequestsPerClient; ++j) {
+                    const auto start = std::chrono::steady_clock::now();
+                    const auto result = execute();
+                    CHECK(result.has_value());
+                    totalLatencyNs += std::chrono::nanoseconds(std::chrono::steady_clock::now() -
+                                                               start)
+                                              .count();
+                }
+            });
+        }
+        for (auto& client : clients) {
+            client.join();
+        }
+    }
+    const int64_t numRequests = state.iterations() * numClients * kRequestsPerClient;
+    state.SetItemsProcessed(numRequests);
+    state.counters["avg_latency_us"] =
+            numRequests == 0 ? 0.0 : totalLatencyNs / 1000.0 / numRequests;
+}
+
+void BM_Unbatched(benchmark::State& state) {
+    SimulatedDriver driver;
+    runClients(state, [&driver] { return std::move(driver.execute(1).front()); });
+}
+
+void BM_Batched(benchmark::State& state) {
+    SimulatedDriver driver;
+    RequestBatcher batcher(
+            [&driver](std::vector<BatchedRequest> requests) {
+                return driver.execute(requests.size());
+            },
+            kMaxBatchSize);
+    runClients(state, [&batcher] { return batcher.execute({}); });
+
+    const auto metrics = batcher.getMetrics();
+    state.counters["avg_batch_size"] =
+            metrics.batches == 0 ? 0.0 : static_cast<double>(metrics.requests) / metrics.batches;
+    state.counters["max_batch_size"] = metrics.maxBatchSize;
+}
+
+BENCHMARK(BM_Unbatched)->ArgName("clients")->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
+BENCHMARK(BM_Batched)->ArgName("clients")->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
+
+}  // namespace
+}  // namespace aidl::android::hardware::neuralnetworks::adapter
+
+BENCHMARK_MAIN();
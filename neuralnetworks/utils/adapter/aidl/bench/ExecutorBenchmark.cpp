@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <nnapi/Types.h>
+#include <nnapi/hal/aidl/Adapter.h>
+#include <nnapi/hal/aidl/ThreadPoolExecutor.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace aidl::android::hardware::neuralnetworks::adapter {
+namespace {
+
+namespace nn = ::android::nn;
+
+// Time a task spends busy, standing in for preparing a small model or running an execution.
+constexpr auto kTaskDuration = std::chrono::microseconds(200);
+
+// Counts down the tasks of a benchmark iteration and lets the benchmark wait for all of them.
+class Latch {
+  public:
+    explicit Latch(size_t count) : mCount(count) {}
+
+    void countDown() {
+        std::lock_guard guard(mMutex);
+        if (--mCount == 0) {
+            mCondition.notify_all();
+        }
+    }
+
+    void wait() {
+        std::unique_lock lock(mMutex);
+        mCondition.wait(lock, [this] { return mCount == 0; });
+    }
+
+  private:
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    size_t mCount;
+};
+
+void busyWait(std::chrono::nanoseconds duration) {
+    const auto end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+// Schedules bursts of tasks on the executor and waits for all of them to complete. The argument is
+// the number of tasks per burst. One in four tasks is high priority and every task has a deadline.
+void runBursts(benchmark::State& state, const PriorityExecutor& executor) {
+    const size_t numTasks = state.range(0);
+    for (auto _ : state) {
+        Latch latch(numTasks);
+        const auto deadline = nn::Clock::now() + std::chrono::seconds(1);
+        for (size_t i = 0; i < numTasks; ++i) {
+            const auto priority = i % 4 == 0 ? nn::Priority::HIGH : nn::Priority::MEDIUM;
+            executor(
+                    [&latch] {
+                        busyWait(kTaskDuration);
+                        latch.countDown();
+                    },
+                    priority, deadline);
+        }
+        latch.wait();
+    }
+    state.SetItemsProcessed(state.iterations() * numTasks);
+}
+
+// The executor adapt() used to install, which starts a detached thread per task.
+void BM_DetachedThreadPerTask(benchmark::State& state) {
+    const PriorityExecutor executor = [](Task task, nn::Priority /*priority*/,
+                                         nn::OptionalTimePoint /*deadline*/) {
+        std::thread(std::move(task)).detach();
+    };
+    runBursts(state, executor);
+}
+
+// The executor adapt() installs by default.
+void BM_ThreadPoolExecutor(benchmark::State& state) {
+    const size_t numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    ThreadPoolExecutor threadPool(numThreads, numThreads * 16);
+    const PriorityExecutor executor = [&threadPool](Task task, nn::Priority priority,
+                                                    nn::OptionalTimePoint deadline) {
+        threadPool.schedule(std::move(task), priority, deadline);
+    };
+    runBursts(state, executor);
+
+    const auto metrics = threadPool.getMetrics();
+    state.counters["max_queue_depth"] = metrics.maxQueueDepth;
+    state.counters["blocked_schedules"] = metrics.blockedSchedules;
+    state.counters["late_starts"] = metrics.startedAfterDeadline;
+    // A worker counts a task as completed only after the task has counted down the latch, so the
+    // completed count may still be short here. Every task was scheduled and started by now, and its
+    // queue time is recorded when it starts.
+    state.counters["avg_queue_us"] =
+            metrics.scheduled == 0
+                    ? 0.0
+                    : std::chrono::duration<double, std::micro>(metrics.totalQueueTime).count() /
+                              metrics.scheduled;
+}
+
+BENCHMARK(BM_DetachedThreadPerTask)->ArgName("tasks")->Arg(16)->Arg(256)->UseRealTime();
+BENCHMARK(BM_ThreadPoolExecutor)->ArgName("tasks")->Arg(16)->Arg(256)->UseRealTime();
+
+}  // namespace
+}  // namespace aidl::android::hardware::neuralnetworks::adapter
+
+BENCHMARK_MAIN();
@@ -19,10 +19,13 @@
 
 #include <aidl/android/hardware/neuralnetworks/BnDevice.h>
 #include <nnapi/IDevice.h>
+#include <nnapi/IPreparedModel.h>
 #include <nnapi/Types.h>
 
 #include <functional>
 #include <memory>
+#include <utility>
+#include <vector>
 
 // See hardware/interfaces/neuralnetworks/utils/README.md for more information on AIDL interface
 // lifetimes across processes and for protecting asynchronous calls across AIDL.
@@ -43,6 +46,43 @@ using Task = std::function<void()>;
  */
 using Executor = std::function<void(Task, ::android::nn::OptionalTimePoint)>;
 
+/**
+ * A type-erased executor which executes a task asynchronously, given the priority of the task.
+ *
+ * This is the same as Executor, but is also provided the priority the caller requested for the
+ * task. Tasks which have no priority, such as preparing a model from cache, are given
+ * nn::Priority::MEDIUM.
+ */
+using PriorityExecutor = std::function<void(Task, ::android::nn::Priority,
+                                            ::android::nn::OptionalTimePoint)>;
+
+/**
+ * A synchronous execution queued to be run as part of a batch.
+ */
+struct BatchedRequest {
+    ::android::nn::Request request;
+    ::android::nn::MeasureTiming measure;
+    ::android::nn::OptionalTimePoint deadline;
+    ::android::nn::OptionalDuration loopTimeoutDuration;
+};
+
+/**
+ * The result of a synchronous execution, as returned by nn::IPreparedModel::execute.
+ */
+using BatchedResult = ::android::nn::ExecutionResult<
+        std::pair<std::vector<::android::nn::OutputShape>, ::android::nn::Timing>>;
+
+/**
+ * A type-erased function which runs several synchronous executions of a prepared model in a single
+ * dispatch to the driver.
+ *
+ * It must return one result per request, in the order of the requests. Requests which share a
+ * memory pool are given the same nn::SharedMemory object for it, so the driver only has to map
+ * each pool once per batch.
+ */
+using BatchExecutor = std::function<std::vector<BatchedResult>(
+        const ::android::nn::IPreparedModel&, std::vector<BatchedRequest>)>;
+
 /**
  * Adapt an NNAPI canonical interface object to a AIDL NN HAL interface object.
  *
@@ -55,7 +95,34 @@ std::shared_ptr<BnDevice> adapt(::android::nn::SharedDevice device, Executor exe
 /**
  * Adapt an NNAPI canonical interface object to a AIDL NN HAL interface object.
  *
- * This function uses a default executor, which will execute tasks from a detached thread.
+ * @param device NNAPI canonical IDevice interface object to be adapted.
+ * @param executor Type-erased executor to handle executing prioritized tasks asynchronously.
+ * @return AIDL NN HAL IDevice interface object.
+ */
+std::shared_ptr<BnDevice> adapt(::android::nn::SharedDevice device, PriorityExecutor executor);
+
+/**
+ * Adapt an NNAPI canonical interface object to a AIDL NN HAL interface object, for a driver which
+ * can run several executions of a prepared model at once.
+ *
+ * Synchronous executions which arrive while an earlier one is running on the same prepared model
+ * are queued, and all of the queued executions are then dispatched together through batchExecutor.
+ * Executions with execution hints or extension prefixes are not batched.
+ *
+ * @param device NNAPI canonical IDevice interface object to be adapted.
+ * @param executor Type-erased executor to handle executing prioritized tasks asynchronously.
+ * @param batchExecutor Type-erased function to handle executing batches of requests.
+ * @return AIDL NN HAL IDevice interface object.
+ */
+std::shared_ptr<BnDevice> adapt(::android::nn::SharedDevice device, PriorityExecutor executor,
+                                BatchExecutor batchExecutor);
+
+/**
+ * Adapt an NNAPI canonical interface object to a AIDL NN HAL interface object.
+ *
+ * This function uses a default executor, which executes tasks on a ThreadPoolExecutor with one
+ * worker thread per CPU. Tasks are started by priority then deadline, and callers block once too
+ * many tasks are queued.
  *
  * @param device NNAPI canonical IDevice interface object to be adapted.
  * @return AIDL NN HAL IDevice interface object.
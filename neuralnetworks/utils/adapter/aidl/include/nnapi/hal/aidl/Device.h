@@ -18,6 +18,7 @@
 #define ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_ADAPTER_AIDL_DEVICE_H
 
 #include "nnapi/hal/aidl/Adapter.h"
+#include "nnapi/hal/aidl/ThreadPoolExecutor.h"
 
 #include <aidl/android/hardware/neuralnetworks/BnDevice.h>
 #include <aidl/android/hardware/neuralnetworks/BufferDesc.h>
@@ -37,6 +38,7 @@
 #include <nnapi/IDevice.h>
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -48,7 +50,13 @@ namespace aidl::android::hardware::neuralnetworks::adapter {
 // Class that adapts nn::IDevice to BnDevice.
 class Device : public BnDevice {
   public:
-    Device(::android::nn::SharedDevice device, Executor executor);
+    /**
+     * @param threadPool Thread pool which runs the tasks of executor, if any. It is only used to
+     *     report its metrics.
+     */
+    Device(::android::nn::SharedDevice device, PriorityExecutor executor,
+           BatchExecutor batchExecutor = nullptr,
+           std::shared_ptr<const ThreadPoolExecutor> threadPool = nullptr);
 
     ndk::ScopedAStatus allocate(const BufferDesc& desc,
                                 const std::vector<IPreparedModelParcel>& preparedModels,
@@ -77,9 +85,17 @@ class Device : public BnDevice {
             const Model& model, const PrepareModelConfig& config,
             const std::shared_ptr<IPreparedModelCallback>& callback) override;
 
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
+    // Returns the metrics of the thread pool running the tasks of the executor, or std::nullopt if
+    // the executor was provided by the caller of adapt().
+    std::optional<ThreadPoolExecutor::Metrics> getExecutorMetrics() const;
+
   protected:
     const ::android::nn::SharedDevice kDevice;
-    const Executor kExecutor;
+    const PriorityExecutor kExecutor;
+    const BatchExecutor kBatchExecutor;
+    const std::shared_ptr<const ThreadPoolExecutor> kThreadPool;
 };
 
 }  // namespace aidl::android::hardware::neuralnetworks::adapter
@@ -18,6 +18,7 @@
 #define ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_ADAPTER_AIDL_PREPARED_MDOEL_H
 
 #include "nnapi/hal/aidl/Adapter.h"
+#include "nnapi/hal/aidl/RequestBatcher.h"
 
 #include <aidl/android/hardware/neuralnetworks/BnPreparedModel.h>
 #include <aidl/android/hardware/neuralnetworks/ExecutionResult.h>
@@ -30,6 +31,7 @@
 #include <nnapi/Types.h>
 
 #include <memory>
+#include <optional>
 #include <vector>
 
 // See hardware/interfaces/neuralnetworks/utils/README.md for more information on AIDL interface
@@ -40,7 +42,8 @@ namespace aidl::android::hardware::neuralnetworks::adapter {
 // Class that adapts nn::IPreparedModel to BnPreparedModel.
 class PreparedModel : public BnPreparedModel {
   public:
-    explicit PreparedModel(::android::nn::SharedPreparedModel preparedModel);
+    explicit PreparedModel(::android::nn::SharedPreparedModel preparedModel,
+                           BatchExecutor batchExecutor = nullptr);
 
     ndk::ScopedAStatus executeSynchronously(const Request& request, bool measureTiming,
                                             int64_t deadlineNs, int64_t loopTimeoutDurationNs,
@@ -63,10 +66,18 @@ class PreparedModel : public BnPreparedModel {
             const ExecutionConfig& config, int64_t deadlineNs, int64_t durationNs,
             FencedExecutionResult* executionResult) override;
 
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
     ::android::nn::SharedPreparedModel getUnderlyingPreparedModel() const;
 
+    // Returns the metrics of the synchronous execution batcher, or std::nullopt if synchronous
+    // executions are not batched.
+    std::optional<RequestBatcher::Metrics> getBatcherMetrics() const;
+
   protected:
     const ::android::nn::SharedPreparedModel kPreparedModel;
+    // Coalesces synchronous executions, or nullptr if the driver does not support batching.
+    const std::unique_ptr<RequestBatcher> kBatcher;
 };
 
 }  // namespace aidl::android::hardware::neuralnetworks::adapter
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_ADAPTER_AIDL_REQUEST_BATCHER_H
+#define ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_ADAPTER_AIDL_REQUEST_BATCHER_H
+
+#include "nnapi/hal/aidl/Adapter.h"
+
+#include <android-base/thread_annotations.h>
+#include <nnapi/Types.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace aidl::android::hardware::neuralnetworks::adapter {
+
+/**
+ * Coalesces concurrent synchronous executions into batches.
+ *
+ * At most one batch is dispatched at a time. Executions which arrive while a batch is running are
+ * queued, and once the batch completes, one of the waiting callers dispatches all of the queued
+ * executions as the next batch. An execution which arrives while nothing is running is dispatched
+ * on its own immediately, so batching never delays an execution on an idle prepared model.
+ */
+class RequestBatcher final {
+  public:
+    using Dispatch = std::function<std::vector<BatchedResult>(std::vector<BatchedRequest>)>;
+
+    struct Metrics {
+        // Number of executions and of batches they were dispatched in.
+        uint64_t requests = 0;
+        uint64_t batches = 0;
+        // Largest number of executions dispatched in one batch.
+        size_t maxBatchSize = 0;
+        // Number of memory pools which were replaced by an identical pool of an earlier request in
+        // the same batch.
+        uint64_t sharedPools = 0;
+        // Number of executions failed without being dispatched because their deadline passed
+        // while they were queued.
+        uint64_t missedDeadlines = 0;
+    };
+
+    /**
+     * @param dispatch Function which runs a batch, returning one result per request in order.
+     * @param maxBatchSize Largest number of executions dispatched at once, must be at least 1.
+     */
+    RequestBatcher(Dispatch dispatch, size_t maxBatchSize);
+
+    // Prevent copy and move.
+    RequestBatcher(const RequestBatcher&) = delete;
+    RequestBatcher(RequestBatcher&&) = delete;
+    RequestBatcher& operator=(const RequestBatcher&) = delete;
+    RequestBatcher& operator=(RequestBatcher&&) = delete;
+
+    /**
+     * Runs the execution as part of a batch, blocking until its result is available.
+     */
+    BatchedResult execute(BatchedRequest request);
+
+    Metrics getMetrics() const;
+
+  private:
+    struct PendingRequest {
+        BatchedRequest request;
+        std::optional<BatchedResult> result;
+    };
+
+    // Dispatches the next batch from the queue. The lock is released while the batch runs.
+    // Executions whose deadline has passed are failed with MISSED_DEADLINE_TRANSIENT instead.
+    void dispatchBatch(std::unique_lock<std::mutex>& lock);
+
+    const Dispatch kDispatch;
+    const size_t kMaxBatchSize;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mBatchCompleted;
+    std::deque<PendingRequest*> mQueue GUARDED_BY(mMutex);
+    bool mDispatching GUARDED_BY(mMutex) = false;
+    Metrics mMetrics GUARDED_BY(mMutex);
+};
+
+}  // namespace aidl::android::hardware::neuralnetworks::adapter
+
+#endif  // ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_ADAPTER_AIDL_REQUEST_BATCHER_H
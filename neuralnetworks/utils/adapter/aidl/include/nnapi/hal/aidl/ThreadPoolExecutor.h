@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_ADAPTER_AIDL_THREAD_POOL_EXECUTOR_H
+#define ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_ADAPTER_AIDL_THREAD_POOL_EXECUTOR_H
+
+#include "nnapi/hal/aidl/Adapter.h"
+
+#include <android-base/thread_annotations.h>
+#include <nnapi/Types.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aidl::android::hardware::neuralnetworks::adapter {
+
+/**
+ * Executor which runs tasks on a fixed number of worker threads.
+ *
+ * Queued tasks are started in priority order. Within a priority, tasks with a deadline are started
+ * earliest deadline first, followed by tasks without a deadline in the order they were scheduled.
+ *
+ * The number of queued tasks is bounded. Scheduling a task while the queue is full blocks the
+ * caller until a worker starts one of the queued tasks, which pushes back on the clients instead
+ * of letting work pile up. Because of this, tasks must not schedule other tasks on the same
+ * executor. If the deadline of the task passes while the caller is blocked, the task is run on the
+ * calling thread instead of being queued, so tasks must fail quickly once their deadline has
+ * passed.
+ */
+class ThreadPoolExecutor final {
+  public:
+    struct Metrics {
+        // Number of tasks scheduled and completed.
+        uint64_t scheduled = 0;
+        uint64_t completed = 0;
+        // Number of tasks which were only started after their deadline had passed.
+        uint64_t startedAfterDeadline = 0;
+        // Number of calls to schedule which had to wait for room in the queue.
+        uint64_t blockedSchedules = 0;
+        // Number of tasks run on the calling thread because their deadline passed while waiting
+        // for room in the queue. These are not counted as scheduled or completed.
+        uint64_t expiredWhileBlocked = 0;
+        // Largest number of tasks that were queued at once.
+        size_t maxQueueDepth = 0;
+        // Total time tasks spent queued before being started.
+        std::chrono::nanoseconds totalQueueTime{0};
+    };
+
+    /**
+     * Starts the worker threads.
+     *
+     * @param numThreads Number of worker threads, must be at least 1.
+     * @param maxQueuedTasks Number of tasks that may wait for a worker, must be at least 1.
+     */
+    ThreadPoolExecutor(size_t numThreads, size_t maxQueuedTasks);
+
+    /**
+     * Runs the tasks that are still queued, then stops the worker threads.
+     */
+    ~ThreadPoolExecutor();
+
+    // Prevent copy and move.
+    ThreadPoolExecutor(const ThreadPoolExecutor&) = delete;
+    ThreadPoolExecutor(ThreadPoolExecutor&&) = delete;
+    ThreadPoolExecutor& operator=(const ThreadPoolExecutor&) = delete;
+    ThreadPoolExecutor& operator=(ThreadPoolExecutor&&) = delete;
+
+    /**
+     * Queues a task to be run by one of the worker threads. Blocks while the queue is full, at
+     * most until the deadline, after which the task is run on the calling thread.
+     *
+     * @param task Task to run.
+     * @param priority Priority of the task relative to the other queued tasks.
+     * @param deadline Optional time by which the task is expected to complete.
+     */
+    void schedule(Task task, ::android::nn::Priority priority,
+                  ::android::nn::OptionalTimePoint deadline);
+
+    Metrics getMetrics() const;
+
+  private:
+    struct QueuedTask {
+        Task task;
+        ::android::nn::Priority priority;
+        ::android::nn::OptionalTimePoint deadline;
+        uint64_t sequenceNumber;
+        ::android::nn::TimePoint queuedTime;
+    };
+
+    // Orders the queue as a max-heap whose top is the next task to start.
+    static bool startsAfter(const QueuedTask& a, const QueuedTask& b);
+
+    void runWorker();
+
+    mutable std::mutex mMutex;
+    std::condition_variable mTaskQueued;
+    std::condition_variable mTaskStarted;
+    std::vector<QueuedTask> mQueue GUARDED_BY(mMutex);
+    const size_t kMaxQueuedTasks;
+    uint64_t mNextSequenceNumber GUARDED_BY(mMutex) = 0;
+    bool mStopping GUARDED_BY(mMutex) = false;
+    Metrics mMetrics GUARDED_BY(mMutex);
+    std::vector<std::thread> mWorkers;
+};
+
+}  // namespace aidl::android::hardware::neuralnetworks::adapter
+
+#endif  // ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_ADAPTER_AIDL_THREAD_POOL_EXECUTOR_H
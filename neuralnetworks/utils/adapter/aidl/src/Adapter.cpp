@@ -17,12 +17,14 @@
 #include "Adapter.h"
 
 #include "Device.h"
+#include "ThreadPoolExecutor.h"
 
 #include <aidl/android/hardware/neuralnetworks/BnDevice.h>
 #include <android/binder_interface_utils.h>
 #include <nnapi/IDevice.h>
 #include <nnapi/Types.h>
 
+#include <algorithm>
 #include <functional>
 #include <memory>
 #include <thread>
@@ -31,16 +33,43 @@
 // lifetimes across processes and for protecting asynchronous calls across AIDL.
 
 namespace aidl::android::hardware::neuralnetworks::adapter {
+namespace {
+
+// Number of tasks the default executor queues per worker thread before blocking callers.
+constexpr size_t kQueuedTasksPerThread = 16;
+
+}  // namespace
 
 std::shared_ptr<BnDevice> adapt(::android::nn::SharedDevice device, Executor executor) {
+    PriorityExecutor priorityExecutor = [executor = std::move(executor)](
+                                                Task task, ::android::nn::Priority /*priority*/,
+                                                ::android::nn::OptionalTimePoint deadline) {
+        executor(std::move(task), deadline);
+    };
+    return adapt(std::move(device), std::move(priorityExecutor));
+}
+
+std::shared_ptr<BnDevice> adapt(::android::nn::SharedDevice device, PriorityExecutor executor) {
     return ndk::SharedRefBase::make<Device>(std::move(device), std::move(executor));
 }
 
+std::shared_ptr<BnDevice> adapt(::android::nn::SharedDevice device, PriorityExecutor executor,
+                                BatchExecutor batchExecutor) {
+    return ndk::SharedRefBase::make<Device>(std::move(device), std::move(executor),
+                                            std::move(batchExecutor));
+}
+
 std::shared_ptr<BnDevice> adapt(::android::nn::SharedDevice device) {
-    Executor defaultExecutor = [](Task task, ::android::nn::OptionalTimePoint /*deadline*/) {
-        std::thread(std::move(task)).detach();
+    const size_t numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    auto threadPool =
+            std::make_shared<ThreadPoolExecutor>(numThreads, numThreads * kQueuedTasksPerThread);
+    PriorityExecutor defaultExecutor = [threadPool](Task task, ::android::nn::Priority priority,
+                                                    ::android::nn::OptionalTimePoint deadline) {
+        threadPool->schedule(std::move(task), priority, deadline);
     };
-    return adapt(std::move(device), std::move(defaultExecutor));
+    // The device keeps the thread pool to report its metrics from dump().
+    return ndk::SharedRefBase::make<Device>(std::move(device), std::move(defaultExecutor),
+                                            /*batchExecutor=*/nullptr, std::move(threadPool));
 }
 
 }  // namespace aidl::android::hardware::neuralnetworks::adapter
@@ -19,6 +19,7 @@
 #include "Adapter.h"
 #include "Buffer.h"
 #include "PreparedModel.h"
+#include "ThreadPoolExecutor.h"
 
 #include <aidl/android/hardware/neuralnetworks/BnDevice.h>
 #include <aidl/android/hardware/neuralnetworks/BufferDesc.h>
@@ -43,7 +44,10 @@
 #include <nnapi/hal/aidl/Conversions.h>
 
 #include <chrono>
+#include <cinttypes>
+#include <cstdio>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -128,11 +132,18 @@ nn::GeneralResult<std::vector<bool>> getSupportedOperations(const nn::IDevice& d
 
 using PrepareModelResult = nn::GeneralResult<nn::SharedPreparedModel>;
 
-std::shared_ptr<PreparedModel> adaptPreparedModel(nn::SharedPreparedModel preparedModel) {
+// A backed up executor may start a task after its deadline, in which case the task fails without
+// calling into the driver.
+bool hasDeadlinePassed(const nn::OptionalTimePoint& deadline) {
+    return deadline.has_value() && nn::Clock::now() > *deadline;
+}
+
+std::shared_ptr<PreparedModel> adaptPreparedModel(nn::SharedPreparedModel preparedModel,
+                                                  const BatchExecutor& batchExecutor) {
     if (preparedModel == nullptr) {
         return nullptr;
     }
-    return ndk::SharedRefBase::make<PreparedModel>(std::move(preparedModel));
+    return ndk::SharedRefBase::make<PreparedModel>(std::move(preparedModel), batchExecutor);
 }
 
 void notify(IPreparedModelCallback* callback, ErrorStatus status,
@@ -145,7 +156,8 @@ void notify(IPreparedModelCallback* callback, ErrorStatus status,
     }
 }
 
-void notify(IPreparedModelCallback* callback, PrepareModelResult result) {
+void notify(IPreparedModelCallback* callback, PrepareModelResult result,
+            const BatchExecutor& batchExecutor) {
     if (!result.has_value()) {
         const auto& [message, status] = result.error();
         LOG(ERROR) << message;
@@ -153,14 +165,15 @@ void notify(IPreparedModelCallback* callback, PrepareModelResult result) {
         notify(callback, aidlCode, nullptr);
     } else {
         auto preparedModel = std::move(result).value();
-        auto aidlPreparedModel = adaptPreparedModel(std::move(preparedModel));
+        auto aidlPreparedModel = adaptPreparedModel(std::move(preparedModel), batchExecutor);
         notify(callback, ErrorStatus::NONE, std::move(aidlPreparedModel));
     }
 }
 
 nn::GeneralResult<void> prepareModel(
-        const nn::SharedDevice& device, const Executor& executor, const Model& model,
-        ExecutionPreference preference, Priority priority, int64_t deadlineNs,
+        const nn::SharedDevice& device, const PriorityExecutor& executor,
+        const BatchExecutor& batchExecutor, const Model& model, ExecutionPreference preference,
+        Priority priority, int64_t deadlineNs,
         const std::vector<ndk::ScopedFileDescriptor>& modelCache,
         const std::vector<ndk::ScopedFileDescriptor>& dataCache, const std::vector<uint8_t>& token,
         const std::vector<TokenValuePair>& hints,
@@ -170,6 +183,9 @@ nn::GeneralResult<void> prepareModel(
         return NN_ERROR(nn::ErrorStatus::INVALID_ARGUMENT) << "Invalid callback";
     }
 
+    // Every model is converted and validated. Validation results are deliberately not memoized:
+    // recognizing a model seen before means hashing all of it, operandValues included, which costs
+    // about as much as validating it.
     auto nnModel = NN_TRY(convertInput(model));
     const auto nnPreference = NN_TRY(convertInput(preference));
     const auto nnPriority = NN_TRY(convertInput(priority));
@@ -183,19 +199,25 @@ nn::GeneralResult<void> prepareModel(
     Task task = [device, nnModel = std::move(nnModel), nnPreference, nnPriority, nnDeadline,
                  nnModelCache = std::move(nnModelCache), nnDataCache = std::move(nnDataCache),
                  nnToken, nnHints = std::move(nnHints),
-                 nnExtensionNameToPrefix = std::move(nnExtensionNameToPrefix), callback] {
+                 nnExtensionNameToPrefix = std::move(nnExtensionNameToPrefix), batchExecutor,
+                 callback] {
+        if (hasDeadlinePassed(nnDeadline)) {
+            notify(callback.get(), ErrorStatus::MISSED_DEADLINE_TRANSIENT, nullptr);
+            return;
+        }
         auto result =
                 device->prepareModel(nnModel, nnPreference, nnPriority, nnDeadline, nnModelCache,
                                      nnDataCache, nnToken, nnHints, nnExtensionNameToPrefix);
-        notify(callback.get(), std::move(result));
+        notify(callback.get(), std::move(result), batchExecutor);
     };
-    executor(std::move(task), nnDeadline);
+    executor(std::move(task), nnPriority, nnDeadline);
 
     return {};
 }
 
 nn::GeneralResult<void> prepareModelFromCache(
-        const nn::SharedDevice& device, const Executor& executor, int64_t deadlineNs,
+        const nn::SharedDevice& device, const PriorityExecutor& executor,
+        const BatchExecutor& batchExecutor, int64_t deadlineNs,
         const std::vector<ndk::ScopedFileDescriptor>& modelCache,
         const std::vector<ndk::ScopedFileDescriptor>& dataCache, const std::vector<uint8_t>& token,
         const std::shared_ptr<IPreparedModelCallback>& callback) {
@@ -209,19 +231,28 @@ nn::GeneralResult<void> prepareModelFromCache(
     const auto nnToken = NN_TRY(convertCacheToken(token));
 
     auto task = [device, nnDeadline, nnModelCache = std::move(nnModelCache),
-                 nnDataCache = std::move(nnDataCache), nnToken, callback] {
+                 nnDataCache = std::move(nnDataCache), nnToken, batchExecutor, callback] {
+        if (hasDeadlinePassed(nnDeadline)) {
+            notify(callback.get(), ErrorStatus::MISSED_DEADLINE_TRANSIENT, nullptr);
+            return;
+        }
         auto result = device->prepareModelFromCache(nnDeadline, nnModelCache, nnDataCache, nnToken);
-        notify(callback.get(), std::move(result));
+        notify(callback.get(), std::move(result), batchExecutor);
     };
-    executor(std::move(task), nnDeadline);
+    executor(std::move(task), nn::Priority::MEDIUM, nnDeadline);
 
     return {};
 }
 
 }  // namespace
 
-Device::Device(::android::nn::SharedDevice device, Executor executor)
-    : kDevice(std::move(device)), kExecutor(std::move(executor)) {
+Device::Device(::android::nn::SharedDevice device, PriorityExecutor executor,
+               BatchExecutor batchExecutor,
+               std::shared_ptr<const ThreadPoolExecutor> threadPool)
+    : kDevice(std::move(device)),
+      kExecutor(std::move(executor)),
+      kBatchExecutor(std::move(batchExecutor)),
+      kThreadPool(std::move(threadPool)) {
     CHECK(kDevice != nullptr);
     CHECK(kExecutor != nullptr);
 }
@@ -289,8 +320,8 @@ ndk::ScopedAStatus Device::prepareModel(const Model& model, ExecutionPreference
                                         const std::vector<uint8_t>& token,
                                         const std::shared_ptr<IPreparedModelCallback>& callback) {
     const auto result =
-            adapter::prepareModel(kDevice, kExecutor, model, preference, priority, deadlineNs,
-                                  modelCache, dataCache, token, {}, {}, callback);
+            adapter::prepareModel(kDevice, kExecutor, kBatchExecutor, model, preference, priority,
+                                  deadlineNs, modelCache, dataCache, token, {}, {}, callback);
     if (!result.has_value()) {
         const auto& [message, code] = result.error();
         const auto aidlCode = utils::convert(code).value_or(ErrorStatus::GENERAL_FAILURE);
@@ -305,8 +336,9 @@ ndk::ScopedAStatus Device::prepareModelFromCache(
         int64_t deadlineNs, const std::vector<ndk::ScopedFileDescriptor>& modelCache,
         const std::vector<ndk::ScopedFileDescriptor>& dataCache, const std::vector<uint8_t>& token,
         const std::shared_ptr<IPreparedModelCallback>& callback) {
-    const auto result = adapter::prepareModelFromCache(kDevice, kExecutor, deadlineNs, modelCache,
-                                                       dataCache, token, callback);
+    const auto result = adapter::prepareModelFromCache(kDevice, kExecutor, kBatchExecutor,
+                                                       deadlineNs, modelCache, dataCache, token,
+                                                       callback);
     if (!result.has_value()) {
         const auto& [message, code] = result.error();
         const auto aidlCode = utils::convert(code).value_or(ErrorStatus::GENERAL_FAILURE);
@@ -321,9 +353,10 @@ ndk::ScopedAStatus Device::prepareModelWithConfig(
         const Model& model, const PrepareModelConfig& config,
         const std::shared_ptr<IPreparedModelCallback>& callback) {
     const auto result = adapter::prepareModel(
-            kDevice, kExecutor, model, config.preference, config.priority, config.deadlineNs,
-            config.modelCache, config.dataCache, utils::toVec(config.cacheToken),
-            config.compilationHints, config.extensionNameToPrefix, callback);
+            kDevice, kExecutor, kBatchExecutor, model, config.preference, config.priority,
+            config.deadlineNs, config.modelCache, config.dataCache,
+            utils::toVec(config.cacheToken), config.compilationHints, config.extensionNameToPrefix,
+            callback);
     if (!result.has_value()) {
         const auto& [message, code] = result.error();
         const auto aidlCode = utils::convert(code).value_or(ErrorStatus::GENERAL_FAILURE);
@@ -334,4 +367,34 @@ ndk::ScopedAStatus Device::prepareModelWithConfig(
     return ndk::ScopedAStatus::ok();
 }
 
+binder_status_t Device::dump(int fd, const char** /*args*/, uint32_t /*numArgs*/) {
+    const auto metrics = getExecutorMetrics();
+    if (!metrics.has_value()) {
+        dprintf(fd, "Tasks are run by an executor provided by the service\n");
+        return STATUS_OK;
+    }
+    const double avgQueueUs =
+            metrics->scheduled == 0
+                    ? 0.0
+                    : std::chrono::duration<double, std::micro>(metrics->totalQueueTime).count() /
+                              metrics->scheduled;
+    dprintf(fd,
+            "Thread pool tasks: %" PRIu64 " scheduled, %" PRIu64 " completed, %" PRIu64
+            " started after their deadline, %" PRIu64 " expired while blocked\n",
+            metrics->scheduled, metrics->completed, metrics->startedAfterDeadline,
+            metrics->expiredWhileBlocked);
+    dprintf(fd,
+            "Thread pool queue: %" PRIu64 " blocked schedules, max depth %zu, average wait "
+            "%.1f us\n",
+            metrics->blockedSchedules, metrics->maxQueueDepth, avgQueueUs);
+    return STATUS_OK;
+}
+
+std::optional<ThreadPoolExecutor::Metrics> Device::getExecutorMetrics() const {
+    if (kThreadPool == nullptr) {
+        return std::nullopt;
+    }
+    return kThreadPool->getMetrics();
+}
+
 }  // namespace aidl::android::hardware::neuralnetworks::adapter
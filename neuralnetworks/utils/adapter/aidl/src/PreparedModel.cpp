@@ -18,6 +18,7 @@
 
 #include "Burst.h"
 #include "Execution.h"
+#include "RequestBatcher.h"
 
 #include <aidl/android/hardware/neuralnetworks/BnFencedExecutionCallback.h>
 #include <aidl/android/hardware/neuralnetworks/BnPreparedModel.h>
@@ -36,13 +37,19 @@
 #include <nnapi/hal/aidl/Conversions.h>
 #include <nnapi/hal/aidl/Utils.h>
 
+#include <cinttypes>
+#include <cstdio>
 #include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
 namespace aidl::android::hardware::neuralnetworks::adapter {
 namespace {
 
+// Largest number of synchronous executions dispatched to the driver in one batch.
+constexpr size_t kMaxBatchSize = 16;
+
 class FencedExecutionCallback : public BnFencedExecutionCallback {
   public:
     FencedExecutionCallback(nn::ExecuteFencedInfoCallback callback)
@@ -118,20 +125,41 @@ nn::GeneralResult<nn::OptionalTimePoint> makeOptionalTimePoint(int64_t durationN
     return durationNs < 0 ? nn::OptionalTimePoint{} : nn::TimePoint(makeDuration(durationNs));
 }
 
+std::unique_ptr<RequestBatcher> makeBatcher(const nn::SharedPreparedModel& preparedModel,
+                                            BatchExecutor batchExecutor) {
+    if (batchExecutor == nullptr) {
+        return nullptr;
+    }
+    auto dispatch = [preparedModel, batchExecutor = std::move(batchExecutor)](
+                            std::vector<BatchedRequest> requests) {
+        return batchExecutor(*preparedModel, std::move(requests));
+    };
+    return std::make_unique<RequestBatcher>(std::move(dispatch), kMaxBatchSize);
+}
+
 nn::ExecutionResult<ExecutionResult> executeSynchronously(
-        const nn::IPreparedModel& preparedModel, const Request& request, bool measureTiming,
-        int64_t deadlineNs, int64_t loopTimeoutDurationNs, const std::vector<TokenValuePair>& hints,
+        const nn::IPreparedModel& preparedModel, RequestBatcher* batcher, const Request& request,
+        bool measureTiming, int64_t deadlineNs, int64_t loopTimeoutDurationNs,
+        const std::vector<TokenValuePair>& hints,
         const std::vector<ExtensionNameAndPrefix>& extensionNameToPrefix) {
-    const auto nnRequest = NN_TRY(convertInput(request));
+    auto nnRequest = NN_TRY(convertInput(request));
     const auto nnMeasureTiming = measureTiming ? nn::MeasureTiming::YES : nn::MeasureTiming::NO;
     const auto nnDeadline = NN_TRY(makeOptionalTimePoint(deadlineNs));
     const auto nnLoopTimeoutDuration = NN_TRY(makeOptionalDuration(loopTimeoutDurationNs));
     auto nnHints = NN_TRY(convertInput(hints));
     auto nnExtensionNameToPrefix = NN_TRY(convertInput(extensionNameToPrefix));
 
+    // Hints and extension prefixes are per execution, so executions which use them are not
+    // batched.
+    const bool batched = batcher != nullptr && nnHints.empty() && nnExtensionNameToPrefix.empty();
     const auto result =
-            preparedModel.execute(nnRequest, nnMeasureTiming, nnDeadline, nnLoopTimeoutDuration,
-                                  nnHints, nnExtensionNameToPrefix);
+            batched ? batcher->execute({.request = std::move(nnRequest),
+                                        .measure = nnMeasureTiming,
+                                        .deadline = nnDeadline,
+                                        .loopTimeoutDuration = nnLoopTimeoutDuration})
+                    : preparedModel.execute(nnRequest, nnMeasureTiming, nnDeadline,
+                                            nnLoopTimeoutDuration, nnHints,
+                                            nnExtensionNameToPrefix);
 
     if (!result.ok() && result.error().code == nn::ErrorStatus::OUTPUT_INSUFFICIENT_SIZE) {
         const auto& [message, code, outputShapes] = result.error();
@@ -234,8 +262,9 @@ nn::GeneralResult<FencedExecutionResult> executeFenced(
 
 }  // namespace
 
-PreparedModel::PreparedModel(nn::SharedPreparedModel preparedModel)
-    : kPreparedModel(std::move(preparedModel)) {
+PreparedModel::PreparedModel(nn::SharedPreparedModel preparedModel, BatchExecutor batchExecutor)
+    : kPreparedModel(std::move(preparedModel)),
+      kBatcher(makeBatcher(kPreparedModel, std::move(batchExecutor))) {
     CHECK(kPreparedModel != nullptr);
 }
 
@@ -243,8 +272,9 @@ ndk::ScopedAStatus PreparedModel::executeSynchronously(const Request& request, b
                                                        int64_t deadlineNs,
                                                        int64_t loopTimeoutDurationNs,
                                                        ExecutionResult* executionResult) {
-    auto result = adapter::executeSynchronously(*kPreparedModel, request, measureTiming, deadlineNs,
-                                                loopTimeoutDurationNs, {}, {});
+    auto result = adapter::executeSynchronously(*kPreparedModel, kBatcher.get(), request,
+                                                measureTiming, deadlineNs, loopTimeoutDurationNs,
+                                                {}, {});
     if (!result.has_value()) {
         const auto& [message, code, _] = result.error();
         const auto aidlCode = utils::convert(code).value_or(ErrorStatus::GENERAL_FAILURE);
@@ -276,7 +306,7 @@ ndk::ScopedAStatus PreparedModel::executeSynchronouslyWithConfig(const Request&
                                                                  int64_t deadlineNs,
                                                                  ExecutionResult* executionResult) {
     auto result = adapter::executeSynchronously(
-            *kPreparedModel, request, config.measureTiming, deadlineNs,
+            *kPreparedModel, kBatcher.get(), request, config.measureTiming, deadlineNs,
             config.loopTimeoutDurationNs, config.executionHints, config.extensionNameToPrefix);
     if (!result.has_value()) {
         const auto& [message, code, _] = result.error();
@@ -317,10 +347,31 @@ ndk::ScopedAStatus PreparedModel::configureExecutionBurst(std::shared_ptr<IBurst
     return ndk::ScopedAStatus::ok();
 }
 
+binder_status_t PreparedModel::dump(int fd, const char** /*args*/, uint32_t /*numArgs*/) {
+    const auto metrics = getBatcherMetrics();
+    if (!metrics.has_value()) {
+        dprintf(fd, "Synchronous executions are not batched\n");
+        return STATUS_OK;
+    }
+    dprintf(fd,
+            "Batched executions: %" PRIu64 " in %" PRIu64 " batches, largest batch %zu, shared "
+            "pools %" PRIu64 ", missed deadlines %" PRIu64 "\n",
+            metrics->requests, metrics->batches, metrics->maxBatchSize, metrics->sharedPools,
+            metrics->missedDeadlines);
+    return STATUS_OK;
+}
+
 nn::SharedPreparedModel PreparedModel::getUnderlyingPreparedModel() const {
     return kPreparedModel;
 }
 
+std::optional<RequestBatcher::Metrics> PreparedModel::getBatcherMetrics() const {
+    if (kBatcher == nullptr) {
+        return std::nullopt;
+    }
+    return kBatcher->getMetrics();
+}
+
 ndk::ScopedAStatus PreparedModel::createReusableExecution(const Request& request,
                                                           const ExecutionConfig& config,
                                                           std::shared_ptr<IExecution>* execution) {
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RequestBatcher.h"
+
+#include "Adapter.h"
+
+#include <android-base/logging.h>
+#include <nnapi/Result.h>
+#include <nnapi/Types.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace aidl::android::hardware::neuralnetworks::adapter {
+namespace {
+
+namespace nn = ::android::nn;
+
+// Identifies the memory a pool refers to. Each request received over binder carries its own file
+// descriptors, so pools are compared by the file they refer to rather than by descriptor. Only
+// regular files, such as memfds, have an inode per region: every legacy ashmem region and every
+// other device file shares the inode of its device, so those pools are never compared.
+struct PoolKey {
+    size_t kind;
+    dev_t device;
+    ino_t inode;
+    size_t size;
+    size_t offset;
+    int prot;
+
+    bool operator==(const PoolKey& other) const {
+        return kind == other.kind && device == other.device && inode == other.inode &&
+               size == other.size && offset == other.offset && prot == other.prot;
+    }
+};
+
+std::optional<PoolKey> getPoolKey(const nn::SharedMemory& memory) {
+    if (memory == nullptr) {
+        return std::nullopt;
+    }
+
+    int fd;
+    PoolKey key = {.kind = memory->handle.index()};
+    if (const auto* ashmem = std::get_if<nn::Memory::Ashmem>(&memory->handle)) {
+        fd = ashmem->fd.get();
+        key.size = ashmem->size;
+        key.offset = 0;
+        key.prot = 0;
+    } else if (const auto* mappableFile = std::get_if<nn::Memory::Fd>(&memory->handle)) {
+        fd = mappableFile->fd.get();
+        key.size = mappableFile->size;
+        key.offset = mappableFile->offset;
+        key.prot = mappableFile->prot;
+    } else {
+        return std::nullopt;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return std::nullopt;
+    }
+    key.device = st.st_dev;
+    key.inode = st.st_ino;
+    return key;
+}
+
+// Replaces each memory pool which refers to the same memory as a pool seen earlier in the batch
+// with that earlier pool, so that the driver maps it once for the whole batch. Returns the number
+// of pools replaced.
+uint64_t shareIdenticalPools(std::vector<BatchedRequest>* requests) {
+    uint64_t sharedPools = 0;
+    std::vector<std::pair<PoolKey, nn::SharedMemory>> seen;
+    for (auto& batchedRequest : *requests) {
+        for (auto& pool : batchedRequest.request.pools) {
+            auto* memory = std::get_if<nn::SharedMemory>(&pool);
+            if (memory == nullptr) {
+                continue;
+            }
+            const auto key = getPoolKey(*memory);
+            if (!key.has_value()) {
+                continue;
+            }
+            const auto it = std::find_if(seen.begin(), seen.end(),
+                                         [&key](const auto& entry) { return entry.first == *key; });
+            if (it == seen.end()) {
+                seen.emplace_back(*key, *memory);
+            } else if (it->second != *memory) {
+                *memory = it->second;
+                ++sharedPools;
+            }
+        }
+    }
+    return sharedPools;
+}
+
+}  // namespace
+
+RequestBatcher::RequestBatcher(Dispatch dispatch, size_t maxBatchSize)
+    : kDispatch(std::move(dispatch)), kMaxBatchSize(maxBatchSize) {
+    CHECK(kDispatch != nullptr);
+    CHECK_GT(kMaxBatchSize, 0u);
+}
+
+BatchedResult RequestBatcher::execute(BatchedRequest request) {
+    PendingRequest pending = {.request = std::move(request)};
+
+    std::unique_lock lock(mMutex);
+    mQueue.push_back(&pending);
+    while (!pending.result.has_value()) {
+        if (mDispatching) {
+            mBatchCompleted.wait(lock);
+        } else {
+            // The batch may not include this request if more than kMaxBatchSize requests were
+            // queued ahead of it, in which case this caller dispatches another batch after it.
+            dispatchBatch(lock);
+        }
+    }
+    return std::move(pending.result).value();
+}
+
+RequestBatcher::Metrics RequestBatcher::getMetrics() const {
+    std::lock_guard guard(mMutex);
+    return mMetrics;
+}
+
+void RequestBatcher::dispatchBatch(std::unique_lock<std::mutex>& lock) {
+    const size_t queuedSize = std::min(mQueue.size(), kMaxBatchSize);
+    std::vector<PendingRequest*> batch;
+    batch.reserve(queuedSize);
+
+    // Executions whose deadline passed while they were queued are failed instead of run.
+    const auto now = nn::Clock::now();
+    for (size_t i = 0; i < queuedSize; ++i) {
+        PendingRequest* pending = mQueue[i];
+        const auto& deadline = pending->request.deadline;
+        if (deadline.has_value() && *deadline < now) {
+            pending->result = NN_ERROR(nn::ErrorStatus::MISSED_DEADLINE_TRANSIENT)
+                              << "Deadline passed before the execution was dispatched";
+            mMetrics.missedDeadlines++;
+        } else {
+            batch.push_back(pending);
+        }
+    }
+    mQueue.erase(mQueue.begin(), mQueue.begin() + queuedSize);
+    if (batch.empty()) {
+        mBatchCompleted.notify_all();
+        return;
+    }
+
+    const size_t batchSize = batch.size();
+    mDispatching = true;
+    lock.unlock();
+
+    std::vector<BatchedRequest> requests;
+    requests.reserve(batchSize);
+    for (auto* pending : batch) {
+        requests.push_back(std::move(pending->request));
+    }
+    const uint64_t sharedPools = shareIdenticalPools(&requests);
+
+    auto results = kDispatch(std::move(requests));
+    if (results.size() != batchSize) {
+        LOG(ERROR) << "Batch of " << batchSize << " requests returned " << results.size()
+                   << " results";
+        results.clear();
+        for (size_t i = 0; i < batchSize; ++i) {
+            results.push_back(NN_ERROR(nn::ErrorStatus::GENERAL_FAILURE)
+                              << "Batch returned the wrong number of results");
+        }
+    }
+
+    lock.lock();
+    for (size_t i = 0; i < batchSize; ++i) {
+        batch[i]->result = std::move(results[i]);
+    }
+    mMetrics.requests += batchSize;
+    mMetrics.batches++;
+    mMetrics.maxBatchSize = std::max(mMetrics.maxBatchSize, batchSize);
+    mMetrics.sharedPools += sharedPools;
+    mDispatching = false;
+    mBatchCompleted.notify_all();
+}
+
+}  // namespace aidl::android::hardware::neuralnetworks::adapter
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ThreadPoolExecutor.h"
+
+#include "Adapter.h"
+
+#include <android-base/logging.h>
+#include <nnapi/Types.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace aidl::android::hardware::neuralnetworks::adapter {
+
+ThreadPoolExecutor::ThreadPoolExecutor(size_t numThreads, size_t maxQueuedTasks)
+    : kMaxQueuedTasks(maxQueuedTasks) {
+    CHECK_GT(numThreads, 0u);
+    CHECK_GT(maxQueuedTasks, 0u);
+    mQueue.reserve(maxQueuedTasks);
+    mWorkers.reserve(numThreads);
+    for (size_t i = 0; i < numThreads; ++i) {
+        mWorkers.emplace_back([this] { runWorker(); });
+    }
+}
+
+ThreadPoolExecutor::~ThreadPoolExecutor() {
+    {
+        std::lock_guard guard(mMutex);
+        mStopping = true;
+    }
+    mTaskQueued.notify_all();
+    for (auto& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+void ThreadPoolExecutor::schedule(Task task, ::android::nn::Priority priority,
+                                  ::android::nn::OptionalTimePoint deadline) {
+    std::unique_lock lock(mMutex);
+    if (mQueue.size() >= kMaxQueuedTasks) {
+        mMetrics.blockedSchedules++;
+        const auto hasRoom = [this]() REQUIRES(mMutex) { return mQueue.size() < kMaxQueuedTasks; };
+        if (!deadline.has_value()) {
+            mTaskStarted.wait(lock, hasRoom);
+        } else if (!mTaskStarted.wait_until(lock, *deadline, hasRoom)) {
+            // Run the task now so that it reports its missed deadline, instead of queueing it
+            // ahead of tasks which can still meet theirs.
+            mMetrics.expiredWhileBlocked++;
+            lock.unlock();
+            task();
+            return;
+        }
+    }
+
+    mQueue.push_back({
+            .task = std::move(task),
+            .priority = priority,
+            .deadline = deadline,
+            .sequenceNumber = mNextSequenceNumber++,
+            .queuedTime = ::android::nn::Clock::now(),
+    });
+    std::push_heap(mQueue.begin(), mQueue.end(), startsAfter);
+    mMetrics.scheduled++;
+    mMetrics.maxQueueDepth = std::max(mMetrics.maxQueueDepth, mQueue.size());
+    lock.unlock();
+
+    mTaskQueued.notify_one();
+}
+
+ThreadPoolExecutor::Metrics ThreadPoolExecutor::getMetrics() const {
+    std::lock_guard guard(mMutex);
+    return mMetrics;
+}
+
+bool ThreadPoolExecutor::startsAfter(const QueuedTask& a, const QueuedTask& b) {
+    if (a.priority != b.priority) {
+        return a.priority < b.priority;
+    }
+    if (a.deadline.has_value() != b.deadline.has_value()) {
+        return !a.deadline.has_value();
+    }
+    if (a.deadline.has_value() && *a.deadline != *b.deadline) {
+        return *a.deadline > *b.deadline;
+    }
+    return a.sequenceNumber > b.sequenceNumber;
+}
+
+void ThreadPoolExecutor::runWorker() {
+    std::unique_lock lock(mMutex);
+    while (true) {
+        mTaskQueued.wait(lock, [this]() REQUIRES(mMutex) { return mStopping || !mQueue.empty(); });
+        // Queued tasks are still run when stopping, as they are responsible for notifying their
+        // callbacks.
+        if (mQueue.empty()) {
+            return;
+        }
+
+        std::pop_heap(mQueue.begin(), mQueue.end(), startsAfter);
+        QueuedTask queuedTask = std::move(mQueue.back());
+        mQueue.pop_back();
+
+        const auto now = ::android::nn::Clock::now();
+        mMetrics.totalQueueTime += now - queuedTask.queuedTime;
+        if (queuedTask.deadline.has_value() && *queuedTask.deadline < now) {
+            mMetrics.startedAfterDeadline++;
+        }
+        lock.unlock();
+        mTaskStarted.notify_one();
+
+        queuedTask.task();
+        // Release whatever the task holds before reporting it as completed.
+        queuedTask.task = nullptr;
+
+        lock.lock();
+        mMetrics.completed++;
+    }
+}
+
+}  // namespace aidl::android::hardware::neuralnetworks::adapter
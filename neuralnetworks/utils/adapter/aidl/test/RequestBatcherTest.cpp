@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/unique_fd.h>
+#include <gtest/gtest.h>
+#include <nnapi/SharedMemory.h>
+#include <nnapi/Types.h>
+#include <nnapi/hal/aidl/Adapter.h>
+#include <nnapi/hal/aidl/RequestBatcher.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace aidl::android::hardware::neuralnetworks::adapter {
+namespace {
+
+namespace nn = ::android::nn;
+
+constexpr size_t kMaxBatchSize = 4;
+constexpr auto kQueueingDelay = std::chrono::milliseconds(100);
+
+// Tags a request with an id, which the fake dispatch echoes back in the result's timing so that
+// each caller can check it received the result of its own request.
+BatchedRequest makeRequest(int64_t id) {
+    return {.loopTimeoutDuration = nn::Duration(std::chrono::nanoseconds(id))};
+}
+
+std::vector<BatchedResult> echoIds(std::vector<BatchedRequest> requests) {
+    std::vector<BatchedResult> results;
+    results.reserve(requests.size());
+    for (const auto& request : requests) {
+        results.push_back(std::make_pair(std::vector<nn::OutputShape>{},
+                                         nn::Timing{.timeOnDevice = request.loopTimeoutDuration}));
+    }
+    return results;
+}
+
+int64_t getId(const BatchedResult& result) {
+    return result.value().second.timeOnDevice.value().count();
+}
+
+// Blocks the first dispatch until it is released, so that executions started meanwhile are queued
+// behind it.
+class FirstDispatchGate {
+  public:
+    void waitIfFirst() {
+        std::unique_lock lock(mMutex);
+        if (mDispatched) {
+            return;
+        }
+        mDispatched = true;
+        mEntered.notify_all();
+        mReleased.wait(lock, [this] { return mOpen; });
+    }
+
+    void waitUntilEntered() {
+        std::unique_lock lock(mMutex);
+        mEntered.wait(lock, [this] { return mDispatched; });
+    }
+
+    void release() {
+        std::lock_guard guard(mMutex);
+        mOpen = true;
+        mReleased.notify_all();
+    }
+
+  private:
+    std::mutex mMutex;
+    std::condition_variable mEntered;
+    std::condition_variable mReleased;
+    bool mDispatched = false;
+    bool mOpen = false;
+};
+
+nn::SharedMemory makeMemfdPool(int fd) {
+    return nn::createSharedMemoryFromFd(/*size=*/4096, PROT_READ | PROT_WRITE, fd, /*offset=*/0)
+            .value();
+}
+
+nn::SharedMemory makeAshmemPool(::android::base::unique_fd fd) {
+    return std::make_shared<const nn::Memory>(
+            nn::Memory{.handle = nn::Memory::Ashmem{.fd = std::move(fd), .size = 4096}});
+}
+
+}  // namespace
+
+TEST(RequestBatcherTest, splitsQueueIntoBatchesAndKeepsResultOrder) {
+    // setup test
+    constexpr int64_t kNumQueued = 3 * kMaxBatchSize - 1;
+    FirstDispatchGate gate;
+    std::mutex mutex;
+    std::vector<size_t> batchSizes;
+    RequestBatcher batcher(
+            [&](std::vector<BatchedRequest> requests) {
+                {
+                    std::lock_guard guard(mutex);
+                    batchSizes.push_back(requests.size());
+                }
+                gate.waitIfFirst();
+                return echoIds(std::move(requests));
+            },
+            kMaxBatchSize);
+
+    // run test
+    std::vector<int64_t> ids(kNumQueued + 1, -1);
+    std::vector<std::thread> clients;
+    clients.emplace_back([&] { ids[0] = getId(batcher.execute(makeRequest(0))); });
+    gate.waitUntilEntered();
+    for (int64_t i = 1; i <= kNumQueued; ++i) {
+        clients.emplace_back([&, i] { ids[i] = getId(batcher.execute(makeRequest(i))); });
+    }
+    std::this_thread::sleep_for(kQueueingDelay);
+    gate.release();
+    for (auto& client : clients) {
+        client.join();
+    }
+
+    // verify result
+    for (int64_t i = 0; i <= kNumQueued; ++i) {
+        EXPECT_EQ(i, ids[i]);
+    }
+    for (const size_t batchSize : batchSizes) {
+        EXPECT_LE(batchSize, kMaxBatchSize);
+    }
+    const auto metrics = batcher.getMetrics();
+    EXPECT_EQ(static_cast<uint64_t>(kNumQueued + 1), metrics.requests);
+    EXPECT_EQ(batchSizes.size(), metrics.batches);
+    EXPECT_EQ(kMaxBatchSize, metrics.maxBatchSize);
+    EXPECT_GE(metrics.batches, 4u);
+}
+
+TEST(RequestBatcherTest, wrongNumberOfResultsFailsBatch) {
+    // setup test
+    RequestBatcher batcher(
+            [](std::vector<BatchedRequest> /*requests*/) { return std::vector<BatchedResult>{}; },
+            kMaxBatchSize);
+
+    // run test
+    const auto result = batcher.execute(makeRequest(0));
+
+    // verify result
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(nn::ErrorStatus::GENERAL_FAILURE, result.error().code);
+}
+
+TEST(RequestBatcherTest, deadlinePassedWhileQueuedFailsExecution) {
+    // setup test
+    FirstDispatchGate gate;
+    std::atomic<size_t> dispatchedRequests = 0;
+    RequestBatcher batcher(
+            [&](std::vector<BatchedRequest> requests) {
+                dispatchedRequests += requests.size();
+                gate.waitIfFirst();
+                return echoIds(std::move(requests));
+            },
+            kMaxBatchSize);
+
+    // run test
+    std::thread first([&] { EXPECT_TRUE(batcher.execute(makeRequest(0)).has_value()); });
+    gate.waitUntilEntered();
+    std::optional<BatchedResult> queuedResult;
+    std::thread queued([&] {
+        auto request = makeRequest(1);
+        request.deadline = nn::Clock::now() + std::chrono::milliseconds(10);
+        queuedResult = batcher.execute(std::move(request));
+    });
+    std::this_thread::sleep_for(kQueueingDelay);
+    gate.release();
+    first.join();
+    queued.join();
+
+    // verify result
+    ASSERT_TRUE(queuedResult.has_value());
+    ASSERT_FALSE(queuedResult->has_value());
+    EXPECT_EQ(nn::ErrorStatus::MISSED_DEADLINE_TRANSIENT, queuedResult->error().code);
+    EXPECT_EQ(1u, dispatchedRequests);
+    EXPECT_EQ(1u, batcher.getMetrics().missedDeadlines);
+}
+
+TEST(RequestBatcherTest, sharesPoolsOfTheSameRegularFile) {
+    // setup test
+    const ::android::base::unique_fd fd(memfd_create("RequestBatcherTest", MFD_CLOEXEC));
+    ASSERT_TRUE(fd.ok());
+    ASSERT_EQ(0, ftruncate(fd.get(), 4096));
+    auto request = makeRequest(0);
+    request.request.pools = {makeMemfdPool(fd.get()), makeMemfdPool(fd.get())};
+    std::vector<nn::Request::MemoryPool> dispatchedPools;
+    RequestBatcher batcher(
+            [&](std::vector<BatchedRequest> requests) {
+                dispatchedPools = requests.front().request.pools;
+                return echoIds(std::move(requests));
+            },
+            kMaxBatchSize);
+
+    // run test
+    ASSERT_TRUE(batcher.execute(std::move(request)).has_value());
+
+    // verify result
+    ASSERT_EQ(2u, dispatchedPools.size());
+    EXPECT_EQ(std::get<nn::SharedMemory>(dispatchedPools[0]),
+              std::get<nn::SharedMemory>(dispatchedPools[1]));
+    EXPECT_EQ(1u, batcher.getMetrics().sharedPools);
+}
+
+TEST(RequestBatcherTest, neverSharesAshmemPools) {
+    // setup test
+    // Every ashmem region is backed by the same device inode, which /dev/null stands in for.
+    auto request = makeRequest(0);
+    request.request.pools = {
+            makeAshmemPool(::android::base::unique_fd(open("/dev/null", O_RDWR | O_CLOEXEC))),
+            makeAshmemPool(::android::base::unique_fd(open("/dev/null", O_RDWR | O_CLOEXEC)))};
+    const auto firstPool = std::get<nn::SharedMemory>(request.request.pools[0]);
+    const auto secondPool = std::get<nn::SharedMemory>(request.request.pools[1]);
+    std::vector<nn::Request::MemoryPool> dispatchedPools;
+    RequestBatcher batcher(
+            [&](std::vector<BatchedRequest> requests) {
+                dispatchedPools = requests.front().request.pools;
+                return echoIds(std::move(requests));
+            },
+            kMaxBatchSize);
+
+    // run test
+    ASSERT_TRUE(batcher.execute(std::move(request)).has_value());
+
+    // verify result
+    ASSERT_EQ(2u, dispatchedPools.size());
+    EXPECT_EQ(firstPool, std::get<nn::SharedMemory>(dispatchedPools[0]));
+    EXPECT_EQ(secondPool, std::get<nn::SharedMemory>(dispatchedPools[1]));
+    EXPECT_EQ(0u, batcher.getMetrics().sharedPools);
+}
+
+}  // namespace aidl::android::hardware::neuralnetworks::adapter
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <nnapi/Types.h>
+#include <nnapi/hal/aidl/ThreadPoolExecutor.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aidl::android::hardware::neuralnetworks::adapter {
+namespace {
+
+namespace nn = ::android::nn;
+
+constexpr auto kBlockedDelay = std::chrono::milliseconds(100);
+
+// Task which occupies a worker until it is released, so that tasks scheduled meanwhile are queued.
+class BlockingTask {
+  public:
+    Task makeTask() {
+        return [this] {
+            std::unique_lock lock(mMutex);
+            mStarted = true;
+            mChanged.notify_all();
+            mChanged.wait(lock, [this] { return mReleased; });
+        };
+    }
+
+    void waitUntilStarted() {
+        std::unique_lock lock(mMutex);
+        mChanged.wait(lock, [this] { return mStarted; });
+    }
+
+    void release() {
+        std::lock_guard guard(mMutex);
+        mReleased = true;
+        mChanged.notify_all();
+    }
+
+  private:
+    std::mutex mMutex;
+    std::condition_variable mChanged;
+    bool mStarted = false;
+    bool mReleased = false;
+};
+
+}  // namespace
+
+TEST(ThreadPoolExecutorTest, startsTasksInPriorityAndDeadlineOrder) {
+    // setup test
+    ThreadPoolExecutor executor(/*numThreads=*/1, /*maxQueuedTasks=*/8);
+    BlockingTask blocker;
+    executor.schedule(blocker.makeTask(), nn::Priority::HIGH, {});
+    blocker.waitUntilStarted();
+
+    std::mutex mutex;
+    std::vector<int> order;
+    const auto record = [&mutex, &order](int id) -> Task {
+        return [&mutex, &order, id] {
+            std::lock_guard guard(mutex);
+            order.push_back(id);
+        };
+    };
+    const auto now = nn::Clock::now();
+    const auto earlier = now + std::chrono::seconds(10);
+    const auto later = now + std::chrono::seconds(20);
+
+    // run test
+    executor.schedule(record(6), nn::Priority::LOW, earlier);
+    executor.schedule(record(4), nn::Priority::MEDIUM, {});
+    executor.schedule(record(3), nn::Priority::MEDIUM, later);
+    executor.schedule(record(5), nn::Priority::MEDIUM, {});
+    executor.schedule(record(2), nn::Priority::MEDIUM, earlier);
+    executor.schedule(record(1), nn::Priority::HIGH, {});
+    blocker.release();
+    while (executor.getMetrics().completed < 7) {
+        std::this_thread::yield();
+    }
+
+    // verify result
+    EXPECT_EQ((std::vector<int>{1, 2, 3, 4, 5, 6}), order);
+}
+
+TEST(ThreadPoolExecutorTest, scheduleBlocksWhileQueueIsFull) {
+    // setup test
+    ThreadPoolExecutor executor(/*numThreads=*/1, /*maxQueuedTasks=*/1);
+    BlockingTask blocker;
+    executor.schedule(blocker.makeTask(), nn::Priority::MEDIUM, {});
+    blocker.waitUntilStarted();
+    executor.schedule([] {}, nn::Priority::MEDIUM, {});
+
+    // run test
+    std::atomic<bool> scheduled = false;
+    std::thread client([&executor, &scheduled] {
+        executor.schedule([] {}, nn::Priority::MEDIUM, {});
+        scheduled = true;
+    });
+    std::this_thread::sleep_for(kBlockedDelay);
+    const bool scheduledWhileFull = scheduled;
+    blocker.release();
+    client.join();
+
+    // verify result
+    EXPECT_FALSE(scheduledWhileFull);
+    EXPECT_TRUE(scheduled);
+    const auto metrics = executor.getMetrics();
+    EXPECT_EQ(1u, metrics.blockedSchedules);
+    EXPECT_EQ(3u, metrics.scheduled);
+    EXPECT_EQ(1u, metrics.maxQueueDepth);
+}
+
+TEST(ThreadPoolExecutorTest, deadlinePassingWhileBlockedRunsTaskOnCaller) {
+    // setup test
+    ThreadPoolExecutor executor(/*numThreads=*/1, /*maxQueuedTasks=*/1);
+    BlockingTask blocker;
+    executor.schedule(blocker.makeTask(), nn::Priority::MEDIUM, {});
+    blocker.waitUntilStarted();
+    executor.schedule([] {}, nn::Priority::MEDIUM, {});
+
+    // run test
+    std::thread::id runner;
+    const auto deadline = nn::Clock::now() + std::chrono::milliseconds(10);
+    executor.schedule([&runner] { runner = std::this_thread::get_id(); }, nn::Priority::HIGH,
+                      deadline);
+    const auto metrics = executor.getMetrics();
+    blocker.release();
+
+    // verify result
+    EXPECT_EQ(std::this_thread::get_id(), runner);
+    EXPECT_GE(nn::Clock::now(), deadline);
+    EXPECT_EQ(1u, metrics.blockedSchedules);
+    EXPECT_EQ(1u, metrics.expiredWhileBlocked);
+    EXPECT_EQ(2u, metrics.scheduled);
+}
+
+}  // namespace aidl::android::hardware::neuralnetworks::adapter
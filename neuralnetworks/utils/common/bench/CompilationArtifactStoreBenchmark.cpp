@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <nnapi/Types.h>
+#include <nnapi/hal/CompilationArtifactStore.h>
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace android::hardware::neuralnetworks::utils {
+namespace {
+
+// Measures preparing a model through the compilation artifact store. The "Cold" benchmark removes
+// the artifact before each preparation, so every preparation compiles the model and writes the
+// artifact, while the "Warm" one reads the artifact written by the first preparation. Compilation
+// is simulated by a fixed delay. The benchmarks are run with the size in bytes of the artifact.
+
+constexpr auto kCompileTime = std::chrono::milliseconds(5);
+constexpr uint64_t kCapacityBytes = 64 << 20;
+
+CompilationArtifactStore::Key makeKey() {
+    CompilationArtifactStore::Key key = {.deviceVersion = "benchmark-driver-1.0",
+                                         .options = "preference=fast_single_answer"};
+    key.token.fill(1);
+    return key;
+}
+
+CompilationArtifactStore::Compile makeCompile(size_t size) {
+    return [size]() -> nn::GeneralResult<std::vector<uint8_t>> {
+        std::this_thread::sleep_for(kCompileTime);
+        return std::vector<uint8_t>(size, 1);
+    };
+}
+
+void BM_PrepareCold(benchmark::State& state) {
+    TemporaryDir directory;
+    const auto store = CompilationArtifactStore::create(directory.path, kCapacityBytes).value();
+    const auto key = makeKey();
+    const auto compile = makeCompile(state.range(0));
+    for (auto _ : state) {
+        const auto artifact = store->getOrCompile(key, compile);
+        CHECK(artifact.has_value()) << artifact.error().message;
+        benchmark::DoNotOptimize(artifact.value()->data());
+        state.PauseTiming();
+        store->remove(key);
+        state.ResumeTiming();
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void BM_PrepareWarm(benchmark::State& state) {
+    TemporaryDir directory;
+    const auto store = CompilationArtifactStore::create(directory.path, kCapacityBytes).value();
+    const auto key = makeKey();
+    const auto compile = makeCompile(state.range(0));
+    CHECK(store->getOrCompile(key, compile).has_value());
+    for (auto _ : state) {
+        const auto artifact = store->getOrCompile(key, compile);
+        CHECK(artifact.has_value()) << artifact.error().message;
+        benchmark::DoNotOptimize(artifact.value()->data());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+    state.counters["hits"] = store->getMetrics().hits;
+}
+
+BENCHMARK(BM_PrepareCold)->Range(4 << 10, 16 << 20)->UseRealTime();
+BENCHMARK(BM_PrepareWarm)->Range(4 << 10, 16 << 20)->UseRealTime();
+
+}  // namespace
+}  // namespace android::hardware::neuralnetworks::utils
+
+BENCHMARK_MAIN();
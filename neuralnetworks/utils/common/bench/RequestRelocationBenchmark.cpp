@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/logging.h>
+#include <nnapi/Types.h>
+#include <nnapi/hal/CommonUtils.h>
+#include <nnapi/hal/RequestRelocationCache.h>
+
+#include <optional>
+#include <vector>
+
+namespace android::hardware::neuralnetworks::utils {
+namespace {
+
+// Measures the relocation done around each synchronous execution of a request with pointer
+// arguments: converting the request, copying the inputs in and copying the outputs back out. The
+// benchmark is run with the size in bytes of each of the request's two inputs and one output.
+
+struct PointerRequest {
+    std::vector<uint8_t> input0;
+    std::vector<uint8_t> input1;
+    std::vector<uint8_t> output;
+    nn::Request request;
+};
+
+PointerRequest makePointerRequest(size_t size) {
+    PointerRequest pointerRequest = {
+            .input0 = std::vector<uint8_t>(size, 1),
+            .input1 = std::vector<uint8_t>(size, 2),
+            .output = std::vector<uint8_t>(size),
+    };
+    const auto makeArgument = [size](auto* data) {
+        return nn::Request::Argument{
+                .lifetime = nn::Request::Argument::LifeTime::POINTER,
+                .location = {.pointer = data, .length = static_cast<uint32_t>(size)}};
+    };
+    pointerRequest.request = {
+            .inputs = {makeArgument(pointerRequest.input0.data()),
+                       makeArgument(pointerRequest.input1.data())},
+            .outputs = {makeArgument(pointerRequest.output.data())},
+    };
+    return pointerRequest;
+}
+
+template <typename Convert>
+void runExecutions(benchmark::State& state, const Convert& convert) {
+    const auto pointerRequest = makePointerRequest(state.range(0));
+    for (auto _ : state) {
+        std::optional<nn::Request> maybeRequestInShared;
+        RequestRelocation relocation;
+        const auto result = convert(&pointerRequest.request, nn::kDefaultRequestMemoryAlignment,
+                                    nn::kDefaultRequestMemoryPadding, &maybeRequestInShared,
+                                    &relocation);
+        CHECK(result.has_value()) << result.error().message;
+        relocation.input->flush();
+        benchmark::DoNotOptimize(result.value().get());
+        relocation.output->flush();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_ConvertRequestFromPointerToShared(benchmark::State& state) {
+    runExecutions(state, [](auto&&... args) { return convertRequestFromPointerToShared(args...); });
+}
+
+void BM_RequestRelocationCache(benchmark::State& state) {
+    RequestRelocationCache cache;
+    runExecutions(state, [&cache](auto&&... args) {
+        return cache.convertRequestFromPointerToShared(args...);
+    });
+    state.counters["arena_allocations"] = cache.getArenaAllocationCount();
+}
+
+BENCHMARK(BM_ConvertRequestFromPointerToShared)->Range(64, 4 << 20);
+BENCHMARK(BM_RequestRelocationCache)->Range(64, 4 << 20);
+
+}  // namespace
+}  // namespace android::hardware::neuralnetworks::utils
+
+BENCHMARK_MAIN();
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_COMMON_COMPILATION_ARTIFACT_STORE_H
+#define ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_COMMON_COMPILATION_ARTIFACT_STORE_H
+
+#include <android-base/thread_annotations.h>
+#include <nnapi/Result.h>
+#include <nnapi/Types.h>
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace android::hardware::neuralnetworks::utils {
+
+/**
+ * On-disk store of compiled models, for drivers which implement nn::IDevice::prepareModel.
+ *
+ * Each artifact is an opaque blob produced by the driver's compiler, stored in its own file in the
+ * store's directory. The file is named after the key the artifact was compiled for, and also
+ * records the full key so that a lookup never returns an artifact compiled for a different device
+ * version or different options.
+ *
+ * Artifacts are written to a temporary file which is renamed into place once it is complete, so a
+ * crash never leaves a partial artifact behind. When the total size of the artifacts exceeds the
+ * store's capacity, the least recently used artifacts are removed.
+ *
+ * This class is thread-safe. Concurrent calls to getOrCompile for the same key compile the model
+ * once and share the result. The directory must not be shared with another store.
+ */
+class CompilationArtifactStore final {
+    struct PrivateConstructorTag {};
+
+  public:
+    struct Key {
+        // Token the client provided to prepareModel, which identifies the model.
+        nn::CacheToken token;
+        // Identifies the driver and compiler which produced the artifact.
+        std::string deviceVersion;
+        // Compilation options which affect the artifact, e.g. the execution preference.
+        std::string options;
+    };
+
+    using Artifact = std::shared_ptr<const std::vector<uint8_t>>;
+    using Compile = std::function<nn::GeneralResult<std::vector<uint8_t>>()>;
+
+    struct Metrics {
+        // Number of calls to getOrCompile which returned a stored artifact.
+        uint64_t hits = 0;
+        // Number of calls to getOrCompile which compiled the model.
+        uint64_t misses = 0;
+        // Number of calls to getOrCompile which waited for another call with the same key.
+        uint64_t deduplicated = 0;
+        // Number of artifacts removed to stay within the capacity.
+        uint64_t evictions = 0;
+        // Number of compiled artifacts that could not be written to the store.
+        uint64_t writeFailures = 0;
+        // Number of artifacts and their total size in bytes.
+        size_t artifactCount = 0;
+        uint64_t sizeBytes = 0;
+    };
+
+    /**
+     * Opens the store in an existing directory, indexing the artifacts it already holds.
+     *
+     * @param directory Directory which holds the artifacts.
+     * @param capacityBytes Total size of the artifacts above which the least recently used ones are
+     *     removed.
+     * @return The store, or GeneralError if the directory cannot be read.
+     */
+    static nn::GeneralResult<std::shared_ptr<CompilationArtifactStore>> create(
+            std::string directory, uint64_t capacityBytes);
+
+    CompilationArtifactStore(PrivateConstructorTag tag, std::string directory,
+                             uint64_t capacityBytes);
+
+    /**
+     * Returns the artifact stored for key, or calls compile and stores the artifact it returns.
+     *
+     * Failing to store the artifact is not an error, the compiled artifact is still returned.
+     * If compile throws, the exception propagates to this caller, and the callers waiting for the
+     * same key get a GENERAL_FAILURE error.
+     *
+     * @param key Key the artifact is compiled for.
+     * @param compile Function which compiles the model.
+     * @return The artifact, or the error returned by compile.
+     */
+    nn::GeneralResult<Artifact> getOrCompile(const Key& key, const Compile& compile);
+
+    /**
+     * Removes the artifact stored for key, e.g. because the driver failed to load it.
+     */
+    void remove(const Key& key);
+
+    Metrics getMetrics() const;
+
+  private:
+    struct Entry {
+        std::string name;
+        uint64_t size;
+    };
+    using Lru = std::list<Entry>;
+
+    nn::GeneralResult<Artifact> getOrCompileUncached(const Key& key, const std::string& name,
+                                                     const Compile& compile);
+    // Returns the stored artifact, or nullptr if it is missing or does not match key.
+    Artifact read(const Key& key, const std::string& name);
+    // Returns the size of the file the artifact was written to, or nullopt on failure.
+    std::optional<uint64_t> write(const Key& key, const std::string& name,
+                                  const std::vector<uint8_t>& artifact);
+    void addLocked(const std::string& name, uint64_t size) REQUIRES(mMutex);
+    bool forgetLocked(const std::string& name) REQUIRES(mMutex);
+    void removeLocked(const std::string& name) REQUIRES(mMutex);
+    void evictLocked() REQUIRES(mMutex);
+    std::string getPath(const std::string& name) const;
+
+    const std::string kDirectory;
+    const uint64_t kCapacityBytes;
+
+    mutable std::mutex mMutex;
+    // Artifacts in the store, most recently used first.
+    Lru mLru GUARDED_BY(mMutex);
+    std::unordered_map<std::string, Lru::iterator> mEntries GUARDED_BY(mMutex);
+    uint64_t mSizeBytes GUARDED_BY(mMutex) = 0;
+    std::unordered_map<std::string, std::shared_future<nn::GeneralResult<Artifact>>> mInFlight
+            GUARDED_BY(mMutex);
+    uint64_t mNextTemporaryId GUARDED_BY(mMutex) = 0;
+    Metrics mMetrics GUARDED_BY(mMutex);
+};
+
+}  // namespace android::hardware::neuralnetworks::utils
+
+#endif  // ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_COMMON_COMPILATION_ARTIFACT_STORE_H
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_COMMON_REQUEST_RELOCATION_CACHE_H
+#define ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_COMMON_REQUEST_RELOCATION_CACHE_H
+
+#include "nnapi/hal/CommonUtils.h"
+
+#include <nnapi/Result.h>
+#include <nnapi/SharedMemory.h>
+#include <nnapi/Types.h>
+
+#include <functional>
+#include <memory>
+#include <optional>
+
+namespace android::hardware::neuralnetworks::utils {
+
+/**
+ * Cache of the shared memory arenas that pointer-based request arguments are relocated into.
+ *
+ * nn::convertRequestFromPointerToShared allocates and maps new shared memory for every request
+ * that has pointer arguments. This class does the same relocation, but into arenas that are
+ * returned to the cache when the request's RequestRelocation is destroyed and reused by later
+ * requests. Arenas are sized to the largest request seen so far, so a model whose requests have
+ * a stable size allocates its arenas once.
+ *
+ * Because an arena may be reused as soon as the RequestRelocation is destroyed, the relocated
+ * request must only be used for executions that are complete by then, i.e. synchronous ones.
+ *
+ * This class is thread-safe. Concurrent requests are given distinct arenas.
+ */
+class RequestRelocationCache final {
+  public:
+    RequestRelocationCache();
+
+    /**
+     * Same as nn::convertRequestFromPointerToShared, except that the shared memory is taken from
+     * the cache.
+     */
+    nn::GeneralResult<std::reference_wrapper<const nn::Request>> convertRequestFromPointerToShared(
+            const nn::Request* request, uint32_t alignment, uint32_t padding,
+            std::optional<nn::Request>* maybeRequestInSharedOut, RequestRelocation* relocationOut);
+
+    /**
+     * Returns the number of arenas allocated over the lifetime of the cache.
+     */
+    size_t getArenaAllocationCount() const;
+
+  private:
+    class ArenaPool;
+
+    const std::shared_ptr<ArenaPool> kInputArenas;
+    const std::shared_ptr<ArenaPool> kOutputArenas;
+};
+
+}  // namespace android::hardware::neuralnetworks::utils
+
+#endif  // ANDROID_HARDWARE_INTERFACES_NEURALNETWORKS_UTILS_COMMON_REQUEST_RELOCATION_CACHE_H
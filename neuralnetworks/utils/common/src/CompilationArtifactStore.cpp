@@ -0,0 +1,389 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CompilationArtifactStore.h"
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/scopeguard.h>
+#include <android-base/strings.h>
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+#include <nnapi/Result.h>
+#include <nnapi/Types.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace android::hardware::neuralnetworks::utils {
+namespace {
+
+constexpr char kArtifactSuffix[] = ".bin";
+constexpr char kTemporarySuffix[] = ".tmp";
+
+constexpr uint32_t kMagic = 0x4e4e4341;  // "NNCA"
+constexpr uint32_t kFormatVersion = 1;
+
+// Every artifact file starts with this header, followed by the device version and options of the
+// key the artifact was compiled for, followed by the artifact itself.
+struct Header {
+    uint32_t magic;
+    uint32_t formatVersion;
+    uint32_t deviceVersionLength;
+    uint32_t optionsLength;
+    uint64_t artifactSize;
+};
+
+uint64_t getFileSize(const CompilationArtifactStore::Key& key, uint64_t artifactSize) {
+    return sizeof(Header) + key.deviceVersion.size() + key.options.size() + artifactSize;
+}
+
+// 64-bit FNV-1a.
+uint64_t hash(const std::string& data, uint64_t value) {
+    for (const char c : data) {
+        value ^= static_cast<uint8_t>(c);
+        value *= 0x100000001b3;
+    }
+    return value;
+}
+
+std::string toHex(const uint8_t* data, size_t size) {
+    constexpr char kDigits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(size * 2);
+    for (size_t i = 0; i < size; ++i) {
+        hex.push_back(kDigits[data[i] >> 4]);
+        hex.push_back(kDigits[data[i] & 0xf]);
+    }
+    return hex;
+}
+
+// The token is used in full, while the device version and options are hashed. A hash collision
+// is caught when reading the artifact, since the file records the full key.
+std::string getName(const CompilationArtifactStore::Key& key) {
+    uint64_t value = 0xcbf29ce484222325;
+    value = hash(key.deviceVersion, value);
+    value = hash(std::string(1, '\0'), value);
+    value = hash(key.options, value);
+    uint8_t bytes[sizeof(value)];
+    for (size_t i = 0; i < sizeof(value); ++i) {
+        bytes[i] = static_cast<uint8_t>(value >> (8 * (sizeof(value) - 1 - i)));
+    }
+    return toHex(key.token.data(), key.token.size()) + "-" + toHex(bytes, sizeof(bytes)) +
+           kArtifactSuffix;
+}
+
+bool readString(int fd, size_t length, std::string* string) {
+    string->resize(length);
+    return base::ReadFully(fd, string->data(), length);
+}
+
+// Makes a rename in the directory durable. Failing to do so only risks losing the artifact if the
+// device loses power, so errors are ignored.
+void syncDirectory(const std::string& directory) {
+    const base::unique_fd fd(open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (fd.ok()) {
+        fsync(fd.get());
+    }
+}
+
+}  // namespace
+
+nn::GeneralResult<std::shared_ptr<CompilationArtifactStore>> CompilationArtifactStore::create(
+        std::string directory, uint64_t capacityBytes) {
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(directory.c_str()), closedir);
+    if (dir == nullptr) {
+        return NN_ERROR() << "Failed to open compilation artifact directory " << directory << ": "
+                          << std::strerror(errno);
+    }
+
+    struct StoredArtifact {
+        std::string name;
+        uint64_t size;
+        timespec lastUsed;
+    };
+    std::vector<StoredArtifact> artifacts;
+    while (const dirent* entry = readdir(dir.get())) {
+        const std::string name = entry->d_name;
+        const std::string path = directory + "/" + name;
+        if (base::EndsWith(name, kTemporarySuffix)) {
+            // Left behind by a write which did not complete.
+            unlink(path.c_str());
+            continue;
+        }
+        struct stat st;
+        if (!base::EndsWith(name, kArtifactSuffix) || stat(path.c_str(), &st) != 0 ||
+            !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        artifacts.push_back({.name = name, .size = static_cast<uint64_t>(st.st_size),
+                             .lastUsed = st.st_mtim});
+    }
+
+    // Add the artifacts from least to most recently used, so that the most recently used one ends
+    // up at the front of the LRU list.
+    std::sort(artifacts.begin(), artifacts.end(), [](const auto& lhs, const auto& rhs) {
+        return std::make_pair(lhs.lastUsed.tv_sec, lhs.lastUsed.tv_nsec) <
+               std::make_pair(rhs.lastUsed.tv_sec, rhs.lastUsed.tv_nsec);
+    });
+
+    auto store = std::make_shared<CompilationArtifactStore>(PrivateConstructorTag{},
+                                                            std::move(directory), capacityBytes);
+    std::lock_guard guard(store->mMutex);
+    for (const auto& artifact : artifacts) {
+        store->addLocked(artifact.name, artifact.size);
+    }
+    store->evictLocked();
+    return store;
+}
+
+CompilationArtifactStore::CompilationArtifactStore(PrivateConstructorTag /*tag*/,
+                                                   std::string directory, uint64_t capacityBytes)
+    : kDirectory(std::move(directory)), kCapacityBytes(capacityBytes) {}
+
+nn::GeneralResult<CompilationArtifactStore::Artifact> CompilationArtifactStore::getOrCompile(
+        const Key& key, const Compile& compile) {
+    const auto name = getName(key);
+
+    std::promise<nn::GeneralResult<Artifact>> promise;
+    {
+        std::unique_lock lock(mMutex);
+        if (const auto it = mInFlight.find(name); it != mInFlight.end()) {
+            ++mMetrics.deduplicated;
+            auto future = it->second;
+            lock.unlock();
+            return future.get();
+        }
+        mInFlight.emplace(name, promise.get_future().share());
+    }
+
+    // However the compilation ends, even if compile throws, the callers waiting on it are woken
+    // and later calls compile again.
+    std::optional<nn::GeneralResult<Artifact>> result;
+    const auto finish = base::make_scope_guard([this, &name, &promise, &result] {
+        {
+            std::lock_guard guard(mMutex);
+            mInFlight.erase(name);
+        }
+        if (result.has_value()) {
+            promise.set_value(*result);
+            return;
+        }
+        nn::GeneralResult<Artifact> failure = NN_ERROR(nn::ErrorStatus::GENERAL_FAILURE)
+                                              << "Compilation of " << name << " did not complete";
+        promise.set_value(std::move(failure));
+    });
+
+    result = getOrCompileUncached(key, name, compile);
+    return *result;
+}
+
+nn::GeneralResult<CompilationArtifactStore::Artifact>
+CompilationArtifactStore::getOrCompileUncached(const Key& key, const std::string& name,
+                                               const Compile& compile) {
+    bool stored;
+    {
+        std::lock_guard guard(mMutex);
+        stored = mEntries.count(name) > 0;
+    }
+
+    // The file is read without holding the lock. If it is evicted in the meantime, either the read
+    // still succeeds from the open file or the lookup is treated as a miss.
+    if (stored) {
+        if (auto artifact = read(key, name)) {
+            std::lock_guard guard(mMutex);
+            if (const auto it = mEntries.find(name); it != mEntries.end()) {
+                mLru.splice(mLru.begin(), mLru, it->second);
+            }
+            ++mMetrics.hits;
+            return artifact;
+        }
+        std::lock_guard guard(mMutex);
+        removeLocked(name);
+    }
+
+    {
+        std::lock_guard guard(mMutex);
+        ++mMetrics.misses;
+    }
+    auto compiled = NN_TRY(compile());
+    auto artifact = std::make_shared<const std::vector<uint8_t>>(std::move(compiled));
+
+    if (getFileSize(key, artifact->size()) > kCapacityBytes) {
+        LOG(WARNING) << "Compilation artifact of " << artifact->size()
+                     << " bytes exceeds the store capacity of " << kCapacityBytes << " bytes";
+        std::lock_guard guard(mMutex);
+        ++mMetrics.writeFailures;
+        return artifact;
+    }
+
+    const auto size = write(key, name, *artifact);
+    std::lock_guard guard(mMutex);
+    if (!size.has_value()) {
+        ++mMetrics.writeFailures;
+        return artifact;
+    }
+    forgetLocked(name);
+    addLocked(name, size.value());
+    evictLocked();
+    return artifact;
+}
+
+CompilationArtifactStore::Artifact CompilationArtifactStore::read(const Key& key,
+                                                                  const std::string& name) {
+    const auto path = getPath(name);
+    const base::unique_fd fd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (!fd.ok()) {
+        return nullptr;
+    }
+
+    struct stat st;
+    Header header;
+    if (fstat(fd.get(), &st) != 0 || !base::ReadFully(fd.get(), &header, sizeof(header)) ||
+        header.magic != kMagic || header.formatVersion != kFormatVersion ||
+        header.deviceVersionLength != key.deviceVersion.size() ||
+        header.optionsLength != key.options.size() ||
+        getFileSize(key, header.artifactSize) != static_cast<uint64_t>(st.st_size)) {
+        LOG(WARNING) << "Discarding malformed compilation artifact " << path;
+        return nullptr;
+    }
+
+    std::string deviceVersion;
+    std::string options;
+    if (!readString(fd.get(), header.deviceVersionLength, &deviceVersion) ||
+        !readString(fd.get(), header.optionsLength, &options) ||
+        deviceVersion != key.deviceVersion || options != key.options) {
+        LOG(WARNING) << "Discarding compilation artifact " << path << " for a different key";
+        return nullptr;
+    }
+
+    std::vector<uint8_t> artifact(header.artifactSize);
+    if (!base::ReadFully(fd.get(), artifact.data(), artifact.size())) {
+        LOG(WARNING) << "Failed to read compilation artifact " << path;
+        return nullptr;
+    }
+
+    // Record the use, so that the LRU order survives restarting the process.
+    futimens(fd.get(), nullptr);
+
+    return std::make_shared<const std::vector<uint8_t>>(std::move(artifact));
+}
+
+std::optional<uint64_t> CompilationArtifactStore::write(const Key& key, const std::string& name,
+                                                        const std::vector<uint8_t>& artifact) {
+    uint64_t temporaryId;
+    {
+        std::lock_guard guard(mMutex);
+        temporaryId = mNextTemporaryId++;
+    }
+    const auto path = getPath(name);
+    const auto temporaryPath = path + "." + std::to_string(temporaryId) + kTemporarySuffix;
+
+    const Header header = {
+            .magic = kMagic,
+            .formatVersion = kFormatVersion,
+            .deviceVersionLength = static_cast<uint32_t>(key.deviceVersion.size()),
+            .optionsLength = static_cast<uint32_t>(key.options.size()),
+            .artifactSize = artifact.size(),
+    };
+
+    base::unique_fd fd(
+            open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600));
+    if (!fd.ok()) {
+        LOG(WARNING) << "Failed to create " << temporaryPath << ": " << std::strerror(errno);
+        return std::nullopt;
+    }
+    const bool written = base::WriteFully(fd.get(), &header, sizeof(header)) &&
+                         base::WriteFully(fd.get(), key.deviceVersion.data(),
+                                          key.deviceVersion.size()) &&
+                         base::WriteFully(fd.get(), key.options.data(), key.options.size()) &&
+                         base::WriteFully(fd.get(), artifact.data(), artifact.size()) &&
+                         fsync(fd.get()) == 0;
+    fd.reset();
+    if (!written || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        LOG(WARNING) << "Failed to write compilation artifact " << path << ": "
+                     << std::strerror(errno);
+        unlink(temporaryPath.c_str());
+        return std::nullopt;
+    }
+    syncDirectory(kDirectory);
+
+    return getFileSize(key, artifact.size());
+}
+
+void CompilationArtifactStore::remove(const Key& key) {
+    std::lock_guard guard(mMutex);
+    removeLocked(getName(key));
+}
+
+CompilationArtifactStore::Metrics CompilationArtifactStore::getMetrics() const {
+    std::lock_guard guard(mMutex);
+    Metrics metrics = mMetrics;
+    metrics.artifactCount = mEntries.size();
+    metrics.sizeBytes = mSizeBytes;
+    return metrics;
+}
+
+void CompilationArtifactStore::addLocked(const std::string& name, uint64_t size) {
+    mLru.push_front({.name = name, .size = size});
+    mEntries[name] = mLru.begin();
+    mSizeBytes += size;
+}
+
+bool CompilationArtifactStore::forgetLocked(const std::string& name) {
+    const auto it = mEntries.find(name);
+    if (it == mEntries.end()) {
+        return false;
+    }
+    mSizeBytes -= it->second->size;
+    mLru.erase(it->second);
+    mEntries.erase(it);
+    return true;
+}
+
+void CompilationArtifactStore::removeLocked(const std::string& name) {
+    if (forgetLocked(name)) {
+        unlink(getPath(name).c_str());
+    }
+}
+
+void CompilationArtifactStore::evictLocked() {
+    while (mSizeBytes > kCapacityBytes && !mLru.empty()) {
+        const std::string name = mLru.back().name;
+        removeLocked(name);
+        ++mMetrics.evictions;
+    }
+}
+
+std::string CompilationArtifactStore::getPath(const std::string& name) const {
+    return kDirectory + "/" + name;
+}
+
+}  // namespace android::hardware::neuralnetworks::utils
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RequestRelocationCache.h"
+
+#include "CommonUtils.h"
+
+#include <android-base/logging.h>
+#include <android-base/thread_annotations.h>
+#include <nnapi/Result.h>
+#include <nnapi/SharedMemory.h>
+#include <nnapi/TypeUtils.h>
+#include <nnapi/Types.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace android::hardware::neuralnetworks::utils {
+namespace {
+
+// Number of unused arenas kept per pool. Each arena serves one request at a time, so this bounds
+// how many concurrent requests can be served without allocating.
+constexpr size_t kMaxCachedArenas = 4;
+
+struct Arena {
+    nn::SharedMemory memory;
+    nn::Mapping mapping;
+};
+
+size_t roundUp(size_t size, size_t multiple) {
+    return (size + multiple - 1) / multiple * multiple;
+}
+
+// Lays out an argument at the end of a pool of poolSize bytes and grows poolSize to include it,
+// the same way nn::MutableMemoryBuilder does.
+nn::DataLocation append(size_t* poolSize, uint32_t poolIndex, uint32_t length, uint32_t alignment,
+                        uint32_t padding) {
+    const size_t offset = roundUp(*poolSize, alignment);
+    const size_t paddedLength = roundUp(length, padding);
+    CHECK_LE(offset + paddedLength, std::numeric_limits<uint32_t>::max());
+    *poolSize = offset + paddedLength;
+    return {.poolIndex = poolIndex,
+            .offset = static_cast<uint32_t>(offset),
+            .length = length,
+            .padding = static_cast<uint32_t>(paddedLength - length)};
+}
+
+// Creates a relocation tracker which uses the mapping of the arena, and keeps the arena out of its
+// pool for as long as the tracker exists.
+template <typename RelocationTrackerType, typename RelocationInfoType>
+std::unique_ptr<RelocationTrackerType> makeRelocationTracker(
+        std::vector<RelocationInfoType> relocationInfos, std::shared_ptr<Arena> arena) {
+    nn::Mapping mapping = {
+            .pointer = arena->mapping.pointer,
+            .size = arena->mapping.size,
+            .context = arena,
+    };
+    return std::make_unique<RelocationTrackerType>(std::move(relocationInfos), arena->memory,
+                                                   std::move(mapping));
+}
+
+}  // namespace
+
+class RequestRelocationCache::ArenaPool final : public std::enable_shared_from_this<ArenaPool> {
+  public:
+    // Returns a mapped arena of at least size bytes. The arena goes back to the pool once the last
+    // reference to it is released.
+    nn::GeneralResult<std::shared_ptr<Arena>> acquire(size_t size);
+
+    size_t getAllocationCount() const;
+
+  private:
+    void release(std::unique_ptr<Arena> arena);
+
+    mutable std::mutex mMutex;
+    std::vector<std::unique_ptr<Arena>> mFreeArenas GUARDED_BY(mMutex);
+    size_t mHighWaterMark GUARDED_BY(mMutex) = 0;
+    size_t mAllocationCount GUARDED_BY(mMutex) = 0;
+};
+
+nn::GeneralResult<std::shared_ptr<Arena>> RequestRelocationCache::ArenaPool::acquire(size_t size) {
+    std::unique_ptr<Arena> arena;
+    size_t allocationSize = 0;
+    {
+        std::lock_guard guard(mMutex);
+        mHighWaterMark = std::max(mHighWaterMark, size);
+        const auto it =
+                std::find_if(mFreeArenas.begin(), mFreeArenas.end(),
+                             [size](const auto& free) { return free->memory->size >= size; });
+        if (it != mFreeArenas.end()) {
+            arena = std::move(*it);
+            mFreeArenas.erase(it);
+        } else {
+            allocationSize = mHighWaterMark;
+            mAllocationCount++;
+        }
+    }
+
+    if (arena == nullptr) {
+        auto memory = NN_TRY(nn::createSharedMemory(std::max<size_t>(allocationSize, 1)));
+        auto mapping = NN_TRY(nn::map(memory));
+        arena = std::make_unique<Arena>(
+                Arena{.memory = std::move(memory), .mapping = std::move(mapping)});
+    }
+
+    return std::shared_ptr<Arena>(arena.release(), [weakPool = weak_from_this()](Arena* arena) {
+        std::unique_ptr<Arena> ownedArena(arena);
+        if (const auto pool = weakPool.lock()) {
+            pool->release(std::move(ownedArena));
+        }
+    });
+}
+
+size_t RequestRelocationCache::ArenaPool::getAllocationCount() const {
+    std::lock_guard guard(mMutex);
+    return mAllocationCount;
+}
+
+void RequestRelocationCache::ArenaPool::release(std::unique_ptr<Arena> arena) {
+    std::lock_guard guard(mMutex);
+    // Arenas smaller than the high-water mark are dropped, so the pool converges on arenas which
+    // are large enough for every request.
+    if (arena->memory->size >= mHighWaterMark && mFreeArenas.size() < kMaxCachedArenas) {
+        mFreeArenas.push_back(std::move(arena));
+    }
+}
+
+RequestRelocationCache::RequestRelocationCache()
+    : kInputArenas(std::make_shared<ArenaPool>()), kOutputArenas(std::make_shared<ArenaPool>()) {}
+
+nn::GeneralResult<std::reference_wrapper<const nn::Request>>
+RequestRelocationCache::convertRequestFromPointerToShared(
+        const nn::Request* request, uint32_t alignment, uint32_t padding,
+        std::optional<nn::Request>* maybeRequestInSharedOut, RequestRelocation* relocationOut) {
+    CHECK(request != nullptr);
+    CHECK(maybeRequestInSharedOut != nullptr);
+    CHECK(relocationOut != nullptr);
+
+    if (hasNoPointerData(*request)) {
+        return std::cref(*request);
+    }
+
+    // Make a copy of the request to modify.
+    auto& requestInShared = maybeRequestInSharedOut->emplace(*request);
+
+    // Change input pointers to offsets into an input arena.
+    const auto inputPoolIndex = static_cast<uint32_t>(requestInShared.pools.size());
+    size_t inputSize = 0;
+    std::vector<nn::InputRelocationInfo> inputRelocationInfos;
+    for (auto& input : requestInShared.inputs) {
+        if (input.lifetime != nn::Request::Argument::LifeTime::POINTER) {
+            continue;
+        }
+        const void* data = std::visit([](auto* ptr) { return static_cast<const void*>(ptr); },
+                                      input.location.pointer);
+        CHECK(data != nullptr);
+        input.lifetime = nn::Request::Argument::LifeTime::POOL;
+        input.location = append(&inputSize, inputPoolIndex, input.location.length, alignment,
+                                padding);
+        inputRelocationInfos.push_back({data, input.location.length, input.location.offset});
+    }
+    if (!inputRelocationInfos.empty()) {
+        auto arena = NN_TRY(kInputArenas->acquire(inputSize));
+        requestInShared.pools.push_back(arena->memory);
+        relocationOut->input = makeRelocationTracker<nn::InputRelocationTracker>(
+                std::move(inputRelocationInfos), std::move(arena));
+    }
+
+    // Change output pointers to offsets into an output arena.
+    const auto outputPoolIndex = static_cast<uint32_t>(requestInShared.pools.size());
+    size_t outputSize = 0;
+    std::vector<nn::OutputRelocationInfo> outputRelocationInfos;
+    for (auto& output : requestInShared.outputs) {
+        if (output.lifetime != nn::Request::Argument::LifeTime::POINTER) {
+            continue;
+        }
+        auto* const* data = std::get_if<void*>(&output.location.pointer);
+        if (data == nullptr) {
+            return NN_ERROR(nn::ErrorStatus::INVALID_ARGUMENT)
+                   << "Request output pointer must not be const";
+        }
+        CHECK(*data != nullptr);
+        output.lifetime = nn::Request::Argument::LifeTime::POOL;
+        output.location = append(&outputSize, outputPoolIndex, output.location.length, alignment,
+                                 padding);
+        outputRelocationInfos.push_back({*data, output.location.length, output.location.offset});
+    }
+    if (!outputRelocationInfos.empty()) {
+        auto arena = NN_TRY(kOutputArenas->acquire(outputSize));
+        requestInShared.pools.push_back(arena->memory);
+        relocationOut->output = makeRelocationTracker<nn::OutputRelocationTracker>(
+                std::move(outputRelocationInfos), std::move(arena));
+    }
+
+    return std::cref(requestInShared);
+}
+
+size_t RequestRelocationCache::getArenaAllocationCount() const {
+    return kInputArenas->getAllocationCount() + kOutputArenas->getAllocationCount();
+}
+
+}  // namespace android::hardware::neuralnetworks::utils
@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/file.h>
+#include <gmock/gmock.h>
+#include <nnapi/Types.h>
+#include <nnapi/hal/CompilationArtifactStore.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace android::hardware::neuralnetworks::utils {
+namespace {
+
+using Key = CompilationArtifactStore::Key;
+
+constexpr uint64_t kCapacityBytes = 1 << 20;
+
+Key makeKey(uint8_t token, std::string options = "") {
+    Key key = {.deviceVersion = "test-driver-1.0", .options = std::move(options)};
+    key.token.fill(token);
+    return key;
+}
+
+CompilationArtifactStore::Compile makeCompile(std::vector<uint8_t> artifact,
+                                              std::atomic<int>* compileCount) {
+    return [artifact = std::move(artifact),
+            compileCount]() -> nn::GeneralResult<std::vector<uint8_t>> {
+        ++*compileCount;
+        return artifact;
+    };
+}
+
+}  // namespace
+
+TEST(CompilationArtifactStoreTest, missCompilesAndHitReads) {
+    // setup call
+    TemporaryDir directory;
+    const auto store = CompilationArtifactStore::create(directory.path, kCapacityBytes).value();
+    const auto key = makeKey(1);
+    const std::vector<uint8_t> expected(100, 7);
+    std::atomic<int> compileCount = 0;
+
+    // run test
+    const auto cold = store->getOrCompile(key, makeCompile(expected, &compileCount));
+    const auto warm = store->getOrCompile(key, makeCompile(expected, &compileCount));
+
+    // verify result
+    ASSERT_TRUE(cold.has_value());
+    ASSERT_TRUE(warm.has_value());
+    EXPECT_EQ(*cold.value(), expected);
+    EXPECT_EQ(*warm.value(), expected);
+    EXPECT_EQ(compileCount, 1);
+    const auto metrics = store->getMetrics();
+    EXPECT_EQ(metrics.hits, 1u);
+    EXPECT_EQ(metrics.misses, 1u);
+    EXPECT_EQ(metrics.artifactCount, 1u);
+}
+
+TEST(CompilationArtifactStoreTest, artifactsPersistAcrossStores) {
+    // setup call
+    TemporaryDir directory;
+    const auto key = makeKey(1);
+    const std::vector<uint8_t> expected(100, 7);
+    std::atomic<int> compileCount = 0;
+    ASSERT_TRUE(CompilationArtifactStore::create(directory.path, kCapacityBytes)
+                        .value()
+                        ->getOrCompile(key, makeCompile(expected, &compileCount))
+                        .has_value());
+
+    // run test
+    const auto store = CompilationArtifactStore::create(directory.path, kCapacityBytes).value();
+    const auto result = store->getOrCompile(key, makeCompile(expected, &compileCount));
+
+    // verify result
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(*result.value(), expected);
+    EXPECT_EQ(compileCount, 1);
+    EXPECT_EQ(store->getMetrics().hits, 1u);
+}
+
+TEST(CompilationArtifactStoreTest, differentOptionsAreStoredSeparately) {
+    // setup call
+    TemporaryDir directory;
+    const auto store = CompilationArtifactStore::create(directory.path, kCapacityBytes).value();
+    std::atomic<int> compileCount = 0;
+
+    // run test
+    const auto fast = store->getOrCompile(makeKey(1, "fast"), makeCompile({1}, &compileCount));
+    const auto small = store->getOrCompile(makeKey(1, "small"), makeCompile({2}, &compileCount));
+
+    // verify result
+    ASSERT_TRUE(fast.has_value());
+    ASSERT_TRUE(small.has_value());
+    EXPECT_EQ(*fast.value(), std::vector<uint8_t>{1});
+    EXPECT_EQ(*small.value(), std::vector<uint8_t>{2});
+    EXPECT_EQ(compileCount, 2);
+}
+
+TEST(CompilationArtifactStoreTest, evictsLeastRecentlyUsed) {
+    // setup call
+    TemporaryDir directory;
+    constexpr size_t kArtifactSize = 1000;
+    // Room for two artifacts and their headers, but not three.
+    const auto store = CompilationArtifactStore::create(directory.path, 3 * kArtifactSize).value();
+    const std::vector<uint8_t> artifact(kArtifactSize);
+    std::atomic<int> compileCount = 0;
+    ASSERT_TRUE(store->getOrCompile(makeKey(1), makeCompile(artifact, &compileCount)).has_value());
+    ASSERT_TRUE(store->getOrCompile(makeKey(2), makeCompile(artifact, &compileCount)).has_value());
+    // Make the first artifact the most recently used.
+    ASSERT_TRUE(store->getOrCompile(makeKey(1), makeCompile(artifact, &compileCount)).has_value());
+
+    // run test
+    ASSERT_TRUE(store->getOrCompile(makeKey(3), makeCompile(artifact, &compileCount)).has_value());
+    ASSERT_TRUE(store->getOrCompile(makeKey(1), makeCompile(artifact, &compileCount)).has_value());
+    ASSERT_TRUE(store->getOrCompile(makeKey(2), makeCompile(artifact, &compileCount)).has_value());
+
+    // verify result
+    // The second artifact was evicted when the third was added, so it is compiled again.
+    EXPECT_EQ(compileCount, 4);
+    const auto metrics = store->getMetrics();
+    EXPECT_EQ(metrics.hits, 2u);
+    EXPECT_EQ(metrics.artifactCount, 2u);
+    EXPECT_LE(metrics.sizeBytes, 3 * kArtifactSize);
+}
+
+TEST(CompilationArtifactStoreTest, oversizedArtifactIsNotStored) {
+    // setup call
+    TemporaryDir directory;
+    const auto store = CompilationArtifactStore::create(directory.path, 100).value();
+    std::atomic<int> compileCount = 0;
+
+    // run test
+    const auto result =
+            store->getOrCompile(makeKey(1), makeCompile(std::vector<uint8_t>(200), &compileCount));
+
+    // verify result
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value()->size(), 200u);
+    const auto metrics = store->getMetrics();
+    EXPECT_EQ(metrics.writeFailures, 1u);
+    EXPECT_EQ(metrics.artifactCount, 0u);
+}
+
+TEST(CompilationArtifactStoreTest, compileErrorIsReturnedAndNotStored) {
+    // setup call
+    TemporaryDir directory;
+    const auto store = CompilationArtifactStore::create(directory.path, kCapacityBytes).value();
+    const auto failingCompile = []() -> nn::GeneralResult<std::vector<uint8_t>> {
+        return NN_ERROR(nn::ErrorStatus::GENERAL_FAILURE) << "compilation failed";
+    };
+
+    // run test
+    const auto result = store->getOrCompile(makeKey(1), failingCompile);
+
+    // verify result
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error().code, nn::ErrorStatus::GENERAL_FAILURE);
+    EXPECT_EQ(store->getMetrics().artifactCount, 0u);
+}
+
+TEST(CompilationArtifactStoreTest, throwingCompileDoesNotBlockLaterCalls) {
+    // setup call
+    TemporaryDir directory;
+    const auto store = CompilationArtifactStore::create(directory.path, kCapacityBytes).value();
+    const auto key = makeKey(1);
+    const auto throwingCompile = []() -> nn::GeneralResult<std::vector<uint8_t>> {
+        throw std::runtime_error("compilation threw");
+    };
+    std::atomic<int> compileCount = 0;
+
+    // run test
+    EXPECT_THROW(store->getOrCompile(key, throwingCompile), std::runtime_error);
+    const auto result = store->getOrCompile(key, makeCompile({1}, &compileCount));
+
+    // verify result
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(*result.value(), std::vector<uint8_t>{1});
+    EXPECT_EQ(compileCount, 1);
+}
+
+TEST(CompilationArtifactStoreTest, throwingCompileFailsWaitingCalls) {
+    // setup call
+    TemporaryDir directory;
+    const auto store = CompilationArtifactStore::create(directory.path, kCapacityBytes).value();
+    const auto key = makeKey(1);
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    const auto throwingCompile = [released]() -> nn::GeneralResult<std::vector<uint8_t>> {
+        released.wait();
+        throw std::runtime_error("compilation threw");
+    };
+    std::atomic<int> compileCount = 0;
+
+    // run test
+    std::thread compiling([&store, &key, &throwingCompile] {
+        EXPECT_THROW(store->getOrCompile(key, throwingCompile), std::runtime_error);
+    });
+    while (store->getMetrics().misses == 0) {
+        std::this_thread::yield();
+    }
+    std::optional<nn::GeneralResult<CompilationArtifactStore::Artifact>> waitingResult;
+    std::thread waiting([&store, &key, &compileCount, &waitingResult] {
+        waitingResult = store->getOrCompile(key, makeCompile({1}, &compileCount));
+    });
+    while (store->getMetrics().deduplicated == 0) {
+        std::this_thread::yield();
+    }
+    release.set_value();
+    compiling.join();
+    waiting.join();
+
+    // verify result
+    ASSERT_TRUE(waitingResult.has_value());
+    ASSERT_FALSE(waitingResult->has_value());
+    EXPECT_EQ(waitingResult->error().code, nn::ErrorStatus::GENERAL_FAILURE);
+    EXPECT_EQ(compileCount, 0);
+}
+
+TEST(CompilationArtifactStoreTest, removeForcesRecompilation) {
+    // setup call
+    TemporaryDir directory;
+    const auto store = CompilationArtifactStore::create(directory.path, kCapacityBytes).value();
+    const auto key = makeKey(1);
+    std::atomic<int> compileCount = 0;
+    ASSERT_TRUE(store->getOrCompile(key, makeCompile({1}, &compileCount)).has_value());
+
+    // run test
+    store->remove(key);
+    ASSERT_TRUE(store->getOrCompile(key, makeCompile({1}, &compileCount)).has_value());
+
+    // verify result
+    EXPECT_EQ(compileCount, 2);
+}
+
+TEST(CompilationArtifactStoreTest, concurrentCallsCompileOnce) {
+    // setup call
+    constexpr size_t kNumThreads = 8;
+    TemporaryDir directory;
+    const auto store = CompilationArtifactStore::create(directory.path, kCapacityBytes).value();
+    const auto key = makeKey(1);
+    std::atomic<int> compileCount = 0;
+    const auto slowCompile = [&compileCount]() -> nn::GeneralResult<std::vector<uint8_t>> {
+        ++compileCount;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        return std::vector<uint8_t>(100, 7);
+    };
+
+    // run test
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < kNumThreads; ++i) {
+        threads.emplace_back([&store, &key, &slowCompile] {
+            const auto result = store->getOrCompile(key, slowCompile);
+            ASSERT_TRUE(result.has_value());
+            EXPECT_EQ(*result.value(), std::vector<uint8_t>(100, 7));
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // verify result
+    EXPECT_EQ(compileCount, 1);
+    const auto metrics = store->getMetrics();
+    EXPECT_EQ(metrics.misses, 1u);
+    EXPECT_EQ(metrics.hits + metrics.deduplicated, kNumThreads - 1);
+}
+
+TEST(CompilationArtifactStoreTest, failsForMissingDirectory) {
+    // run test
+    const auto result = CompilationArtifactStore::create("/nonexistent/directory", kCapacityBytes);
+
+    // verify result
+    EXPECT_FALSE(result.has_value());
+}
+
+}  // namespace android::hardware::neuralnetworks::utils
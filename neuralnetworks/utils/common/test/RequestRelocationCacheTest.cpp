@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gmock/gmock.h>
+#include <nnapi/SharedMemory.h>
+#include <nnapi/Types.h>
+#include <nnapi/hal/CommonUtils.h>
+#include <nnapi/hal/RequestRelocationCache.h>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+namespace android::hardware::neuralnetworks::utils {
+namespace {
+
+constexpr uint32_t kAlignment = 64;
+constexpr uint32_t kPadding = 64;
+
+nn::Request::Argument makePointerArgument(const void* data, uint32_t length) {
+    return {.lifetime = nn::Request::Argument::LifeTime::POINTER,
+            .location = {.pointer = data, .length = length}};
+}
+
+nn::Request::Argument makePointerArgument(void* data, uint32_t length) {
+    return {.lifetime = nn::Request::Argument::LifeTime::POINTER,
+            .location = {.pointer = data, .length = length}};
+}
+
+uint8_t* getPointer(const nn::SharedMemory& memory, nn::Mapping* mappingOut) {
+    *mappingOut = nn::map(memory).value();
+    return static_cast<uint8_t*>(std::get<void*>(mappingOut->pointer));
+}
+
+}  // namespace
+
+TEST(RequestRelocationCacheTest, requestWithoutPointersIsNotRelocated) {
+    // setup call
+    RequestRelocationCache cache;
+    const auto request = nn::Request{};
+    std::optional<nn::Request> maybeRequestInShared;
+    RequestRelocation relocation;
+
+    // run test
+    const auto result = cache.convertRequestFromPointerToShared(
+            &request, kAlignment, kPadding, &maybeRequestInShared, &relocation);
+
+    // verify result
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(&result.value().get(), &request);
+    EXPECT_FALSE(maybeRequestInShared.has_value());
+    EXPECT_EQ(relocation.input, nullptr);
+    EXPECT_EQ(relocation.output, nullptr);
+    EXPECT_EQ(cache.getArenaAllocationCount(), 0u);
+}
+
+TEST(RequestRelocationCacheTest, relocatesPointerArguments) {
+    // setup call
+    RequestRelocationCache cache;
+    const std::vector<uint8_t> input0(10, 1);
+    const std::vector<uint8_t> input1(100, 2);
+    std::vector<uint8_t> output(20, 0);
+    const auto request = nn::Request{
+            .inputs = {makePointerArgument(input0.data(), input0.size()),
+                       makePointerArgument(input1.data(), input1.size())},
+            .outputs = {makePointerArgument(output.data(), output.size())},
+    };
+    std::optional<nn::Request> maybeRequestInShared;
+    RequestRelocation relocation;
+
+    // run test
+    const auto result = cache.convertRequestFromPointerToShared(
+            &request, kAlignment, kPadding, &maybeRequestInShared, &relocation);
+
+    // verify result
+    ASSERT_TRUE(result.has_value());
+    const nn::Request& requestInShared = result.value().get();
+    ASSERT_EQ(requestInShared.pools.size(), 2u);
+    ASSERT_NE(relocation.input, nullptr);
+    ASSERT_NE(relocation.output, nullptr);
+
+    const auto& location0 = requestInShared.inputs[0].location;
+    const auto& location1 = requestInShared.inputs[1].location;
+    EXPECT_EQ(requestInShared.inputs[0].lifetime, nn::Request::Argument::LifeTime::POOL);
+    EXPECT_EQ(location0.poolIndex, 0u);
+    EXPECT_EQ(location0.offset, 0u);
+    EXPECT_EQ(location0.length, input0.size());
+    EXPECT_EQ(location0.length + location0.padding, kPadding);
+    EXPECT_EQ(location1.poolIndex, 0u);
+    EXPECT_EQ(location1.offset, kAlignment);
+    EXPECT_EQ(requestInShared.outputs[0].location.poolIndex, 1u);
+
+    relocation.input->flush();
+    nn::Mapping inputMapping;
+    const uint8_t* inputPool = getPointer(std::get<nn::SharedMemory>(requestInShared.pools[0]),
+                                          &inputMapping);
+    EXPECT_EQ(std::memcmp(inputPool + location0.offset, input0.data(), input0.size()), 0);
+    EXPECT_EQ(std::memcmp(inputPool + location1.offset, input1.data(), input1.size()), 0);
+
+    nn::Mapping outputMapping;
+    uint8_t* outputPool = getPointer(std::get<nn::SharedMemory>(requestInShared.pools[1]),
+                                     &outputMapping);
+    std::memset(outputPool + requestInShared.outputs[0].location.offset, 3, output.size());
+    relocation.output->flush();
+    EXPECT_EQ(output, std::vector<uint8_t>(output.size(), 3));
+}
+
+TEST(RequestRelocationCacheTest, reusesArenasAcrossRequests) {
+    // setup call
+    RequestRelocationCache cache;
+    const std::vector<uint8_t> input(100);
+    std::vector<uint8_t> output(100);
+    const auto request = nn::Request{
+            .inputs = {makePointerArgument(input.data(), input.size())},
+            .outputs = {makePointerArgument(output.data(), output.size())},
+    };
+
+    // run test
+    for (int i = 0; i < 10; ++i) {
+        std::optional<nn::Request> maybeRequestInShared;
+        RequestRelocation relocation;
+        ASSERT_TRUE(cache.convertRequestFromPointerToShared(&request, kAlignment, kPadding,
+                                                            &maybeRequestInShared, &relocation)
+                            .has_value());
+    }
+
+    // verify result
+    EXPECT_EQ(cache.getArenaAllocationCount(), 2u);
+}
+
+TEST(RequestRelocationCacheTest, concurrentRequestsUseDistinctArenas) {
+    // setup call
+    RequestRelocationCache cache;
+    const std::vector<uint8_t> input(100);
+    const auto request = nn::Request{
+            .inputs = {makePointerArgument(input.data(), input.size())},
+    };
+    std::optional<nn::Request> maybeRequestInShared0, maybeRequestInShared1;
+    RequestRelocation relocation0, relocation1;
+
+    // run test
+    const auto result0 = cache.convertRequestFromPointerToShared(
+            &request, kAlignment, kPadding, &maybeRequestInShared0, &relocation0);
+    const auto result1 = cache.convertRequestFromPointerToShared(
+            &request, kAlignment, kPadding, &maybeRequestInShared1, &relocation1);
+
+    // verify result
+    ASSERT_TRUE(result0.has_value());
+    ASSERT_TRUE(result1.has_value());
+    EXPECT_NE(result0.value().get().pools[0], result1.value().get().pools[0]);
+    EXPECT_EQ(cache.getArenaAllocationCount(), 2u);
+}
+
+TEST(RequestRelocationCacheTest, growsArenasToLargestRequest) {
+    // setup call
+    RequestRelocationCache cache;
+    const std::vector<uint8_t> smallInput(100);
+    const std::vector<uint8_t> largeInput(1000);
+    const auto smallRequest = nn::Request{
+            .inputs = {makePointerArgument(smallInput.data(), smallInput.size())},
+    };
+    const auto largeRequest = nn::Request{
+            .inputs = {makePointerArgument(largeInput.data(), largeInput.size())},
+    };
+    const auto convert = [&cache](const nn::Request& request) {
+        std::optional<nn::Request> maybeRequestInShared;
+        RequestRelocation relocation;
+        return cache
+                .convertRequestFromPointerToShared(&request, kAlignment, kPadding,
+                                                   &maybeRequestInShared, &relocation)
+                .has_value();
+    };
+
+    // run test
+    ASSERT_TRUE(convert(smallRequest));
+    ASSERT_TRUE(convert(largeRequest));
+    ASSERT_TRUE(convert(smallRequest));
+    ASSERT_TRUE(convert(largeRequest));
+
+    // verify result
+    EXPECT_EQ(cache.getArenaAllocationCount(), 2u);
+}
+
+}  // namespace android::hardware::neuralnetworks::utils
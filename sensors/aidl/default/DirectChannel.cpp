@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sensors-impl/DirectChannel.h"
+
+#include <cutils/ashmem.h>
+#include <log/log.h>
+
+#include <string.h>
+#include <sys/mman.h>
+#include <algorithm>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace sensors {
+
+using EventPayload = Event::EventPayload;
+
+namespace {
+
+constexpr size_t kEventSize =
+        static_cast<size_t>(ISensors::DIRECT_REPORT_SENSOR_EVENT_TOTAL_LENGTH);
+constexpr size_t kDataSize =
+        static_cast<size_t>(ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_RESERVED -
+                            ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_DATA);
+
+template <typename T>
+void writeField(uint8_t* record, int32_t offset, const T& value) {
+    memcpy(record + offset, &value, sizeof(T));
+}
+
+// Fills data with the payload laid out the same way as the data of a sensors_event_t
+void convertPayload(const EventPayload& payload, uint8_t* data) {
+    float* values = reinterpret_cast<float*>(data);
+    switch (payload.getTag()) {
+        case EventPayload::Tag::vec3: {
+            const EventPayload::Vec3& vec3 = payload.get<EventPayload::Tag::vec3>();
+            values[0] = vec3.x;
+            values[1] = vec3.y;
+            values[2] = vec3.z;
+            data[3 * sizeof(float)] = static_cast<uint8_t>(vec3.status);
+            break;
+        }
+        case EventPayload::Tag::vec4: {
+            const EventPayload::Vec4& vec4 = payload.get<EventPayload::Tag::vec4>();
+            values[0] = vec4.x;
+            values[1] = vec4.y;
+            values[2] = vec4.z;
+            values[3] = vec4.w;
+            break;
+        }
+        case EventPayload::Tag::scalar:
+            values[0] = payload.get<EventPayload::Tag::scalar>();
+            break;
+        case EventPayload::Tag::data: {
+            const auto& data16 = payload.get<EventPayload::Tag::data>().values;
+            memcpy(values, data16.data(), std::min(kDataSize, data16.size() * sizeof(float)));
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+}  // namespace
+
+std::shared_ptr<DirectChannel> DirectChannel::create(const SharedMemInfo& mem) {
+    int fd = mem.memoryHandle.fds[0].get();
+    size_t size = static_cast<size_t>(mem.size);
+    int regionSize = ashmem_get_size_region(fd);
+    if (regionSize < 0 || static_cast<size_t>(regionSize) < size) {
+        ALOGE("Shared memory region of %d bytes is too small for %zu bytes", regionSize, size);
+        return nullptr;
+    }
+
+    void* buffer = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (buffer == MAP_FAILED) {
+        ALOGE("Unable to map direct channel memory: error %s", strerror(errno));
+        return nullptr;
+    }
+    memset(buffer, 0, size);
+    return std::shared_ptr<DirectChannel>(new DirectChannel(static_cast<uint8_t*>(buffer), size));
+}
+
+DirectChannel::~DirectChannel() {
+    munmap(mBuffer, mSize);
+}
+
+void DirectChannel::write(const Event& event, int32_t reportToken) {
+    uint8_t* record = mBuffer + mWriteOffset;
+    writeField(record, ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_FIELD,
+               static_cast<int32_t>(kEventSize));
+    writeField(record, ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_REPORT_TOKEN, reportToken);
+    writeField(record, ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_SENSOR_TYPE,
+               static_cast<int32_t>(event.sensorType));
+    writeField(record, ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_TIMESTAMP, event.timestamp);
+    uint8_t* data = record + ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_DATA;
+    memset(data, 0, kEventSize - ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_DATA);
+    convertPayload(event.payload, data);
+
+    // The counter is written last so the client never sees it before the rest of the record
+    uint32_t* counter = reinterpret_cast<uint32_t*>(
+            record + ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_ATOMIC_COUNTER);
+    __atomic_store_n(counter, mNextCounter, __ATOMIC_RELEASE);
+    if (++mNextCounter == 0) {
+        mNextCounter = 1;
+    }
+
+    mWriteOffset += kEventSize;
+    if (mWriteOffset + kEventSize > mSize) {
+        mWriteOffset = 0;
+    }
+}
+
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sensors-impl/SamplingScheduler.h"
+
+#include <log/log.h>
+#include "utils/SystemClock.h"
+
+#include <sched.h>
+#include <algorithm>
+#include <optional>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace sensors {
+
+SamplingScheduler::SamplingScheduler(RoundCallback onRoundComplete)
+    : mOnRoundComplete(std::move(onRoundComplete)), mEpochNs(::android::elapsedRealtimeNano()) {
+    mThread = std::thread([this] { run(); });
+}
+
+SamplingScheduler::~SamplingScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStopThread = true;
+        mWaitCV.notify_all();
+    }
+    mThread.join();
+}
+
+void SamplingScheduler::schedule(int64_t id, int64_t periodNs, Callback callback) {
+    std::lock_guard<std::mutex> lock(mLock);
+    auto job = mJobs.find(id);
+    if (job != mJobs.end() && job->second.periodNs == periodNs) {
+        job->second.callback = std::move(callback);
+        return;
+    }
+    // The first sample lines up with the others, and a new period only takes effect once the
+    // old one has passed, so that samples are never closer together than the period.
+    int64_t earliestSampleTimeNs = ::android::elapsedRealtimeNano();
+    std::optional<int64_t> lastSampleTimeNs;
+    if (job != mJobs.end()) {
+        lastSampleTimeNs = job->second.lastSampleTimeNs;
+    }
+    if (lastSampleTimeNs.has_value()) {
+        earliestSampleTimeNs = std::max(earliestSampleTimeNs, *lastSampleTimeNs + periodNs);
+    }
+    mJobs[id] = Job{
+            .periodNs = periodNs,
+            .nextSampleTimeNs = mEpochNs + (earliestSampleTimeNs - mEpochNs + periodNs - 1) /
+                                                   periodNs * periodNs,
+            .lastSampleTimeNs = lastSampleTimeNs,
+            .callback = std::move(callback),
+    };
+    mWaitCV.notify_all();
+}
+
+void SamplingScheduler::cancel(int64_t id) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mJobs.erase(id);
+}
+
+void SamplingScheduler::run() {
+    std::unique_lock<std::mutex> lock(mLock);
+
+    struct sched_param params;
+    // Set the thread to the lowest real-time priority.
+    params.sched_priority = 1;
+    if (sched_setscheduler(/*pid=*/0, SCHED_FIFO, &params)) {
+        ALOGE("Unable to set SCHED_FIFO: error %s", strerror(errno));
+    }
+    while (!mStopThread) {
+        if (mJobs.empty()) {
+            mWaitCV.wait(lock, [&] { return !mJobs.empty() || mStopThread; });
+            continue;
+        }
+
+        int64_t now = ::android::elapsedRealtimeNano();
+        int64_t nextSampleTimeNs = INT64_MAX;
+        bool sampled = false;
+        for (auto& [id, job] : mJobs) {
+            if (now >= job.nextSampleTimeNs) {
+                job.callback(now);
+                job.lastSampleTimeNs = now;
+                mSampleCount++;
+                sampled = true;
+                // Move on to the next multiple of the period since mEpochNs. This stays on the
+                // period instead of drifting by the wakeup latency, does not try to catch up on
+                // samples missed while the thread was held off, and lines up the samples of jobs
+                // with the same or multiple periods so they share wakeups.
+                job.nextSampleTimeNs =
+                        mEpochNs + ((now - mEpochNs) / job.periodNs + 1) * job.periodNs;
+            }
+            nextSampleTimeNs = std::min(nextSampleTimeNs, job.nextSampleTimeNs);
+        }
+        if (sampled && mOnRoundComplete) {
+            mOnRoundComplete(now, nextSampleTimeNs);
+        }
+
+        mWaitCV.wait_for(lock, std::chrono::nanoseconds(nextSampleTimeNs - now));
+        mWakeupCount++;
+    }
+}
+
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -17,10 +17,9 @@
 #include "sensors-impl/Sensor.h"
 
 #include <log/log.h>
-#include "utils/SystemClock.h"
 
+#include <algorithm>
 #include <cmath>
-#include <sched.h>
 
 using ::ndk::ScopedAStatus;
 
@@ -31,48 +30,54 @@ namespace sensors {
 
 static constexpr int32_t kDefaultMaxDelayUs = 10 * 1000 * 1000;
 
+// Flags of a sensor that can report to ashmem direct channels at rate levels up to maxRate
+static uint32_t directReportFlags(ISensors::RateLevel maxRate) {
+    return static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DIRECT_CHANNEL_ASHMEM) |
+           (static_cast<uint32_t>(maxRate) << SensorInfo::SENSOR_FLAG_SHIFT_DIRECT_REPORT);
+}
+
+// Returns the nominal report rate of a direct report rate level
+static int64_t getNominalRateHz(ISensors::RateLevel rate) {
+    switch (rate) {
+        case ISensors::RateLevel::NORMAL:
+            return 50;
+        case ISensors::RateLevel::FAST:
+            return 200;
+        case ISensors::RateLevel::VERY_FAST:
+            return 800;
+        default:
+            return 0;
+    }
+}
+
 Sensor::Sensor(ISensorsEventCallback* callback)
     : mIsEnabled(false),
       mSamplingPeriodNs(0),
-      mLastSampleTimeNs(0),
+      mMaxReportLatencyNs(0),
       mCallback(callback),
-      mMode(OperationMode::NORMAL) {
-    mRunThread = std::thread(startThread, this);
-}
+      mMode(OperationMode::NORMAL) {}
 
-Sensor::~Sensor() {
-    std::unique_lock<std::mutex> lock(mRunMutex);
-    mStopThread = true;
-    mIsEnabled = false;
-    mWaitCV.notify_all();
-    lock.release();
-    mRunThread.join();
-}
+Sensor::~Sensor() {}
 
 const SensorInfo& Sensor::getSensorInfo() const {
     return mSensorInfo;
 }
 
-void Sensor::batch(int64_t samplingPeriodNs) {
+void Sensor::batch(int64_t samplingPeriodNs, int64_t maxReportLatencyNs) {
     if (samplingPeriodNs < mSensorInfo.minDelayUs * 1000LL) {
         samplingPeriodNs = mSensorInfo.minDelayUs * 1000LL;
     } else if (samplingPeriodNs > mSensorInfo.maxDelayUs * 1000LL) {
         samplingPeriodNs = mSensorInfo.maxDelayUs * 1000LL;
     }
 
-    if (mSamplingPeriodNs != samplingPeriodNs) {
-        mSamplingPeriodNs = samplingPeriodNs;
-        // Wake up the 'run' thread to check if a new event should be generated now
-        mWaitCV.notify_all();
-    }
+    mSamplingPeriodNs = samplingPeriodNs;
+    // The latency is ignored by sensors without a FIFO, their events are reported right away
+    mMaxReportLatencyNs =
+            mSensorInfo.fifoMaxEventCount > 0 ? std::max<int64_t>(maxReportLatencyNs, 0) : 0;
 }
 
 void Sensor::activate(bool enable) {
-    if (mIsEnabled != enable) {
-        std::unique_lock<std::mutex> lock(mRunMutex);
-        mIsEnabled = enable;
-        mWaitCV.notify_all();
-    }
+    mIsEnabled = enable;
 }
 
 ScopedAStatus Sensor::flush() {
@@ -99,64 +104,58 @@ ScopedAStatus Sensor::flush() {
     return ScopedAStatus::ok();
 }
 
-void Sensor::startThread(Sensor* sensor) {
-    sensor->run();
+bool Sensor::isSampling() const {
+    return mIsEnabled && mMode == OperationMode::NORMAL;
 }
 
-void Sensor::run() {
-    std::unique_lock<std::mutex> runLock(mRunMutex);
-    constexpr int64_t kNanosecondsInSeconds = 1000 * 1000 * 1000;
+int64_t Sensor::getSamplingPeriodNs() const {
+    // Sample at the fastest rate if the sensor is enabled before batch is ever called
+    return std::max<int64_t>(mSamplingPeriodNs, mSensorInfo.minDelayUs * 1000LL);
+}
 
-    struct sched_param params;
-    // Set the thread to the lowest real-time priority.
-    params.sched_priority = 1;
-    if (sched_setscheduler(/*pid=*/0, SCHED_FIFO, &params)) {
-        ALOGE("Unable to set SCHED_FIFO: error %s", strerror(errno));
-    }
-    while (!mStopThread) {
-        if (!mIsEnabled || mMode == OperationMode::DATA_INJECTION) {
-            mWaitCV.wait(runLock, [&] {
-                return ((mIsEnabled && mMode == OperationMode::NORMAL) || mStopThread);
-            });
-        } else {
-            timespec curTime;
-            clock_gettime(CLOCK_BOOTTIME, &curTime);
-            int64_t now = (curTime.tv_sec * kNanosecondsInSeconds) + curTime.tv_nsec;
-            int64_t nextSampleTime = mLastSampleTimeNs + mSamplingPeriodNs;
-
-            if (now >= nextSampleTime) {
-                mLastSampleTimeNs = now;
-                nextSampleTime = mLastSampleTimeNs + mSamplingPeriodNs;
-                mCallback->postEvents(readEvents(), isWakeUpSensor());
-            }
-
-            mWaitCV.wait_for(runLock, std::chrono::nanoseconds(nextSampleTime - now));
-        }
-    }
+int64_t Sensor::getMaxReportLatencyNs() const {
+    return mMaxReportLatencyNs;
 }
 
-bool Sensor::isWakeUpSensor() {
+bool Sensor::isWakeUpSensor() const {
     return mSensorInfo.flags & static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_WAKE_UP);
 }
 
-std::vector<Event> Sensor::readEvents() {
+std::vector<Event> Sensor::readEvents(int64_t timestampNs) {
     std::vector<Event> events;
+    events.push_back(readEvent(timestampNs));
+    return events;
+}
+
+Event Sensor::readEvent(int64_t timestampNs) {
     Event event;
     event.sensorHandle = mSensorInfo.sensorHandle;
     event.sensorType = mSensorInfo.type;
-    event.timestamp = ::android::elapsedRealtimeNano();
+    event.timestamp = timestampNs;
     memset(&event.payload, 0, sizeof(event.payload));
     readEventPayload(event.payload);
-    events.push_back(event);
-    return events;
+    return event;
+}
+
+bool Sensor::supportsDirectReport(RateLevel rate) const {
+    uint32_t maxRate = (mSensorInfo.flags &
+                        static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_MASK_DIRECT_REPORT)) >>
+                       SensorInfo::SENSOR_FLAG_SHIFT_DIRECT_REPORT;
+    return (mSensorInfo.flags &
+            static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DIRECT_CHANNEL_ASHMEM)) &&
+           rate != RateLevel::STOP && static_cast<uint32_t>(rate) <= maxRate;
+}
+
+int64_t Sensor::getDirectReportPeriodNs(RateLevel rate) const {
+    constexpr int64_t kNanosecondsInSeconds = 1000 * 1000 * 1000;
+    // Report at the nominal rate of the level, unless that is faster than the sensor can go. The
+    // flags only advertise levels whose range starts below the fastest rate of the sensor.
+    return std::max<int64_t>(kNanosecondsInSeconds / getNominalRateHz(rate),
+                             mSensorInfo.minDelayUs * 1000LL);
 }
 
 void Sensor::setOperationMode(OperationMode mode) {
-    if (mMode != mode) {
-        std::unique_lock<std::mutex> lock(mRunMutex);
-        mMode = mode;
-        mWaitCV.notify_all();
-    }
+    mMode = mode;
 }
 
 bool Sensor::supportsDataInjection() const {
@@ -187,14 +186,16 @@ OnChangeSensor::OnChangeSensor(ISensorsEventCallback* callback)
     : Sensor(callback), mPreviousEventSet(false) {}
 
 void OnChangeSensor::activate(bool enable) {
-    Sensor::activate(enable);
-    if (!enable) {
+    // Reset when enabling rather than disabling, since sampling is only stopped once the sensor is
+    // disabled and a last sample may still be read in between
+    if (enable && !mIsEnabled) {
         mPreviousEventSet = false;
     }
+    Sensor::activate(enable);
 }
 
-std::vector<Event> OnChangeSensor::readEvents() {
-    std::vector<Event> events = Sensor::readEvents();
+std::vector<Event> OnChangeSensor::readEvents(int64_t timestampNs) {
+    std::vector<Event> events = Sensor::readEvents(timestampNs);
     std::vector<Event> outputEvents;
 
     for (auto iter = events.begin(); iter != events.end(); ++iter) {
@@ -218,13 +219,14 @@ AccelSensor::AccelSensor(int32_t sensorHandle, ISensorsEventCallback* callback)
     mSensorInfo.typeAsString = "";
     mSensorInfo.maxRange = 78.4f;  // +/- 8g
     mSensorInfo.resolution = 1.52e-5;
-    mSensorInfo.power = 0.001f;          // mA
-    mSensorInfo.minDelayUs = 10 * 1000;  // microseconds
+    mSensorInfo.power = 0.001f;         // mA
+    mSensorInfo.minDelayUs = 5 * 1000;  // microseconds
     mSensorInfo.maxDelayUs = kDefaultMaxDelayUs;
     mSensorInfo.fifoReservedEventCount = 0;
-    mSensorInfo.fifoMaxEventCount = 0;
+    mSensorInfo.fifoMaxEventCount = kFifoMaxEventCount;
     mSensorInfo.requiredPermission = "";
-    mSensorInfo.flags = static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DATA_INJECTION);
+    mSensorInfo.flags = static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DATA_INJECTION) |
+                        directReportFlags(ISensors::RateLevel::FAST);
 };
 
 void AccelSensor::readEventPayload(EventPayload& payload) {
@@ -251,7 +253,7 @@ PressureSensor::PressureSensor(int32_t sensorHandle, ISensorsEventCallback* call
     mSensorInfo.minDelayUs = 100 * 1000;  // microseconds
     mSensorInfo.maxDelayUs = kDefaultMaxDelayUs;
     mSensorInfo.fifoReservedEventCount = 0;
-    mSensorInfo.fifoMaxEventCount = 0;
+    mSensorInfo.fifoMaxEventCount = kFifoMaxEventCount;
     mSensorInfo.requiredPermission = "";
     mSensorInfo.flags = 0;
 };
@@ -274,9 +276,10 @@ MagnetometerSensor::MagnetometerSensor(int32_t sensorHandle, ISensorsEventCallba
     mSensorInfo.minDelayUs = 20 * 1000;  // microseconds
     mSensorInfo.maxDelayUs = kDefaultMaxDelayUs;
     mSensorInfo.fifoReservedEventCount = 0;
-    mSensorInfo.fifoMaxEventCount = 0;
+    mSensorInfo.fifoMaxEventCount = kFifoMaxEventCount;
     mSensorInfo.requiredPermission = "";
-    mSensorInfo.flags = static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DATA_INJECTION);
+    mSensorInfo.flags = static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DATA_INJECTION) |
+                        directReportFlags(ISensors::RateLevel::NORMAL);
 };
 
 void MagnetometerSensor::readEventPayload(EventPayload& payload) {
@@ -346,12 +349,13 @@ GyroSensor::GyroSensor(int32_t sensorHandle, ISensorsEventCallback* callback) :
     mSensorInfo.maxRange = 1000.0f * M_PI / 180.0f;
     mSensorInfo.resolution = 1000.0f * M_PI / (180.0f * 32768.0f);
     mSensorInfo.power = 0.001f;
-    mSensorInfo.minDelayUs = 10 * 1000;  // microseconds
+    mSensorInfo.minDelayUs = 5 * 1000;  // microseconds
     mSensorInfo.maxDelayUs = kDefaultMaxDelayUs;
     mSensorInfo.fifoReservedEventCount = 0;
-    mSensorInfo.fifoMaxEventCount = 0;
+    mSensorInfo.fifoMaxEventCount = kFifoMaxEventCount;
     mSensorInfo.requiredPermission = "";
-    mSensorInfo.flags = static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DATA_INJECTION);
+    mSensorInfo.flags = static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DATA_INJECTION) |
+                        directReportFlags(ISensors::RateLevel::FAST);
 };
 
 void GyroSensor::readEventPayload(EventPayload& payload) {
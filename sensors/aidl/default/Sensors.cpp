@@ -18,6 +18,8 @@
 
 #include <aidl/android/hardware/common/fmq/SynchronizedReadWrite.h>
 
+#include <algorithm>
+
 using ::aidl::android::hardware::common::fmq::MQDescriptor;
 using ::aidl::android::hardware::common::fmq::SynchronizedReadWrite;
 using ::aidl::android::hardware::sensors::Event;
@@ -34,7 +36,14 @@ namespace sensors {
 ScopedAStatus Sensors::activate(int32_t in_sensorHandle, bool in_enabled) {
     auto sensor = mSensors.find(in_sensorHandle);
     if (sensor != mSensors.end()) {
+        std::lock_guard<std::mutex> lock(mSamplingLock);
         sensor->second->activate(in_enabled);
+        updateSamplingLocked(sensor->second);
+        if (!in_enabled) {
+            // Nothing may sample again to report the events batched so far
+            std::lock_guard<std::mutex> batchLock(mBatchLock);
+            postBatchedEventsLocked();
+        }
         return ScopedAStatus::ok();
     }
 
@@ -42,28 +51,60 @@ ScopedAStatus Sensors::activate(int32_t in_sensorHandle, bool in_enabled) {
 }
 
 ScopedAStatus Sensors::batch(int32_t in_sensorHandle, int64_t in_samplingPeriodNs,
-                             int64_t /* in_maxReportLatencyNs */) {
+                             int64_t in_maxReportLatencyNs) {
     auto sensor = mSensors.find(in_sensorHandle);
     if (sensor != mSensors.end()) {
-        sensor->second->batch(in_samplingPeriodNs);
+        std::lock_guard<std::mutex> lock(mSamplingLock);
+        sensor->second->batch(in_samplingPeriodNs, in_maxReportLatencyNs);
+        updateSamplingLocked(sensor->second);
         return ScopedAStatus::ok();
     }
 
     return ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
 }
 
-ScopedAStatus Sensors::configDirectReport(int32_t /* in_sensorHandle */,
-                                          int32_t /* in_channelHandle */,
-                                          ISensors::RateLevel /* in_rate */,
-                                          int32_t* _aidl_return) {
-    *_aidl_return = EX_UNSUPPORTED_OPERATION;
+ScopedAStatus Sensors::configDirectReport(int32_t in_sensorHandle, int32_t in_channelHandle,
+                                          ISensors::RateLevel in_rate, int32_t* _aidl_return) {
+    std::lock_guard<std::mutex> lock(mDirectChannelLock);
+    auto channel = mDirectChannels.find(in_channelHandle);
+    if (channel == mDirectChannels.end()) {
+        return ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+    }
+
+    if (in_rate == ISensors::RateLevel::STOP) {
+        if (in_sensorHandle != -1 && mSensors.find(in_sensorHandle) == mSensors.end()) {
+            return ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+        }
+        stopDirectReportsLocked(in_channelHandle, in_sensorHandle);
+        *_aidl_return = 0;
+        return ScopedAStatus::ok();
+    }
+
+    auto sensor = mSensors.find(in_sensorHandle);
+    if (sensor == mSensors.end() || !sensor->second->supportsDirectReport(in_rate)) {
+        return ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+    }
 
-    return ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    // Sensor handles are unique and positive, so they also serve as report tokens
+    int32_t reportToken = in_sensorHandle;
+    mSamplingScheduler.schedule(
+            getDirectReportId(in_channelHandle, in_sensorHandle),
+            sensor->second->getDirectReportPeriodNs(in_rate),
+            [directChannel = channel->second, directSensor = sensor->second,
+             reportToken](int64_t timestampNs) {
+                directChannel->write(directSensor->readEvent(timestampNs), reportToken);
+            });
+    *_aidl_return = reportToken;
+    return ScopedAStatus::ok();
 }
 
 ScopedAStatus Sensors::flush(int32_t in_sensorHandle) {
     auto sensor = mSensors.find(in_sensorHandle);
     if (sensor != mSensors.end()) {
+        // Report the batched events before the flush complete event, holding the lock so no
+        // sample is batched in between
+        std::lock_guard<std::mutex> lock(mBatchLock);
+        postBatchedEventsLocked();
         return sensor->second->flush();
     }
 
@@ -86,8 +127,19 @@ ScopedAStatus Sensors::initialize(
     ScopedAStatus result = ScopedAStatus::ok();
 
     // Ensure that all sensors are disabled.
-    for (auto sensor : mSensors) {
-        sensor.second->activate(false);
+    {
+        std::lock_guard<std::mutex> lock(mSamplingLock);
+        for (auto sensor : mSensors) {
+            sensor.second->activate(false);
+            updateSamplingLocked(sensor.second);
+        }
+    }
+    {
+        // Events batched for the previous client are dropped along with its Event FMQ
+        std::lock_guard<std::mutex> lock(mBatchLock);
+        mBatchedEvents.clear();
+        mBatchedWakeUpEvents.clear();
+        mBatchDeadlineNs = INT64_MAX;
     }
 
     // Stop the Wake Lock thread if it is currently running
@@ -139,22 +191,96 @@ ScopedAStatus Sensors::injectSensorData(const Event& in_event) {
     return ScopedAStatus::fromServiceSpecificError(static_cast<int32_t>(ERROR_BAD_VALUE));
 }
 
-ScopedAStatus Sensors::registerDirectChannel(const ISensors::SharedMemInfo& /* in_mem */,
+ScopedAStatus Sensors::registerDirectChannel(const ISensors::SharedMemInfo& in_mem,
                                              int32_t* _aidl_return) {
-    *_aidl_return = EX_UNSUPPORTED_OPERATION;
+    // Only ashmem (or memfd, which libcutils treats the same) regions are supported
+    if (in_mem.type != ISensors::SharedMemInfo::SharedMemType::ASHMEM ||
+        in_mem.format != ISensors::SharedMemInfo::SharedMemFormat::SENSORS_EVENT ||
+        in_mem.size < DIRECT_REPORT_SENSOR_EVENT_TOTAL_LENGTH ||
+        in_mem.memoryHandle.fds.size() != 1) {
+        return ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+    }
+
+    std::shared_ptr<DirectChannel> channel = DirectChannel::create(in_mem);
+    if (channel == nullptr) {
+        return ScopedAStatus::fromServiceSpecificError(static_cast<int32_t>(ERROR_NO_MEMORY));
+    }
 
-    return ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    std::lock_guard<std::mutex> lock(mDirectChannelLock);
+    *_aidl_return = mNextDirectChannelHandle++;
+    mDirectChannels[*_aidl_return] = channel;
+    return ScopedAStatus::ok();
 }
 
 ScopedAStatus Sensors::setOperationMode(OperationMode in_mode) {
+    std::lock_guard<std::mutex> lock(mSamplingLock);
     for (auto sensor : mSensors) {
         sensor.second->setOperationMode(in_mode);
+        updateSamplingLocked(sensor.second);
+    }
+    return ScopedAStatus::ok();
+}
+
+ScopedAStatus Sensors::unregisterDirectChannel(int32_t in_channelHandle) {
+    std::lock_guard<std::mutex> lock(mDirectChannelLock);
+    if (mDirectChannels.find(in_channelHandle) != mDirectChannels.end()) {
+        stopDirectReportsLocked(in_channelHandle, -1 /* sensorHandle */);
+        mDirectChannels.erase(in_channelHandle);
     }
     return ScopedAStatus::ok();
 }
 
-ScopedAStatus Sensors::unregisterDirectChannel(int32_t /* in_channelHandle */) {
-    return ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+void Sensors::updateSamplingLocked(const std::shared_ptr<Sensor>& sensor) {
+    int32_t sensorHandle = sensor->getSensorInfo().sensorHandle;
+    if (!sensor->isSampling()) {
+        mSamplingScheduler.cancel(sensorHandle);
+        return;
+    }
+
+    // Samples of every sensor due at the same time are batched together and reported once the
+    // round is complete, so they share a single Event FMQ write
+    mSamplingScheduler.schedule(
+            sensorHandle, sensor->getSamplingPeriodNs(),
+            [this, sensor, maxReportLatencyNs = sensor->getMaxReportLatencyNs(),
+             wakeup = sensor->isWakeUpSensor()](int64_t timestampNs) {
+                std::vector<Event> events = sensor->readEvents(timestampNs);
+                if (events.empty()) {
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(mBatchLock);
+                std::vector<Event>& batch = wakeup ? mBatchedWakeUpEvents : mBatchedEvents;
+                batch.insert(batch.end(), events.begin(), events.end());
+                mBatchDeadlineNs = std::min(mBatchDeadlineNs, timestampNs + maxReportLatencyNs);
+            });
+}
+
+void Sensors::onSamplingRoundComplete(int64_t /* timestampNs */, int64_t nextSampleTimeNs) {
+    std::lock_guard<std::mutex> lock(mBatchLock);
+    if (mBatchDeadlineNs <= nextSampleTimeNs ||
+        mBatchedEvents.size() + mBatchedWakeUpEvents.size() >=
+                static_cast<size_t>(Sensor::kFifoMaxEventCount)) {
+        postBatchedEventsLocked();
+    }
+}
+
+void Sensors::postBatchedEventsLocked() {
+    if (!mBatchedEvents.empty()) {
+        postEvents(mBatchedEvents, false /* wakeup */);
+        mBatchedEvents.clear();
+    }
+    if (!mBatchedWakeUpEvents.empty()) {
+        postEvents(mBatchedWakeUpEvents, true /* wakeup */);
+        mBatchedWakeUpEvents.clear();
+    }
+    mBatchDeadlineNs = INT64_MAX;
+}
+
+void Sensors::stopDirectReportsLocked(int32_t channelHandle, int32_t sensorHandle) {
+    for (const auto& sensor : mSensors) {
+        if (sensorHandle == -1 || sensor.first == sensorHandle) {
+            mSamplingScheduler.cancel(getDirectReportId(channelHandle, sensor.first));
+        }
+    }
 }
 
 }  // namespace sensors
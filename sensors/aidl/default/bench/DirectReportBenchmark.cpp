@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/benchmark.h"
+
+#include "sensors-impl/Sensors.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+
+using ::aidl::android::hardware::common::NativeHandle;
+using ::aidl::android::hardware::sensors::ISensors;
+using ::aidl::android::hardware::sensors::SensorInfo;
+using ::aidl::android::hardware::sensors::Sensors;
+using ::aidl::android::hardware::sensors::SensorType;
+using ::benchmark::Counter;
+using ::benchmark::State;
+
+// How long each iteration lets the sensor report
+static constexpr int64_t kMeasurementNs = 1000 * 1000 * 1000;
+
+// Enough records to hold a whole measurement at the fastest rate without wrapping
+static constexpr size_t kNumRecords = 2048;
+static constexpr size_t kRecordSize = ISensors::DIRECT_REPORT_SENSOR_EVENT_TOTAL_LENGTH;
+static constexpr size_t kMemSize = kNumRecords * kRecordSize;
+static constexpr size_t kCounterOffset =
+        ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_ATOMIC_COUNTER;
+static constexpr size_t kTimestampOffset =
+        ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_TIMESTAMP;
+
+static int64_t getNominalPeriodNs(ISensors::RateLevel rate) {
+    switch (rate) {
+        case ISensors::RateLevel::NORMAL:
+            return 1000 * 1000 * 1000 / 50;
+        case ISensors::RateLevel::FAST:
+            return 1000 * 1000 * 1000 / 200;
+        default:
+            return 1000 * 1000 * 1000 / 800;
+    }
+}
+
+static int64_t getTimeNs(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Measures how close the rate of direct reports from the accelerometer is to the rate implied by
+// the rate level, the worst deviation of a sample from its period, and the CPU used to report.
+static void BM_DirectReportAccelerometer(State& state) {
+    auto rate = static_cast<ISensors::RateLevel>(state.range(0));
+    std::shared_ptr<Sensors> sensors = ndk::SharedRefBase::make<Sensors>();
+
+    std::vector<SensorInfo> sensorsList;
+    sensors->getSensorsList(&sensorsList);
+    auto accel = std::find_if(sensorsList.begin(), sensorsList.end(), [](const SensorInfo& info) {
+        return info.type == SensorType::ACCELEROMETER;
+    });
+    if (accel == sensorsList.end()) {
+        state.SkipWithError("No accelerometer");
+        return;
+    }
+    int64_t expectedPeriodNs =
+            std::max<int64_t>(getNominalPeriodNs(rate), accel->minDelayUs * 1000LL);
+
+    int fd = memfd_create("DirectReportBenchmark", MFD_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, kMemSize) != 0) {
+        state.SkipWithError("Unable to create shared memory");
+        return;
+    }
+    auto* buffer = static_cast<uint8_t*>(
+            mmap(nullptr, kMemSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+
+    for (auto _ : state) {
+        ISensors::SharedMemInfo mem;
+        mem.type = ISensors::SharedMemInfo::SharedMemType::ASHMEM;
+        mem.format = ISensors::SharedMemInfo::SharedMemFormat::SENSORS_EVENT;
+        mem.size = kMemSize;
+        mem.memoryHandle.fds.emplace_back(dup(fd));
+        int32_t channelHandle;
+        if (!sensors->registerDirectChannel(mem, &channelHandle).isOk()) {
+            state.SkipWithError("Unable to register direct channel");
+            break;
+        }
+
+        int32_t reportToken;
+        int64_t cpuStartNs = getTimeNs(CLOCK_PROCESS_CPUTIME_ID);
+        int64_t startNs = getTimeNs(CLOCK_MONOTONIC);
+        sensors->configDirectReport(accel->sensorHandle, channelHandle, rate, &reportToken);
+        usleep(kMeasurementNs / 1000);
+        sensors->configDirectReport(accel->sensorHandle, channelHandle, ISensors::RateLevel::STOP,
+                                    &reportToken);
+        int64_t elapsedNs = getTimeNs(CLOCK_MONOTONIC) - startNs;
+        int64_t cpuNs = getTimeNs(CLOCK_PROCESS_CPUTIME_ID) - cpuStartNs;
+        sensors->unregisterDirectChannel(channelHandle);
+
+        size_t numRecords = 0;
+        int64_t firstTimestampNs = 0;
+        int64_t lastTimestampNs = 0;
+        int64_t maxJitterNs = 0;
+        for (; numRecords < kNumRecords; numRecords++) {
+            const uint8_t* record = buffer + numRecords * kRecordSize;
+            uint32_t counter;
+            memcpy(&counter, record + kCounterOffset, sizeof(counter));
+            if (counter == 0) {
+                break;
+            }
+            int64_t timestampNs;
+            memcpy(&timestampNs, record + kTimestampOffset, sizeof(timestampNs));
+            if (numRecords == 0) {
+                firstTimestampNs = timestampNs;
+            } else {
+                maxJitterNs = std::max(maxJitterNs,
+                                       std::abs(timestampNs - lastTimestampNs - expectedPeriodNs));
+            }
+            lastTimestampNs = timestampNs;
+        }
+        if (numRecords < 2) {
+            state.SkipWithError("No direct reports written");
+            break;
+        }
+
+        double rateHz = (numRecords - 1) * 1e9 / (lastTimestampNs - firstTimestampNs);
+        double expectedRateHz = 1e9 / expectedPeriodNs;
+        state.SetIterationTime(elapsedNs / 1e9);
+        state.counters["rate_hz"] = Counter(rateHz, Counter::kAvgIterations);
+        double rateErrorPct = 100.0 * (rateHz - expectedRateHz) / expectedRateHz;
+        state.counters["rate_error_pct"] = Counter(rateErrorPct, Counter::kAvgIterations);
+        state.counters["max_jitter_us"] = Counter(maxJitterNs / 1e3, Counter::kAvgIterations);
+        state.counters["cpu_pct"] = Counter(100.0 * cpuNs / elapsedNs, Counter::kAvgIterations);
+    }
+
+    munmap(buffer, kMemSize);
+    close(fd);
+}
+
+BENCHMARK(BM_DirectReportAccelerometer)
+        ->ArgName("rate")
+        ->Arg(static_cast<int64_t>(ISensors::RateLevel::NORMAL))
+        ->Arg(static_cast<int64_t>(ISensors::RateLevel::FAST))
+        ->Iterations(5)
+        ->UseManualTime()
+        ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
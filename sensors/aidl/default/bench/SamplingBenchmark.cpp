@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/benchmark.h"
+
+#include <aidl/android/hardware/sensors/BnSensorsCallback.h>
+
+#include "sensors-impl/Sensors.h"
+
+#include <unistd.h>
+
+using ::aidl::android::hardware::common::fmq::SynchronizedReadWrite;
+using ::aidl::android::hardware::sensors::BnSensorsCallback;
+using ::aidl::android::hardware::sensors::Event;
+using ::aidl::android::hardware::sensors::SensorInfo;
+using ::aidl::android::hardware::sensors::Sensors;
+using ::android::AidlMessageQueue;
+using ::benchmark::Counter;
+using ::benchmark::State;
+using ::ndk::ScopedAStatus;
+
+using EventQueue = AidlMessageQueue<Event, SynchronizedReadWrite>;
+using WakeLockQueue = AidlMessageQueue<int32_t, SynchronizedReadWrite>;
+
+// How long each iteration lets the sensors sample
+static constexpr int64_t kMeasurementNs = 1000 * 1000 * 1000;
+
+// Enough events to hold a whole measurement of every sensor at its fastest rate
+static constexpr size_t kQueueSize = 1024;
+
+class NoOpSensorsCallback : public BnSensorsCallback {
+  public:
+    ScopedAStatus onDynamicSensorsConnected(
+            const std::vector<SensorInfo>& /* sensorInfos */) override {
+        return ScopedAStatus::ok();
+    }
+
+    ScopedAStatus onDynamicSensorsDisconnected(
+            const std::vector<int32_t>& /* sensorHandles */) override {
+        return ScopedAStatus::ok();
+    }
+};
+
+static int64_t getTimeNs(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Enables every sensor at its fastest rate and measures how often the sampling thread wakes up
+// and writes to the Event FMQ, compared to the number of events it reports. The argument is the
+// maxReportLatency the sensors are batched with.
+static void BM_SampleAllSensors(State& state) {
+    int64_t maxReportLatencyNs = state.range(0) * 1000 * 1000;
+    std::shared_ptr<Sensors> sensors = ndk::SharedRefBase::make<Sensors>();
+    auto eventQueue = std::make_unique<EventQueue>(kQueueSize, true /* configureEventFlagWord */);
+    auto wakeLockQueue =
+            std::make_unique<WakeLockQueue>(kQueueSize, true /* configureEventFlagWord */);
+    sensors->initialize(eventQueue->dupeDesc(), wakeLockQueue->dupeDesc(),
+                        ndk::SharedRefBase::make<NoOpSensorsCallback>());
+
+    std::vector<SensorInfo> sensorsList;
+    sensors->getSensorsList(&sensorsList);
+    std::vector<Event> events(kQueueSize);
+
+    for (auto _ : state) {
+        uint64_t wakeupsStart = sensors->getSamplingWakeupCount();
+        uint64_t writesStart = sensors->getEventQueueWriteCount();
+        int64_t cpuStartNs = getTimeNs(CLOCK_PROCESS_CPUTIME_ID);
+        int64_t startNs = getTimeNs(CLOCK_MONOTONIC);
+        for (const SensorInfo& info : sensorsList) {
+            sensors->batch(info.sensorHandle, info.minDelayUs * 1000LL, maxReportLatencyNs);
+            sensors->activate(info.sensorHandle, true);
+        }
+        usleep(kMeasurementNs / 1000);
+        for (const SensorInfo& info : sensorsList) {
+            sensors->activate(info.sensorHandle, false);
+        }
+        int64_t elapsedNs = getTimeNs(CLOCK_MONOTONIC) - startNs;
+        int64_t cpuNs = getTimeNs(CLOCK_PROCESS_CPUTIME_ID) - cpuStartNs;
+        uint64_t wakeups = sensors->getSamplingWakeupCount() - wakeupsStart;
+        uint64_t writes = sensors->getEventQueueWriteCount() - writesStart;
+
+        size_t numEvents = eventQueue->availableToRead();
+        eventQueue->read(events.data(), numEvents);
+
+        double elapsedS = elapsedNs / 1e9;
+        state.SetIterationTime(elapsedS);
+        state.counters["wakeups_per_s"] = Counter(wakeups / elapsedS, Counter::kAvgIterations);
+        state.counters["fmq_writes_per_s"] = Counter(writes / elapsedS, Counter::kAvgIterations);
+        state.counters["events_per_s"] = Counter(numEvents / elapsedS, Counter::kAvgIterations);
+        state.counters["cpu_pct"] = Counter(100.0 * cpuNs / elapsedNs, Counter::kAvgIterations);
+    }
+}
+
+BENCHMARK(BM_SampleAllSensors)
+        ->ArgName("latency_ms")
+        ->Arg(0)
+        ->Arg(100)
+        ->Iterations(5)
+        ->UseManualTime()
+        ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
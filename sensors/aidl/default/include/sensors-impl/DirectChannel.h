@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <aidl/android/hardware/sensors/BnSensors.h>
+
+#include <memory>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace sensors {
+
+// A shared memory region registered through ISensors::registerDirectChannel. Sensor events are
+// written into it as a ring of DIRECT_REPORT_SENSOR_EVENT_TOTAL_LENGTH byte records that the
+// client reads directly, without going through the Event FMQ.
+class DirectChannel {
+  public:
+    using SharedMemInfo = ::aidl::android::hardware::sensors::ISensors::SharedMemInfo;
+
+    // Maps the ashmem or memfd region of mem and clears it. Returns nullptr if it can't be mapped.
+    static std::shared_ptr<DirectChannel> create(const SharedMemInfo& mem);
+
+    ~DirectChannel();
+
+    // Appends an event to the ring, overwriting the oldest one once it is full. Must only be
+    // called from one thread at a time.
+    void write(const Event& event, int32_t reportToken);
+
+  private:
+    DirectChannel(uint8_t* buffer, size_t size) : mBuffer(buffer), mSize(size) {}
+
+    uint8_t* const mBuffer;
+    const size_t mSize;
+
+    // Offset of the next record to write
+    size_t mWriteOffset = 0;
+    // Counter stored in the next record, never zero since zero marks an unwritten record
+    uint32_t mNextCounter = 1;
+};
+
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace sensors {
+
+// Runs periodic sampling callbacks for any number of sensors from a single thread. Each wakeup
+// runs every callback that is due with the same timestamp, then sleeps until the next one is due.
+class SamplingScheduler {
+  public:
+    using Callback = std::function<void(int64_t timestampNs)>;
+    // Called once the callbacks due at timestampNs have all run, with the time of the next wakeup
+    using RoundCallback = std::function<void(int64_t timestampNs, int64_t nextSampleTimeNs)>;
+
+    explicit SamplingScheduler(RoundCallback onRoundComplete = nullptr);
+    ~SamplingScheduler();
+
+    // Starts calling the callback every periodNs, replacing any callback already scheduled with
+    // the same id. All calls, including the first, happen on multiples of the period since the
+    // scheduler started, so they line up with the calls of the other callbacks whose periods are
+    // multiples. When the period of an id changes, the first call with the new period is at least
+    // that period after the last call with the old one.
+    void schedule(int64_t id, int64_t periodNs, Callback callback);
+
+    // Stops the callback with the id. Once this returns the callback is not running and will not
+    // be called again. Callbacks must not call back into the scheduler.
+    void cancel(int64_t id);
+
+    // The number of times the thread woke up and the number of callbacks it ran
+    uint64_t getWakeupCount() const { return mWakeupCount.load(); }
+    uint64_t getSampleCount() const { return mSampleCount.load(); }
+
+  private:
+    struct Job {
+        int64_t periodNs;
+        int64_t nextSampleTimeNs;
+        // When the callback was last called for the id, kept across changes of the period
+        std::optional<int64_t> lastSampleTimeNs;
+        Callback callback;
+    };
+
+    void run();
+
+    const RoundCallback mOnRoundComplete;
+    // The origin of the sampling times, shared by all jobs
+    const int64_t mEpochNs;
+    std::mutex mLock;
+    std::condition_variable mWaitCV;
+    std::map<int64_t, Job> mJobs;
+    bool mStopThread = false;
+    std::thread mThread;
+
+    std::atomic<uint64_t> mWakeupCount = 0;
+    std::atomic<uint64_t> mSampleCount = 0;
+};
+
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
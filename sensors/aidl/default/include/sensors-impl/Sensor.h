@@ -14,8 +14,6 @@
  * limitations under the License.
  */
 
-#include <thread>
-
 #include <aidl/android/hardware/sensors/BnSensors.h>
 
 namespace aidl {
@@ -34,6 +32,7 @@ class ISensorsEventCallback {
 class Sensor {
   public:
     using OperationMode = ::aidl::android::hardware::sensors::ISensors::OperationMode;
+    using RateLevel = ::aidl::android::hardware::sensors::ISensors::RateLevel;
     using Event = ::aidl::android::hardware::sensors::Event;
     using EventPayload = ::aidl::android::hardware::sensors::Event::EventPayload;
     using SensorInfo = ::aidl::android::hardware::sensors::SensorInfo;
@@ -41,11 +40,15 @@ class Sensor {
     using MetaDataEventType =
             ::aidl::android::hardware::sensors::Event::EventPayload::MetaData::MetaDataEventType;
 
+    // The size of the FIFO shared by the sensors that support batching. Kept well below the size
+    // of the Event FMQ so that a full FIFO fits in a single write.
+    static constexpr int32_t kFifoMaxEventCount = 128;
+
     Sensor(ISensorsEventCallback* callback);
     virtual ~Sensor();
 
     const SensorInfo& getSensorInfo() const;
-    void batch(int64_t samplingPeriodNs);
+    void batch(int64_t samplingPeriodNs, int64_t maxReportLatencyNs);
     virtual void activate(bool enable);
     ndk::ScopedAStatus flush();
 
@@ -53,24 +56,31 @@ class Sensor {
     bool supportsDataInjection() const;
     ndk::ScopedAStatus injectEvent(const Event& event);
 
+    // Whether samples should be generated for the sensor, and at which period. The caller is
+    // responsible for calling readEvents at that period, such as from a SamplingScheduler.
+    bool isSampling() const;
+    int64_t getSamplingPeriodNs() const;
+    // How long samples may be batched before they are reported, zero if batching isn't supported
+    int64_t getMaxReportLatencyNs() const;
+    bool isWakeUpSensor() const;
+
+    // Returns the events to report for a sample taken at timestampNs
+    virtual std::vector<Event> readEvents(int64_t timestampNs);
+    // Returns a sample taken at timestampNs, without any on-change filtering
+    Event readEvent(int64_t timestampNs);
+
+    bool supportsDirectReport(RateLevel rate) const;
+    // The sampling period used for direct reports at the rate level
+    int64_t getDirectReportPeriodNs(RateLevel rate) const;
+
   protected:
-    void run();
-    virtual std::vector<Event> readEvents();
     virtual void readEventPayload(EventPayload&) = 0;
-    static void startThread(Sensor* sensor);
-
-    bool isWakeUpSensor();
 
     bool mIsEnabled;
     int64_t mSamplingPeriodNs;
-    int64_t mLastSampleTimeNs;
+    int64_t mMaxReportLatencyNs;
     SensorInfo mSensorInfo;
 
-    std::atomic_bool mStopThread;
-    std::condition_variable mWaitCV;
-    std::mutex mRunMutex;
-    std::thread mRunThread;
-
     ISensorsEventCallback* mCallback;
 
     OperationMode mMode;
@@ -81,9 +91,7 @@ class OnChangeSensor : public Sensor {
     OnChangeSensor(ISensorsEventCallback* callback);
 
     virtual void activate(bool enable) override;
-
-  protected:
-    virtual std::vector<Event> readEvents() override;
+    virtual std::vector<Event> readEvents(int64_t timestampNs) override;
 
   protected:
     Event mPreviousEvent;
@@ -21,6 +21,8 @@
 #include <fmq/AidlMessageQueue.h>
 #include <hardware_legacy/power.h>
 #include <map>
+#include "DirectChannel.h"
+#include "SamplingScheduler.h"
 #include "Sensor.h"
 
 #include <android-base/thread_annotations.h>
@@ -43,10 +45,16 @@ class Sensors : public BnSensors, public ISensorsEventCallback {
     Sensors()
         : mEventQueueFlag(nullptr),
           mNextHandle(1),
+          mNextDirectChannelHandle(1),
           mOutstandingWakeUpEvents(0),
           mReadWakeLockQueueRun(false),
           mAutoReleaseWakeLockTime(0),
-          mHasWakeLock(false) {
+          mHasWakeLock(false),
+          mBatchDeadlineNs(INT64_MAX),
+          mEventQueueWriteCount(0),
+          mSamplingScheduler([this](int64_t timestampNs, int64_t nextSampleTimeNs) {
+              onSamplingRoundComplete(timestampNs, nextSampleTimeNs);
+          }) {
         AddSensor<AccelSensor>();
         AddSensor<GyroSensor>();
         AddSensor<AmbientTempSensor>();
@@ -95,10 +103,11 @@ class Sensors : public BnSensors, public ISensorsEventCallback {
 
     void postEvents(const std::vector<Event>& events, bool wakeup) override {
         std::lock_guard<std::mutex> lock(mWriteLock);
-        if (mEventQueue == nullptr) {
+        if (mEventQueue == nullptr || events.empty()) {
             return;
         }
         if (mEventQueue->write(&events.front(), events.size())) {
+            mEventQueueWriteCount++;
             if (mEventQueueFlag == nullptr) {
                 // Don't take the wake lock if we can't wake the receiver to avoid holding it
                 // indefinitely.
@@ -114,7 +123,35 @@ class Sensors : public BnSensors, public ISensorsEventCallback {
         }
     }
 
+    // The number of times the sampling thread woke up and the number of writes to the Event FMQ
+    uint64_t getSamplingWakeupCount() const { return mSamplingScheduler.getWakeupCount(); }
+    uint64_t getEventQueueWriteCount() const { return mEventQueueWriteCount.load(); }
+
   protected:
+    // Starts, updates or stops sampling the sensor to the Event FMQ to match its configuration.
+    // Expects mSamplingLock to be locked prior to invocation.
+    void updateSamplingLocked(const std::shared_ptr<Sensor>& sensor);
+
+    // Called by the sampling thread once all the samples of a wakeup are batched. Reports the
+    // batched events if waiting for the next wakeup would exceed the latency of one of them, or if
+    // the FIFO is full.
+    void onSamplingRoundComplete(int64_t timestampNs, int64_t nextSampleTimeNs);
+
+    // Writes all batched events to the Event FMQ. Expects mBatchLock to be locked prior to
+    // invocation.
+    void postBatchedEventsLocked();
+
+    // Stops the reports of a sensor, or of all sensors when sensorHandle is -1, to a direct
+    // channel. Expects mDirectChannelLock to be locked prior to invocation.
+    void stopDirectReportsLocked(int32_t channelHandle, int32_t sensorHandle);
+
+    // The id of the scheduler callback of a sensor reporting to a direct channel. Direct channel
+    // handles start at 1, so these never collide with the ids of the sensors sampled to the Event
+    // FMQ, which are their sensor handles.
+    static int64_t getDirectReportId(int32_t channelHandle, int32_t sensorHandle) {
+        return (static_cast<int64_t>(channelHandle) << 32) | static_cast<uint32_t>(sensorHandle);
+    }
+
     // Add a new sensor
     template <class SensorType>
     void AddSensor() {
@@ -207,6 +244,15 @@ class Sensors : public BnSensors, public ISensorsEventCallback {
     std::map<int32_t, std::shared_ptr<Sensor>> mSensors;
     // The next available sensor handle.
     int32_t mNextHandle;
+    // Lock to protect the configuration of the sensors and their sampling.
+    std::mutex mSamplingLock;
+    // Lock to protect the direct channels and their reports.
+    std::mutex mDirectChannelLock;
+    // A map of the registered direct channels.
+    std::map<int32_t, std::shared_ptr<DirectChannel>> mDirectChannels
+            GUARDED_BY(mDirectChannelLock);
+    // The next available direct channel handle.
+    int32_t mNextDirectChannelHandle GUARDED_BY(mDirectChannelLock);
     // Lock to protect writes to the FMQs.
     std::mutex mWriteLock;
     // Lock to protect acquiring and releasing the wake lock
@@ -221,6 +267,18 @@ class Sensors : public BnSensors, public ISensorsEventCallback {
     int64_t mAutoReleaseWakeLockTime;
     // Flag to indicate if a wake lock has been acquired
     bool mHasWakeLock;
+    // Lock to protect the batched events.
+    std::mutex mBatchLock;
+    // Events sampled but not yet written to the Event FMQ, kept apart by whether they wake up
+    std::vector<Event> mBatchedEvents GUARDED_BY(mBatchLock);
+    std::vector<Event> mBatchedWakeUpEvents GUARDED_BY(mBatchLock);
+    // The time by which the batched events must be reported to honor their maxReportLatencyNs
+    int64_t mBatchDeadlineNs GUARDED_BY(mBatchLock);
+    // The number of writes to the Event FMQ
+    std::atomic<uint64_t> mEventQueueWriteCount;
+    // Samples all the sensors, both to the Event FMQ and to direct channels, from a single thread.
+    // Declared last so that the thread is stopped before anything it uses is destroyed.
+    SamplingScheduler mSamplingScheduler;
 };
 
 }  // namespace sensors
@@ -59,14 +59,14 @@ int32_t setSubHalIndex(int32_t sensorHandle, size_t subHalIndex) {
 }
 
 /**
- * Extract the subHalIndex from sensorHandle.
+ * Check the flags of a sensor for WAKE_UP.
  *
- * @param sensorHandle The sensorHandle to extract from.
+ * @param sensor The sensor info to check.
  *
- * @return The subhal index.
+ * @return true if the sensor is a wake up sensor.
  */
-size_t extractSubHalIndex(int32_t sensorHandle) {
-    return static_cast<size_t>(sensorHandle >> kBitsAfterSubHalIndex);
+bool isWakeUpSensorInfo(const SensorInfo& sensor) {
+    return (sensor.flags & static_cast<uint32_t>(V1_0::SensorFlagBits::WAKE_UP)) != 0;
 }
 
 /**
@@ -159,11 +159,11 @@ Return<Result> HalProxy::setOperationMode(OperationMode mode) {
 }
 
 Return<Result> HalProxy::activate(int32_t sensorHandle, bool enabled) {
-    if (!isSubHalIndexValid(sensorHandle)) {
+    ISubHalWrapperBase* subHal = getSubHalForSensorHandle(sensorHandle);
+    if (subHal == nullptr) {
         return Result::BAD_VALUE;
     }
-    return getSubHalForSensorHandle(sensorHandle)
-            ->activate(clearSubHalIndex(sensorHandle), enabled);
+    return subHal->activate(clearSubHalIndex(sensorHandle), enabled);
 }
 
 Return<Result> HalProxy::initialize_2_1(
@@ -224,11 +224,11 @@ Return<Result> HalProxy::initializeCommon(
     disableAllSensors();
 
     // Clears the queue if any events were pending write before.
-    mPendingWriteEventsQueue = std::queue<std::pair<std::vector<V2_1::Event>, size_t>>();
-    mSizePendingWriteEventsQueue = 0;
+    mPendingWriteEvents.clear();
 
     // Clears previously connected dynamic sensors
     mDynamicSensors.clear();
+    mSensorHandleTable.removeDynamicSensors();
 
     mDynamicSensorsCallback = sensorsCallback;
 
@@ -276,18 +276,19 @@ Return<Result> HalProxy::initializeCommon(
 
 Return<Result> HalProxy::batch(int32_t sensorHandle, int64_t samplingPeriodNs,
                                int64_t maxReportLatencyNs) {
-    if (!isSubHalIndexValid(sensorHandle)) {
+    ISubHalWrapperBase* subHal = getSubHalForSensorHandle(sensorHandle);
+    if (subHal == nullptr) {
         return Result::BAD_VALUE;
     }
-    return getSubHalForSensorHandle(sensorHandle)
-            ->batch(clearSubHalIndex(sensorHandle), samplingPeriodNs, maxReportLatencyNs);
+    return subHal->batch(clearSubHalIndex(sensorHandle), samplingPeriodNs, maxReportLatencyNs);
 }
 
 Return<Result> HalProxy::flush(int32_t sensorHandle) {
-    if (!isSubHalIndexValid(sensorHandle)) {
+    ISubHalWrapperBase* subHal = getSubHalForSensorHandle(sensorHandle);
+    if (subHal == nullptr) {
         return Result::BAD_VALUE;
     }
-    return getSubHalForSensorHandle(sensorHandle)->flush(clearSubHalIndex(sensorHandle));
+    return subHal->flush(clearSubHalIndex(sensorHandle));
 }
 
 Return<Result> HalProxy::injectSensorData_2_1(const V2_1::Event& event) {
@@ -304,12 +305,12 @@ Return<Result> HalProxy::injectSensorData(const V1_0::Event& event) {
     }
     if (result == Result::OK) {
         V1_0::Event subHalEvent = event;
-        if (!isSubHalIndexValid(event.sensorHandle)) {
+        ISubHalWrapperBase* subHal = getSubHalForSensorHandle(event.sensorHandle);
+        if (subHal == nullptr) {
             return Result::BAD_VALUE;
         }
         subHalEvent.sensorHandle = clearSubHalIndex(event.sensorHandle);
-        result = getSubHalForSensorHandle(event.sensorHandle)
-                         ->injectSensorData(convertToNewEvent(subHalEvent));
+        result = subHal->injectSensorData(convertToNewEvent(subHalEvent));
     }
     return result;
 }
@@ -370,16 +371,20 @@ Return<void> HalProxy::debug(const hidl_handle& fd, const hidl_vec<hidl_string>&
            << " ms ago" << std::endl;
     // TODO(b/142969448): Add logging for history of wakelock acquisition per subhal.
     stream << "  Wakelock ref count: " << mWakelockRefCount << std::endl;
-    stream << "  # of events on pending write writes queue: " << mSizePendingWriteEventsQueue
-           << std::endl;
+    stream << "  # of events on pending write writes queue: " << mPendingWriteEvents.size()
+           << " (capacity " << mPendingWriteEvents.capacity() << ")" << std::endl;
     stream << " Most events seen on pending write events queue: "
-           << mMostEventsObservedPendingWriteEventsQueue << std::endl;
-    if (!mPendingWriteEventsQueue.empty()) {
-        stream << "  Size of events list on front of pending writes queue: "
-               << mPendingWriteEventsQueue.front().first.size() << std::endl;
-    }
+           << mMostEventsObservedPendingWriteEventsQueue.load() << std::endl;
+    stream << "  # of events written from pending write events queue: "
+           << mNumPendingEventsWritten.load() << std::endl;
+    stream << "  # of events dropped, pending write events queue full: "
+           << mNumEventsDroppedQueueFull.load() << std::endl;
+    stream << "  # of events dropped, event fmq write timed out: "
+           << mNumEventsDroppedWriteTimeout.load() << std::endl;
     stream << "  # of non-dynamic sensors across all subhals: " << mSensors.size() << std::endl;
     stream << "  # of dynamic sensors across all subhals: " << mDynamicSensors.size() << std::endl;
+    stream << "  # of sensors in handle table: " << mSensorHandleTable.size() << " ("
+           << mSensorHandleTable.overflowSize() << " outside the flat array)" << std::endl;
     stream << "SubHals (" << mSubHalList.size() << "):" << std::endl;
     for (auto& subHal : mSubHalList) {
         stream << "  Name: " << subHal->getName() << std::endl;
@@ -405,6 +410,8 @@ Return<void> HalProxy::onDynamicSensorsConnected(const hidl_vec<SensorInfo>& dyn
             } else {
                 sensor.sensorHandle = setSubHalIndex(sensor.sensorHandle, subHalIndex);
                 mDynamicSensors[sensor.sensorHandle] = sensor;
+                mSensorHandleTable.add(sensor.sensorHandle, isWakeUpSensorInfo(sensor),
+                                       true /* dynamic */);
                 sensors.push_back(sensor);
             }
         }
@@ -426,6 +433,7 @@ Return<void> HalProxy::onDynamicSensorsDisconnected(
                 sensorHandle = setSubHalIndex(sensorHandle, subHalIndex);
                 if (mDynamicSensors.find(sensorHandle) != mDynamicSensors.end()) {
                     mDynamicSensors.erase(sensorHandle);
+                    mSensorHandleTable.remove(sensorHandle);
                     sensorHandles.push_back(sensorHandle);
                 }
             }
@@ -497,6 +505,8 @@ void HalProxy::initializeSensorList() {
                     sensor.sensorHandle = setSubHalIndex(sensor.sensorHandle, subHalIndex);
                     setDirectChannelFlags(&sensor, mSubHalList[subHalIndex]);
                     mSensors[sensor.sensorHandle] = sensor;
+                    mSensorHandleTable.add(sensor.sensorHandle, isWakeUpSensorInfo(sensor),
+                                           false /* dynamic */);
                 }
             }
         });
@@ -527,6 +537,7 @@ void* HalProxy::getHandleForSubHalSharedObject(const std::string& filename) {
 }
 
 void HalProxy::init() {
+    mSensorHandleTable.reset(mSubHalList.size());
     initializeSensorList();
 }
 
@@ -544,7 +555,10 @@ void HalProxy::stopThreads() {
         mWakelockQueueFlag->wake(static_cast<uint32_t>(WakeLockQueueFlagBits::DATA_WRITTEN));
     }
     mWakelockCV.notify_one();
-    mEventQueueWriteCV.notify_one();
+    {
+        std::lock_guard<std::mutex> lock(mPendingWritesWaitMutex);
+        mEventQueueWriteCV.notify_one();
+    }
     if (mPendingWritesThread.joinable()) {
         mPendingWritesThread.join();
     }
@@ -570,45 +584,60 @@ void HalProxy::startPendingWritesThread(HalProxy* halProxy) {
 }
 
 void HalProxy::handlePendingWrites() {
-    // TODO(b/143302327): Find a way to optimize locking strategy maybe using two mutexes instead of
-    // one.
-    std::unique_lock<std::mutex> lock(mEventQueueWriteMutex);
+    // When the event fmq was first seen full with events pending, or -1 if it is not full
+    int64_t blockedSinceNs = -1;
     while (mThreadsRun.load()) {
-        mEventQueueWriteCV.wait(
-                lock, [&] { return !mPendingWriteEventsQueue.empty() || !mThreadsRun.load(); });
-        if (mThreadsRun.load()) {
-            std::vector<Event>& pendingWriteEvents = mPendingWriteEventsQueue.front().first;
-            size_t numWakeupEvents = mPendingWriteEventsQueue.front().second;
-            size_t eventQueueSize = mEventQueue->getQuantumCount();
-            size_t numToWrite = std::min(pendingWriteEvents.size(), eventQueueSize);
-            lock.unlock();
-            if (!mEventQueue->writeBlocking(
-                        pendingWriteEvents.data(), numToWrite,
-                        static_cast<uint32_t>(EventQueueFlagBits::EVENTS_READ),
-                        static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS),
-                        kPendingWriteTimeoutNs, mEventQueueFlag)) {
-                ALOGE("Dropping %zu events after blockingWrite failed (is system_server running?).",
-                      numToWrite);
-                if (numWakeupEvents > 0) {
-                    if (pendingWriteEvents.size() > eventQueueSize) {
-                        decrementRefCountAndMaybeReleaseWakelock(
-                                countNumWakeupEvents(pendingWriteEvents, eventQueueSize));
-                    } else {
-                        decrementRefCountAndMaybeReleaseWakelock(numWakeupEvents);
-                    }
-                }
-            }
-            lock.lock();
-            mSizePendingWriteEventsQueue -= numToWrite;
-            if (pendingWriteEvents.size() > eventQueueSize) {
-                // TODO(b/143302327): Check if this erase operation is too inefficient. It will copy
-                // all the events ahead of it down to fill gap off array at front after the erase.
-                pendingWriteEvents.erase(pendingWriteEvents.begin(),
-                                         pendingWriteEvents.begin() + eventQueueSize);
+        const Event* events;
+        size_t numPending = mPendingWriteEvents.front(&events, mEventQueue->getQuantumCount());
+        if (numPending == 0) {
+            std::unique_lock<std::mutex> lock(mPendingWritesWaitMutex);
+            mPendingWritesThreadWaiting.store(true);
+            mEventQueueWriteCV.wait(lock, [&] {
+                return mPendingWriteEvents.front(&events, 1) > 0 || !mThreadsRun.load();
+            });
+            mPendingWritesThreadWaiting.store(false);
+            continue;
+        }
+
+        size_t numWritten = 0;
+        {
+            // Write straight from the queue into the fmq
+            std::lock_guard<std::mutex> lock(mEventQueueWriteMutex);
+            numWritten = std::min(numPending, mEventQueue->availableToWrite());
+            if (numWritten > 0 && mEventQueue->write(events, numWritten)) {
+                mEventQueueFlag->wake(static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS));
             } else {
-                mPendingWriteEventsQueue.pop();
+                numWritten = 0;
             }
         }
+        if (numWritten > 0) {
+            mNumPendingEventsWritten += numWritten;
+            mPendingWriteEvents.pop(numWritten);
+            blockedSinceNs = -1;
+            continue;
+        }
+
+        // Wait for the framework to make room without holding the lock
+        int64_t now = getTimeNow();
+        if (blockedSinceNs < 0) {
+            blockedSinceNs = now;
+        }
+        int64_t timeLeftNs = kPendingWriteTimeoutNs - (now - blockedSinceNs);
+        uint32_t efState = 0;
+        if (timeLeftNs > 0) {
+            mEventQueueFlag->wait(static_cast<uint32_t>(EventQueueFlagBits::EVENTS_READ), &efState,
+                                  timeLeftNs, true /* retry on spurious wake */);
+            continue;
+        }
+        ALOGE("Dropping %zu events after the event fmq stayed full (is system_server running?).",
+              numPending);
+        mNumEventsDroppedWriteTimeout += numPending;
+        size_t numWakeupEvents = countNumWakeupEvents(events, numPending);
+        if (numWakeupEvents > 0) {
+            decrementRefCountAndMaybeReleaseWakelock(numWakeupEvents);
+        }
+        mPendingWriteEvents.pop(numPending);
+        blockedSinceNs = -1;
     }
 }
 
@@ -662,32 +691,53 @@ void HalProxy::resetSharedWakelock() {
 void HalProxy::postEventsToMessageQueue(const std::vector<Event>& events, size_t numWakeupEvents,
                                         V2_0::implementation::ScopedWakelock wakelock) {
     size_t numToWrite = 0;
-    std::lock_guard<std::mutex> lock(mEventQueueWriteMutex);
     if (wakelock.isLocked()) {
         incrementRefCountAndMaybeAcquireWakelock(numWakeupEvents);
     }
-    if (mPendingWriteEventsQueue.empty()) {
-        numToWrite = std::min(events.size(), mEventQueue->availableToWrite());
-        if (numToWrite > 0) {
-            if (mEventQueue->write(events.data(), numToWrite)) {
-                // TODO(b/143302327): While loop if mEventQueue->avaiableToWrite > 0 to possibly fit
-                // in more writes immediately
-                mEventQueueFlag->wake(static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS));
-            } else {
-                numToWrite = 0;
+    {
+        std::lock_guard<std::mutex> lock(mEventQueueWriteMutex);
+        // Events already waiting go first, queue behind them instead of writing directly
+        if (mPendingWriteEvents.empty()) {
+            numToWrite = std::min(events.size(), mEventQueue->availableToWrite());
+            if (numToWrite > 0) {
+                if (mEventQueue->write(events.data(), numToWrite)) {
+                    mEventQueueFlag->wake(
+                            static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS));
+                } else {
+                    numToWrite = 0;
+                }
             }
         }
     }
     size_t numLeft = events.size() - numToWrite;
-    if (numToWrite < events.size() &&
-        mSizePendingWriteEventsQueue + numLeft <= kMaxSizePendingWriteEventsQueue) {
-        std::vector<Event> eventsLeft(events.begin() + numToWrite, events.end());
-        mPendingWriteEventsQueue.push({eventsLeft, numWakeupEvents});
-        mSizePendingWriteEventsQueue += numLeft;
-        mMostEventsObservedPendingWriteEventsQueue =
-                std::max(mMostEventsObservedPendingWriteEventsQueue, mSizePendingWriteEventsQueue);
+    if (numLeft > 0 && !pushPendingWriteEvents(events.data() + numToWrite, numLeft)) {
+        ALOGW("Dropping %zu events, pending write events queue is full", numLeft);
+        mNumEventsDroppedQueueFull += numLeft;
+        if (wakelock.isLocked()) {
+            size_t numWakeupEventsLeft = numWakeupEvents - countNumWakeupEvents(events.data(),
+                                                                                numToWrite);
+            if (numWakeupEventsLeft > 0) {
+                decrementRefCountAndMaybeReleaseWakelock(numWakeupEventsLeft);
+            }
+        }
+    }
+}
+
+bool HalProxy::pushPendingWriteEvents(const Event* events, size_t n) {
+    if (!mPendingWriteEvents.push(events, n)) {
+        return false;
+    }
+    size_t size = mPendingWriteEvents.size();
+    size_t most = mMostEventsObservedPendingWriteEventsQueue.load();
+    while (size > most && !mMostEventsObservedPendingWriteEventsQueue.compare_exchange_weak(
+                                  most, size)) {
+    }
+    // Only take the lock when the background thread may be about to sleep
+    if (mPendingWritesThreadWaiting.load()) {
+        std::lock_guard<std::mutex> lock(mPendingWritesWaitMutex);
         mEventQueueWriteCV.notify_one();
     }
+    return true;
 }
 
 bool HalProxy::incrementRefCountAndMaybeAcquireWakelock(size_t delta,
@@ -737,19 +787,18 @@ void HalProxy::setDirectChannelFlags(SensorInfo* sensorInfo,
     }
 }
 
-std::shared_ptr<ISubHalWrapperBase> HalProxy::getSubHalForSensorHandle(int32_t sensorHandle) {
-    return mSubHalList[extractSubHalIndex(sensorHandle)];
-}
-
-bool HalProxy::isSubHalIndexValid(int32_t sensorHandle) {
-    return extractSubHalIndex(sensorHandle) < mSubHalList.size();
+ISubHalWrapperBase* HalProxy::getSubHalForSensorHandle(int32_t sensorHandle) {
+    uint32_t entry = mSensorHandleTable.lookup(sensorHandle);
+    if (!SensorHandleTable::isValid(entry)) {
+        return nullptr;
+    }
+    return mSubHalList[SensorHandleTable::getSubHalIndex(entry)].get();
 }
 
-size_t HalProxy::countNumWakeupEvents(const std::vector<Event>& events, size_t n) {
+size_t HalProxy::countNumWakeupEvents(const Event* events, size_t n) {
     size_t numWakeupEvents = 0;
     for (size_t i = 0; i < n; i++) {
-        int32_t sensorHandle = events[i].sensorHandle;
-        if (mSensors[sensorHandle].flags & static_cast<uint32_t>(V1_0::SensorFlagBits::WAKE_UP)) {
+        if (isWakeUpSensor(events[i].sensorHandle)) {
             numWakeupEvents++;
         }
     }
@@ -66,17 +66,17 @@ std::vector<V2_1::Event> HalProxyCallbackBase::processEvents(const std::vector<V
                                                              size_t* numWakeupEvents) const {
     *numWakeupEvents = 0;
     std::vector<V2_1::Event> eventsOut;
+    eventsOut.reserve(events.size());
     for (V2_1::Event event : events) {
         event.sensorHandle = setSubHalIndex(event.sensorHandle, mSubHalIndex);
         if (event.sensorType == V2_1::SensorType::DYNAMIC_SENSOR_META) {
             event.u.dynamic.sensorHandle =
                     setSubHalIndex(event.u.dynamic.sensorHandle, mSubHalIndex);
         }
-        eventsOut.push_back(event);
-        const V2_1::SensorInfo& sensor = mCallback->getSensorInfo(event.sensorHandle);
-        if ((sensor.flags & V1_0::SensorFlagBits::WAKE_UP) != 0) {
+        if (mCallback->isWakeUpSensor(event.sensorHandle)) {
             (*numWakeupEvents)++;
         }
+        eventsOut.push_back(event);
     }
     return eventsOut;
 }
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android/hardware/sensors/2.1/types.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+/**
+ * A fixed size ring of events written by any number of threads and read by a single thread.
+ *
+ * Writers reserve a contiguous range of positions with a compare-and-swap on the tail, copy their
+ * events in and then publish each slot by storing its sequence number. The reader consumes the
+ * published slots in order, so the events of a single push are never interleaved with others and
+ * neither side ever takes a lock.
+ */
+class EventRing {
+  public:
+    explicit EventRing(size_t capacity)
+        : mCapacity(capacity),
+          mEvents(new Event[capacity]),
+          mSequences(new std::atomic<uint64_t>[capacity]()) {}
+
+    size_t capacity() const { return mCapacity; }
+
+    /**
+     * Number of events pushed and not yet popped, including the ones still being copied in.
+     */
+    size_t size() const {
+        return static_cast<size_t>(mTail.load(std::memory_order_acquire) -
+                                   mHead.load(std::memory_order_acquire));
+    }
+
+    bool empty() const { return size() == 0; }
+
+    /**
+     * Copies count events into the ring. Can be called from any thread.
+     *
+     * @return false, leaving the ring unchanged, if there is no room for all of the events.
+     */
+    bool push(const Event* events, size_t count) {
+        uint64_t tail = mTail.load(std::memory_order_relaxed);
+        do {
+            // tail may be stale and already behind the head, so the positions are compared
+            // rather than subtracted. A stale tail then fails the exchange below and is reloaded.
+            if (tail + count > mHead.load(std::memory_order_acquire) + mCapacity) {
+                return false;
+            }
+        } while (!mTail.compare_exchange_weak(tail, tail + count, std::memory_order_acq_rel,
+                                              std::memory_order_relaxed));
+
+        for (size_t i = 0; i < count; i++) {
+            size_t slot = (tail + i) % mCapacity;
+            mEvents[slot] = events[i];
+            // A slot is published for position p once its sequence is p + 1
+            mSequences[slot].store(tail + i + 1, std::memory_order_seq_cst);
+        }
+        return true;
+    }
+
+    /**
+     * Finds the published events at the front of the ring that are contiguous in memory. Only
+     * called by the reader.
+     *
+     * @param events Set to the first event if any are available.
+     * @param maxCount The most events to return.
+     *
+     * @return The number of events available at *events, which stay valid until popped.
+     */
+    size_t front(const Event** events, size_t maxCount) const {
+        uint64_t head = mHead.load(std::memory_order_relaxed);
+        size_t slot = head % mCapacity;
+        size_t count = 0;
+        size_t limit = std::min(maxCount, mCapacity - slot);
+        while (count < limit &&
+               mSequences[slot + count].load(std::memory_order_seq_cst) == head + count + 1) {
+            count++;
+        }
+        *events = &mEvents[slot];
+        return count;
+    }
+
+    /**
+     * Releases the first count events returned by front() so writers can reuse their slots.
+     */
+    void pop(size_t count) { mHead.fetch_add(count, std::memory_order_release); }
+
+    /**
+     * Discards all events. Only safe to call when no other thread is using the ring.
+     */
+    void clear() { mHead.store(mTail.load(std::memory_order_acquire), std::memory_order_release); }
+
+  private:
+    const size_t mCapacity;
+    std::unique_ptr<Event[]> mEvents;
+    std::unique_ptr<std::atomic<uint64_t>[]> mSequences;
+
+    //! Position of the next event to read
+    std::atomic<uint64_t> mHead = 0;
+
+    //! Position of the next slot to reserve
+    std::atomic<uint64_t> mTail = 0;
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -17,8 +17,10 @@
 #pragma once
 
 #include "EventMessageQueueWrapper.h"
+#include "EventRing.h"
 #include "HalProxyCallback.h"
 #include "ISensorsCallbackWrapper.h"
+#include "SensorHandleTable.h"
 #include "SubHalWrapper.h"
 #include "V2_0/ScopedWakelock.h"
 #include "V2_0/SubHal.h"
@@ -37,7 +39,6 @@
 #include <condition_variable>
 #include <map>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <utility>
 
@@ -129,8 +130,8 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
     void postEventsToMessageQueue(const std::vector<Event>& events, size_t numWakeupEvents,
                                   V2_0::implementation::ScopedWakelock wakelock) override;
 
-    const SensorInfo& getSensorInfo(int32_t sensorHandle) override {
-        return mSensors[sensorHandle];
+    bool isWakeUpSensor(int32_t sensorHandle) const override {
+        return SensorHandleTable::isWakeUp(mSensorHandleTable.lookup(sensorHandle));
     }
 
     bool areThreadsRunning() override { return mThreadsRun.load(); }
@@ -189,6 +190,12 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
     //! Map of the dynamic sensors that have been added to halproxy.
     std::map<int32_t, SensorInfo> mDynamicSensors;
 
+    /**
+     * The subhal index and flags of every sensor in mSensors and mDynamicSensors, looked up on
+     * the event path and by calls taking a sensor handle instead of the maps.
+     */
+    SensorHandleTable mSensorHandleTable;
+
     //! The current operation mode for all subhals.
     OperationMode mCurrentOperationMode = OperationMode::NORMAL;
 
@@ -201,27 +208,37 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
     //! The bit mask used to get the subhal index from a sensor handle.
     static constexpr int32_t kSensorHandleSubHalIndexMask = 0xFF000000;
 
+    //! The max number of events allowed in the pending write events queue
+    static constexpr size_t kMaxSizePendingWriteEventsQueue = 100000;
+
     /**
-     * A FIFO queue of pairs of vector of events and the number of wakeup events in that vector
-     * which are waiting to be written to the events fmq in the background thread.
+     * The events that did not fit in the event fmq when they were posted, waiting to be written
+     * by the background thread. Subhal callbacks add to it without taking a lock.
      */
-    std::queue<std::pair<std::vector<Event>, size_t>> mPendingWriteEventsQueue;
+    EventRing mPendingWriteEvents{kMaxSizePendingWriteEventsQueue};
 
     //! The most events observed on the pending write events queue for debug purposes.
-    size_t mMostEventsObservedPendingWriteEventsQueue = 0;
+    std::atomic<size_t> mMostEventsObservedPendingWriteEventsQueue = 0;
 
-    //! The max number of events allowed in the pending write events queue
-    static constexpr size_t kMaxSizePendingWriteEventsQueue = 100000;
+    //! The number of events dropped because the pending write events queue was full.
+    std::atomic<uint64_t> mNumEventsDroppedQueueFull = 0;
 
-    //! The number of events in the pending write events queue
-    size_t mSizePendingWriteEventsQueue = 0;
+    //! The number of events dropped because the framework did not read the event fmq in time.
+    std::atomic<uint64_t> mNumEventsDroppedWriteTimeout = 0;
 
-    //! The mutex protecting writing to the fmq and the pending events queue
+    //! The number of events written by the background thread.
+    std::atomic<uint64_t> mNumPendingEventsWritten = 0;
+
+    //! The mutex serializing writes to the event fmq
     std::mutex mEventQueueWriteMutex;
 
-    //! The condition variable waiting on pending write events to stack up
+    //! The mutex and condition variable the background thread waits on for pending write events
+    std::mutex mPendingWritesWaitMutex;
     std::condition_variable mEventQueueWriteCV;
 
+    //! Whether the background thread is waiting for pending write events
+    std::atomic_bool mPendingWritesThreadWaiting = false;
+
     //! The thread object ptr that handles pending writes
     std::thread mPendingWritesThread;
 
@@ -340,31 +357,30 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
     void setDirectChannelFlags(SensorInfo* sensorInfo, std::shared_ptr<ISubHalWrapperBase> subHal);
 
     /*
-     * Get the subhal pointer which can be found by indexing into the mSubHalList vector
-     * using the index from the first byte of sensorHandle.
+     * Get the subhal owning the sensor with sensorHandle from the sensor handle table.
      *
      * @param sensorHandle The handle used to identify a sensor in one of the subhals.
+     *
+     * @return The subhal, or nullptr if no subhal has a sensor with that handle.
      */
-    std::shared_ptr<ISubHalWrapperBase> getSubHalForSensorHandle(int32_t sensorHandle);
+    ISubHalWrapperBase* getSubHalForSensorHandle(int32_t sensorHandle);
 
     /**
-     * Checks that sensorHandle's subhal index byte is within bounds of mSubHalList.
+     * Count the number of wakeup events in the first n events of the array.
      *
-     * @param sensorHandle The sensor handle to check.
+     * @param events The array of Event objects.
+     * @param n The end index not inclusive of events to consider.
      *
-     * @return true if sensorHandles's subhal index byte is valid.
+     * @return The number of wakeup events of the considered events.
      */
-    bool isSubHalIndexValid(int32_t sensorHandle);
+    size_t countNumWakeupEvents(const Event* events, size_t n);
 
     /**
-     * Count the number of wakeup events in the first n events of the vector.
-     *
-     * @param events The vector of Event objects.
-     * @param n The end index not inclusive of events to consider.
+     * Add events to the pending write events queue and wake the background thread.
      *
-     * @return The number of wakeup events of the considered events.
+     * @return false if the queue did not have room for the events.
      */
-    size_t countNumWakeupEvents(const std::vector<Event>& events, size_t n);
+    bool pushPendingWriteEvents(const Event* events, size_t n);
 
     /*
      * Clear out the subhal index bytes from a sensorHandle.
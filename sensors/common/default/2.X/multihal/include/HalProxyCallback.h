@@ -63,13 +63,13 @@ class ISubHalCallback {
                                           V2_0::implementation::ScopedWakelock wakelock) = 0;
 
     /**
-     * Get the sensor info associated with that sensorHandle.
+     * Check whether the sensor with that sensorHandle is a wake up sensor.
      *
      * @param sensorHandle The sensor handle.
      *
-     * @return The sensor info object in the mapping.
+     * @return true if the sensor is known and is a wake up sensor.
      */
-    virtual const V2_1::SensorInfo& getSensorInfo(int32_t sensorHandle) = 0;
+    virtual bool isWakeUpSensor(int32_t sensorHandle) const = 0;
 
     virtual bool areThreadsRunning() = 0;
 };
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+/**
+ * Maps the sensor handles given to the framework to a packed entry holding the index of the
+ * subhal owning the sensor and the flags needed on the hot paths.
+ *
+ * Sensor handles carry the subhal index in their first byte and subhals number their sensors from
+ * small integers, so the entries live in one flat array indexed by subhal index and the remaining
+ * bytes of the handle. The rare handles that do not fit in the array are kept in a map instead.
+ * Lookups of handles in the array never take a lock, so they are safe to do from the subhal
+ * callbacks while dynamic sensors are added or removed. Calls that modify the table must be
+ * serialized by the caller.
+ */
+class SensorHandleTable {
+  public:
+    //! The number of sensor handles of each subhal kept in the flat array.
+    static constexpr size_t kDenseHandlesPerSubHal = 256;
+
+    static constexpr uint32_t kSubHalIndexMask = 0xFF;
+    static constexpr uint32_t kFlagValid = 1 << 8;
+    static constexpr uint32_t kFlagWakeUp = 1 << 9;
+    static constexpr uint32_t kFlagDynamic = 1 << 10;
+
+    static bool isValid(uint32_t entry) { return (entry & kFlagValid) != 0; }
+    static bool isWakeUp(uint32_t entry) { return (entry & kFlagWakeUp) != 0; }
+    static size_t getSubHalIndex(uint32_t entry) { return entry & kSubHalIndexMask; }
+
+    /**
+     * Removes all the sensors and sizes the table for numSubHals subhals. Only safe to call when
+     * no other thread is using the table.
+     */
+    void reset(size_t numSubHals) {
+        mNumSubHals = numSubHals;
+        mEntries.reset(new std::atomic<uint32_t>[numSubHals * kDenseHandlesPerSubHal]());
+        std::lock_guard<std::mutex> lock(mOverflowMutex);
+        mOverflowEntries.clear();
+        mNumSensors = 0;
+    }
+
+    /**
+     * Adds or replaces the entry of a sensor.
+     *
+     * @param sensorHandle The sensor handle with the subhal index set.
+     * @param wakeUp Whether the sensor is a wake up sensor.
+     * @param dynamic Whether the sensor is a dynamic sensor.
+     *
+     * @return false if the subhal index of the sensor handle is out of range.
+     */
+    bool add(int32_t sensorHandle, bool wakeUp, bool dynamic) {
+        size_t subHalIndex = extractSubHalIndex(sensorHandle);
+        if (subHalIndex >= mNumSubHals) {
+            return false;
+        }
+        uint32_t entry = static_cast<uint32_t>(subHalIndex) | kFlagValid |
+                         (wakeUp ? kFlagWakeUp : 0) | (dynamic ? kFlagDynamic : 0);
+        std::atomic<uint32_t>* slot = getDenseSlot(subHalIndex, sensorHandle);
+        if (slot != nullptr) {
+            if (!isValid(slot->exchange(entry, std::memory_order_release))) {
+                mNumSensors++;
+            }
+            return true;
+        }
+        std::lock_guard<std::mutex> lock(mOverflowMutex);
+        if (mOverflowEntries.insert_or_assign(sensorHandle, entry).second) {
+            mNumSensors++;
+        }
+        return true;
+    }
+
+    /**
+     * Removes the entry of a sensor, if there is one.
+     */
+    void remove(int32_t sensorHandle) {
+        size_t subHalIndex = extractSubHalIndex(sensorHandle);
+        if (subHalIndex >= mNumSubHals) {
+            return;
+        }
+        std::atomic<uint32_t>* slot = getDenseSlot(subHalIndex, sensorHandle);
+        if (slot != nullptr) {
+            if (isValid(slot->exchange(0, std::memory_order_release))) {
+                mNumSensors--;
+            }
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mOverflowMutex);
+        mNumSensors -= mOverflowEntries.erase(sensorHandle);
+    }
+
+    /**
+     * Removes the entries of all the dynamic sensors.
+     */
+    void removeDynamicSensors() {
+        for (size_t i = 0; i < mNumSubHals * kDenseHandlesPerSubHal; i++) {
+            if ((mEntries[i].load(std::memory_order_relaxed) & kFlagDynamic) != 0) {
+                mEntries[i].store(0, std::memory_order_release);
+                mNumSensors--;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mOverflowMutex);
+        for (auto iter = mOverflowEntries.begin(); iter != mOverflowEntries.end();) {
+            if ((iter->second & kFlagDynamic) != 0) {
+                iter = mOverflowEntries.erase(iter);
+                mNumSensors--;
+            } else {
+                iter++;
+            }
+        }
+    }
+
+    /**
+     * @return The entry of the sensor, which is not valid if the sensor is unknown.
+     */
+    uint32_t lookup(int32_t sensorHandle) const {
+        size_t subHalIndex = extractSubHalIndex(sensorHandle);
+        if (subHalIndex >= mNumSubHals) {
+            return 0;
+        }
+        const std::atomic<uint32_t>* slot = getDenseSlot(subHalIndex, sensorHandle);
+        if (slot != nullptr) {
+            return slot->load(std::memory_order_acquire);
+        }
+        std::lock_guard<std::mutex> lock(mOverflowMutex);
+        auto iter = mOverflowEntries.find(sensorHandle);
+        return iter != mOverflowEntries.end() ? iter->second : 0;
+    }
+
+    //! The number of sensors in the table.
+    size_t size() const { return mNumSensors.load(); }
+
+    //! The number of sensors that did not fit in the flat array.
+    size_t overflowSize() const {
+        std::lock_guard<std::mutex> lock(mOverflowMutex);
+        return mOverflowEntries.size();
+    }
+
+  private:
+    static constexpr int32_t kBitsAfterSubHalIndex = 24;
+    static constexpr uint32_t kLocalHandleMask = (1 << kBitsAfterSubHalIndex) - 1;
+
+    static size_t extractSubHalIndex(int32_t sensorHandle) {
+        return static_cast<uint32_t>(sensorHandle) >> kBitsAfterSubHalIndex;
+    }
+
+    std::atomic<uint32_t>* getDenseSlot(size_t subHalIndex, int32_t sensorHandle) const {
+        size_t localHandle = static_cast<uint32_t>(sensorHandle) & kLocalHandleMask;
+        if (localHandle >= kDenseHandlesPerSubHal) {
+            return nullptr;
+        }
+        return &mEntries[subHalIndex * kDenseHandlesPerSubHal + localHandle];
+    }
+
+    size_t mNumSubHals = 0;
+
+    //! The entries of the sensors whose handles fit in the flat array, zero when unused.
+    std::unique_ptr<std::atomic<uint32_t>[]> mEntries;
+
+    //! The entries of the remaining sensors.
+    std::map<int32_t, uint32_t> mOverflowEntries;
+    mutable std::mutex mOverflowMutex;
+
+    std::atomic<size_t> mNumSensors = 0;
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
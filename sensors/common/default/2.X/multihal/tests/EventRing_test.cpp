@@ -0,0 +1,202 @@
+//
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "EventRing.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+namespace {
+
+std::vector<Event> makeEvents(size_t count, int64_t firstTimestamp) {
+    std::vector<Event> events(count);
+    for (size_t i = 0; i < count; i++) {
+        events[i].timestamp = firstTimestamp + i;
+    }
+    return events;
+}
+
+// Pops every published event, checking they are contiguous across the ring wrap
+std::vector<int64_t> drain(EventRing& ring) {
+    std::vector<int64_t> timestamps;
+    const Event* events;
+    size_t count;
+    while ((count = ring.front(&events, ring.capacity())) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            timestamps.push_back(events[i].timestamp);
+        }
+        ring.pop(count);
+    }
+    return timestamps;
+}
+
+}  // namespace
+
+TEST(EventRingTest, PushAndPop) {
+    EventRing ring(8);
+    EXPECT_TRUE(ring.empty());
+
+    std::vector<Event> events = makeEvents(3, 100);
+    EXPECT_TRUE(ring.push(events.data(), events.size()));
+    EXPECT_EQ(ring.size(), 3);
+
+    EXPECT_EQ(drain(ring), (std::vector<int64_t>{100, 101, 102}));
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(EventRingTest, FrontStopsAtEndOfRing) {
+    EventRing ring(4);
+    std::vector<Event> events = makeEvents(3, 0);
+    ASSERT_TRUE(ring.push(events.data(), events.size()));
+    EXPECT_EQ(drain(ring).size(), 3);
+
+    // Wraps around the end of the ring
+    events = makeEvents(3, 10);
+    ASSERT_TRUE(ring.push(events.data(), events.size()));
+    const Event* front;
+    EXPECT_EQ(ring.front(&front, 4), 1);
+    EXPECT_EQ(front[0].timestamp, 10);
+    ring.pop(1);
+    EXPECT_EQ(ring.front(&front, 4), 2);
+    EXPECT_EQ(front[0].timestamp, 11);
+    EXPECT_EQ(front[1].timestamp, 12);
+}
+
+TEST(EventRingTest, FrontHonorsMaxCount) {
+    EventRing ring(8);
+    std::vector<Event> events = makeEvents(6, 0);
+    ASSERT_TRUE(ring.push(events.data(), events.size()));
+
+    const Event* front;
+    EXPECT_EQ(ring.front(&front, 4), 4);
+}
+
+TEST(EventRingTest, RejectsPushWhenFull) {
+    EventRing ring(4);
+    std::vector<Event> events = makeEvents(3, 0);
+    ASSERT_TRUE(ring.push(events.data(), events.size()));
+
+    // Does not fit, and leaves the ring unchanged
+    EXPECT_FALSE(ring.push(events.data(), 2));
+    EXPECT_EQ(ring.size(), 3);
+
+    EXPECT_TRUE(ring.push(events.data(), 1));
+    EXPECT_EQ(ring.size(), 4);
+}
+
+TEST(EventRingTest, Clear) {
+    EventRing ring(4);
+    std::vector<Event> events = makeEvents(3, 0);
+    ASSERT_TRUE(ring.push(events.data(), events.size()));
+
+    ring.clear();
+    EXPECT_TRUE(ring.empty());
+    EXPECT_TRUE(drain(ring).empty());
+}
+
+TEST(EventRingTest, ConcurrentPushesAreNotInterleaved) {
+    constexpr size_t kNumThreads = 4;
+    constexpr size_t kNumPushes = 1000;
+    constexpr size_t kEventsPerPush = 5;
+    EventRing ring(kNumThreads * kNumPushes * kEventsPerPush);
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kNumThreads; t++) {
+        threads.emplace_back([&ring, t] {
+            for (size_t i = 0; i < kNumPushes; i++) {
+                std::vector<Event> events =
+                        makeEvents(kEventsPerPush, (t * kNumPushes + i) * kEventsPerPush);
+                ASSERT_TRUE(ring.push(events.data(), events.size()));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<int64_t> timestamps = drain(ring);
+    ASSERT_EQ(timestamps.size(), kNumThreads * kNumPushes * kEventsPerPush);
+    for (size_t i = 0; i < timestamps.size(); i += kEventsPerPush) {
+        EXPECT_EQ(timestamps[i] % kEventsPerPush, 0);
+        for (size_t j = 1; j < kEventsPerPush; j++) {
+            EXPECT_EQ(timestamps[i + j], timestamps[i] + j);
+        }
+    }
+}
+
+TEST(EventRingTest, ConcurrentPushesBelowCapacityNeverFail) {
+    constexpr size_t kNumThreads = 4;
+    constexpr size_t kNumPushes = 10000;
+    constexpr size_t kCapacity = 8;
+    EventRing ring(kCapacity);
+
+    // Writers take a credit before each push and the reader returns it after popping, so the ring
+    // never holds more than its capacity and every push has room.
+    std::atomic<int64_t> credits = kCapacity;
+    std::atomic<size_t> failedPushes = 0;
+    std::atomic<size_t> runningWriters = kNumThreads;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kNumThreads; t++) {
+        threads.emplace_back([&] {
+            std::vector<Event> events = makeEvents(1, 0);
+            for (size_t i = 0; i < kNumPushes; i++) {
+                int64_t available = credits.load();
+                while (available == 0 || !credits.compare_exchange_weak(available, available - 1)) {
+                    std::this_thread::yield();
+                    available = credits.load();
+                }
+                if (!ring.push(events.data(), events.size())) {
+                    failedPushes++;
+                    credits++;
+                }
+            }
+            runningWriters--;
+        });
+    }
+
+    size_t popped = 0;
+    while (runningWriters > 0 || !ring.empty()) {
+        const Event* events;
+        size_t count = ring.front(&events, kCapacity);
+        if (count == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        ring.pop(count);
+        credits += count;
+        popped += count;
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(failedPushes, 0);
+    EXPECT_EQ(popped, kNumThreads * kNumPushes);
+}
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
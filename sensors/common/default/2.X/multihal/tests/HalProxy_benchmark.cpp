@@ -0,0 +1,119 @@
+//
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <benchmark/benchmark.h>
+
+#include <android/hardware/sensors/2.1/types.h>
+#include <fmq/MessageQueue.h>
+
+#include "HalProxy.h"
+#include "SensorsSubHal.h"
+
+#include <memory>
+#include <vector>
+
+namespace {
+
+using ::android::hardware::EventFlag;
+using ::android::hardware::hidl_vec;
+using ::android::hardware::MessageQueue;
+using ::android::hardware::Return;
+using ::android::hardware::sensors::V1_0::SensorInfo;
+using ::android::hardware::sensors::V2_0::WakeLockQueueFlagBits;
+using ::android::hardware::sensors::V2_1::implementation::HalProxy;
+using ::android::hardware::sensors::V2_1::subhal::implementation::AllSensorsSubHal;
+using ::android::hardware::sensors::V2_1::subhal::implementation::SensorsSubHalV2_0;
+
+using ISensorsCallbackV2_0 = ::android::hardware::sensors::V2_0::ISensorsCallback;
+using EventV1_0 = ::android::hardware::sensors::V1_0::Event;
+using EventV2_1 = ::android::hardware::sensors::V2_1::Event;
+using SensorTypeV2_1 = ::android::hardware::sensors::V2_1::SensorType;
+using EventMessageQueueV2_0 = MessageQueue<EventV1_0, ::android::hardware::kSynchronizedReadWrite>;
+using WakeupMessageQueue = MessageQueue<uint32_t, ::android::hardware::kSynchronizedReadWrite>;
+
+// The sensor handles AllSensorsSubHal gives to a non wake up and a wake up sensor
+constexpr int32_t kAccelerometerHandle = 0x00000001;
+constexpr int32_t kProximityHandle = 0x00000008;
+
+constexpr size_t kQueueSize = 1024;
+
+class SensorsCallback : public ISensorsCallbackV2_0 {
+  public:
+    Return<void> onDynamicSensorsConnected(
+            const hidl_vec<SensorInfo>& /*dynamicSensorsAdded*/) override {
+        return Return<void>();
+    }
+
+    Return<void> onDynamicSensorsDisconnected(
+            const hidl_vec<int32_t>& /*dynamicSensorHandlesRemoved*/) override {
+        return Return<void>();
+    }
+};
+
+std::vector<EventV2_1> makeEvents(size_t numEvents, size_t numWakeupEvents) {
+    std::vector<EventV2_1> events(numEvents);
+    for (size_t i = 0; i < numEvents; i++) {
+        bool wakeup = i < numWakeupEvents;
+        events[i].timestamp = i;
+        events[i].sensorHandle = wakeup ? kProximityHandle : kAccelerometerHandle;
+        events[i].sensorType = wakeup ? SensorTypeV2_1::PROXIMITY : SensorTypeV2_1::ACCELEROMETER;
+    }
+    return events;
+}
+
+// Measures the events per second posted by a subhal through HalProxyCallback::postEvents and
+// written to the event FMQ. Arguments are the events per post and how many of them are wake up.
+void BM_PostEvents(benchmark::State& state) {
+    size_t numEvents = state.range(0);
+    size_t numWakeupEvents = state.range(1);
+
+    AllSensorsSubHal<SensorsSubHalV2_0> subHal;
+    std::vector<ISensorsSubHal*> subHals{&subHal};
+    HalProxy proxy(subHals);
+    auto eventQueue = std::make_unique<EventMessageQueueV2_0>(kQueueSize, true);
+    auto wakeLockQueue = std::make_unique<WakeupMessageQueue>(kQueueSize, true);
+    ::android::sp<ISensorsCallbackV2_0> callback = new SensorsCallback();
+    proxy.initialize(*eventQueue->getDesc(), *wakeLockQueue->getDesc(), callback);
+
+    EventFlag* wakelockQueueFlag;
+    EventFlag::createEventFlag(wakeLockQueue->getEventFlagWord(), &wakelockQueueFlag);
+
+    std::vector<EventV2_1> events = makeEvents(numEvents, numWakeupEvents);
+    std::vector<EventV1_0> eventsRead(numEvents);
+    uint32_t numWakeupEventsUInt32 = static_cast<uint32_t>(numWakeupEvents);
+    for (auto _ : state) {
+        subHal.postEvents(events, numWakeupEvents > 0 /* wakeup */);
+        eventQueue->read(eventsRead.data(), eventQueue->availableToRead());
+        if (numWakeupEvents > 0) {
+            wakeLockQueue->write(&numWakeupEventsUInt32);
+            wakelockQueueFlag->wake(static_cast<uint32_t>(WakeLockQueueFlagBits::DATA_WRITTEN));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * numEvents);
+
+    EventFlag::deleteEventFlag(&wakelockQueueFlag);
+}
+
+BENCHMARK(BM_PostEvents)
+        ->ArgNames({"events", "wakeup"})
+        ->Args({1, 0})
+        ->Args({16, 0})
+        ->Args({128, 0})
+        ->Args({16, 4})
+        ->Args({128, 32});
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,107 @@
+//
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "SensorHandleTable.h"
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+namespace {
+
+int32_t makeHandle(int32_t subHalIndex, int32_t localHandle) {
+    return (subHalIndex << 24) | localHandle;
+}
+
+}  // namespace
+
+TEST(SensorHandleTableTest, LookupUnknownHandle) {
+    SensorHandleTable table;
+    table.reset(2);
+    EXPECT_FALSE(SensorHandleTable::isValid(table.lookup(makeHandle(0, 1))));
+    EXPECT_FALSE(SensorHandleTable::isValid(table.lookup(makeHandle(2, 1))));
+    EXPECT_FALSE(SensorHandleTable::isValid(table.lookup(-1)));
+    EXPECT_EQ(table.size(), 0);
+}
+
+TEST(SensorHandleTableTest, AddAndLookup) {
+    SensorHandleTable table;
+    table.reset(2);
+    EXPECT_TRUE(table.add(makeHandle(0, 1), false /* wakeUp */, false /* dynamic */));
+    EXPECT_TRUE(table.add(makeHandle(1, 1), true /* wakeUp */, false /* dynamic */));
+    EXPECT_FALSE(table.add(makeHandle(2, 1), false /* wakeUp */, false /* dynamic */));
+    EXPECT_EQ(table.size(), 2);
+
+    uint32_t entry = table.lookup(makeHandle(0, 1));
+    EXPECT_TRUE(SensorHandleTable::isValid(entry));
+    EXPECT_FALSE(SensorHandleTable::isWakeUp(entry));
+    EXPECT_EQ(SensorHandleTable::getSubHalIndex(entry), 0);
+
+    entry = table.lookup(makeHandle(1, 1));
+    EXPECT_TRUE(SensorHandleTable::isValid(entry));
+    EXPECT_TRUE(SensorHandleTable::isWakeUp(entry));
+    EXPECT_EQ(SensorHandleTable::getSubHalIndex(entry), 1);
+}
+
+TEST(SensorHandleTableTest, HandlesOutsideFlatArray) {
+    SensorHandleTable table;
+    table.reset(1);
+    int32_t handle = makeHandle(0, SensorHandleTable::kDenseHandlesPerSubHal + 5);
+    EXPECT_TRUE(table.add(handle, true /* wakeUp */, false /* dynamic */));
+    EXPECT_EQ(table.overflowSize(), 1);
+    EXPECT_TRUE(SensorHandleTable::isWakeUp(table.lookup(handle)));
+
+    table.remove(handle);
+    EXPECT_FALSE(SensorHandleTable::isValid(table.lookup(handle)));
+    EXPECT_EQ(table.size(), 0);
+}
+
+TEST(SensorHandleTableTest, RemoveDynamicSensors) {
+    SensorHandleTable table;
+    table.reset(1);
+    int32_t staticHandle = makeHandle(0, 1);
+    int32_t dynamicHandle = makeHandle(0, 2);
+    int32_t dynamicOverflowHandle = makeHandle(0, 0x10000);
+    table.add(staticHandle, false /* wakeUp */, false /* dynamic */);
+    table.add(dynamicHandle, false /* wakeUp */, true /* dynamic */);
+    table.add(dynamicOverflowHandle, false /* wakeUp */, true /* dynamic */);
+    EXPECT_EQ(table.size(), 3);
+
+    table.removeDynamicSensors();
+    EXPECT_EQ(table.size(), 1);
+    EXPECT_TRUE(SensorHandleTable::isValid(table.lookup(staticHandle)));
+    EXPECT_FALSE(SensorHandleTable::isValid(table.lookup(dynamicHandle)));
+    EXPECT_FALSE(SensorHandleTable::isValid(table.lookup(dynamicOverflowHandle)));
+}
+
+TEST(SensorHandleTableTest, ReplaceEntry) {
+    SensorHandleTable table;
+    table.reset(1);
+    int32_t handle = makeHandle(0, 3);
+    table.add(handle, false /* wakeUp */, true /* dynamic */);
+    table.add(handle, true /* wakeUp */, true /* dynamic */);
+    EXPECT_EQ(table.size(), 1);
+    EXPECT_TRUE(SensorHandleTable::isWakeUp(table.lookup(handle)));
+}
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -283,7 +283,10 @@ void Demux::frontendIptvInputThreadLoop(dtv_plugin* interface, dtv_streamer* str
                 static_cast<int32_t>(Result::UNKNOWN_ERROR));
     }
 
-    mFilters[filterId] = filter;
+    {
+        std::lock_guard<std::mutex> lock(mPidIndexLock);
+        mFilters[filterId] = filter;
+    }
     if (filter->isPcrFilter()) {
         mPcrFilterIds.insert(filterId);
     }
@@ -380,7 +383,15 @@ void Demux::frontendIptvInputThreadLoop(dtv_plugin* interface, dtv_streamer* str
     }
     mPlaybackFilterIds.clear();
     mRecordFilterIds.clear();
-    mFilters.clear();
+    // The filters are released outside the lock, as a filter being destroyed removes itself
+    map<int64_t, std::shared_ptr<Filter>> filters;
+    {
+        std::lock_guard<std::mutex> lock(mPidIndexLock);
+        mStartedFilterIds.clear();
+        mPidIndex = nullptr;
+        filters.swap(mFilters);
+    }
+    filters.clear();
     mLastUsedFilterId = -1;
     if (mTuner != nullptr) {
         mTuner->removeDemux(mDemuxId);
@@ -412,36 +423,107 @@ void Demux::frontendIptvInputThreadLoop(dtv_plugin* interface, dtv_streamer* str
     }
     mPlaybackFilterIds.erase(filterId);
     mRecordFilterIds.erase(filterId);
-    mFilters.erase(filterId);
+    // The filter is released outside the lock, as a filter being destroyed removes itself
+    std::shared_ptr<Filter> filter;
+    {
+        std::lock_guard<std::mutex> lock(mPidIndexLock);
+        map<int64_t, std::shared_ptr<Filter>>::iterator it = mFilters.find(filterId);
+        if (it != mFilters.end()) {
+            filter = std::move(it->second);
+            mFilters.erase(it);
+        }
+        if (mStartedFilterIds.erase(filterId) > 0) {
+            rebuildPidIndexLocked();
+        }
+    }
 
     return ::ndk::ScopedAStatus::ok();
 }
 
-void Demux::startBroadcastTsFilter(vector<int8_t> data) {
-    set<int64_t>::iterator it;
-    uint16_t pid = ((data[1] & 0x1f) << 8) | ((data[2] & 0xff));
-    if (DEBUG_DEMUX) {
-        ALOGW("[Demux] start ts filter pid: %d", pid);
+void Demux::startBroadcastTsFilter(const int8_t* data, size_t numPackets, size_t packetSize) {
+    std::shared_ptr<const PidIndex> index = getPidIndex();
+    if (index == nullptr || index->filterLists.size() <= 1) {
+        return;
     }
-    for (it = mPlaybackFilterIds.begin(); it != mPlaybackFilterIds.end(); it++) {
-        if (pid == mFilters[*it]->getTpid()) {
-            mFilters[*it]->updateFilterOutput(data);
+
+    std::lock_guard<std::mutex> lock(mPidBatchesLock);
+    if (mPidBatches.size() < index->filterLists.size()) {
+        mPidBatches.resize(index->filterLists.size());
+    }
+    for (size_t i = 0; i < numPackets; i++) {
+        const int8_t* packet = data + i * packetSize;
+        uint16_t pid = ((packet[1] & 0x1f) << 8) | ((packet[2] & 0xff));
+        if (DEBUG_DEMUX) {
+            ALOGW("[Demux] start ts filter pid: %d", pid);
+        }
+        uint16_t slot = index->slots[pid];
+        if (slot != 0) {
+            mPidBatches[slot].push_back(static_cast<uint32_t>(i * packetSize));
+        }
+    }
+    for (size_t slot = 1; slot < index->filterLists.size(); slot++) {
+        vector<uint32_t>& batch = mPidBatches[slot];
+        if (batch.empty()) {
+            continue;
         }
+        for (const std::shared_ptr<Filter>& filter : index->filterLists[slot]) {
+            filter->updateFilterOutput(data, batch, packetSize);
+        }
+        batch.clear();
+    }
+}
+
+void Demux::setFilterStarted(int64_t filterId, bool started) {
+    std::lock_guard<std::mutex> lock(mPidIndexLock);
+    bool changed = started ? mStartedFilterIds.insert(filterId).second
+                           : mStartedFilterIds.erase(filterId) > 0;
+    // A running filter may also be reconfigured to another PID
+    if (changed || started) {
+        rebuildPidIndexLocked();
+    }
+}
+
+void Demux::rebuildPidIndexLocked() {
+    // Unlike the routing over mPlaybackFilterIds this replaces, stopped filters are left out, so
+    // they no longer stage input that a later start would deliver as stale events. Non-TS filters
+    // are left out as they have no TS PID, and record filters get their input from
+    // sendFrontendInputToRecord.
+    std::shared_ptr<PidIndex> index = std::make_shared<PidIndex>();
+    // Slot 0 marks the PIDs without any filter
+    index->filterLists.emplace_back();
+    for (int64_t filterId : mStartedFilterIds) {
+        map<int64_t, std::shared_ptr<Filter>>::iterator it = mFilters.find(filterId);
+        if (it == mFilters.end() || !it->second->isTsFilter() || it->second->isRecordFilter()) {
+            continue;
+        }
+        uint16_t& slot = index->slots[it->second->getTpid() & (TS_PID_COUNT - 1)];
+        if (slot == 0) {
+            slot = index->filterLists.size();
+            index->filterLists.emplace_back();
+        }
+        index->filterLists[slot].push_back(it->second);
     }
+    mPidIndex = std::move(index);
 }
 
-void Demux::sendFrontendInputToRecord(vector<int8_t> data) {
+std::shared_ptr<const Demux::PidIndex> Demux::getPidIndex() {
+    std::lock_guard<std::mutex> lock(mPidIndexLock);
+    return mPidIndex;
+}
+
+void Demux::sendFrontendInputToRecord(const int8_t* data, size_t size) {
     set<int64_t>::iterator it;
     if (DEBUG_DEMUX) {
         ALOGW("[Demux] update record filter output");
     }
     for (it = mRecordFilterIds.begin(); it != mRecordFilterIds.end(); it++) {
-        mFilters[*it]->updateRecordOutput(data);
+        mFilters[*it]->updateRecordOutput(data, size);
     }
 }
 
-void Demux::sendFrontendInputToRecord(vector<int8_t> data, uint16_t pid, uint64_t pts) {
-    sendFrontendInputToRecord(data);
+void Demux::sendFrontendInputToRecord(const int8_t* data, size_t size, uint16_t pid,
+                                      uint64_t pts) {
+    sendFrontendInputToRecord(data, size);
     set<int64_t>::iterator it;
     for (it = mRecordFilterIds.begin(); it != mRecordFilterIds.end(); it++) {
         if (pid == mFilters[*it]->getTpid()) {
@@ -479,15 +561,6 @@ bool Demux::startRecordFilterDispatcher() {
     return mFilters[filterId]->startFilterHandler();
 }
 
-void Demux::updateFilterOutput(int64_t filterId, vector<int8_t> data) {
-    mFilters[filterId]->updateFilterOutput(data);
-}
-
-void Demux::updateMediaFilterOutput(int64_t filterId, vector<int8_t> data, uint64_t pts) {
-    updateFilterOutput(filterId, data);
-    mFilters[filterId]->updatePts(pts);
-}
-
 uint16_t Demux::getFilterTpid(int64_t filterId) {
     return mFilters[filterId]->getTpid();
 }
@@ -530,11 +603,17 @@ void Demux::frontendInputThreadLoop() {
 
     while (mFrontendInputThreadRunning) {
         uint32_t efState = 0;
+        // Wake up in time to flush the record output held back waiting for more input
+        int64_t timeout = mIsRecording ? RECORD_FLUSH_INTERVAL_NS : WAIT_TIMEOUT;
         ::android::status_t status = mDvrPlayback->getDvrEventFlag()->wait(
-                static_cast<uint32_t>(DemuxQueueNotifyBits::DATA_READY), &efState, WAIT_TIMEOUT,
+                static_cast<uint32_t>(DemuxQueueNotifyBits::DATA_READY), &efState, timeout,
                 true /* retry on spurious wake */);
         if (status != ::android::OK) {
-            ALOGD("[Demux] wait for data ready on the playback FMQ");
+            if (mIsRecording) {
+                startRecordFilterDispatcher();
+            } else {
+                ALOGD("[Demux] wait for data ready on the playback FMQ");
+            }
             continue;
         }
         if (mDvrPlayback->getSettings().get<DvrSettings::Tag::playback>().dataFormat ==
@@ -588,6 +667,11 @@ bool Demux::isRecording() {
 binder_status_t Demux::dump(int fd, const char** args, uint32_t numArgs) {
     dprintf(fd, " Demux %d:\n", mDemuxId);
     dprintf(fd, "  mIsRecording %d\n", mIsRecording);
+    {
+        std::shared_ptr<const PidIndex> index = getPidIndex();
+        dprintf(fd, "  Indexed PIDs: %zu\n",
+                index == nullptr ? 0 : index->filterLists.size() - 1);
+    }
     {
         dprintf(fd, "  Filters:\n");
         map<int64_t, std::shared_ptr<Filter>>::iterator it;
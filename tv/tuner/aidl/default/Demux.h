@@ -21,6 +21,7 @@
 
 #include <fmq/AidlMessageQueue.h>
 #include <math.h>
+#include <array>
 #include <atomic>
 #include <condition_variable>
 #include <map>
@@ -62,6 +63,8 @@ class Tuner;
 const int IPTV_PLAYBACK_TIMEOUT = 20;            // ms
 const int IPTV_PLAYBACK_BUFFER_TIMEOUT = 20000;  // ms
 
+const int TS_PID_COUNT = 0x2000;  // PIDs are 13 bits wide
+
 class DvrPlaybackCallback : public BnDvrCallback {
   public:
     virtual ::ndk::ScopedAStatus onPlaybackStatus(PlaybackStatus status) override {
@@ -103,9 +106,12 @@ class Demux : public BnDemux {
     bool attachRecordFilter(int64_t filterId);
     bool detachRecordFilter(int64_t filterId);
     ::ndk::ScopedAStatus startFilterHandler(int64_t filterId);
-    void updateFilterOutput(int64_t filterId, vector<int8_t> data);
-    void updateMediaFilterOutput(int64_t filterId, vector<int8_t> data, uint64_t pts);
     uint16_t getFilterTpid(int64_t filterId);
+    /**
+     * Adds or removes a playback filter from the PID index used to route TS packets.
+     * Called when the filter is started, stopped or reconfigured.
+     */
+    void setFilterStarted(int64_t filterId, bool started);
     void setIsRecording(bool isRecording);
     bool isRecording();
     void startFrontendInputLoop();
@@ -117,10 +123,14 @@ class Demux : public BnDemux {
      * Note that recording filters are not included.
      */
     bool startBroadcastFilterDispatcher();
-    void startBroadcastTsFilter(vector<int8_t> data);
+    /**
+     * Routes numPackets consecutive TS packets to the started filters listening on their PIDs.
+     * Packets of the same PID are handed to each filter in a single batch.
+     */
+    void startBroadcastTsFilter(const int8_t* data, size_t numPackets, size_t packetSize);
 
-    void sendFrontendInputToRecord(vector<int8_t> data);
-    void sendFrontendInputToRecord(vector<int8_t> data, uint16_t pid, uint64_t pts);
+    void sendFrontendInputToRecord(const int8_t* data, size_t size);
+    void sendFrontendInputToRecord(const int8_t* data, size_t size, uint16_t pid, uint64_t pts);
     bool startRecordFilterDispatcher();
 
     void getDemuxInfo(DemuxInfo* demuxInfo);
@@ -164,6 +174,18 @@ class Demux : public BnDemux {
     void deleteEventFlag();
     bool readDataFromMQ();
 
+    /**
+     * Direct lookup from a PID to the started TS playback filters listening on it.
+     * slots[pid] is the position of the filters in filterLists, or 0 if there are none.
+     */
+    struct PidIndex {
+        std::array<uint16_t, TS_PID_COUNT> slots = {};
+        vector<vector<std::shared_ptr<Filter>>> filterLists;
+    };
+    // mPidIndexLock needs to be held to call this function
+    void rebuildPidIndexLocked();
+    std::shared_ptr<const PidIndex> getPidIndex();
+
     int32_t mDemuxId = -1;
     int32_t mCiCamId;
     set<int64_t> mPcrFilterIds;
@@ -185,9 +207,25 @@ class Demux : public BnDemux {
     /**
      * A list of created Filter sp.
      * The array number is the filter ID.
+     * Modified under mPidIndexLock, which rebuilding the PID index holds while reading it.
      */
     std::map<int64_t, std::shared_ptr<Filter>> mFilters;
 
+    /**
+     * The started playback filters and the PID index built from them. The index is rebuilt
+     * on filter start/stop/removal and swapped in under mPidIndexLock, so the input threads only
+     * hold the lock while taking a reference to it.
+     */
+    std::mutex mPidIndexLock;
+    set<int64_t> mStartedFilterIds;
+    std::shared_ptr<const PidIndex> mPidIndex;
+    /**
+     * Packet offsets of the batch being routed, grouped by PID index slot.
+     * Kept across batches to avoid reallocating them.
+     */
+    std::mutex mPidBatchesLock;
+    vector<vector<uint32_t>> mPidBatches;
+
     /**
      * Local reference to the opened Timer Filter instance.
      */
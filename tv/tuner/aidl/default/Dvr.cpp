@@ -20,6 +20,7 @@
 #include <aidl/android/hardware/tv/tuner/DemuxQueueNotifyBits.h>
 #include <aidl/android/hardware/tv/tuner/Result.h>
 
+#include <inttypes.h>
 #include <utils/Log.h>
 #include "Dvr.h"
 
@@ -31,6 +32,47 @@ namespace tuner {
 
 #define WAIT_TIMEOUT 3000000000
 
+EsDispatchWorker::EsDispatchWorker() {
+    mThread = std::thread(&EsDispatchWorker::threadLoop, this);
+}
+
+EsDispatchWorker::~EsDispatchWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExiting = true;
+    }
+    mCv.notify_all();
+    mThread.join();
+}
+
+void EsDispatchWorker::post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mTask = std::move(task);
+    }
+    mCv.notify_all();
+}
+
+void EsDispatchWorker::wait() {
+    std::unique_lock<std::mutex> lock(mLock);
+    mCv.wait(lock, [this] { return mTask == nullptr; });
+}
+
+void EsDispatchWorker::threadLoop() {
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mCv.wait(lock, [this] { return mTask != nullptr || mExiting; });
+        if (mTask == nullptr) {
+            return;
+        }
+        lock.unlock();
+        mTask();
+        lock.lock();
+        mTask = nullptr;
+        mCv.notify_all();
+    }
+}
+
 Dvr::Dvr(DvrType type, uint32_t bufferSize, const std::shared_ptr<IDvrCallback>& cb,
          std::shared_ptr<Demux> demux) {
     mType = type;
@@ -189,6 +231,9 @@ binder_status_t Dvr::dump(int fd, const char** /* args */, uint32_t /* numArgs *
     dprintf(fd, "    Dvr:\n");
     dprintf(fd, "      mType: %hhd\n", mType);
     dprintf(fd, "      mDvrThreadRunning: %d\n", (bool)mDvrThreadRunning);
+    dprintf(fd, "      Zero-copy read bytes: %" PRIu64 "\n", mZeroCopyReadBytes.load());
+    dprintf(fd, "      Bounced read bytes: %" PRIu64 "\n", mBouncedReadBytes.load());
+    dprintf(fd, "      ES frames dispatched: %" PRIu64 "\n", mEsFramesDispatched.load());
     return STATUS_OK;
 }
 
@@ -196,21 +241,27 @@ void Dvr::playbackThreadLoop() {
     ALOGD("[Dvr] playback threadLoop start.");
 
     while (mDvrThreadRunning) {
+        // If the both dvr playback and dvr record are created, the playback will be treated as
+        // the source of the record. isVirtualFrontend set to true would direct the dvr playback
+        // input to the demux record filters or live broadcast filters.
+        bool isRecording = mDemux->isRecording();
+        bool isVirtualFrontend = isRecording;
+
         uint32_t efState = 0;
+        // Wake up in time to flush the record output held back waiting for more input
+        int64_t timeout = isRecording ? RECORD_FLUSH_INTERVAL_NS : WAIT_TIMEOUT;
         ::android::status_t status =
                 mDvrEventFlag->wait(static_cast<uint32_t>(DemuxQueueNotifyBits::DATA_READY),
-                                    &efState, WAIT_TIMEOUT, true /* retry on spurious wake */);
+                                    &efState, timeout, true /* retry on spurious wake */);
         if (status != ::android::OK) {
-            ALOGD("[Dvr] wait for data ready on the playback FMQ");
+            if (isRecording) {
+                mDemux->startRecordFilterDispatcher();
+            } else {
+                ALOGD("[Dvr] wait for data ready on the playback FMQ");
+            }
             continue;
         }
 
-        // If the both dvr playback and dvr record are created, the playback will be treated as
-        // the source of the record. isVirtualFrontend set to true would direct the dvr playback
-        // input to the demux record filters or live broadcast filters.
-        bool isRecording = mDemux->isRecording();
-        bool isVirtualFrontend = isRecording;
-
         if (mDvrSettings.get<DvrSettings::Tag::playback>().dataFormat == DataFormat::ES) {
             if (!processEsDataOnPlayback(isVirtualFrontend, isRecording)) {
                 ALOGE("[Dvr] playback es data failed to be filtered. Ending thread");
@@ -245,8 +296,9 @@ void Dvr::maySendIptvPlaybackStatusCallback() {
                                                          IPTV_PLAYBACK_STATUS_THRESHOLD_HIGH,
                                                          IPTV_PLAYBACK_STATUS_THRESHOLD_LOW);
     if (mPlaybackStatus != newStatus) {
+        map<int64_t, std::shared_ptr<Filter>> filters = getPlaybackFilters();
         map<int64_t, std::shared_ptr<Filter>>::iterator it;
-        for (it = mFilters.begin(); it != mFilters.end(); it++) {
+        for (it = filters.begin(); it != filters.end(); it++) {
             std::shared_ptr<Filter> currentFilter = it->second;
             currentFilter->setIptvDvrPlaybackStatus(newStatus);
         }
@@ -285,28 +337,60 @@ PlaybackStatus Dvr::checkPlaybackStatusChange(uint32_t availableToWrite, uint32_
 }
 
 bool Dvr::readPlaybackFMQ(bool isVirtualFrontend, bool isRecording) {
-    // Read playback data from the input FMQ
-    size_t size = mDvrMQ->availableToRead();
-    int64_t playbackPacketSize = mDvrSettings.get<DvrSettings::Tag::playback>().packetSize;
-    vector<int8_t> dataOutputBuffer;
-    dataOutputBuffer.resize(playbackPacketSize);
-    // Dispatch the packet to the PID matching filter output buffer
-    for (int i = 0; i < size / playbackPacketSize; i++) {
-        if (!mDvrMQ->read(dataOutputBuffer.data(), playbackPacketSize)) {
-            return false;
-        }
-        if (isVirtualFrontend) {
-            if (isRecording) {
-                mDemux->sendFrontendInputToRecord(dataOutputBuffer);
-            } else {
-                mDemux->startBroadcastTsFilter(dataOutputBuffer);
-            }
-        } else {
-            startTpidFilter(dataOutputBuffer);
-        }
+    size_t playbackPacketSize = mDvrSettings.get<DvrSettings::Tag::playback>().packetSize;
+    size_t numPackets = mDvrMQ->availableToRead() / playbackPacketSize;
+    if (numPackets == 0) {
+        return true;
     }
+    size_t size = numPackets * playbackPacketSize;
 
-    return true;
+    // Route the complete packets straight out of the FMQ ring. Only a packet wrapping around
+    // the end of the ring is copied, so that each packet handed to the filters is contiguous.
+    // The read is committed after the filters have consumed the data.
+    DvrMQ::MemTransaction tx;
+    if (!mDvrMQ->beginRead(size, &tx)) {
+        return false;
+    }
+    const DvrMQ::MemRegion& first = tx.getFirstRegion();
+    const DvrMQ::MemRegion& second = tx.getSecondRegion();
+    size_t firstPackets = first.getLength() / playbackPacketSize;
+    dispatchPlaybackPackets(first.getAddress(), firstPackets, playbackPacketSize,
+                            isVirtualFrontend, isRecording);
+
+    size_t secondOffset = 0;
+    size_t secondPackets = numPackets - firstPackets;
+    size_t tailSize = first.getLength() - firstPackets * playbackPacketSize;
+    if (tailSize > 0) {
+        mPacketBounceBuffer.resize(playbackPacketSize);
+        memcpy(mPacketBounceBuffer.data(), first.getAddress() + firstPackets * playbackPacketSize,
+               tailSize);
+        secondOffset = playbackPacketSize - tailSize;
+        memcpy(mPacketBounceBuffer.data() + tailSize, second.getAddress(), secondOffset);
+        dispatchPlaybackPackets(mPacketBounceBuffer.data(), 1, playbackPacketSize,
+                                isVirtualFrontend, isRecording);
+        secondPackets--;
+        mBouncedReadBytes += playbackPacketSize;
+    }
+    if (secondPackets > 0) {
+        dispatchPlaybackPackets(second.getAddress() + secondOffset, secondPackets,
+                                playbackPacketSize, isVirtualFrontend, isRecording);
+    }
+    mZeroCopyReadBytes += size - (tailSize > 0 ? playbackPacketSize : 0);
+
+    return mDvrMQ->commitRead(size);
+}
+
+void Dvr::dispatchPlaybackPackets(const int8_t* data, size_t numPackets, size_t packetSize,
+                                  bool isVirtualFrontend, bool isRecording) {
+    if (numPackets == 0) {
+        return;
+    }
+    if (isVirtualFrontend && isRecording) {
+        mDemux->sendFrontendInputToRecord(data, numPackets * packetSize);
+    } else {
+        // Dispatch the packets to the PID matching filter output buffers
+        mDemux->startBroadcastTsFilter(data, numPackets, packetSize);
+    }
 }
 
 bool Dvr::processEsDataOnPlayback(bool isVirtualFrontend, bool isRecording) {
@@ -314,71 +398,126 @@ bool Dvr::processEsDataOnPlayback(bool isVirtualFrontend, bool isRecording) {
     // Note that currently we only provides ES with metaData in a specific format to be parsed.
     // The ES size should be smaller than the Playback FMQ size to avoid reading truncated data.
     int size = mDvrMQ->availableToRead();
-    vector<int8_t> dataOutputBuffer;
-    dataOutputBuffer.resize(size);
-    if (!mDvrMQ->read(dataOutputBuffer.data(), size)) {
+    mEsBuffer.resize(size);
+    if (!mDvrMQ->read(mEsBuffer.data(), size)) {
+        return false;
+    }
+
+    MediaEsInfo info;
+    uint32_t magic = 0;
+    if (size >= static_cast<int>(sizeof(magic))) {
+        memcpy(&magic, mEsBuffer.data(), sizeof(magic));
+    }
+    bool parsed = magic == ES_BINARY_META_MAGIC
+                          ? parseBinaryEsMetaData(mEsBuffer.data(), size, &info)
+                          : parseAsciiEsMetaData(mEsBuffer.data(), size, &info);
+    if (!parsed) {
+        return false;
+    }
+
+    if (info.metaDataSize + info.audioEsDataSize + info.videoEsDataSize != size) {
+        ALOGE("[Dvr] Invalid meta data, metaSize=%d, videoSize=%d, audioSize=%d, totolSize=%d",
+              info.metaDataSize, info.videoEsDataSize, info.audioEsDataSize, size);
         return false;
     }
+    for (const MediaEsMetaData& frame : mEsMeta) {
+        int esStart = frame.isAudio ? info.metaDataSize + info.videoEsDataSize : info.metaDataSize;
+        int esEnd = frame.isAudio ? size : info.metaDataSize + info.videoEsDataSize;
+        if (frame.len < 0 || frame.startIndex < esStart || frame.startIndex + frame.len > esEnd) {
+            ALOGE("[Dvr] Invalid meta data, frame exceeds its ES data");
+            return false;
+        }
+    }
+
+    if (isRecording) {
+        // Send to the record filters, which all see both the audio and video ES
+        for (const MediaEsMetaData& frame : mEsMeta) {
+            int pid = frame.isAudio ? info.audioPid : info.videoPid;
+            mDemux->sendFrontendInputToRecord(mEsBuffer.data() + frame.startIndex, frame.len, pid,
+                                              static_cast<uint64_t>(frame.pts));
+            startFilterDispatcher(isVirtualFrontend, isRecording);
+        }
+    } else if (info.audioPid == info.videoPid) {
+        dispatchEsFrames(mEsBuffer.data(), false /*isAudio*/, info.videoPid);
+        dispatchEsFrames(mEsBuffer.data(), true /*isAudio*/, info.audioPid);
+    } else {
+        // Audio and video go to different media filters, dispatch them in parallel
+        if (mAudioEsWorker == nullptr) {
+            mAudioEsWorker = std::make_unique<EsDispatchWorker>();
+        }
+        const int8_t* data = mEsBuffer.data();
+        int audioPid = info.audioPid;
+        mAudioEsWorker->post([this, data, audioPid] {
+            dispatchEsFrames(data, true /*isAudio*/, audioPid);
+        });
+        dispatchEsFrames(data, false /*isAudio*/, info.videoPid);
+        mAudioEsWorker->wait();
+    }
+    mEsFramesDispatched += mEsMeta.size();
 
+    return true;
+}
+
+bool Dvr::parseAsciiEsMetaData(int8_t* data, int size, MediaEsInfo* info) {
     int metaDataSize = size;
     int totalFrames = 0;
-    int videoEsDataSize = 0;
-    int audioEsDataSize = 0;
-    int audioPid = 0;
-    int videoPid = 0;
-
-    vector<MediaEsMetaData> esMeta;
     int videoReadPointer = 0;
     int audioReadPointer = 0;
     int frameCount = 0;
+    mEsMeta.clear();
     // Get meta data from the es
     for (int i = 0; i < metaDataSize; i++) {
-        switch (dataOutputBuffer[i]) {
+        switch (data[i]) {
             case 'm':
                 metaDataSize = 0;
-                getMetaDataValue(i, dataOutputBuffer.data(), metaDataSize);
+                getMetaDataValue(i, data, metaDataSize);
                 videoReadPointer = metaDataSize;
                 continue;
             case 'l':
-                getMetaDataValue(i, dataOutputBuffer.data(), totalFrames);
-                esMeta.resize(totalFrames);
+                getMetaDataValue(i, data, totalFrames);
+                mEsMeta.resize(totalFrames);
                 continue;
             case 'V':
-                getMetaDataValue(i, dataOutputBuffer.data(), videoEsDataSize);
-                audioReadPointer = metaDataSize + videoEsDataSize;
+                getMetaDataValue(i, data, info->videoEsDataSize);
+                audioReadPointer = metaDataSize + info->videoEsDataSize;
                 continue;
             case 'A':
-                getMetaDataValue(i, dataOutputBuffer.data(), audioEsDataSize);
+                getMetaDataValue(i, data, info->audioEsDataSize);
                 continue;
             case 'p':
-                if (dataOutputBuffer[++i] == 'a') {
-                    getMetaDataValue(i, dataOutputBuffer.data(), audioPid);
-                } else if (dataOutputBuffer[i] == 'v') {
-                    getMetaDataValue(i, dataOutputBuffer.data(), videoPid);
+                if (data[++i] == 'a') {
+                    getMetaDataValue(i, data, info->audioPid);
+                } else if (data[i] == 'v') {
+                    getMetaDataValue(i, data, info->videoPid);
                 }
                 continue;
             case 'v':
-            case 'a':
-                if (dataOutputBuffer[i + 1] != ',') {
+            case 'a': {
+                if (data[i + 1] != ',' || frameCount >= totalFrames) {
                     ALOGE("[Dvr] Invalid format meta data.");
                     return false;
                 }
-                esMeta[frameCount] = {
-                        .isAudio = dataOutputBuffer[i] == 'a' ? true : false,
+                MediaEsMetaData& frame = mEsMeta[frameCount];
+                frame = {
+                        .isAudio = data[i] == 'a' ? true : false,
+                        .len = 0,
                 };
                 i += 5;  // Move to Len
-                getMetaDataValue(i, dataOutputBuffer.data(), esMeta[frameCount].len);
-                if (esMeta[frameCount].isAudio) {
-                    esMeta[frameCount].startIndex = audioReadPointer;
-                    audioReadPointer += esMeta[frameCount].len;
+                getMetaDataValue(i, data, frame.len);
+                if (frame.isAudio) {
+                    frame.startIndex = audioReadPointer;
+                    audioReadPointer += frame.len;
                 } else {
-                    esMeta[frameCount].startIndex = videoReadPointer;
-                    videoReadPointer += esMeta[frameCount].len;
+                    frame.startIndex = videoReadPointer;
+                    videoReadPointer += frame.len;
                 }
                 i += 4;  // move to PTS
-                getMetaDataValue(i, dataOutputBuffer.data(), esMeta[frameCount].pts);
+                int pts = 0;
+                getMetaDataValue(i, data, pts);
+                frame.pts = pts;
                 frameCount++;
                 continue;
+            }
             default:
                 continue;
         }
@@ -390,38 +529,78 @@ bool Dvr::processEsDataOnPlayback(bool isVirtualFrontend, bool isRecording) {
         return false;
     }
 
-    if (metaDataSize + audioEsDataSize + videoEsDataSize != size) {
-        ALOGE("[Dvr] Invalid meta data, metaSize=%d, videoSize=%d, audioSize=%d, totolSize=%d",
-              metaDataSize, videoEsDataSize, audioEsDataSize, size);
+    info->metaDataSize = metaDataSize;
+    return true;
+}
+
+bool Dvr::parseBinaryEsMetaData(const int8_t* data, int size, MediaEsInfo* info) {
+    EsBinaryMetaHeader header;
+    if (size < static_cast<int>(sizeof(header))) {
+        ALOGE("[Dvr] Invalid binary meta data, size=%d", size);
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    uint64_t metaDataSize =
+            sizeof(header) + static_cast<uint64_t>(header.frameCount) * sizeof(EsBinaryMetaFrame);
+    uint32_t totalSize = static_cast<uint32_t>(size);
+    if (header.version != ES_BINARY_META_VERSION || metaDataSize > totalSize ||
+        header.videoEsDataSize > totalSize || header.audioEsDataSize > totalSize) {
+        ALOGE("[Dvr] Invalid binary meta data, version=%u, frameCount=%u", header.version,
+              header.frameCount);
         return false;
     }
 
-    // Read es raw data from the FMQ per meta data built previously
-    vector<int8_t> frameData;
-    map<int64_t, std::shared_ptr<Filter>>::iterator it;
-    int pid = 0;
-    for (int i = 0; i < totalFrames; i++) {
-        frameData.resize(esMeta[i].len);
-        pid = esMeta[i].isAudio ? audioPid : videoPid;
-        memcpy(frameData.data(), dataOutputBuffer.data() + esMeta[i].startIndex, esMeta[i].len);
-        // Send to the media filters or record filters
-        if (!isRecording) {
-            for (it = mFilters.begin(); it != mFilters.end(); it++) {
-                if (pid == mDemux->getFilterTpid(it->first)) {
-                    mDemux->updateMediaFilterOutput(it->first, frameData,
-                                                    static_cast<uint64_t>(esMeta[i].pts));
-                }
-            }
-        } else {
-            mDemux->sendFrontendInputToRecord(frameData, pid, static_cast<uint64_t>(esMeta[i].pts));
+    info->metaDataSize = static_cast<int>(metaDataSize);
+    info->videoEsDataSize = header.videoEsDataSize;
+    info->audioEsDataSize = header.audioEsDataSize;
+    info->videoPid = header.videoPid;
+    info->audioPid = header.audioPid;
+
+    int videoReadPointer = info->metaDataSize;
+    int audioReadPointer = info->metaDataSize + info->videoEsDataSize;
+    mEsMeta.resize(header.frameCount);
+    const int8_t* entry = data + sizeof(header);
+    for (MediaEsMetaData& frame : mEsMeta) {
+        EsBinaryMetaFrame binaryFrame;
+        memcpy(&binaryFrame, entry, sizeof(binaryFrame));
+        entry += sizeof(binaryFrame);
+        frame.isAudio = binaryFrame.flags & ES_BINARY_META_FLAG_AUDIO;
+        int& readPointer = frame.isAudio ? audioReadPointer : videoReadPointer;
+        if (readPointer > size || binaryFrame.len > totalSize - readPointer) {
+            ALOGE("[Dvr] Invalid binary meta data, frame length %u", binaryFrame.len);
+            return false;
         }
-        startFilterDispatcher(isVirtualFrontend, isRecording);
-        frameData.clear();
+        frame.len = binaryFrame.len;
+        frame.pts = binaryFrame.pts;
+        frame.startIndex = readPointer;
+        readPointer += frame.len;
     }
 
     return true;
 }
 
+void Dvr::dispatchEsFrames(const int8_t* data, bool isAudio, int pid) {
+    // The audio and video workers dispatch concurrently, each to its own snapshot of the filters
+    map<int64_t, std::shared_ptr<Filter>> filters = getPlaybackFilters();
+    map<int64_t, std::shared_ptr<Filter>>::iterator it;
+    for (const MediaEsMetaData& frame : mEsMeta) {
+        if (frame.isAudio != isAudio) {
+            continue;
+        }
+        // Send to the media filters
+        for (it = filters.begin(); it != filters.end(); it++) {
+            if (pid != it->second->getTpid()) {
+                continue;
+            }
+            it->second->updateFilterOutput(data + frame.startIndex, frame.len);
+            it->second->updatePts(static_cast<uint64_t>(frame.pts));
+            if (!it->second->startFilterHandler().isOk()) {
+                ALOGW("[Dvr] filter %" PRId64 " failed to handle es frame", it->first);
+            }
+        }
+    }
+}
+
 void Dvr::getMetaDataValue(int& index, int8_t* dataOutputBuffer, int& value) {
     index += 2;  // Move the pointer across the ":" to the value
     while (dataOutputBuffer[index] != ',' && dataOutputBuffer[index] != '\n') {
@@ -429,19 +608,6 @@ void Dvr::getMetaDataValue(int& index, int8_t* dataOutputBuffer, int& value) {
     }
 }
 
-void Dvr::startTpidFilter(vector<int8_t> data) {
-    map<int64_t, std::shared_ptr<Filter>>::iterator it;
-    for (it = mFilters.begin(); it != mFilters.end(); it++) {
-        uint16_t pid = ((data[1] & 0x1f) << 8) | ((data[2] & 0xff));
-        if (DEBUG_DVR) {
-            ALOGW("[Dvr] start ts filter pid: %d", pid);
-        }
-        if (pid == mDemux->getFilterTpid(it->first)) {
-            mDemux->updateFilterOutput(it->first, data);
-        }
-    }
-}
-
 bool Dvr::startFilterDispatcher(bool isVirtualFrontend, bool isRecording) {
     if (isVirtualFrontend) {
         if (isRecording) {
@@ -451,9 +617,10 @@ bool Dvr::startFilterDispatcher(bool isVirtualFrontend, bool isRecording) {
         }
     }
 
+    map<int64_t, std::shared_ptr<Filter>> filters = getPlaybackFilters();
     map<int64_t, std::shared_ptr<Filter>>::iterator it;
     // Handle the output data per filter type
-    for (it = mFilters.begin(); it != mFilters.end(); it++) {
+    for (it = filters.begin(); it != filters.end(); it++) {
         if (!mDemux->startFilterHandler(it->first).isOk()) {
             return false;
         }
@@ -480,20 +647,32 @@ int Dvr::writePlaybackFMQ(void* buf, size_t size) {
     return DVR_WRITE_FAILURE_REASON_UNKNOWN;
 }
 
-bool Dvr::writeRecordFMQ(const vector<int8_t>& data) {
+size_t Dvr::writeRecordFMQ(const int8_t* data, size_t size, const int8_t* wrapData,
+                           size_t wrapSize) {
     lock_guard<mutex> lock(mWriteLock);
     if (mRecordStatus == RecordStatus::OVERFLOW) {
-        ALOGW("[Dvr] stops writing and wait for the client side flushing.");
-        return true;
+        // Resume writing once the client has read from the FMQ
+        maySendRecordStatusCallback();
+        if (mRecordStatus == RecordStatus::OVERFLOW) {
+            ALOGW("[Dvr] stops writing and wait for the client side flushing.");
+            return 0;
+        }
     }
-    if (mDvrMQ->write(data.data(), data.size())) {
-        mDvrEventFlag->wake(static_cast<uint32_t>(DemuxQueueNotifyBits::DATA_READY));
+    size_t length = min(size + wrapSize, mDvrMQ->availableToWrite());
+    DvrMQ::MemTransaction tx;
+    if (length == 0 || !mDvrMQ->beginWrite(length, &tx)) {
         maySendRecordStatusCallback();
-        return true;
+        return 0;
     }
-
+    size_t firstLength = min(size, length);
+    tx.copyTo(data, 0, firstLength);
+    if (length > firstLength) {
+        tx.copyTo(wrapData, firstLength, length - firstLength);
+    }
+    mDvrMQ->commitWrite(length);
+    mDvrEventFlag->wake(static_cast<uint32_t>(DemuxQueueNotifyBits::DATA_READY));
     maySendRecordStatusCallback();
-    return false;
+    return length;
 }
 
 void Dvr::maySendRecordStatusCallback() {
@@ -524,15 +703,31 @@ RecordStatus Dvr::checkRecordStatusChange(uint32_t availableToWrite, uint32_t av
 }
 
 bool Dvr::addPlaybackFilter(int64_t filterId, std::shared_ptr<Filter> filter) {
+    lock_guard<mutex> lock(mFiltersLock);
     mFilters[filterId] = filter;
     return true;
 }
 
 bool Dvr::removePlaybackFilter(int64_t filterId) {
-    mFilters.erase(filterId);
+    // The filter is released outside the lock, as a filter being destroyed removes itself
+    std::shared_ptr<Filter> filter;
+    {
+        lock_guard<mutex> lock(mFiltersLock);
+        map<int64_t, std::shared_ptr<Filter>>::iterator it = mFilters.find(filterId);
+        if (it == mFilters.end()) {
+            return true;
+        }
+        filter = std::move(it->second);
+        mFilters.erase(it);
+    }
     return true;
 }
 
+map<int64_t, std::shared_ptr<Filter>> Dvr::getPlaybackFilters() {
+    lock_guard<mutex> lock(mFiltersLock);
+    return mFilters;
+}
+
 }  // namespace tuner
 }  // namespace tv
 }  // namespace hardware
@@ -22,6 +22,8 @@
 #include <fmq/AidlMessageQueue.h>
 #include <math.h>
 #include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -64,7 +66,68 @@ struct MediaEsMetaData {
     bool isAudio;
     int startIndex;
     int len;
-    int pts;
+    int64_t pts;
+};
+
+/**
+ * Sizes and PIDs of an ES playback buffer, parsed from its meta data.
+ */
+struct MediaEsInfo {
+    int metaDataSize = 0;
+    int videoEsDataSize = 0;
+    int audioEsDataSize = 0;
+    int videoPid = 0;
+    int audioPid = 0;
+};
+
+/**
+ * Binary ES meta data, an alternative to the ASCII format that can be parsed in one pass.
+ * All the fields are little-endian. The buffer starts with an EsBinaryMetaHeader, followed by
+ * frameCount EsBinaryMetaFrame entries, then the video ES data and the audio ES data.
+ */
+const uint32_t ES_BINARY_META_MAGIC = 0x424d5345;  // "ESMB"
+const uint32_t ES_BINARY_META_VERSION = 1;
+
+struct EsBinaryMetaHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t frameCount;
+    uint32_t videoEsDataSize;
+    uint32_t audioEsDataSize;
+    uint32_t videoPid;
+    uint32_t audioPid;
+};
+
+struct EsBinaryMetaFrame {
+    uint32_t flags;  // ES_BINARY_META_FLAG_*
+    uint32_t len;
+    int64_t pts;
+};
+
+const uint32_t ES_BINARY_META_FLAG_AUDIO = 1 << 0;
+
+/**
+ * A thread running one task at a time, used to dispatch audio and video ES in parallel.
+ */
+class EsDispatchWorker {
+  public:
+    EsDispatchWorker();
+    ~EsDispatchWorker();
+
+    // Runs the task on the worker thread. The previous task must have completed.
+    void post(std::function<void()> task);
+    // Waits for the posted task to complete
+    void wait();
+
+  private:
+    void threadLoop();
+
+    std::thread mThread;
+    // mLock protects mTask and mExiting
+    std::mutex mLock;
+    std::condition_variable mCv;
+    std::function<void()> mTask;
+    bool mExiting = false;
 };
 
 class Demux;
@@ -98,7 +161,12 @@ class Dvr : public BnDvr {
      */
     bool createDvrMQ();
     int writePlaybackFMQ(void* buf, size_t size);
-    bool writeRecordFMQ(const std::vector<int8_t>& data);
+    /**
+     * Writes as much of the two regions of a ring buffer as fits into the record FMQ in one
+     * transaction. Returns the number of bytes written.
+     */
+    size_t writeRecordFMQ(const int8_t* data, size_t size, const int8_t* wrapData,
+                          size_t wrapSize);
     bool addPlaybackFilter(int64_t filterId, std::shared_ptr<Filter> filter);
     bool removePlaybackFilter(int64_t filterId);
     bool readPlaybackFMQ(bool isVirtualFrontend, bool isRecording);
@@ -114,11 +182,24 @@ class Dvr : public BnDvr {
     DvrType mType;
     uint32_t mBufferSize;
     std::shared_ptr<IDvrCallback> mCallback;
+    // mFiltersLock protects mFilters, which binder threads change while the playback threads
+    // dispatch to the filters
+    std::mutex mFiltersLock;
     std::map<int64_t, std::shared_ptr<Filter>> mFilters;
 
+    // Returns a copy of mFilters, to dispatch to without holding mFiltersLock
+    std::map<int64_t, std::shared_ptr<Filter>> getPlaybackFilters();
+
     void deleteEventFlag();
     bool readDataFromMQ();
     void getMetaDataValue(int& index, int8_t* dataOutputBuffer, int& value);
+    /**
+     * Parse the ES meta data at the start of data into info and mEsMeta.
+     * Return false if the meta data is invalid.
+     */
+    bool parseAsciiEsMetaData(int8_t* data, int size, MediaEsInfo* info);
+    bool parseBinaryEsMetaData(const int8_t* data, int size, MediaEsInfo* info);
+    void dispatchEsFrames(const int8_t* data, bool isAudio, int pid);
     void maySendPlaybackStatusCallback();
     void maySendIptvPlaybackStatusCallback();
     void maySendRecordStatusCallback();
@@ -126,14 +207,26 @@ class Dvr : public BnDvr {
                                              int64_t highThreshold, int64_t lowThreshold);
     RecordStatus checkRecordStatusChange(uint32_t availableToWrite, uint32_t availableToRead,
                                          int64_t highThreshold, int64_t lowThreshold);
-    /**
-     * A dispatcher to read and dispatch input data to all the started filters.
-     * Each filter handler handles the data filtering/output writing/filterEvent updating.
-     */
-    void startTpidFilter(vector<int8_t> data);
     void playbackThreadLoop();
+    void dispatchPlaybackPackets(const int8_t* data, size_t numPackets, size_t packetSize,
+                                 bool isVirtualFrontend, bool isRecording);
 
     unique_ptr<DvrMQ> mDvrMQ;
+    // Holds a packet that wraps around the end of the playback FMQ ring
+    vector<int8_t> mPacketBounceBuffer;
+    /**
+     * Playback bytes routed straight out of the FMQ ring and bytes that had to be copied
+     * to the bounce buffer first.
+     */
+    std::atomic<uint64_t> mZeroCopyReadBytes = 0;
+    std::atomic<uint64_t> mBouncedReadBytes = 0;
+
+    // ES playback data and the frames parsed from it, kept across reads to avoid reallocating
+    vector<int8_t> mEsBuffer;
+    vector<MediaEsMetaData> mEsMeta;
+    // Dispatches the audio ES while the playback thread dispatches the video ES
+    unique_ptr<EsDispatchWorker> mAudioEsWorker;
+    std::atomic<uint64_t> mEsFramesDispatched = 0;
     EventFlag* mDvrEventFlag;
     /**
      * Demux callbacks used on filter events or IO buffer status
@@ -20,10 +20,13 @@
 #include <BufferAllocator/BufferAllocator.h>
 #include <aidl/android/hardware/tv/tuner/DemuxFilterMonitorEventType.h>
 #include <aidl/android/hardware/tv/tuner/DemuxQueueNotifyBits.h>
+#include <aidl/android/hardware/tv/tuner/DemuxTsIndex.h>
 #include <aidl/android/hardware/tv/tuner/Result.h>
 #include <aidlcommonsupport/NativeHandle.h>
 #include <inttypes.h>
+#include <sys/mman.h>
 #include <utils/Log.h>
+#include <utils/Timers.h>
 
 #include "Filter.h"
 
@@ -35,6 +38,37 @@ namespace tuner {
 
 #define WAIT_TIMEOUT 3000000000
 
+namespace {
+
+// CRC-32/MPEG-2 lookup table, as used by PSI sections in ISO/IEC 13818-1 Annex A
+constexpr std::array<uint32_t, 256> makeCrc32Table() {
+    std::array<uint32_t, 256> table = {};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i << 24;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr std::array<uint32_t, 256> kCrc32Table = makeCrc32Table();
+
+// Running the CRC over a whole section, including its CRC_32 field, yields 0 when it is intact
+uint32_t crc32Mpeg2(const int8_t* data, size_t size) {
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; i++) {
+        crc = (crc << 8) ^ kCrc32Table[((crc >> 24) ^ static_cast<uint8_t>(data[i])) & 0xff];
+    }
+    return crc;
+}
+
+// table_id and section_length, as defined in ISO/IEC 13818-1 Section 2.4.4
+const size_t SECTION_HEADER_SIZE = 3;
+
+}  // namespace
+
 FilterCallbackScheduler::FilterCallbackScheduler(const std::shared_ptr<IFilterCallback>& cb)
     : mCallback(cb),
       mIsConditionMet(false),
@@ -61,6 +95,26 @@ void FilterCallbackScheduler::onFilterEvent(DemuxFilterEvent&& event) {
     }
 }
 
+void FilterCallbackScheduler::onFilterEvents(std::vector<DemuxFilterEvent>&& events) {
+    if (events.empty()) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mLock);
+    for (auto&& event : events) {
+        mDataLength += getDemuxFilterEventDataLength(event);
+        mCallbackBuffer.push_back(std::move(event));
+    }
+    events.clear();
+
+    if (isDataSizeDelayConditionMetLocked()) {
+        mIsConditionMet = true;
+        // unlock, so thread is not immediately blocked when it is notified.
+        lock.unlock();
+        mCv.notify_all();
+    }
+}
+
 void FilterCallbackScheduler::onFilterStatus(const DemuxFilterStatus& status) {
     if (mCallback) {
         mCallback->onFilterStatus(status);
@@ -194,6 +248,7 @@ Filter::Filter(DemuxFilterType type, int64_t filterId, uint32_t bufferSize,
       mFilterId(filterId),
       mBufferSize(bufferSize),
       mType(type) {
+    mAvStatsStartNs = systemTime(SYSTEM_TIME_MONOTONIC);
     switch (mType.mainType) {
         case DemuxFilterMainType::TS:
             if (mType.subType.get<DemuxFilterSubType::Tag::tsFilterType>() ==
@@ -210,6 +265,18 @@ Filter::Filter(DemuxFilterType type, int64_t filterId, uint32_t bufferSize,
                 DemuxTsFilterType::RECORD) {
                 mIsRecordFilter = true;
             }
+            if (mType.subType.get<DemuxFilterSubType::Tag::tsFilterType>() ==
+                DemuxTsFilterType::TS) {
+                mIsRawTsFilter = true;
+            }
+            if (mType.subType.get<DemuxFilterSubType::Tag::tsFilterType>() ==
+                DemuxTsFilterType::SECTION) {
+                mIsSectionFilter = true;
+            }
+            if (mType.subType.get<DemuxFilterSubType::Tag::tsFilterType>() ==
+                DemuxTsFilterType::PES) {
+                mIsPesFilter = true;
+            }
             break;
         case DemuxFilterMainType::MMTP:
             if (mType.subType.get<DemuxFilterSubType::Tag::mmtpFilterType>() ==
@@ -236,6 +303,8 @@ Filter::Filter(DemuxFilterType type, int64_t filterId, uint32_t bufferSize,
 
 Filter::~Filter() {
     close();
+    freeAvBufferPool();
+    freeSharedAvHandle();
 }
 
 ::ndk::ScopedAStatus Filter::getId64Bit(int64_t* _aidl_return) {
@@ -303,9 +372,25 @@ Filter::~Filter() {
 
     mFilterSettings = in_settings;
     switch (mType.mainType) {
-        case DemuxFilterMainType::TS:
-            mTpid = in_settings.get<DemuxFilterSettings::Tag::ts>().tpid;
+        case DemuxFilterMainType::TS: {
+            const DemuxTsFilterSettings& tsSettings =
+                    in_settings.get<DemuxFilterSettings::Tag::ts>();
+            mTpid = tsSettings.tpid;
+            if (tsSettings.filterSettings.getTag() ==
+                DemuxTsFilterSettingsFilterSettings::Tag::section) {
+                mIsCheckCrc = tsSettings.filterSettings
+                                      .get<DemuxTsFilterSettingsFilterSettings::Tag::section>()
+                                      .isCheckCrc;
+            } else if (tsSettings.filterSettings.getTag() ==
+                       DemuxTsFilterSettingsFilterSettings::Tag::record) {
+                const DemuxFilterRecordSettings& recordSettings =
+                        tsSettings.filterSettings
+                                .get<DemuxTsFilterSettingsFilterSettings::Tag::record>();
+                std::lock_guard<std::mutex> lock(mRecordFilterOutputLock);
+                mRecordTsIndexMask = recordSettings.tsIndexMask;
+            }
             break;
+        }
         case DemuxFilterMainType::MMTP:
             break;
         case DemuxFilterMainType::IP:
@@ -319,6 +404,10 @@ Filter::~Filter() {
     }
 
     mConfigured = true;
+    if (mFilterThreadRunning) {
+        // Pick up a PID change of a running filter
+        mDemux->setFilterStarted(mFilterId, true);
+    }
     return ::ndk::ScopedAStatus::ok();
 }
 
@@ -328,7 +417,13 @@ Filter::~Filter() {
     std::vector<DemuxFilterEvent> events;
 
     mFilterCount += 1;
+    {
+        std::lock_guard<std::mutex> lock(mFilterOutputLock);
+        mLastContinuityCounter = -1;
+        resetReassemblyLocked();
+    }
     mDemux->setIptvThreadRunning(true);
+    mDemux->setFilterStarted(mFilterId, true);
 
     // All the filter event callbacks in start are for testing purpose.
     switch (mType.mainType) {
@@ -373,8 +468,20 @@ Filter::~Filter() {
         }
     }
 
-    mFilterThreadRunning = false;
+    mDemux->setFilterStarted(mFilterId, false);
+    if (mIsRecordFilter) {
+        // Do not hold back the tail of the recording
+        std::lock_guard<std::mutex> lock(mRecordFilterOutputLock);
+        flushRecordOutputLocked();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mFilterEventsLock);
+        mFilterThreadRunning = false;
+    }
     if (mFilterThread.joinable()) {
+        // Wake the filter thread from waiting for new events or for the data to be consumed
+        mFilterEventsCv.notify_all();
+        mFilterEventsFlag->wake(static_cast<uint32_t>(DemuxQueueNotifyBits::DATA_CONSUMED));
         mFilterThread.join();
     }
 
@@ -391,6 +498,10 @@ Filter::~Filter() {
     int8_t* buffer = new int8_t[size];
     mFilterMQ->read(buffer, size);
     delete[] buffer;
+    {
+        std::lock_guard<std::mutex> lock(mFilterOutputLock);
+        resetReassemblyLocked();
+    }
     mFilterStatus = DemuxFilterStatus::DATA_READY;
 
     return ::ndk::ScopedAStatus::ok();
@@ -399,18 +510,31 @@ Filter::~Filter() {
 ::ndk::ScopedAStatus Filter::releaseAvHandle(const NativeHandle& in_avMemory, int64_t in_avDataId) {
     ALOGV("%s", __FUNCTION__);
 
+    std::lock_guard<std::mutex> lock(mAvBufferLock);
     if ((mSharedAvMemHandle != nullptr) && (in_avMemory.fds.size() > 0) &&
         (sameFile(in_avMemory.fds[0].get(), mSharedAvMemHandle->data[0]))) {
-        freeSharedAvHandle();
+        freeSharedAvHandleLocked();
+        return ::ndk::ScopedAStatus::ok();
+    }
+
+    // A region of the shared A/V memory may be overwritten once released
+    if (mSharedAvRegions.erase(static_cast<uint64_t>(in_avDataId)) > 0) {
         return ::ndk::ScopedAStatus::ok();
     }
 
-    if (mDataId2Avfd.find(in_avDataId) == mDataId2Avfd.end()) {
+    auto it = mAvAllocations.find(static_cast<uint64_t>(in_avDataId));
+    if (it == mAvAllocations.end()) {
         return ::ndk::ScopedAStatus::fromServiceSpecificError(
                 static_cast<int32_t>(Result::INVALID_ARGUMENT));
     }
 
-    ::close(mDataId2Avfd[in_avDataId]);
+    if (it->second.bufferIndex >= 0) {
+        // The pooled buffer is recycled on the next allocation once nothing in it is in use
+        mAvBuffers[it->second.bufferIndex].outstanding--;
+    } else {
+        ::close(it->second.fd);
+    }
+    mAvAllocations.erase(it);
     return ::ndk::ScopedAStatus::ok();
 }
 
@@ -442,6 +566,7 @@ Filter::~Filter() {
                 static_cast<int32_t>(Result::INVALID_STATE));
     }
 
+    std::lock_guard<std::mutex> lock(mAvBufferLock);
     if (mSharedAvMemHandle != nullptr) {
         *out_avMemory = ::android::dupToAidl(mSharedAvMemHandle);
         *_aidl_return = BUFFER_SIZE;
@@ -580,94 +705,117 @@ void Filter::filterThreadLoop() {
 
     // For the first time of filter output, implementation needs to send the filter
     // Event Callback without waiting for the DATA_CONSUMED to init the process.
-    while (mFilterThreadRunning) {
+    {
         std::unique_lock<std::mutex> lock(mFilterEventsLock);
-        if (mFilterEvents.size() == 0) {
-            lock.unlock();
-            if (DEBUG_FILTER) {
-                ALOGD("[Filter] wait for filter data output.");
-            }
-            usleep(1000 * 1000);
-            continue;
+        mFilterEventsCv.wait(lock,
+                             [this] { return !mFilterThreadRunning || !mFilterEvents.empty(); });
+        if (!mFilterThreadRunning) {
+            ALOGD("[Filter] filter thread ended.");
+            return;
         }
 
         // After successfully write, send a callback and wait for the read to be done
-        if (mCallbackScheduler.hasCallbackRegistered()) {
-            if (mConfigured) {
-                auto startEvent =
-                        DemuxFilterEvent::make<DemuxFilterEvent::Tag::startId>(mStartId++);
-                mCallbackScheduler.onFilterEvent(std::move(startEvent));
-                mConfigured = false;
-            }
-
-            // lock is still being held
-            for (auto&& event : mFilterEvents) {
-                mCallbackScheduler.onFilterEvent(std::move(event));
-            }
-        } else {
+        if (!mCallbackScheduler.hasCallbackRegistered()) {
             ALOGD("[Filter] filter callback is not configured yet.");
             mFilterThreadRunning = false;
             return;
         }
-
-        mFilterEvents.clear();
-        mFilterStatus = DemuxFilterStatus::DATA_READY;
-        mCallbackScheduler.onFilterStatus(mFilterStatus);
-        break;
+        if (mConfigured) {
+            auto startEvent = DemuxFilterEvent::make<DemuxFilterEvent::Tag::startId>(mStartId++);
+            mCallbackScheduler.onFilterEvent(std::move(startEvent));
+            mConfigured = false;
+        }
+        sendFilterEventsLocked();
     }
+    mFilterStatus = DemuxFilterStatus::DATA_READY;
+    mCallbackScheduler.onFilterStatus(mFilterStatus);
 
-    while (mFilterThreadRunning) {
+    // We do not wait for the last round of written data to be read to finish the thread
+    // because the VTS can verify the reading itself.
+    for (int i = 0; i < SECTION_WRITE_COUNT && mFilterThreadRunning; i++) {
         uint32_t efState = 0;
-        // We do not wait for the last round of written data to be read to finish the thread
-        // because the VTS can verify the reading itself.
-        for (int i = 0; i < SECTION_WRITE_COUNT; i++) {
-            if (!mFilterThreadRunning) {
-                break;
-            }
-            while (mFilterThreadRunning && mIsUsingFMQ) {
-                ::android::status_t status = mFilterEventsFlag->wait(
-                        static_cast<uint32_t>(DemuxQueueNotifyBits::DATA_CONSUMED), &efState,
-                        WAIT_TIMEOUT, true /* retry on spurious wake */);
-                if (status != ::android::OK) {
-                    ALOGD("[Filter] wait for data consumed");
-                    continue;
-                }
-                break;
+        while (mFilterThreadRunning && mIsUsingFMQ) {
+            ::android::status_t status = mFilterEventsFlag->wait(
+                    static_cast<uint32_t>(DemuxQueueNotifyBits::DATA_CONSUMED), &efState,
+                    WAIT_TIMEOUT, true /* retry on spurious wake */);
+            if (status != ::android::OK) {
+                ALOGD("[Filter] wait for data consumed");
+                continue;
             }
+            break;
+        }
 
-            maySendFilterStatusCallback();
+        maySendFilterStatusCallback();
 
-            while (mFilterThreadRunning) {
-                std::lock_guard<std::mutex> lock(mFilterEventsLock);
-                if (mFilterEvents.size() == 0) {
-                    continue;
-                }
-                // After successfully write, send a callback and wait for the read to be done
-                for (auto&& event : mFilterEvents) {
-                    mCallbackScheduler.onFilterEvent(std::move(event));
-                }
-                mFilterEvents.clear();
-                break;
-            }
-            // We do not wait for the last read to be done
-            // VTS can verify the read result itself.
-            if (i == SECTION_WRITE_COUNT - 1) {
-                ALOGD("[Filter] filter %" PRIu64 " writing done. Ending thread", mFilterId);
-                break;
-            }
+        std::unique_lock<std::mutex> lock(mFilterEventsLock);
+        mFilterEventsCv.wait(lock,
+                             [this] { return !mFilterThreadRunning || !mFilterEvents.empty(); });
+        if (!mFilterThreadRunning) {
+            break;
+        }
+        // After successfully write, send a callback and wait for the read to be done
+        sendFilterEventsLocked();
+        // We do not wait for the last read to be done
+        // VTS can verify the read result itself.
+        if (i == SECTION_WRITE_COUNT - 1) {
+            ALOGD("[Filter] filter %" PRIu64 " writing done. Ending thread", mFilterId);
         }
-        break;
     }
     ALOGD("[Filter] filter thread ended.");
 }
 
+void Filter::addFilterEvent(DemuxFilterEvent&& event, int64_t inputTimeNs) {
+    {
+        std::lock_guard<std::mutex> lock(mFilterEventsLock);
+        mFilterEvents.push_back(std::move(event));
+        mFilterEventInputTimes.push_back(inputTimeNs != 0 ? inputTimeNs
+                                                          : systemTime(SYSTEM_TIME_MONOTONIC));
+    }
+    mFilterEventsCv.notify_all();
+}
+
+// mFilterEventsLock needs to be held to call this function
+void Filter::sendFilterEventsLocked() {
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int64_t inputTimeNs : mFilterEventInputTimes) {
+        int64_t latencyNs = now - inputTimeNs;
+        mEventLatencyCount++;
+        mEventLatencyTotalNs += latencyNs;
+        mEventLatencyMaxNs = max(mEventLatencyMaxNs, latencyNs);
+    }
+    mFilterEventInputTimes.clear();
+    mCallbackScheduler.onFilterEvents(std::move(mFilterEvents));
+    mFilterEvents.clear();
+}
+
 void Filter::freeSharedAvHandle() {
-    if (!mIsMediaFilter) {
+    std::lock_guard<std::mutex> lock(mAvBufferLock);
+    freeSharedAvHandleLocked();
+}
+
+void Filter::freeSharedAvHandleLocked() {
+    if (!mIsMediaFilter || mSharedAvMemHandle == nullptr) {
         return;
     }
+    if (mSharedAvMemAddress != nullptr) {
+        munmap(mSharedAvMemAddress, BUFFER_SIZE);
+        mSharedAvMemAddress = nullptr;
+    }
     native_handle_close(mSharedAvMemHandle);
     native_handle_delete(mSharedAvMemHandle);
     mSharedAvMemHandle = nullptr;
+    mSharedAvRegions.clear();
+    mSharedAvMemOffset = 0;
+}
+
+bool Filter::isSharedAvRegionInUseLocked(int64_t offset, size_t size) {
+    int64_t end = offset + static_cast<int64_t>(size);
+    for (const auto& [dataId, region] : mSharedAvRegions) {
+        if (offset < region.offset + static_cast<int64_t>(region.size) && region.offset < end) {
+            return true;
+        }
+    }
+    return false;
 }
 
 binder_status_t Filter::dump(int fd, const char** /* args */, uint32_t /* numArgs */) {
@@ -678,6 +826,40 @@ binder_status_t Filter::dump(int fd, const char** /* args */, uint32_t /* numArg
     dprintf(fd, "      mIsRecordFilter: %d\n", mIsRecordFilter);
     dprintf(fd, "      mIsUsingFMQ: %d\n", mIsUsingFMQ);
     dprintf(fd, "      mFilterThreadRunning: %d\n", (bool)mFilterThreadRunning);
+    dprintf(fd, "      Direct write bytes: %" PRIu64 "\n", mDirectWriteBytes.load());
+    dprintf(fd, "      Staged bytes: %" PRIu64 "\n", mStagedBytes.load());
+    dprintf(fd, "      Dropped bytes: %" PRIu64 "\n", mDroppedBytes.load());
+    if (mIsRecordFilter) {
+        dprintf(fd, "      Record flushes: %" PRIu64 ", index events: %" PRIu64 "\n",
+                mRecordFlushCount.load(), mRecordIndexEventCount.load());
+    }
+    dprintf(fd, "      Continuity errors: %" PRIu64 "\n", mContinuityErrors.load());
+    dprintf(fd, "      CRC errors: %" PRIu64 "\n", mCrcErrors.load());
+    {
+        std::lock_guard<std::mutex> lock(mFilterEventsLock);
+        dprintf(fd, "      Input to event latency: count %" PRId64 ", avg %" PRId64
+                    " us, max %" PRId64 " us\n",
+                mEventLatencyCount,
+                mEventLatencyCount > 0 ? ns2us(mEventLatencyTotalNs / mEventLatencyCount) : 0,
+                ns2us(mEventLatencyMaxNs));
+    }
+    if (mIsMediaFilter) {
+        double elapsedSec = static_cast<double>(systemTime(SYSTEM_TIME_MONOTONIC) -
+                                                mAvStatsStartNs) / 1e9;
+        if (elapsedSec <= 0) {
+            elapsedSec = 1;
+        }
+        std::lock_guard<std::mutex> lock(mAvBufferLock);
+        dprintf(fd, "      AV buffer allocations: %" PRIu64 " (%.2f/s)\n", mAvAllocCount.load(),
+                mAvAllocCount / elapsedSec);
+        dprintf(fd, "      AV buffer maps: %" PRIu64 " (%.2f/s)\n", mAvMapCount.load(),
+                mAvMapCount / elapsedSec);
+        dprintf(fd, "      Pooled AV events: %" PRIu64 "\n", mPooledAvEventCount.load());
+        dprintf(fd, "      AV pool buffers: %zu, outstanding AV handles: %zu\n",
+                mAvBuffers.size(), mAvAllocations.size());
+        dprintf(fd, "      Outstanding shared AV regions: %zu, overflow drops: %" PRIu64 "\n",
+                mSharedAvRegions.size(), mSharedAvOverflowCount.load());
+    }
     return STATUS_OK;
 }
 
@@ -717,9 +899,45 @@ uint16_t Filter::getTpid() {
     return mTpid;
 }
 
-void Filter::updateFilterOutput(vector<int8_t>& data) {
+void Filter::updateFilterOutput(const int8_t* data, size_t size) {
     std::lock_guard<std::mutex> lock(mFilterOutputLock);
-    mFilterOutput.insert(mFilterOutput.end(), data.begin(), data.end());
+    if (mInputTimeNs == 0) {
+        mInputTimeNs = systemTime(SYSTEM_TIME_MONOTONIC);
+    }
+    mFilterOutput.insert(mFilterOutput.end(), data, data + size);
+    mStagedBytes += size;
+}
+
+void Filter::updateFilterOutput(const int8_t* data, const vector<uint32_t>& packetOffsets,
+                                size_t packetSize) {
+    if (mIsRawTsFilter) {
+        writePacketsToFilterMQ(data, packetOffsets, packetSize);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mFilterOutputLock);
+    if (mInputTimeNs == 0) {
+        mInputTimeNs = systemTime(SYSTEM_TIME_MONOTONIC);
+    }
+    if (mIsSectionFilter || mIsPesFilter) {
+        // Reassemble as the packets arrive instead of staging them in mFilterOutput
+        for (uint32_t offset : packetOffsets) {
+            if (mIsSectionFilter) {
+                processSectionPacketLocked(data + offset);
+            } else {
+                processPesPacketLocked(data + offset);
+            }
+        }
+        if (mFilterOutput.empty()) {
+            mInputTimeNs = 0;
+        }
+        return;
+    }
+    mFilterOutput.reserve(mFilterOutput.size() + packetOffsets.size() * packetSize);
+    for (uint32_t offset : packetOffsets) {
+        mFilterOutput.insert(mFilterOutput.end(), data + offset, data + offset + packetSize);
+    }
+    mStagedBytes += packetOffsets.size() * packetSize;
 }
 
 void Filter::updatePts(uint64_t pts) {
@@ -727,9 +945,132 @@ void Filter::updatePts(uint64_t pts) {
     mPts = pts;
 }
 
-void Filter::updateRecordOutput(vector<int8_t>& data) {
+void Filter::updateRecordOutput(const int8_t* data, size_t size) {
     std::lock_guard<std::mutex> lock(mRecordFilterOutputLock);
-    mRecordFilterOutput.insert(mRecordFilterOutput.end(), data.begin(), data.end());
+    if (mRecordRing.empty()) {
+        mRecordRing.resize(RECORD_RING_SIZE);
+    }
+    if (mRecordTsIndexMask == 0 || size % TS_SIZE != 0) {
+        appendRecordOutputLocked(data, size);
+        return;
+    }
+
+    // Index the packets in the same pass that stages them
+    for (size_t offset = 0; offset < size; offset += TS_SIZE) {
+        const int8_t* packet = data + offset;
+        if (!appendRecordOutputLocked(packet, TS_SIZE)) {
+            // An overflow dropped the packet, there is nothing to index
+            continue;
+        }
+        // The packet is the newest staged data, so its offset follows any dropped output
+        int64_t byteNumber = mRecordBytes - TS_SIZE;
+        int32_t tsIndexMask = getTsIndexMaskLocked(packet) & mRecordTsIndexMask;
+        if (tsIndexMask == 0) {
+            continue;
+        }
+        DemuxFilterTsRecordEvent indexEvent;
+        indexEvent.pid.set<DemuxPid::Tag::tPid>(
+                ((static_cast<uint8_t>(packet[1]) & 0x1f) << 8) | static_cast<uint8_t>(packet[2]));
+        indexEvent.tsIndexMask = tsIndexMask;
+        indexEvent.byteNumber = byteNumber;
+        indexEvent.pts = mPts;
+        mPendingRecordIndexEvents.push_back(std::move(indexEvent));
+    }
+}
+
+bool Filter::appendRecordOutputLocked(const int8_t* data, size_t size) {
+    while (size > 0) {
+        // Inputs up to the ring size are staged whole, so a drop never splits a packet
+        size_t length = min(size, mRecordRing.size());
+        if (mRecordRing.size() - mRecordRingSize < length) {
+            flushRecordOutputLocked();
+        }
+        if (mRecordRing.size() - mRecordRingSize < length) {
+            // The DVR FMQ is full. Drop the new input rather than the staged output, whose index
+            // events are still pending.
+            ALOGW("[Filter] record output overflow, dropped %zu bytes", size);
+            mDroppedBytes += size;
+            return false;
+        }
+        if (mRecordInputTimeNs == 0) {
+            mRecordInputTimeNs = systemTime(SYSTEM_TIME_MONOTONIC);
+        }
+        size_t tail = (mRecordRingHead + mRecordRingSize) % mRecordRing.size();
+        size_t firstLength = min(length, mRecordRing.size() - tail);
+        memcpy(mRecordRing.data() + tail, data, firstLength);
+        memcpy(mRecordRing.data(), data + firstLength, length - firstLength);
+        mRecordRingSize += length;
+        mRecordBytes += length;
+        mStagedBytes += length;
+        data += length;
+        size -= length;
+    }
+    return true;
+}
+
+int32_t Filter::getTsIndexMaskLocked(const int8_t* packet) {
+    if (static_cast<uint8_t>(packet[0]) != 0x47) {
+        return 0;
+    }
+    uint16_t pid =
+            ((static_cast<uint8_t>(packet[1]) & 0x1f) << 8) | static_cast<uint8_t>(packet[2]);
+    if (pid != mTpid) {
+        return 0;
+    }
+
+    int32_t tsIndexMask = 0;
+    if (static_cast<uint8_t>(packet[1]) & 0x40) {
+        tsIndexMask |= static_cast<int32_t>(DemuxTsIndex::PAYLOAD_UNIT_START_INDICATOR);
+    }
+    int scramblingControl = (static_cast<uint8_t>(packet[3]) >> 6) & 0x03;
+    if (mLastScramblingControl < 0) {
+        tsIndexMask |= static_cast<int32_t>(DemuxTsIndex::FIRST_PACKET);
+    } else if (scramblingControl != mLastScramblingControl) {
+        switch (scramblingControl) {
+            case 0:
+                tsIndexMask |= static_cast<int32_t>(DemuxTsIndex::CHANGE_TO_NOT_SCRAMBLED);
+                break;
+            case 2:
+                tsIndexMask |= static_cast<int32_t>(DemuxTsIndex::CHANGE_TO_EVEN_SCRAMBLED);
+                break;
+            case 3:
+                tsIndexMask |= static_cast<int32_t>(DemuxTsIndex::CHANGE_TO_ODD_SCRAMBLED);
+                break;
+            default:
+                break;
+        }
+    }
+    mLastScramblingControl = scramblingControl;
+
+    // The adaptation field flags map to the remaining indexes
+    if ((static_cast<uint8_t>(packet[3]) & 0x20) && static_cast<uint8_t>(packet[4]) > 0) {
+        uint8_t flags = static_cast<uint8_t>(packet[5]);
+        if (flags & 0x80) {
+            tsIndexMask |= static_cast<int32_t>(DemuxTsIndex::DISCONTINUITY_INDICATOR);
+        }
+        if (flags & 0x40) {
+            tsIndexMask |= static_cast<int32_t>(DemuxTsIndex::RANDOM_ACCESS_INDICATOR);
+        }
+        if (flags & 0x20) {
+            tsIndexMask |= static_cast<int32_t>(DemuxTsIndex::PRIORITY_INDICATOR);
+        }
+        if (flags & 0x10) {
+            tsIndexMask |= static_cast<int32_t>(DemuxTsIndex::PCR_FLAG);
+        }
+        if (flags & 0x08) {
+            tsIndexMask |= static_cast<int32_t>(DemuxTsIndex::OPCR_FLAG);
+        }
+        if (flags & 0x04) {
+            tsIndexMask |= static_cast<int32_t>(DemuxTsIndex::SPLICING_POINT_FLAG);
+        }
+        if (flags & 0x02) {
+            tsIndexMask |= static_cast<int32_t>(DemuxTsIndex::PRIVATE_DATA);
+        }
+        if (flags & 0x01) {
+            tsIndexMask |= static_cast<int32_t>(DemuxTsIndex::ADAPTATION_EXTENSION_FLAG);
+        }
+    }
+    return tsIndexMask;
 }
 
 ::ndk::ScopedAStatus Filter::startFilterHandler() {
@@ -777,88 +1118,25 @@ void Filter::updateRecordOutput(vector<int8_t>& data) {
         default:
             break;
     }
+    if (mFilterOutput.empty()) {
+        mInputTimeNs = 0;
+    }
     return ::ndk::ScopedAStatus::ok();
 }
 
 ::ndk::ScopedAStatus Filter::startSectionFilterHandler() {
-    if (mFilterOutput.empty()) {
-        return ::ndk::ScopedAStatus::ok();
-    }
-    if (!writeSectionsAndCreateEvent(mFilterOutput)) {
-        ALOGD("[Filter] filter %" PRIu64 " fails to write into FMQ. Ending thread", mFilterId);
-        return ::ndk::ScopedAStatus::fromServiceSpecificError(
-                static_cast<int32_t>(Result::UNKNOWN_ERROR));
+    for (size_t i = 0; i + TS_SIZE <= mFilterOutput.size(); i += TS_SIZE) {
+        processSectionPacketLocked(mFilterOutput.data() + i);
     }
-
     mFilterOutput.clear();
 
     return ::ndk::ScopedAStatus::ok();
 }
 
 ::ndk::ScopedAStatus Filter::startPesFilterHandler() {
-    if (mFilterOutput.empty()) {
-        return ::ndk::ScopedAStatus::ok();
-    }
-
-    for (int i = 0; i < mFilterOutput.size(); i += 188) {
-        if (mPesSizeLeft == 0) {
-            uint32_t prefix = (mFilterOutput[i + 4] << 16) | (mFilterOutput[i + 5] << 8) |
-                              mFilterOutput[i + 6];
-            if (DEBUG_FILTER) {
-                ALOGD("[Filter] prefix %d", prefix);
-            }
-            if (prefix == 0x000001) {
-                // TODO handle mulptiple Pes filters
-                mPesSizeLeft = (static_cast<uint8_t>(mFilterOutput[i + 8]) << 8) |
-                               static_cast<uint8_t>(mFilterOutput[i + 9]);
-                mPesSizeLeft += 6;
-                if (DEBUG_FILTER) {
-                    ALOGD("[Filter] pes data length %d", mPesSizeLeft);
-                }
-            } else {
-                continue;
-            }
-        }
-
-        uint32_t endPoint = min(184u, mPesSizeLeft);
-        // append data and check size
-        vector<int8_t>::const_iterator first = mFilterOutput.begin() + i + 4;
-        vector<int8_t>::const_iterator last = mFilterOutput.begin() + i + 4 + endPoint;
-        mPesOutput.insert(mPesOutput.end(), first, last);
-        // size does not match then continue
-        mPesSizeLeft -= endPoint;
-        if (DEBUG_FILTER) {
-            ALOGD("[Filter] pes data left %d", mPesSizeLeft);
-        }
-        if (mPesSizeLeft > 0) {
-            continue;
-        }
-        // size match then create event
-        if (!writeDataToFilterMQ(mPesOutput)) {
-            ALOGD("[Filter] pes data write failed");
-            mFilterOutput.clear();
-            return ::ndk::ScopedAStatus::fromServiceSpecificError(
-                    static_cast<int32_t>(Result::INVALID_ARGUMENT));
-        }
-        maySendFilterStatusCallback();
-        DemuxFilterPesEvent pesEvent;
-        pesEvent = {
-                // temp dump meta data
-                .streamId = static_cast<int32_t>(mPesOutput[3]),
-                .dataLength = static_cast<int32_t>(mPesOutput.size()),
-        };
-        if (DEBUG_FILTER) {
-            ALOGD("[Filter] assembled pes data length %d", pesEvent.dataLength);
-        }
-
-        {
-            std::lock_guard<std::mutex> lock(mFilterEventsLock);
-            mFilterEvents.push_back(DemuxFilterEvent::make<DemuxFilterEvent::Tag::pes>(pesEvent));
-        }
-
-        mPesOutput.clear();
+    for (size_t i = 0; i + TS_SIZE <= mFilterOutput.size(); i += TS_SIZE) {
+        processPesPacketLocked(mFilterOutput.data() + i);
     }
-
     mFilterOutput.clear();
 
     return ::ndk::ScopedAStatus::ok();
@@ -958,10 +1236,6 @@ void Filter::updateRecordOutput(vector<int8_t>& data) {
 
 ::ndk::ScopedAStatus Filter::createMediaFilterEventWithIon(vector<int8_t>& output) {
     if (mUsingSharedAvMem) {
-        if (mSharedAvMemHandle == nullptr) {
-            return ::ndk::ScopedAStatus::fromServiceSpecificError(
-                    static_cast<int32_t>(Result::UNKNOWN_ERROR));
-        }
         return createShareMemMediaEvents(output);
     }
 
@@ -970,31 +1244,77 @@ void Filter::updateRecordOutput(vector<int8_t>& data) {
 
 ::ndk::ScopedAStatus Filter::startRecordFilterHandler() {
     std::lock_guard<std::mutex> lock(mRecordFilterOutputLock);
-    if (mRecordFilterOutput.empty()) {
+    if (mRecordRingSize == 0) {
+        return ::ndk::ScopedAStatus::ok();
+    }
+    // Batch small inputs into fewer, larger FMQ writes without holding them back for long
+    if (mRecordRingSize < RECORD_FLUSH_BYTES &&
+        systemTime(SYSTEM_TIME_MONOTONIC) - mRecordInputTimeNs < RECORD_FLUSH_INTERVAL_NS) {
         return ::ndk::ScopedAStatus::ok();
     }
 
-    if (mDvr == nullptr || !mDvr->writeRecordFMQ(mRecordFilterOutput)) {
-        ALOGD("[Filter] dvr fails to write into record FMQ.");
+    if (mDvr == nullptr) {
         return ::ndk::ScopedAStatus::fromServiceSpecificError(
                 static_cast<int32_t>(Result::UNKNOWN_ERROR));
     }
+    // Whatever the DVR FMQ cannot take stays staged and is retried on the next input
+    size_t stagedSize = mRecordRingSize;
+    flushRecordOutputLocked();
+    if (mRecordRingSize == stagedSize) {
+        return ::ndk::ScopedAStatus::fromServiceSpecificError(
+                static_cast<int32_t>(Result::UNKNOWN_ERROR));
+    }
+    return ::ndk::ScopedAStatus::ok();
+}
+
+bool Filter::flushRecordOutputLocked() {
+    if (mRecordRingSize == 0) {
+        return true;
+    }
+
+    size_t firstSize = min(mRecordRingSize, mRecordRing.size() - mRecordRingHead);
+    size_t written = mDvr == nullptr
+                             ? 0
+                             : mDvr->writeRecordFMQ(mRecordRing.data() + mRecordRingHead,
+                                                    firstSize, mRecordRing.data(),
+                                                    mRecordRingSize - firstSize);
+    if (written == 0) {
+        ALOGD("[Filter] dvr fails to write into record FMQ.");
+        return false;
+    }
+    mRecordFlushCount++;
+
+    // Send the index events of the packets which are now wholly in the DVR FMQ
+    int64_t writtenBytes = mRecordBytes - static_cast<int64_t>(mRecordRingSize - written);
+    auto indexEnd = mPendingRecordIndexEvents.begin();
+    while (indexEnd != mPendingRecordIndexEvents.end() &&
+           indexEnd->byteNumber + TS_SIZE <= writtenBytes) {
+        addFilterEvent(DemuxFilterEvent::make<DemuxFilterEvent::Tag::tsRecord>(
+                               std::move(*indexEnd)),
+                       mRecordInputTimeNs);
+        ++indexEnd;
+    }
+    mRecordIndexEventCount += indexEnd - mPendingRecordIndexEvents.begin();
+    mPendingRecordIndexEvents.erase(mPendingRecordIndexEvents.begin(), indexEnd);
 
     DemuxFilterTsRecordEvent recordEvent;
     recordEvent = {
-            .byteNumber = static_cast<int64_t>(mRecordFilterOutput.size()),
+            .byteNumber = static_cast<int64_t>(written),
             .pts = (mPts == 0) ? static_cast<int64_t>(time(NULL)) * 900000 : mPts,
             .firstMbInSlice = 0,  // random address
     };
 
-    {
-        std::lock_guard<std::mutex> lock(mFilterEventsLock);
-        mFilterEvents.push_back(
-                DemuxFilterEvent::make<DemuxFilterEvent::Tag::tsRecord>(recordEvent));
-    }
+    addFilterEvent(DemuxFilterEvent::make<DemuxFilterEvent::Tag::tsRecord>(recordEvent),
+                   mRecordInputTimeNs);
 
-    mRecordFilterOutput.clear();
-    return ::ndk::ScopedAStatus::ok();
+    mRecordRingHead = (mRecordRingHead + written) % mRecordRing.size();
+    mRecordRingSize -= written;
+    if (mRecordRingSize > 0) {
+        return false;
+    }
+    mRecordRingHead = 0;
+    mRecordInputTimeNs = 0;
+    return true;
 }
 
 ::ndk::ScopedAStatus Filter::startPcrFilterHandler() {
@@ -1007,68 +1327,229 @@ void Filter::updateRecordOutput(vector<int8_t>& data) {
     return ::ndk::ScopedAStatus::ok();
 }
 
-// Read PSI (Program Specific Information) Sections from TransportStreams
-// as defined in ISO/IEC 13818-1 Section 2.4.4
-bool Filter::writeSectionsAndCreateEvent(vector<int8_t>& data) {
-    // TODO check how many sections has been read
-    ALOGD("[Filter] section handler");
-
-    // Transport Stream Packets are 188 bytes long, as defined in the
-    // Introduction of ISO/IEC 13818-1
-    for (int i = 0; i < data.size(); i += 188) {
-        if (mSectionSizeLeft == 0) {
-            // Location for sectionSize as defined by Section 2.4.4
-            // Note that the first 4 bytes skipped are the TsHeader
-            mSectionSizeLeft = ((static_cast<uint8_t>(data[i + 5]) & 0x0f) << 8) |
-                               static_cast<uint8_t>(data[i + 6]);
-            mSectionSizeLeft += 3;
+// Locate the payload of a TS packet as defined in ISO/IEC 13818-1 Section 2.4.3.2, and track
+// its continuity counter. Return false if the packet carries no new payload.
+bool Filter::parseTsPacketLocked(const int8_t* packet, uint32_t* payloadOffset,
+                                 bool* payloadUnitStart) {
+    if (static_cast<uint8_t>(packet[0]) != 0x47) {
+        return false;
+    }
+    uint8_t adaptationFieldControl = (static_cast<uint8_t>(packet[3]) >> 4) & 0x03;
+    uint8_t continuityCounter = static_cast<uint8_t>(packet[3]) & 0x0f;
+    uint32_t offset = 4;
+    bool discontinuity = false;
+    if (adaptationFieldControl & 0x02) {
+        uint8_t adaptationFieldLength = static_cast<uint8_t>(packet[4]);
+        discontinuity = adaptationFieldLength > 0 && (static_cast<uint8_t>(packet[5]) & 0x80);
+        offset += 1 + adaptationFieldLength;
+    }
+    // The continuity counter only increments on packets with a payload
+    if (!(adaptationFieldControl & 0x01) || offset >= TS_SIZE) {
+        return false;
+    }
+
+    if (mLastContinuityCounter >= 0 && !discontinuity) {
+        if (continuityCounter == mLastContinuityCounter) {
+            // Duplicate packet
+            return false;
+        }
+        if (continuityCounter != ((mLastContinuityCounter + 1) & 0x0f)) {
             if (DEBUG_FILTER) {
-                ALOGD("[Filter] section data length %d", mSectionSizeLeft);
+                ALOGD("[Filter] continuity error, expected %d got %d",
+                      (mLastContinuityCounter + 1) & 0x0f, continuityCounter);
             }
+            mContinuityErrors++;
+            resetReassemblyLocked();
         }
+    }
+    mLastContinuityCounter = continuityCounter;
 
-        // 184 bytes per packet is derived by subtracting the 4 byte length of
-        // the TsHeader from its 188 byte packet size
-        uint32_t endPoint = min(184u, mSectionSizeLeft);
-        // append data and check size
-        vector<int8_t>::const_iterator first = data.begin() + i + 4;
-        vector<int8_t>::const_iterator last = data.begin() + i + 4 + endPoint;
-        mSectionOutput.insert(mSectionOutput.end(), first, last);
-        // size does not match then continue
-        mSectionSizeLeft -= endPoint;
-        if (DEBUG_FILTER) {
-            ALOGD("[Filter] section data left %d", mSectionSizeLeft);
+    *payloadOffset = offset;
+    *payloadUnitStart = static_cast<uint8_t>(packet[1]) & 0x40;
+    return true;
+}
+
+void Filter::resetReassemblyLocked() {
+    mSectionOutput.clear();
+    mPesOutput.clear();
+    mPesPacketLength = 0;
+}
+
+// Read PSI (Program Specific Information) Sections from TransportStreams
+// as defined in ISO/IEC 13818-1 Section 2.4.4
+void Filter::processSectionPacketLocked(const int8_t* packet) {
+    uint32_t offset;
+    bool payloadUnitStart;
+    if (!parseTsPacketLocked(packet, &offset, &payloadUnitStart)) {
+        return;
+    }
+    const int8_t* payload = packet + offset;
+    size_t size = TS_SIZE - offset;
+
+    if (payloadUnitStart) {
+        // The pointer_field gives the number of bytes ending the previous section before the
+        // first section starting in this packet
+        size_t pointerField = static_cast<uint8_t>(payload[0]);
+        payload++;
+        size--;
+        if (pointerField > size) {
+            mSectionOutput.clear();
+            return;
         }
-        if (mSectionSizeLeft > 0) {
-            continue;
+        if (!mSectionOutput.empty()) {
+            // Only the pending section is completed from these bytes. Anything left over before
+            // the pointer_field target is not the start of a new section.
+            appendSectionDataLocked(payload, pointerField, /*pendingSectionOnly=*/true);
+            // Anything still pending was cut short
+            mSectionOutput.clear();
         }
+        payload += pointerField;
+        size -= pointerField;
+    } else if (mSectionOutput.empty()) {
+        // Wait for the start of a section
+        return;
+    }
 
-        if (!writeDataToFilterMQ(mSectionOutput)) {
+    appendSectionDataLocked(payload, size, /*pendingSectionOnly=*/false);
+}
+
+void Filter::appendSectionDataLocked(const int8_t* data, size_t size, bool pendingSectionOnly) {
+    while (size > 0) {
+        if (mSectionOutput.empty() && pendingSectionOnly) {
+            return;
+        }
+        if (mSectionOutput.empty() && static_cast<uint8_t>(data[0]) == 0xff) {
+            // Stuffing bytes until the end of the packet
+            return;
+        }
+
+        size_t needed;
+        if (mSectionOutput.size() < SECTION_HEADER_SIZE) {
+            needed = SECTION_HEADER_SIZE - mSectionOutput.size();
+        } else {
+            needed = getSectionSizeLocked() - mSectionOutput.size();
+        }
+        size_t count = min(needed, size);
+        mSectionOutput.insert(mSectionOutput.end(), data, data + count);
+        data += count;
+        size -= count;
+
+        if (mSectionOutput.size() >= SECTION_HEADER_SIZE &&
+            mSectionOutput.size() == getSectionSizeLocked()) {
+            createSectionEventLocked();
             mSectionOutput.clear();
-            return false;
         }
+    }
+}
+
+size_t Filter::getSectionSizeLocked() {
+    return SECTION_HEADER_SIZE + (((static_cast<uint8_t>(mSectionOutput[1]) & 0x0f) << 8) |
+                                  static_cast<uint8_t>(mSectionOutput[2]));
+}
 
-        DemuxFilterSectionEvent secEvent;
-        secEvent = {
-                // temp dump meta data
-                .tableId = 0,
-                .version = 1,
-                .sectionNum = 1,
-                .dataLength = static_cast<int32_t>(mSectionOutput.size()),
-        };
+void Filter::createSectionEventLocked() {
+    // Only the long form sections (section_syntax_indicator set) carry a CRC_32
+    bool isLongForm = static_cast<uint8_t>(mSectionOutput[1]) & 0x80;
+    if (mIsCheckCrc && isLongForm &&
+        crc32Mpeg2(mSectionOutput.data(), mSectionOutput.size()) != 0) {
         if (DEBUG_FILTER) {
-            ALOGD("[Filter] assembled section data length %" PRIu64, secEvent.dataLength);
+            ALOGD("[Filter] section CRC mismatch, dropping %zu bytes", mSectionOutput.size());
         }
+        mCrcErrors++;
+        return;
+    }
 
-        {
-            std::lock_guard<std::mutex> lock(mFilterEventsLock);
-            mFilterEvents.push_back(
-                    DemuxFilterEvent::make<DemuxFilterEvent::Tag::section>(secEvent));
+    if (!writeDataToFilterMQ(mSectionOutput)) {
+        mDroppedBytes += mSectionOutput.size();
+        maySendFilterStatusCallback();
+        return;
+    }
+
+    // Short form sections have no version or section_number, so they keep the values events
+    // always reported before sections were parsed.
+    DemuxFilterSectionEvent secEvent;
+    secEvent = {
+            .tableId = static_cast<uint8_t>(mSectionOutput[0]),
+            .version = 1,
+            .sectionNum = 1,
+            .dataLength = static_cast<int64_t>(mSectionOutput.size()),
+    };
+    if (isLongForm && mSectionOutput.size() > 6) {
+        secEvent.version = (static_cast<uint8_t>(mSectionOutput[5]) >> 1) & 0x1f;
+        secEvent.sectionNum = static_cast<uint8_t>(mSectionOutput[6]);
+    }
+    if (DEBUG_FILTER) {
+        ALOGD("[Filter] assembled section data length %" PRId64, secEvent.dataLength);
+    }
+
+    addFilterEvent(DemuxFilterEvent::make<DemuxFilterEvent::Tag::section>(secEvent),
+                   mInputTimeNs);
+}
+
+// Read PES (Packetized Elementary Stream) Packets from TransportStreams
+// as defined in ISO/IEC 13818-1 Section 2.4.3.6
+void Filter::processPesPacketLocked(const int8_t* packet) {
+    uint32_t offset;
+    bool payloadUnitStart;
+    if (!parseTsPacketLocked(packet, &offset, &payloadUnitStart)) {
+        return;
+    }
+    const int8_t* payload = packet + offset;
+    size_t size = TS_SIZE - offset;
+
+    if (payloadUnitStart) {
+        // A PES packet of unbounded length ends where the next one starts
+        if (!mPesOutput.empty() && mPesPacketLength == 0) {
+            createPesEventLocked();
         }
-        mSectionOutput.clear();
+        mPesOutput.clear();
+
+        // Packet Start Code Prefix 0x000001 followed by stream_id and PES_packet_length
+        if (size < 6 || payload[0] != 0 || payload[1] != 0 || payload[2] != 1) {
+            return;
+        }
+        mPesPacketLength = (static_cast<uint8_t>(payload[4]) << 8) |
+                           static_cast<uint8_t>(payload[5]);
+        if (mPesPacketLength > 0) {
+            mPesPacketLength += 6;
+        }
+        if (DEBUG_FILTER) {
+            ALOGD("[Filter] pes data length %zu", mPesPacketLength);
+        }
+    } else if (mPesOutput.empty()) {
+        // Wait for the start of a PES packet
+        return;
     }
 
-    return true;
+    if (mPesPacketLength > 0) {
+        size = min(size, mPesPacketLength - mPesOutput.size());
+    }
+    mPesOutput.insert(mPesOutput.end(), payload, payload + size);
+    if (mPesPacketLength > 0 && mPesOutput.size() == mPesPacketLength) {
+        createPesEventLocked();
+        mPesOutput.clear();
+    }
+}
+
+void Filter::createPesEventLocked() {
+    if (!writeDataToFilterMQ(mPesOutput)) {
+        ALOGD("[Filter] pes data write failed");
+        mDroppedBytes += mPesOutput.size();
+        maySendFilterStatusCallback();
+        return;
+    }
+    maySendFilterStatusCallback();
+
+    DemuxFilterPesEvent pesEvent;
+    pesEvent = {
+            .streamId = static_cast<uint8_t>(mPesOutput[3]),
+            .dataLength = static_cast<int32_t>(mPesOutput.size()),
+    };
+    if (DEBUG_FILTER) {
+        ALOGD("[Filter] assembled pes data length %d", pesEvent.dataLength);
+    }
+
+    addFilterEvent(DemuxFilterEvent::make<DemuxFilterEvent::Tag::pes>(pesEvent), mInputTimeNs);
 }
 
 bool Filter::writeDataToFilterMQ(const std::vector<int8_t>& data) {
@@ -1079,6 +1560,37 @@ bool Filter::writeDataToFilterMQ(const std::vector<int8_t>& data) {
     return false;
 }
 
+// Copy the packets from the input straight into the filter FMQ, without staging them in
+// mFilterOutput first
+bool Filter::writePacketsToFilterMQ(const int8_t* data, const vector<uint32_t>& packetOffsets,
+                                    size_t packetSize) {
+    size_t size = packetOffsets.size() * packetSize;
+    bool written = false;
+    {
+        std::lock_guard<std::mutex> lock(mWriteLock);
+        FilterMQ::MemTransaction tx;
+        if (mFilterMQ->beginWrite(size, &tx)) {
+            size_t index = 0;
+            for (uint32_t offset : packetOffsets) {
+                tx.copyTo(data + offset, index, packetSize);
+                index += packetSize;
+            }
+            written = mFilterMQ->commitWrite(size);
+        }
+    }
+
+    if (written) {
+        mDirectWriteBytes += size;
+    } else {
+        mDroppedBytes += size;
+        if (DEBUG_FILTER) {
+            ALOGD("[Filter] filter %" PRIu64 " FMQ full, dropped %zu bytes", mFilterId, size);
+        }
+    }
+    maySendFilterStatusCallback();
+    return written;
+}
+
 void Filter::attachFilterToRecord(const std::shared_ptr<Dvr> dvr) {
     mDvr = dvr;
 }
@@ -1131,34 +1643,135 @@ native_handle_t* Filter::createNativeHandle(int fd) {
     return nativeHandle;
 }
 
-::ndk::ScopedAStatus Filter::createIndependentMediaEvents(vector<int8_t>& output) {
-    int av_fd = createAvIonFd(output.size());
-    if (av_fd == -1) {
-        return ::ndk::ScopedAStatus::fromServiceSpecificError(
-                static_cast<int32_t>(Result::UNKNOWN_ERROR));
+bool Filter::allocatePooledAvMemoryLocked(size_t size, int* bufferIndex, int64_t* offset) {
+    if (size > AV_POOL_BUFFER_SIZE) {
+        return false;
     }
-    // copy the filtered data to the buffer
-    uint8_t* avBuffer = getIonBuffer(av_fd, output.size());
-    if (avBuffer == NULL) {
-        return ::ndk::ScopedAStatus::fromServiceSpecificError(
-                static_cast<int32_t>(Result::UNKNOWN_ERROR));
+    size_t alignedSize =
+            (size + AV_POOL_ALIGNMENT - 1) & ~static_cast<size_t>(AV_POOL_ALIGNMENT - 1);
+
+    for (size_t i = 0; i < mAvBuffers.size(); i++) {
+        AvBuffer& buffer = mAvBuffers[i];
+        if (buffer.outstanding == 0) {
+            buffer.used = 0;
+        }
+        if (AV_POOL_BUFFER_SIZE - buffer.used < size) {
+            continue;
+        }
+        *bufferIndex = static_cast<int>(i);
+        *offset = static_cast<int64_t>(buffer.used);
+        buffer.used = min(buffer.used + alignedSize, static_cast<size_t>(AV_POOL_BUFFER_SIZE));
+        buffer.outstanding++;
+        return true;
     }
-    memcpy(avBuffer, output.data(), output.size() * sizeof(uint8_t));
 
-    native_handle_t* nativeHandle = createNativeHandle(av_fd);
-    if (nativeHandle == NULL) {
-        return ::ndk::ScopedAStatus::fromServiceSpecificError(
-                static_cast<int32_t>(Result::UNKNOWN_ERROR));
+    if (mAvBuffers.size() >= static_cast<size_t>(AV_POOL_MAX_BUFFERS)) {
+        return false;
+    }
+    int av_fd = createAvIonFd(AV_POOL_BUFFER_SIZE);
+    if (av_fd < 0) {
+        return false;
+    }
+    mAvAllocCount++;
+    uint8_t* address = getIonBuffer(av_fd, AV_POOL_BUFFER_SIZE);
+    if (address == nullptr) {
+        ::close(av_fd);
+        return false;
+    }
+    mAvMapCount++;
+    native_handle_t* handle = createNativeHandle(av_fd);
+    ::close(av_fd);
+    if (handle == nullptr) {
+        munmap(address, AV_POOL_BUFFER_SIZE);
+        return false;
+    }
+
+    mAvBuffers.push_back({
+            .handle = handle,
+            .address = address,
+            .used = alignedSize,
+            .outstanding = 1,
+    });
+    *bufferIndex = static_cast<int>(mAvBuffers.size() - 1);
+    *offset = 0;
+    return true;
+}
+
+void Filter::freeAvBufferPool() {
+    std::lock_guard<std::mutex> lock(mAvBufferLock);
+    for (auto& [dataId, allocation] : mAvAllocations) {
+        if (allocation.fd >= 0) {
+            ::close(allocation.fd);
+        }
+    }
+    mAvAllocations.clear();
+    for (auto& buffer : mAvBuffers) {
+        munmap(buffer.address, AV_POOL_BUFFER_SIZE);
+        native_handle_close(buffer.handle);
+        native_handle_delete(buffer.handle);
     }
+    mAvBuffers.clear();
+}
+
+::ndk::ScopedAStatus Filter::createIndependentMediaEvents(vector<int8_t>& output) {
+    NativeHandle avMemory;
+    uint64_t dataId;
+    int64_t offset = 0;
+    uint8_t* avBuffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mAvBufferLock);
+        int bufferIndex;
+        if (allocatePooledAvMemoryLocked(output.size(), &bufferIndex, &offset)) {
+            avBuffer = mAvBuffers[bufferIndex].address + offset;
+            avMemory = ::android::dupToAidl(mAvBuffers[bufferIndex].handle);
+            dataId = mLastUsedDataId++ /*createdUID*/;
+            mAvAllocations[dataId] = {.bufferIndex = bufferIndex, .fd = -1};
+        }
+    }
+
+    if (avBuffer != nullptr) {
+        // The allocation stays reserved until released, so the copy does not need the lock
+        memcpy(avBuffer, output.data(), output.size() * sizeof(uint8_t));
+        mPooledAvEventCount++;
+    } else {
+        // The frame does not fit in the pool, give it a buffer of its own
+        int av_fd = createAvIonFd(output.size());
+        if (av_fd == -1) {
+            return ::ndk::ScopedAStatus::fromServiceSpecificError(
+                    static_cast<int32_t>(Result::UNKNOWN_ERROR));
+        }
+        mAvAllocCount++;
+        // copy the filtered data to the buffer
+        avBuffer = getIonBuffer(av_fd, output.size());
+        if (avBuffer == NULL) {
+            ::close(av_fd);
+            return ::ndk::ScopedAStatus::fromServiceSpecificError(
+                    static_cast<int32_t>(Result::UNKNOWN_ERROR));
+        }
+        mAvMapCount++;
+        memcpy(avBuffer, output.data(), output.size() * sizeof(uint8_t));
+        munmap(avBuffer, output.size());
 
-    // Create a dataId and add a <dataId, av_fd> pair into the dataId2Avfd map
-    uint64_t dataId = mLastUsedDataId++ /*createdUID*/;
-    mDataId2Avfd[dataId] = dup(av_fd);
+        native_handle_t* nativeHandle = createNativeHandle(av_fd);
+        if (nativeHandle == NULL) {
+            ::close(av_fd);
+            return ::ndk::ScopedAStatus::fromServiceSpecificError(
+                    static_cast<int32_t>(Result::UNKNOWN_ERROR));
+        }
+        avMemory = ::android::dupToAidl(nativeHandle);
+        native_handle_close(nativeHandle);
+        native_handle_delete(nativeHandle);
+
+        std::lock_guard<std::mutex> lock(mAvBufferLock);
+        dataId = mLastUsedDataId++ /*createdUID*/;
+        mAvAllocations[dataId] = {.bufferIndex = -1, .fd = av_fd};
+    }
 
     // Create mediaEvent and send callback
     auto event = DemuxFilterEvent::make<DemuxFilterEvent::Tag::media>();
     auto& mediaEvent = event.get<DemuxFilterEvent::Tag::media>();
-    mediaEvent.avMemory = ::android::dupToAidl(nativeHandle);
+    mediaEvent.avMemory = std::move(avMemory);
+    mediaEvent.offset = offset;
     mediaEvent.dataLength = static_cast<int64_t>(output.size());
     mediaEvent.avDataId = static_cast<int64_t>(dataId);
     if (mPts) {
@@ -1166,14 +1779,9 @@ native_handle_t* Filter::createNativeHandle(int fd) {
         mPts = 0;
     }
 
-    {
-        std::lock_guard<std::mutex> lock(mFilterEventsLock);
-        mFilterEvents.push_back(std::move(event));
-    }
+    addFilterEvent(std::move(event), mInputTimeNs);
 
     // Clear and log
-    native_handle_close(nativeHandle);
-    native_handle_delete(nativeHandle);
     output.clear();
     mAvBufferCopyCount = 0;
     if (DEBUG_FILTER) {
@@ -1183,18 +1791,54 @@ native_handle_t* Filter::createNativeHandle(int fd) {
 }
 
 ::ndk::ScopedAStatus Filter::createShareMemMediaEvents(vector<int8_t>& output) {
-    // copy the filtered data to the shared buffer
-    uint8_t* sharedAvBuffer =
-            getIonBuffer(mSharedAvMemHandle->data[0], output.size() + mSharedAvMemOffset);
-    if (sharedAvBuffer == NULL) {
+    if (output.size() > BUFFER_SIZE) {
         return ::ndk::ScopedAStatus::fromServiceSpecificError(
-                static_cast<int32_t>(Result::UNKNOWN_ERROR));
+                static_cast<int32_t>(Result::OUT_OF_MEMORY));
+    }
+    int64_t offset;
+    uint64_t dataId;
+    {
+        // The handle may be released from a binder thread, so map and copy under the lock
+        std::lock_guard<std::mutex> lock(mAvBufferLock);
+        if (mSharedAvMemHandle == nullptr) {
+            return ::ndk::ScopedAStatus::fromServiceSpecificError(
+                    static_cast<int32_t>(Result::UNKNOWN_ERROR));
+        }
+        // Map the shared buffer once and keep it mapped until the handle is freed
+        if (mSharedAvMemAddress == nullptr) {
+            mSharedAvMemAddress = getIonBuffer(mSharedAvMemHandle->data[0], BUFFER_SIZE);
+            if (mSharedAvMemAddress == NULL) {
+                return ::ndk::ScopedAStatus::fromServiceSpecificError(
+                        static_cast<int32_t>(Result::UNKNOWN_ERROR));
+            }
+            mAvMapCount++;
+        }
+        offset = mSharedAvMemOffset;
+        if (offset + output.size() > BUFFER_SIZE) {
+            offset = 0;
+        }
+        if (isSharedAvRegionInUseLocked(offset, output.size())) {
+            // Overwriting a region the client still holds would corrupt its frame, so drop this
+            // one until the client releases enough of the buffer
+            ALOGW("[Filter] shared av memory full, dropping %zu bytes", output.size());
+            mSharedAvOverflowCount++;
+            mDroppedBytes += output.size();
+            mPts = 0;
+            output.clear();
+            return ::ndk::ScopedAStatus::ok();
+        }
+        // copy the filtered data to the shared buffer
+        memcpy(mSharedAvMemAddress + offset, output.data(), output.size() * sizeof(uint8_t));
+        mSharedAvMemOffset = offset + output.size();
+        dataId = mLastUsedDataId++ /*createdUID*/;
+        mSharedAvRegions[dataId] = {.offset = offset, .size = output.size()};
     }
-    memcpy(sharedAvBuffer + mSharedAvMemOffset, output.data(), output.size() * sizeof(uint8_t));
 
     // Create a memory handle with numFds == 0
     native_handle_t* nativeHandle = createNativeHandle(-1);
     if (nativeHandle == NULL) {
+        std::lock_guard<std::mutex> lock(mAvBufferLock);
+        mSharedAvRegions.erase(dataId);
         return ::ndk::ScopedAStatus::fromServiceSpecificError(
                 static_cast<int32_t>(Result::UNKNOWN_ERROR));
     }
@@ -1203,19 +1847,15 @@ native_handle_t* Filter::createNativeHandle(int fd) {
     auto event = DemuxFilterEvent::make<DemuxFilterEvent::Tag::media>();
     auto& mediaEvent = event.get<DemuxFilterEvent::Tag::media>();
     mediaEvent.avMemory = ::android::dupToAidl(nativeHandle);
-    mediaEvent.offset = mSharedAvMemOffset;
+    mediaEvent.offset = offset;
     mediaEvent.dataLength = static_cast<int64_t>(output.size());
+    mediaEvent.avDataId = static_cast<int64_t>(dataId);
     if (mPts) {
         mediaEvent.pts = mPts;
         mPts = 0;
     }
 
-    {
-        std::lock_guard<std::mutex> lock(mFilterEventsLock);
-        mFilterEvents.push_back(std::move(event));
-    }
-
-    mSharedAvMemOffset += output.size();
+    addFilterEvent(std::move(event), mInputTimeNs);
 
     // Clear and log
     native_handle_close(nativeHandle);
@@ -1284,33 +1924,29 @@ void Filter::createMediaEvent(vector<DemuxFilterEvent>& events, bool isAudioPres
         mediaEvent.extraMetaData.set<DemuxFilterMediaEventExtraMetaData::Tag::audio>(audio);
     }
 
-    int av_fd = createAvIonFd(BUFFER_SIZE);
-    if (av_fd == -1) {
-        return;
-    }
+    {
+        std::lock_guard<std::mutex> lock(mAvBufferLock);
+        int bufferIndex;
+        int64_t offset;
+        if (!allocatePooledAvMemoryLocked(mediaEvent.offset + mediaEvent.dataLength, &bufferIndex,
+                                          &offset)) {
+            ALOGE("[Filter] Failed to allocate av memory");
+            return;
+        }
+        uint64_t dataId = mLastUsedDataId++ /*createdUID*/;
+        mAvAllocations[dataId] = {.bufferIndex = bufferIndex, .fd = -1};
 
-    native_handle_t* nativeHandle = createNativeHandle(av_fd);
-    if (nativeHandle == nullptr) {
-        ::close(av_fd);
-        ALOGE("[Filter] Failed to create native_handle %d", errno);
-        return;
+        mediaEvent.offset += offset;
+        mediaEvent.avDataId = static_cast<int64_t>(dataId);
+        mediaEvent.avMemory = ::android::dupToAidl(mAvBuffers[bufferIndex].handle);
     }
-
-    // Create a dataId and add a <dataId, av_fd> pair into the dataId2Avfd map
-    uint64_t dataId = mLastUsedDataId++ /*createdUID*/;
-    mDataId2Avfd[dataId] = dup(av_fd);
-
-    mediaEvent.avDataId = static_cast<int64_t>(dataId);
-    mediaEvent.avMemory = ::android::dupToAidl(nativeHandle);
+    mPooledAvEventCount++;
 
     mediaEvent.numDataPieces = 2;
     mediaEvent.indexInDataGroup = indexInDataGroup;
     mediaEvent.dataGroupId = 321;
 
     events.push_back(DemuxFilterEvent::make<DemuxFilterEvent::Tag::media>(std::move(mediaEvent)));
-
-    native_handle_close(nativeHandle);
-    native_handle_delete(nativeHandle);
 }
 
 void Filter::createTsRecordEvent(vector<DemuxFilterEvent>& events) {
@@ -26,6 +26,7 @@
 #include <ion/ion.h>
 #include <math.h>
 #include <sys/stat.h>
+#include <array>
 #include <atomic>
 #include <condition_variable>
 #include <map>
@@ -55,6 +56,16 @@ using ::android::hardware::EventFlag;
 using FilterMQ = AidlMessageQueue<int8_t, SynchronizedReadWrite>;
 
 const uint32_t BUFFER_SIZE = 0x800000;  // 8 MB
+// Media filters sub-allocate their AV output from a few recycled buffers of this size
+const uint32_t AV_POOL_BUFFER_SIZE = 0x400000;  // 4 MB
+const int AV_POOL_MAX_BUFFERS = 4;
+const uint32_t AV_POOL_ALIGNMENT = 64;
+// Record filters stage their output in a ring of this many TS packets
+const uint32_t RECORD_RING_SIZE = 4096 * 188;
+// The staged record output is written to the DVR FMQ once it reaches this size, or once its
+// oldest byte has waited RECORD_FLUSH_INTERVAL_NS
+const uint32_t RECORD_FLUSH_BYTES = 256 * 188;
+const int64_t RECORD_FLUSH_INTERVAL_NS = 20000000;  // 20 ms
 
 class Demux;
 class Dvr;
@@ -65,6 +76,8 @@ class FilterCallbackScheduler final {
     ~FilterCallbackScheduler();
 
     void onFilterEvent(DemuxFilterEvent&& event);
+    // Queues all the events at once and clears the vector
+    void onFilterEvents(std::vector<DemuxFilterEvent>&& events);
     void onFilterStatus(const DemuxFilterStatus& status);
 
     void setTimeDelayHint(int timeDelay);
@@ -139,14 +152,23 @@ class Filter : public BnFilter {
      */
     bool createFilterMQ();
     uint16_t getTpid();
-    void updateFilterOutput(vector<int8_t>& data);
-    void updateRecordOutput(vector<int8_t>& data);
+    void updateFilterOutput(const int8_t* data, size_t size);
+    /**
+     * Appends the packets at packetOffsets in data to the filter output under a single lock.
+     */
+    void updateFilterOutput(const int8_t* data, const vector<uint32_t>& packetOffsets,
+                            size_t packetSize);
+    void updateRecordOutput(const int8_t* data, size_t size);
     void updatePts(uint64_t pts);
     ::ndk::ScopedAStatus startFilterHandler();
+    /**
+     * Writes the staged record output to the DVR FMQ if a flush threshold has been reached.
+     */
     ::ndk::ScopedAStatus startRecordFilterHandler();
     void attachFilterToRecord(const std::shared_ptr<Dvr> dvr);
     void detachFilterFromRecord();
     void freeSharedAvHandle();
+    bool isTsFilter() { return mType.mainType == DemuxFilterMainType::TS; };
     bool isMediaFilter() { return mIsMediaFilter; };
     bool isPcrFilter() { return mIsPcrFilter; };
     bool isRecordFilter() { return mIsRecordFilter; };
@@ -167,14 +189,34 @@ class Filter : public BnFilter {
     bool mIsMediaFilter = false;
     bool mIsPcrFilter = false;
     bool mIsRecordFilter = false;
+    // TS filters output the packets unchanged and bypass mFilterOutput
+    bool mIsRawTsFilter = false;
+    // Section and PES filters reassemble the packets as they arrive
+    bool mIsSectionFilter = false;
+    bool mIsPesFilter = false;
+    bool mIsCheckCrc = false;
     DemuxFilterSettings mFilterSettings;
 
     uint16_t mTpid;
     std::shared_ptr<IFilter> mDataSource;
     bool mIsDataSourceDemux = true;
     vector<int8_t> mFilterOutput;
-    vector<int8_t> mRecordFilterOutput;
+    // Record output waiting to be flushed. mRecordRingHead is the oldest pending byte.
+    vector<int8_t> mRecordRing;
+    size_t mRecordRingHead = 0;
+    size_t mRecordRingSize = 0;
+    // Bytes recorded since the filter was created, the byteNumber of the next index event
+    int64_t mRecordBytes = 0;
+    // DemuxTsIndex bits to generate record index events for
+    int32_t mRecordTsIndexMask = 0;
+    // Index events of the pending record output, sent once their data is in the DVR FMQ
+    vector<DemuxFilterTsRecordEvent> mPendingRecordIndexEvents;
+    // Scrambling control of the last recorded packet on the filter PID, -1 if none yet
+    int mLastScramblingControl = -1;
     int64_t mPts = 0;
+    // When the oldest pending data of mFilterOutput/mRecordRing arrived, 0 if none
+    int64_t mInputTimeNs = 0;
+    int64_t mRecordInputTimeNs = 0;
     unique_ptr<FilterMQ> mFilterMQ;
     bool mIsUsingFMQ = false;
     EventFlag* mFilterEventsFlag;
@@ -212,9 +254,37 @@ class Filter : public BnFilter {
     ::ndk::ScopedAStatus startFilterLoop();
 
     void deleteEventFlag();
+    /**
+     * Queues an event for the filter thread. inputTimeNs is when the input the event was
+     * created from arrived, or 0 if unknown.
+     */
+    void addFilterEvent(DemuxFilterEvent&& event, int64_t inputTimeNs);
+    // mFilterEventsLock needs to be held to call this function
+    void sendFilterEventsLocked();
     bool writeDataToFilterMQ(const std::vector<int8_t>& data);
+    bool writePacketsToFilterMQ(const int8_t* data, const vector<uint32_t>& packetOffsets,
+                                size_t packetSize);
     bool readDataFromMQ();
-    bool writeSectionsAndCreateEvent(vector<int8_t>& data);
+    /**
+     * Incremental section and PES reassembly, fed one TS packet at a time.
+     * mFilterOutputLock needs to be held to call these functions.
+     */
+    bool parseTsPacketLocked(const int8_t* packet, uint32_t* payloadOffset,
+                             bool* payloadUnitStart);
+    void resetReassemblyLocked();
+    void processSectionPacketLocked(const int8_t* packet);
+    // With pendingSectionOnly, stops once the pending section is complete instead of starting
+    // another one.
+    void appendSectionDataLocked(const int8_t* data, size_t size, bool pendingSectionOnly);
+    size_t getSectionSizeLocked();
+    void createSectionEventLocked();
+    void processPesPacketLocked(const int8_t* packet);
+    void createPesEventLocked();
+    // Returns false if the DVR FMQ was too full to stage the data, which is then dropped
+    bool appendRecordOutputLocked(const int8_t* data, size_t size);
+    int32_t getTsIndexMaskLocked(const int8_t* packet);
+    // Writes as much of the staged output as fits into the DVR FMQ, true if all of it was written
+    bool flushRecordOutputLocked();
     void maySendFilterStatusCallback();
     DemuxFilterStatus checkFilterStatusChange(uint32_t availableToWrite, uint32_t availableToRead,
                                               uint32_t highThreshold, uint32_t lowThreshold);
@@ -229,6 +299,14 @@ class Filter : public BnFilter {
     int createAvIonFd(int size);
     uint8_t* getIonBuffer(int fd, int size);
     native_handle_t* createNativeHandle(int fd);
+    /**
+     * Reserve size bytes from the AV buffer pool. Returns false if the pool is exhausted, in
+     * which case the caller falls back to a dedicated buffer.
+     */
+    bool allocatePooledAvMemoryLocked(size_t size, int* bufferIndex, int64_t* offset);
+    void freeAvBufferPool();
+    void freeSharedAvHandleLocked();
+    bool isSharedAvRegionInUseLocked(int64_t offset, size_t size);
     ::ndk::ScopedAStatus createMediaFilterEventWithIon(vector<int8_t>& output);
     ::ndk::ScopedAStatus createIndependentMediaEvents(vector<int8_t>& output);
     ::ndk::ScopedAStatus createShareMemMediaEvents(vector<int8_t>& output);
@@ -255,6 +333,14 @@ class Filter : public BnFilter {
      */
     // TODO make each filter separate event lock
     std::mutex mFilterEventsLock;
+    // Notified when an event is added or the filter thread is stopped
+    std::condition_variable mFilterEventsCv;
+    // When the input of each event in mFilterEvents arrived
+    vector<int64_t> mFilterEventInputTimes;
+    // Input to event delivery latency, protected by mFilterEventsLock
+    int64_t mEventLatencyCount = 0;
+    int64_t mEventLatencyTotalNs = 0;
+    int64_t mEventLatencyMaxNs = 0;
     /**
      * Lock to protect writes to the input status
      */
@@ -262,24 +348,64 @@ class Filter : public BnFilter {
     std::mutex mFilterOutputLock;
     std::mutex mRecordFilterOutputLock;
 
-    // handle single Section filter
-    uint32_t mSectionSizeLeft = 0;
+    // Continuity counter of the last packet with payload on the filter PID, -1 if none yet
+    int mLastContinuityCounter = -1;
+    std::atomic<uint64_t> mContinuityErrors = 0;
+    std::atomic<uint64_t> mCrcErrors = 0;
+
+    // The section being reassembled, starting from its table_id
     vector<int8_t> mSectionOutput;
 
-    // temp handle single PES filter
-    // TODO handle mulptiple Pes filters
+    // The PES packet being reassembled. mPesPacketLength is its full size, or 0 if unbounded.
+    size_t mPesPacketLength = 0;
+    // PES payload left to read by the media filter handler
     uint32_t mPesSizeLeft = 0;
     vector<int8_t> mPesOutput;
 
-    // A map from data id to ion handle
-    std::map<uint64_t, int> mDataId2Avfd;
+    // A pre-mapped AV buffer. Allocations are carved out of it in order and the whole buffer
+    // is recycled once the client has released every one of them.
+    struct AvBuffer {
+        native_handle_t* handle;
+        uint8_t* address;
+        size_t used;
+        int outstanding;
+    };
+    // An AV memory handed to the client, either from the pool or a dedicated buffer
+    struct AvAllocation {
+        int bufferIndex;  // -1 for a dedicated buffer
+        int fd;           // dedicated buffer fd, -1 for a pooled allocation
+    };
+    /**
+     * Lock to protect the AV buffer pool and the allocations handed out from it
+     */
+    std::mutex mAvBufferLock;
+    vector<AvBuffer> mAvBuffers;
+    // A map from data id to the AV memory allocation
+    std::map<uint64_t, AvAllocation> mAvAllocations;
     uint64_t mLastUsedDataId = 1;
     int mAvBufferCopyCount = 0;
-
-    // Shared A/V memory handle
+    // AV memory statistics since the filter was created
+    int64_t mAvStatsStartNs = 0;
+    std::atomic<uint64_t> mAvAllocCount = 0;
+    std::atomic<uint64_t> mAvMapCount = 0;
+    std::atomic<uint64_t> mPooledAvEventCount = 0;
+
+    // Shared A/V memory handle, mapped once on the first use. The handle, its mapping and the
+    // offset are guarded by mAvBufferLock.
     native_handle_t* mSharedAvMemHandle = nullptr;
+    uint8_t* mSharedAvMemAddress = nullptr;
     bool mUsingSharedAvMem = false;
     int64_t mSharedAvMemOffset = 0;
+    // A region of the shared A/V memory handed to the client in a media event
+    struct SharedAvRegion {
+        int64_t offset;
+        size_t size;
+    };
+    // A map from data id to the shared A/V memory region the client has not released yet. The
+    // regions must not be overwritten, guarded by mAvBufferLock.
+    std::map<uint64_t, SharedAvRegion> mSharedAvRegions;
+    // Media events dropped because the shared A/V memory was full of unreleased regions
+    std::atomic<uint64_t> mSharedAvOverflowCount = 0;
 
     uint32_t mAudioStreamType;
     uint32_t mVideoStreamType;
@@ -294,6 +420,16 @@ class Filter : public BnFilter {
 
     PlaybackStatus mIptvDvrPlaybackStatus;
     std::atomic<int> mFilterCount = 0;
+
+    /**
+     * Input bytes copied straight into the filter FMQ, input bytes staged in the output
+     * buffers before being processed, and input bytes dropped because the FMQ was full.
+     */
+    std::atomic<uint64_t> mDirectWriteBytes = 0;
+    std::atomic<uint64_t> mStagedBytes = 0;
+    std::atomic<uint64_t> mDroppedBytes = 0;
+    std::atomic<uint64_t> mRecordFlushCount = 0;
+    std::atomic<uint64_t> mRecordIndexEventCount = 0;
 };
 
 }  // namespace tuner
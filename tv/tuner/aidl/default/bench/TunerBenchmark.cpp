@@ -0,0 +1,486 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "android.hardware.tv.tuner-service.example-Benchmark"
+
+#include <aidl/android/hardware/tv/tuner/BnFilterCallback.h>
+#include <aidl/android/hardware/tv/tuner/DemuxTsIndex.h>
+#include <benchmark/benchmark.h>
+#include <log/log.h>
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "Demux.h"
+#include "Dvr.h"
+#include "Filter.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace tv {
+namespace tuner {
+
+namespace {
+
+// Packets routed per iteration, about what one read of a playback FMQ hands to the demux
+constexpr size_t kPacketsPerIteration = 1024;
+// Large enough for a filter to take all the packets of an iteration
+constexpr int32_t kFilterBufferSize = kPacketsPerIteration * TS_SIZE;
+constexpr int32_t kFirstPid = 0x100;
+// Room for a read of every size measured, plus half a packet
+constexpr int32_t kPlaybackBufferSize = (kPacketsPerIteration + 1) * TS_SIZE - TS_SIZE / 2;
+// An ES playback buffer of about a second of 30 fps video and its audio
+constexpr uint32_t kVideoFrames = 30;
+constexpr uint32_t kVideoFrameSize = 32 * 1024;
+constexpr uint32_t kAudioFrames = 2 * kVideoFrames;
+constexpr uint32_t kAudioFrameSize = 1024;
+constexpr int32_t kEsPlaybackBufferSize = 2 * 1024 * 1024;
+// The media events are only released with their filters, which bounds the iterations
+constexpr int64_t kEsIterations = 1000;
+constexpr int32_t kRecordBufferSize = 4 * kPacketsPerIteration * TS_SIZE;
+// As for the media events, the record events are only released with their filter
+constexpr int64_t kRecordIterations = 1000;
+
+class NoopFilterCallback : public BnFilterCallback {
+  public:
+    ::ndk::ScopedAStatus onFilterEvent(const vector<DemuxFilterEvent>& /* events */) override {
+        return ::ndk::ScopedAStatus::ok();
+    }
+
+    ::ndk::ScopedAStatus onFilterStatus(DemuxFilterStatus /* status */) override {
+        return ::ndk::ScopedAStatus::ok();
+    }
+};
+
+// Writes a TS packet carrying the payload, padded with stuffing bytes
+void writeTsPacket(int8_t* packet, int32_t pid, bool payloadUnitStart, uint8_t continuityCounter,
+                   const int8_t* payload, size_t size) {
+    LOG_ALWAYS_FATAL_IF(size > TS_SIZE - 4, "payload of %zu bytes does not fit a TS packet", size);
+    packet[0] = 0x47;
+    packet[1] = static_cast<int8_t>((payloadUnitStart ? 0x40 : 0) | ((pid >> 8) & 0x1f));
+    packet[2] = static_cast<int8_t>(pid & 0xff);
+    // Payload only
+    packet[3] = static_cast<int8_t>(0x10 | (continuityCounter & 0x0f));
+    memcpy(packet + 4, payload, size);
+    memset(packet + 4 + size, 0xff, TS_SIZE - 4 - size);
+}
+
+// CRC-32/MPEG-2 of the data, as ISO/IEC 13818-1 Annex A defines for the CRC_32 of a section
+uint32_t crc32Mpeg2(const int8_t* data, size_t size) {
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= static_cast<uint32_t>(static_cast<uint8_t>(data[i])) << 24;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// Appends a long form EIT section of the size, ending with its CRC_32
+void appendEitSection(std::vector<int8_t>& sections, size_t size, uint8_t sectionNumber) {
+    LOG_ALWAYS_FATAL_IF(size < 12 || size > 4096, "invalid section size %zu", size);
+    size_t start = sections.size();
+    sections.resize(start + size, 0x5a);
+    int8_t* section = sections.data() + start;
+    size_t sectionLength = size - 3;
+    section[0] = 0x4e;
+    section[1] = static_cast<int8_t>(0xb0 | ((sectionLength >> 8) & 0x0f));
+    section[2] = static_cast<int8_t>(sectionLength & 0xff);
+    // version_number 1, current_next_indicator set
+    section[5] = static_cast<int8_t>(0xc3);
+    section[6] = static_cast<int8_t>(sectionNumber);
+    section[7] = static_cast<int8_t>(0xff);
+    uint32_t crc = crc32Mpeg2(section, size - 4);
+    for (int i = 0; i < 4; i++) {
+        section[size - 4 + i] = static_cast<int8_t>(crc >> (24 - 8 * i));
+    }
+}
+
+// Splits back to back sections into TS packets, setting the pointer_field of the packets in
+// which a section starts. Sections are cut at the end of the last packet.
+std::vector<int8_t> packetizeSections(const std::vector<int8_t>& sections, size_t sectionSize,
+                                      int32_t pid, size_t numPackets) {
+    std::vector<int8_t> stream(numPackets * TS_SIZE);
+    int8_t payload[TS_SIZE - 4];
+    size_t position = 0;
+    for (size_t i = 0; i < numPackets; i++) {
+        size_t nextSection = (position + sectionSize - 1) / sectionSize * sectionSize;
+        bool payloadUnitStart = nextSection - position < sizeof(payload) - 1;
+        size_t size = 0;
+        if (payloadUnitStart) {
+            payload[size++] = static_cast<int8_t>(nextSection - position);
+        }
+        size_t count = min(sizeof(payload) - size, sections.size() - position);
+        memcpy(payload + size, sections.data() + position, count);
+        position += count;
+        writeTsPacket(stream.data() + i * TS_SIZE, pid, payloadUnitStart,
+                      static_cast<uint8_t>(i), payload, size + count);
+    }
+    return stream;
+}
+
+// Builds an ES playback buffer with binary meta data, interleaving two audio frames with each
+// video frame
+std::vector<int8_t> makeBinaryEsBuffer(int32_t videoPid, int32_t audioPid) {
+    EsBinaryMetaHeader header = {
+            .magic = ES_BINARY_META_MAGIC,
+            .version = ES_BINARY_META_VERSION,
+            .frameCount = kVideoFrames + kAudioFrames,
+            .videoEsDataSize = kVideoFrames * kVideoFrameSize,
+            .audioEsDataSize = kAudioFrames * kAudioFrameSize,
+            .videoPid = static_cast<uint32_t>(videoPid),
+            .audioPid = static_cast<uint32_t>(audioPid),
+    };
+    size_t metaDataSize = sizeof(header) + header.frameCount * sizeof(EsBinaryMetaFrame);
+    std::vector<int8_t> buffer(metaDataSize + header.videoEsDataSize + header.audioEsDataSize,
+                               0x5a);
+    memcpy(buffer.data(), &header, sizeof(header));
+    int8_t* entry = buffer.data() + sizeof(header);
+    for (uint32_t i = 0; i < kVideoFrames; i++) {
+        // 90 kHz PTS at 30 fps
+        int64_t pts = i * 3000;
+        EsBinaryMetaFrame frames[] = {
+                {.flags = 0, .len = kVideoFrameSize, .pts = pts},
+                {.flags = ES_BINARY_META_FLAG_AUDIO, .len = kAudioFrameSize, .pts = pts},
+                {.flags = ES_BINARY_META_FLAG_AUDIO, .len = kAudioFrameSize, .pts = pts + 1500},
+        };
+        memcpy(entry, frames, sizeof(frames));
+        entry += sizeof(frames);
+    }
+    return buffer;
+}
+
+// Opens a TS filter on the PID and adds it to the PID index. The filter is not started, so no
+// event thread or test events get in the way of the measurements.
+std::shared_ptr<Filter> openTsFilter(const std::shared_ptr<Demux>& demux,
+                                     DemuxTsFilterType tsFilterType, int32_t pid,
+                                     const DemuxTsFilterSettingsFilterSettings& filterSettings) {
+    DemuxFilterType type;
+    type.mainType = DemuxFilterMainType::TS;
+    type.subType.set<DemuxFilterSubType::Tag::tsFilterType>(tsFilterType);
+    std::shared_ptr<IFilter> filter;
+    LOG_ALWAYS_FATAL_IF(!demux->openFilter(type, kFilterBufferSize,
+                                           ::ndk::SharedRefBase::make<NoopFilterCallback>(),
+                                           &filter)
+                                 .isOk(),
+                        "failed to open filter");
+
+    DemuxTsFilterSettings tsSettings{.tpid = pid, .filterSettings = filterSettings};
+    DemuxFilterSettings settings;
+    settings.set<DemuxFilterSettings::Tag::ts>(tsSettings);
+    LOG_ALWAYS_FATAL_IF(!filter->configure(settings).isOk(), "failed to configure filter");
+
+    int64_t filterId;
+    filter->getId64Bit(&filterId);
+    demux->setFilterStarted(filterId, true);
+    return std::static_pointer_cast<Filter>(filter);
+}
+
+// Measures the routing of TS packets to the raw TS filters listening on their PIDs. Half of the
+// PIDs in the stream have no filter. The argument is the number of filters.
+void BM_RouteTsPackets(benchmark::State& state) {
+    const int32_t numFilters = static_cast<int32_t>(state.range(0));
+    std::shared_ptr<Demux> demux = ::ndk::SharedRefBase::make<Demux>(0, 0);
+    std::vector<std::shared_ptr<Filter>> filters;
+    for (int32_t i = 0; i < numFilters; i++) {
+        filters.push_back(openTsFilter(
+                demux, DemuxTsFilterType::TS, kFirstPid + i,
+                DemuxTsFilterSettingsFilterSettings::make<
+                        DemuxTsFilterSettingsFilterSettings::Tag::noinit>(true)));
+    }
+
+    std::vector<int8_t> stream(kPacketsPerIteration * TS_SIZE);
+    const int8_t payload[TS_SIZE - 4] = {};
+    for (size_t i = 0; i < kPacketsPerIteration; i++) {
+        int32_t pid = kFirstPid + static_cast<int32_t>(i % (2 * numFilters));
+        writeTsPacket(stream.data() + i * TS_SIZE, pid, false,
+                      static_cast<uint8_t>(i / (2 * numFilters)), payload, sizeof(payload));
+    }
+
+    for (auto _ : state) {
+        demux->startBroadcastTsFilter(stream.data(), kPacketsPerIteration, TS_SIZE);
+
+        // Read the filter FMQs, as the client would, so that the next packets fit
+        state.PauseTiming();
+        for (const std::shared_ptr<Filter>& filter : filters) {
+            filter->flush();
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * kPacketsPerIteration);
+    state.SetBytesProcessed(state.iterations() * kPacketsPerIteration * TS_SIZE);
+
+    for (const std::shared_ptr<Filter>& filter : filters) {
+        filter->close();
+    }
+    demux->close();
+}
+
+// Measures reading TS packets from the playback DVR FMQ and routing them to a raw TS filter. The
+// ring is not a whole number of packets long, so reads regularly find a packet wrapping around its
+// end. The argument is the number of packets per read.
+void BM_ReadPlaybackFmq(benchmark::State& state) {
+    const size_t packetsPerRead = static_cast<size_t>(state.range(0));
+    std::shared_ptr<Demux> demux = ::ndk::SharedRefBase::make<Demux>(0, 0);
+    std::shared_ptr<IDvr> dvr;
+    LOG_ALWAYS_FATAL_IF(!demux->openDvr(DvrType::PLAYBACK, kPlaybackBufferSize,
+                                        ::ndk::SharedRefBase::make<DvrPlaybackCallback>(), &dvr)
+                                 .isOk(),
+                        "failed to open DVR");
+    PlaybackSettings playbackSettings{.dataFormat = DataFormat::TS, .packetSize = TS_SIZE};
+    LOG_ALWAYS_FATAL_IF(
+            !dvr->configure(DvrSettings::make<DvrSettings::Tag::playback>(playbackSettings))
+                     .isOk(),
+            "failed to configure DVR");
+    MQDescriptor<int8_t, SynchronizedReadWrite> desc;
+    dvr->getQueueDesc(&desc);
+    // The client side of the FMQ
+    DvrMQ playbackMQ(desc, false /* resetPointers */);
+    std::shared_ptr<Filter> filter = openTsFilter(
+            demux, DemuxTsFilterType::TS, kFirstPid,
+            DemuxTsFilterSettingsFilterSettings::make<
+                    DemuxTsFilterSettingsFilterSettings::Tag::noinit>(true));
+
+    std::vector<int8_t> stream(packetsPerRead * TS_SIZE);
+    const int8_t payload[TS_SIZE - 4] = {};
+    for (size_t i = 0; i < packetsPerRead; i++) {
+        writeTsPacket(stream.data() + i * TS_SIZE, kFirstPid, false, static_cast<uint8_t>(i),
+                      payload, sizeof(payload));
+    }
+
+    std::shared_ptr<Dvr> playback = std::static_pointer_cast<Dvr>(dvr);
+    for (auto _ : state) {
+        state.PauseTiming();
+        LOG_ALWAYS_FATAL_IF(!playbackMQ.write(stream.data(), stream.size()),
+                            "failed to write the playback FMQ");
+        state.ResumeTiming();
+
+        LOG_ALWAYS_FATAL_IF(!playback->readPlaybackFMQ(true /*isVirtualFrontend*/,
+                                                       false /*isRecording*/),
+                            "failed to read the playback FMQ");
+
+        state.PauseTiming();
+        filter->flush();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * packetsPerRead);
+    state.SetBytesProcessed(state.iterations() * packetsPerRead * TS_SIZE);
+
+    filter->close();
+    dvr->close();
+    demux->close();
+}
+
+// Measures reassembling EIT sections from TS packets in a section filter, which checks their
+// CRC_32 if asked to. The arguments are the section size and whether the CRC_32 is checked.
+void BM_ReassembleSections(benchmark::State& state) {
+    const size_t sectionSize = static_cast<size_t>(state.range(0));
+    DemuxFilterSectionSettings sectionSettings{.isCheckCrc = state.range(1) != 0};
+    const auto filterSettings = DemuxTsFilterSettingsFilterSettings::make<
+            DemuxTsFilterSettingsFilterSettings::Tag::section>(sectionSettings);
+    std::shared_ptr<Demux> demux = ::ndk::SharedRefBase::make<Demux>(0, 0);
+
+    std::vector<int8_t> sections;
+    for (size_t i = 0; sections.size() < kPacketsPerIteration * (TS_SIZE - 4); i++) {
+        appendEitSection(sections, sectionSize, static_cast<uint8_t>(i));
+    }
+    std::vector<int8_t> stream =
+            packetizeSections(sections, sectionSize, kFirstPid, kPacketsPerIteration);
+
+    std::shared_ptr<Filter> filter;
+    for (auto _ : state) {
+        // A fresh filter for each iteration, as the section events are only released with it
+        state.PauseTiming();
+        if (filter != nullptr) {
+            filter->close();
+        }
+        filter = openTsFilter(demux, DemuxTsFilterType::SECTION, kFirstPid, filterSettings);
+        state.ResumeTiming();
+
+        demux->startBroadcastTsFilter(stream.data(), kPacketsPerIteration, TS_SIZE);
+    }
+    state.SetItemsProcessed(state.iterations() * (kPacketsPerIteration * (TS_SIZE - 4) /
+                                                  sectionSize));
+    state.SetBytesProcessed(state.iterations() * kPacketsPerIteration * TS_SIZE);
+
+    if (filter != nullptr) {
+        filter->close();
+    }
+    demux->close();
+}
+
+// Measures parsing ES playback buffers and dispatching their frames to an audio and a video
+// filter, which copy them to their shared AV memory. The argument is whether the audio and video
+// have their own PIDs, which lets them be dispatched in parallel.
+void BM_DispatchEsFrames(benchmark::State& state) {
+    const bool separatePids = state.range(0) != 0;
+    const int32_t videoPid = kFirstPid;
+    const int32_t audioPid = separatePids ? kFirstPid + 1 : kFirstPid;
+    std::shared_ptr<Demux> demux = ::ndk::SharedRefBase::make<Demux>(0, 0);
+    std::shared_ptr<IDvr> dvr;
+    LOG_ALWAYS_FATAL_IF(!demux->openDvr(DvrType::PLAYBACK, kEsPlaybackBufferSize,
+                                        ::ndk::SharedRefBase::make<DvrPlaybackCallback>(), &dvr)
+                                 .isOk(),
+                        "failed to open DVR");
+    PlaybackSettings playbackSettings{.dataFormat = DataFormat::ES};
+    LOG_ALWAYS_FATAL_IF(
+            !dvr->configure(DvrSettings::make<DvrSettings::Tag::playback>(playbackSettings))
+                     .isOk(),
+            "failed to configure DVR");
+    MQDescriptor<int8_t, SynchronizedReadWrite> desc;
+    dvr->getQueueDesc(&desc);
+    DvrMQ playbackMQ(desc, false /* resetPointers */);
+
+    // Opened after the DVR, which then dispatches to them
+    const auto avSettings = DemuxTsFilterSettingsFilterSettings::make<
+            DemuxTsFilterSettingsFilterSettings::Tag::av>(DemuxFilterAvSettings{});
+    std::vector<std::shared_ptr<Filter>> filters = {
+            openTsFilter(demux, DemuxTsFilterType::VIDEO, videoPid, avSettings),
+            openTsFilter(demux, DemuxTsFilterType::AUDIO, audioPid, avSettings),
+    };
+    for (const std::shared_ptr<Filter>& filter : filters) {
+        NativeHandle avMemory;
+        int64_t avMemorySize;
+        LOG_ALWAYS_FATAL_IF(!filter->getAvSharedHandle(&avMemory, &avMemorySize).isOk(),
+                            "failed to get the shared AV memory");
+    }
+
+    std::vector<int8_t> buffer = makeBinaryEsBuffer(videoPid, audioPid);
+    std::shared_ptr<Dvr> playback = std::static_pointer_cast<Dvr>(dvr);
+    // Each filter numbers its media events from 1
+    std::vector<int64_t> nextDataIds(filters.size(), 1);
+    for (auto _ : state) {
+        state.PauseTiming();
+        // Release the frames of the last iteration, as the client does, so that the shared AV
+        // memory does not fill up and drop frames
+        for (size_t i = 0; i < filters.size(); i++) {
+            while (filters[i]->releaseAvHandle(NativeHandle(), nextDataIds[i]).isOk()) {
+                nextDataIds[i]++;
+            }
+        }
+        LOG_ALWAYS_FATAL_IF(!playbackMQ.write(buffer.data(), buffer.size()),
+                            "failed to write the playback FMQ");
+        state.ResumeTiming();
+
+        LOG_ALWAYS_FATAL_IF(!playback->processEsDataOnPlayback(true /*isVirtualFrontend*/,
+                                                               false /*isRecording*/),
+                            "failed to process the ES playback buffer");
+    }
+    state.SetItemsProcessed(state.iterations() * (kVideoFrames + kAudioFrames));
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+
+    for (const std::shared_ptr<Filter>& filter : filters) {
+        filter->close();
+    }
+    dvr->close();
+    demux->close();
+}
+
+// Measures recording a stream through a record filter, which stages the input and flushes it
+// to the record DVR FMQ, read by the client between iterations. One in 16 packets starts a PES
+// packet. The argument is whether the filter indexes the packets.
+void BM_RecordTsPackets(benchmark::State& state) {
+    int32_t tsIndexMask = 0;
+    if (state.range(0) != 0) {
+        tsIndexMask = static_cast<int32_t>(DemuxTsIndex::FIRST_PACKET) |
+                      static_cast<int32_t>(DemuxTsIndex::PAYLOAD_UNIT_START_INDICATOR);
+    }
+    std::shared_ptr<Demux> demux = ::ndk::SharedRefBase::make<Demux>(0, 0);
+    std::shared_ptr<IDvr> dvr;
+    LOG_ALWAYS_FATAL_IF(!demux->openDvr(DvrType::RECORD, kRecordBufferSize,
+                                        ::ndk::SharedRefBase::make<DvrPlaybackCallback>(), &dvr)
+                                 .isOk(),
+                        "failed to open DVR");
+    RecordSettings recordSettings{
+            .lowThreshold = kRecordBufferSize / 10,
+            .highThreshold = kRecordBufferSize * 9 / 10,
+            .dataFormat = DataFormat::TS,
+            .packetSize = TS_SIZE,
+    };
+    LOG_ALWAYS_FATAL_IF(
+            !dvr->configure(DvrSettings::make<DvrSettings::Tag::record>(recordSettings)).isOk(),
+            "failed to configure DVR");
+    MQDescriptor<int8_t, SynchronizedReadWrite> desc;
+    dvr->getQueueDesc(&desc);
+    DvrMQ recordMQ(desc, false /* resetPointers */);
+
+    DemuxFilterRecordSettings filterRecordSettings{.tsIndexMask = tsIndexMask};
+    std::shared_ptr<Filter> filter = openTsFilter(
+            demux, DemuxTsFilterType::RECORD, kFirstPid,
+            DemuxTsFilterSettingsFilterSettings::make<
+                    DemuxTsFilterSettingsFilterSettings::Tag::record>(filterRecordSettings));
+    LOG_ALWAYS_FATAL_IF(!dvr->attachFilter(filter).isOk() || !dvr->start().isOk(),
+                        "failed to start recording");
+
+    std::vector<int8_t> stream(kPacketsPerIteration * TS_SIZE);
+    const int8_t payload[TS_SIZE - 4] = {};
+    for (size_t i = 0; i < kPacketsPerIteration; i++) {
+        writeTsPacket(stream.data() + i * TS_SIZE, kFirstPid, i % 16 == 0,
+                      static_cast<uint8_t>(i), payload, sizeof(payload));
+    }
+
+    std::vector<int8_t> recorded(kRecordBufferSize);
+    for (auto _ : state) {
+        demux->sendFrontendInputToRecord(stream.data(), stream.size());
+        LOG_ALWAYS_FATAL_IF(!demux->startRecordFilterDispatcher(),
+                            "failed to flush the record output");
+
+        state.PauseTiming();
+        LOG_ALWAYS_FATAL_IF(!recordMQ.read(recorded.data(), recordMQ.availableToRead()),
+                            "failed to read the record FMQ");
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * kPacketsPerIteration);
+    state.SetBytesProcessed(state.iterations() * kPacketsPerIteration * TS_SIZE);
+
+    filter->close();
+    dvr->close();
+    demux->close();
+}
+
+BENCHMARK(BM_RouteTsPackets)->ArgName("filters")->Arg(1)->Arg(8)->Arg(64);
+BENCHMARK(BM_ReadPlaybackFmq)->ArgName("packets")->Arg(16)->Arg(256)->Arg(1024);
+BENCHMARK(BM_ReassembleSections)
+        ->ArgNames({"section_bytes", "check_crc"})
+        ->Args({64, 0})
+        ->Args({64, 1})
+        ->Args({1024, 0})
+        ->Args({1024, 1})
+        ->Args({4096, 0})
+        ->Args({4096, 1});
+BENCHMARK(BM_DispatchEsFrames)
+        ->ArgName("separate_pids")
+        ->Arg(0)
+        ->Arg(1)
+        ->Iterations(kEsIterations);
+BENCHMARK(BM_RecordTsPackets)
+        ->ArgName("ts_index")
+        ->Arg(0)
+        ->Arg(1)
+        ->Iterations(kRecordIterations);
+
+}  // namespace
+
+}  // namespace tuner
+}  // namespace tv
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
+
+BENCHMARK_MAIN();
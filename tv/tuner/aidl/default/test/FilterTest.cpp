@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <aidl/android/hardware/tv/tuner/BnFilterCallback.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Demux.h"
+#include "Filter.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace tv {
+namespace tuner {
+
+namespace {
+
+using ::testing::HasSubstr;
+
+constexpr int32_t kPid = 0x100;
+constexpr int32_t kFilterBufferSize = 64 * 1024;
+constexpr size_t kPayloadSize = TS_SIZE - 4;
+
+class NoopFilterCallback : public BnFilterCallback {
+  public:
+    ::ndk::ScopedAStatus onFilterEvent(const vector<DemuxFilterEvent>& /* events */) override {
+        return ::ndk::ScopedAStatus::ok();
+    }
+
+    ::ndk::ScopedAStatus onFilterStatus(DemuxFilterStatus /* status */) override {
+        return ::ndk::ScopedAStatus::ok();
+    }
+};
+
+std::vector<int8_t> concat(std::initializer_list<std::vector<int8_t>> parts) {
+    std::vector<int8_t> result;
+    for (const std::vector<int8_t>& part : parts) {
+        result.insert(result.end(), part.begin(), part.end());
+    }
+    return result;
+}
+
+std::vector<int8_t> slice(const std::vector<int8_t>& data, size_t start, size_t end) {
+    return std::vector<int8_t>(data.begin() + start, data.begin() + end);
+}
+
+// A TS packet on kPid carrying the payload, padded with stuffing bytes
+std::vector<int8_t> makeTsPacket(bool payloadUnitStart, uint8_t continuityCounter,
+                                 const std::vector<int8_t>& payload) {
+    EXPECT_LE(payload.size(), kPayloadSize);
+    std::vector<int8_t> packet(TS_SIZE, static_cast<int8_t>(0xff));
+    packet[0] = 0x47;
+    packet[1] = static_cast<int8_t>((payloadUnitStart ? 0x40 : 0) | ((kPid >> 8) & 0x1f));
+    packet[2] = static_cast<int8_t>(kPid & 0xff);
+    // Payload only
+    packet[3] = static_cast<int8_t>(0x10 | (continuityCounter & 0x0f));
+    memcpy(packet.data() + 4, payload.data(), payload.size());
+    return packet;
+}
+
+uint32_t crc32Mpeg2(const int8_t* data, size_t size) {
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= static_cast<uint32_t>(static_cast<uint8_t>(data[i])) << 24;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// A long form section of the size, ending with its CRC_32
+std::vector<int8_t> makeSection(uint8_t tableId, size_t size) {
+    std::vector<int8_t> section(size);
+    size_t sectionLength = size - 3;
+    section[0] = static_cast<int8_t>(tableId);
+    section[1] = static_cast<int8_t>(0xb0 | ((sectionLength >> 8) & 0x0f));
+    section[2] = static_cast<int8_t>(sectionLength & 0xff);
+    // version_number 1, current_next_indicator set
+    section[5] = static_cast<int8_t>(0xc3);
+    for (size_t i = 8; i < size - 4; i++) {
+        section[i] = static_cast<int8_t>(i);
+    }
+    uint32_t crc = crc32Mpeg2(section.data(), size - 4);
+    for (int i = 0; i < 4; i++) {
+        section[size - 4 + i] = static_cast<int8_t>(crc >> (24 - 8 * i));
+    }
+    return section;
+}
+
+// A PES packet of the stream with PES_packet_length set to size - 6, or to 0 if unbounded
+std::vector<int8_t> makePesPacket(size_t size, bool unbounded) {
+    std::vector<int8_t> pes(size);
+    pes[2] = 0x01;
+    pes[3] = static_cast<int8_t>(0xe0);
+    size_t pesPacketLength = unbounded ? 0 : size - 6;
+    pes[4] = static_cast<int8_t>(pesPacketLength >> 8);
+    pes[5] = static_cast<int8_t>(pesPacketLength & 0xff);
+    for (size_t i = 6; i < size; i++) {
+        pes[i] = static_cast<int8_t>(i);
+    }
+    return pes;
+}
+
+}  // namespace
+
+// Feeds crafted TS packets to a section or PES filter through the demux, and checks what the
+// filter writes to its FMQ.
+class FilterTest : public ::testing::Test {
+  protected:
+    void SetUp() override { mDemux = ::ndk::SharedRefBase::make<Demux>(0, 0); }
+
+    void TearDown() override {
+        if (mFilter != nullptr) {
+            mFilter->close();
+        }
+        mDemux->close();
+    }
+
+    void openFilter(DemuxTsFilterType tsFilterType,
+                    const DemuxTsFilterSettingsFilterSettings& filterSettings) {
+        DemuxFilterType type;
+        type.mainType = DemuxFilterMainType::TS;
+        type.subType.set<DemuxFilterSubType::Tag::tsFilterType>(tsFilterType);
+        std::shared_ptr<IFilter> filter;
+        ASSERT_TRUE(mDemux->openFilter(type, kFilterBufferSize,
+                                       ::ndk::SharedRefBase::make<NoopFilterCallback>(), &filter)
+                            .isOk());
+        mFilter = std::static_pointer_cast<Filter>(filter);
+
+        DemuxTsFilterSettings tsSettings{.tpid = kPid, .filterSettings = filterSettings};
+        DemuxFilterSettings settings;
+        settings.set<DemuxFilterSettings::Tag::ts>(tsSettings);
+        ASSERT_TRUE(mFilter->configure(settings).isOk());
+
+        MQDescriptor<int8_t, SynchronizedReadWrite> desc;
+        ASSERT_TRUE(mFilter->getQueueDesc(&desc).isOk());
+        mFilterMQ = std::make_unique<FilterMQ>(desc, false /* resetPointers */);
+        ASSERT_TRUE(mFilterMQ->isValid());
+
+        // Route the packets to the filter without starting it, which would send test events
+        int64_t filterId;
+        ASSERT_TRUE(mFilter->getId64Bit(&filterId).isOk());
+        mDemux->setFilterStarted(filterId, true);
+    }
+
+    void openSectionFilter(bool isCheckCrc) {
+        DemuxFilterSectionSettings sectionSettings{.isCheckCrc = isCheckCrc};
+        openFilter(DemuxTsFilterType::SECTION,
+                   DemuxTsFilterSettingsFilterSettings::make<
+                           DemuxTsFilterSettingsFilterSettings::Tag::section>(sectionSettings));
+    }
+
+    void openPesFilter() {
+        openFilter(DemuxTsFilterType::PES,
+                   DemuxTsFilterSettingsFilterSettings::make<
+                           DemuxTsFilterSettingsFilterSettings::Tag::pesData>(
+                           DemuxFilterPesDataSettings{}));
+    }
+
+    void openVideoFilter() {
+        openFilter(DemuxTsFilterType::VIDEO,
+                   DemuxTsFilterSettingsFilterSettings::make<
+                           DemuxTsFilterSettingsFilterSettings::Tag::av>(DemuxFilterAvSettings{}));
+    }
+
+    // Sends an ES frame to the media filter, as the DVR does in ES playback
+    void sendEsFrame(const std::vector<int8_t>& frame) {
+        mFilter->updateFilterOutput(frame.data(), frame.size());
+        mFilter->updatePts(1);
+        ASSERT_TRUE(mFilter->startFilterHandler().isOk());
+    }
+
+    void send(std::initializer_list<std::vector<int8_t>> packets) {
+        std::vector<int8_t> stream = concat(packets);
+        mDemux->startBroadcastTsFilter(stream.data(), stream.size() / TS_SIZE, TS_SIZE);
+    }
+
+    std::vector<int8_t> readOutput() {
+        std::vector<int8_t> output(mFilterMQ->availableToRead());
+        EXPECT_TRUE(mFilterMQ->read(output.data(), output.size()));
+        return output;
+    }
+
+    std::string dumpFilter() {
+        int fds[2];
+        EXPECT_EQ(0, pipe(fds));
+        mFilter->dump(fds[1], nullptr, 0);
+        ::close(fds[1]);
+        std::string dump;
+        char buffer[256];
+        ssize_t size;
+        while ((size = read(fds[0], buffer, sizeof(buffer))) > 0) {
+            dump.append(buffer, size);
+        }
+        ::close(fds[0]);
+        return dump;
+    }
+
+    std::shared_ptr<Demux> mDemux;
+    std::shared_ptr<Filter> mFilter;
+    std::unique_ptr<FilterMQ> mFilterMQ;
+};
+
+TEST_F(FilterTest, SectionWithBadCrcIsDropped) {
+    openSectionFilter(true /* isCheckCrc */);
+    std::vector<int8_t> good = makeSection(0x4e, 40);
+    std::vector<int8_t> bad = makeSection(0x4e, 40);
+    bad[20] ^= 0x01;
+
+    send({makeTsPacket(true, 0, concat({{0}, good, bad}))});
+
+    EXPECT_EQ(good, readOutput());
+    EXPECT_THAT(dumpFilter(), HasSubstr("CRC errors: 1\n"));
+}
+
+TEST_F(FilterTest, SectionCrcIsNotCheckedUnlessAsked) {
+    openSectionFilter(false /* isCheckCrc */);
+    std::vector<int8_t> good = makeSection(0x4e, 40);
+    std::vector<int8_t> bad = makeSection(0x4e, 40);
+    bad[20] ^= 0x01;
+
+    send({makeTsPacket(true, 0, concat({{0}, good, bad}))});
+
+    EXPECT_EQ(concat({good, bad}), readOutput());
+}
+
+TEST_F(FilterTest, PointerFieldCompletesPendingSection) {
+    openSectionFilter(true /* isCheckCrc */);
+    std::vector<int8_t> first = makeSection(0x4e, 300);
+    std::vector<int8_t> second = makeSection(0x4f, 40);
+    size_t firstPart = kPayloadSize - 1;
+    std::vector<int8_t> pointerField = {static_cast<int8_t>(first.size() - firstPart)};
+
+    send({makeTsPacket(true, 0, concat({{0}, slice(first, 0, firstPart)})),
+          makeTsPacket(true, 1,
+                       concat({pointerField, slice(first, firstPart, first.size()), second}))});
+
+    EXPECT_EQ(concat({first, second}), readOutput());
+}
+
+TEST_F(FilterTest, PointerFieldBeyondPayloadDropsPendingSection) {
+    openSectionFilter(true /* isCheckCrc */);
+    std::vector<int8_t> first = makeSection(0x4e, 300);
+    std::vector<int8_t> second = makeSection(0x4f, 40);
+    size_t firstPart = kPayloadSize - 1;
+    std::vector<int8_t> payload(kPayloadSize, static_cast<int8_t>(0xff));
+    payload[0] = static_cast<int8_t>(kPayloadSize);
+
+    send({makeTsPacket(true, 0, concat({{0}, slice(first, 0, firstPart)})),
+          makeTsPacket(true, 1, payload), makeTsPacket(true, 2, concat({{0}, second}))});
+
+    EXPECT_EQ(second, readOutput());
+}
+
+TEST_F(FilterTest, ContinuityErrorDropsPendingSection) {
+    openSectionFilter(true /* isCheckCrc */);
+    std::vector<int8_t> first = makeSection(0x4e, 500);
+    std::vector<int8_t> second = makeSection(0x4f, 40);
+    size_t firstPart = kPayloadSize - 1;
+    size_t secondPart = firstPart + kPayloadSize;
+
+    // The packet with continuity_counter 1 is lost
+    send({makeTsPacket(true, 0, concat({{0}, slice(first, 0, firstPart)})),
+          makeTsPacket(false, 2, slice(first, secondPart, first.size())),
+          makeTsPacket(true, 3, concat({{0}, second}))});
+
+    EXPECT_EQ(second, readOutput());
+    EXPECT_THAT(dumpFilter(), HasSubstr("Continuity errors: 1\n"));
+}
+
+TEST_F(FilterTest, DuplicatePacketIsIgnored) {
+    openSectionFilter(true /* isCheckCrc */);
+    std::vector<int8_t> section = makeSection(0x4e, 500);
+    size_t firstPart = kPayloadSize - 1;
+    size_t secondPart = firstPart + kPayloadSize;
+    std::vector<int8_t> middle = makeTsPacket(false, 1, slice(section, firstPart, secondPart));
+
+    send({makeTsPacket(true, 0, concat({{0}, slice(section, 0, firstPart)})), middle, middle,
+          makeTsPacket(false, 2, slice(section, secondPart, section.size()))});
+
+    EXPECT_EQ(section, readOutput());
+    EXPECT_THAT(dumpFilter(), HasSubstr("Continuity errors: 0\n"));
+}
+
+TEST_F(FilterTest, PesPacketEndsAtItsLength) {
+    openPesFilter();
+    std::vector<int8_t> pes = makePesPacket(406, false /* unbounded */);
+
+    // The last packet is padded with stuffing bytes past the end of the PES packet
+    send({makeTsPacket(true, 0, slice(pes, 0, kPayloadSize)),
+          makeTsPacket(false, 1, slice(pes, kPayloadSize, 2 * kPayloadSize)),
+          makeTsPacket(false, 2, slice(pes, 2 * kPayloadSize, pes.size()))});
+
+    EXPECT_EQ(pes, readOutput());
+}
+
+TEST_F(FilterTest, UnboundedPesPacketEndsAtNextPayloadUnitStart) {
+    openPesFilter();
+    std::vector<int8_t> pes = makePesPacket(2 * kPayloadSize, true /* unbounded */);
+    std::vector<int8_t> next = makePesPacket(kPayloadSize, true /* unbounded */);
+
+    send({makeTsPacket(true, 0, slice(pes, 0, kPayloadSize)),
+          makeTsPacket(false, 1, slice(pes, kPayloadSize, pes.size()))});
+    EXPECT_TRUE(readOutput().empty());
+
+    send({makeTsPacket(true, 2, next)});
+    EXPECT_EQ(pes, readOutput());
+}
+
+TEST_F(FilterTest, SharedAvMemoryDropsFrameInsteadOfOverwritingUnreleasedOne) {
+    openVideoFilter();
+    NativeHandle avMemory;
+    int64_t avMemorySize;
+    ASSERT_TRUE(mFilter->getAvSharedHandle(&avMemory, &avMemorySize).isOk());
+    // Two frames fit in the shared memory, a third one would wrap around onto the first
+    std::vector<int8_t> frame(avMemorySize * 3 / 8, 0x5a);
+
+    sendEsFrame(frame);
+    sendEsFrame(frame);
+    sendEsFrame(frame);
+    EXPECT_THAT(dumpFilter(), HasSubstr("Outstanding shared AV regions: 2, overflow drops: 1\n"));
+
+    // Once the client releases the first frame, its region is reused
+    EXPECT_TRUE(mFilter->releaseAvHandle(NativeHandle(), 1).isOk());
+    sendEsFrame(frame);
+    EXPECT_THAT(dumpFilter(), HasSubstr("Outstanding shared AV regions: 2, overflow drops: 1\n"));
+    EXPECT_FALSE(mFilter->releaseAvHandle(NativeHandle(), 1).isOk());
+    EXPECT_TRUE(mFilter->releaseAvHandle(NativeHandle(), 2).isOk());
+    EXPECT_TRUE(mFilter->releaseAvHandle(NativeHandle(), 3).isOk());
+}
+
+}  // namespace tuner
+}  // namespace tv
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl